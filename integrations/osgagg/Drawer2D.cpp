@@ -1,5 +1,6 @@
 #include <agg_arc.h>
 #include <agg_arrowhead.h>
+#include <agg_bounding_rect.h>
 #include <agg_rounded_rect.h>
 #include <agg_ellipse.h>
 #include <agg_conv_bspline.h>
@@ -18,10 +19,74 @@
 #include <agg_span_interpolator_linear.h>
 #include <agg_image_accessors.h>
 #include <agg_scanline_p.h>
-#include <util/agg_color_conv_rgb8.h>
-#include <util/agg_color_conv_rgb16.h>
+#include <agg_scanline_storage_aa.h>
+#include <agg_blur.h>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
+#include <OpenThreads/ScopedLock>
+#include <cstring>
+#include "PixelConverter.h"
+#include "ImageEffects.h"
 #include "Drawer2D.h"
 
+/* DeferredCommand */
+
+/** A draw command recorded in deferred mode, with its outline already flattened and transformed */
+struct DeferredCommand
+{
+    enum Type { CLEAR, PIXELS, FILL, SCANLINES, IMAGE };
+    
+    DeferredCommand( Type t, bool aa )
+    :   type(t), imageWidth(0), imageHeight(0), imageStride(0), antiAlias(aa) {}
+    
+    Type type;
+    agg::path_storage path;          // FILL, IMAGE: the outline to rasterize
+    std::vector<agg::int8u> data;    // SCANLINES: serialized glyph covers; IMAGE: copy of the pixels
+    agg::trans_affine imageMatrix;   // IMAGE: inverted image matrix
+    agg::rgba8 color;
+    agg::rect_i clipBox, bounds;     // Clip box of the renderer, and pixels which may be changed
+    int imageWidth, imageHeight, imageStride;
+    bool antiAlias;
+};
+
+/** Read-only vertex source of a recorded path, so that several threads may rasterize it together */
+struct DeferredPathSource
+{
+    DeferredPathSource( const agg::path_storage& p ) : path(p), index(0) {}
+    void rewind( unsigned ) { index = 0; }
+    
+    unsigned vertex( double* x, double* y )
+    {
+        if ( index>=path.total_vertices() ) return agg::path_cmd_stop;
+        return path.vertex( index++, x, y );
+    }
+    
+    const agg::path_storage& path;
+    unsigned index;
+};
+
+/** Move a rasterizer to the first scanline of a tile, other scanline sources are swept from the top */
+inline bool skipToRow( agg::rasterizer_scanline_aa<>& rasterizer, int y )
+{ return y<=rasterizer.min_y() || rasterizer.navigate_scanline(y); }
+
+template<typename SourceType>
+inline bool skipToRow( SourceType&, int ) { return true; }
+
+/** Same as agg::render_scanlines(), but only render scanlines within [y1, y2] */
+template<typename SourceType, typename ScanlineType, typename RendererType>
+void renderRows( SourceType& source, ScanlineType& scanline, RendererType& renderer, int y1, int y2 )
+{
+    if ( !source.rewind_scanlines() || !skipToRow(source, y1) ) return;
+    scanline.reset( source.min_x(), source.max_x() );
+    renderer.prepare();
+    while ( source.sweep_scanline(scanline) )
+    {
+        if ( scanline.y()<y1 ) continue;
+        if ( scanline.y()>y2 ) break;
+        renderer.render( scanline );
+    }
+}
+
 /* DrawAdapter */
 
 template<typename PixelFormat, typename SpanGeneratorType>
@@ -32,6 +97,8 @@ public:
     typedef agg::renderer_scanline_aa_solid< agg::renderer_base<PixelFormat> > RendererType;
     typedef agg::span_interpolator_linear<> InterpolatorType;
     typedef agg::image_accessor_clone<PixelFormat> ImageAccessorType;
+    typedef agg::span_allocator<typename RendererBaseType::color_type> AllocatorType;
+    typedef agg::renderer_scanline_aa<RendererBaseType, AllocatorType, SpanGeneratorType> ImageRendererType;
     
     DrawAdapter( AggDrawer* d=0 ) : AggDrawer::DrawAdapterBase(d)
     {
@@ -39,10 +106,15 @@ public:
         rasterizer.clip_box( 0.0, 0.0, d->s(), d->t() );
     }
     
+    virtual ~DrawAdapter()
+    {
+        discardCommands();
+    }
+    
     virtual void setAntiAlias( bool flag )
     {
-        if ( flag ) rasterizer.gamma( agg::gamma_linear() );
-        else rasterizer.gamma( agg::gamma_threshold(0.5) );
+        antiAlias = flag;
+        setGamma( rasterizer, flag );
     }
     
     virtual void clear( const agg::rgba8& color, bool resetClipBox )
@@ -54,12 +126,23 @@ public:
         }
         
         if ( resetClipBox ) drawer->clip( 0, 0, drawer->s() - 1, drawer->t() - 1 );
+        if ( !checkNotRecording("Clearing") ) return;
+        if ( drawer->getDeferred() )
+        {
+            // Clearing always fills the whole buffer, as agg::renderer_base::clear() does
+            DeferredCommand* command = createCommand( DeferredCommand::CLEAR, color );
+            command->clipBox = agg::rect_i(0, 0, drawer->s() - 1, drawer->t() - 1);
+            addCommand( command, agg::rect_i(0, 0, drawer->s() - 1, drawer->t() - 1) );
+            return;
+        }
+        
         PixelFormat pixelFormat( *(drawer->getRenderBuffer()) );
         RendererBaseType rendererBase( pixelFormat );
         
         const agg::rect_i& rect = drawer->getClipBox();
         rendererBase.clip_box( rect.x1, rect.y1, rect.x2, rect.y2 );
         rendererBase.clear( color );
+        drawer->addDirtyRect( agg::rect_i(0, 0, drawer->s() - 1, drawer->t() - 1) );
     }
     
     virtual void drawPixels( int x0, int y0, int x1, int y1, const agg::rgba8& color )
@@ -70,6 +153,15 @@ public:
             return;
         }
         
+        if ( !checkNotRecording("Drawing pixels") ) return;
+        if ( drawer->getDeferred() )
+        {
+            if ( y1<=y0 ) return;
+            DeferredCommand* command = createCommand( DeferredCommand::PIXELS, color );
+            addCommand( command, agg::rect_i(osg::minimum(x0, x1), y0, osg::maximum(x0, x1), y1 - 1) );
+            return;
+        }
+        
         PixelFormat pixelFormat( *(drawer->getRenderBuffer()) );
         RendererBaseType rendererBase( pixelFormat );
         
@@ -79,6 +171,7 @@ public:
         {
             rendererBase.copy_hline( x0, y, x1, color );
         }
+        if ( y1>y0 ) damage( osg::minimum(x0, x1), y0, osg::maximum(x0, x1), y1 - 1 );
     }
     
     virtual void drawData( agg::path_storage& canvas, agg::trans_affine& matrix, agg::rendering_buffer& data )
@@ -89,18 +182,38 @@ public:
             return;
         }
         
-        PixelFormat pixelFormat( *(drawer->getRenderBuffer()) );
-        RendererBaseType rendererBase( pixelFormat );
-        
-        const agg::rect_i& rect = drawer->getClipBox();
-        rendererBase.clip_box( rect.x1, rect.y1, rect.x2, rect.y2 );
-        
         agg::trans_affine imageMatrix;
         if ( drawer->getTransform() ) imageMatrix = *(drawer->getTransform());
         imageMatrix *= matrix;
         imageMatrix.invert();
         
-        typedef agg::span_allocator<RendererBaseType::color_type> AllocatorType;
+        if ( !checkNotRecording("Drawing images") ) return;
+        agg::conv_contour<agg::path_storage> converter( canvas );
+        if ( drawer->getDeferred() )
+        {
+            // Keep a copy of the pixels, which may be released before flushing
+            DeferredCommand* command = createCommand( DeferredCommand::IMAGE, agg::rgba8(0, 0, 0, 0) );
+            command->path.concat_path( converter );
+            command->imageMatrix = imageMatrix;
+            command->imageWidth = data.width();
+            command->imageHeight = data.height();
+            command->imageStride = data.stride_abs();
+            command->data.resize( command->imageStride * command->imageHeight );
+            if ( !command->data.empty() )
+            {
+                agg::rendering_buffer copy( &(command->data[0]), command->imageWidth,
+                                            command->imageHeight, command->imageStride );
+                copy.copy_from( data );
+            }
+            addPathCommand( command );
+            return;
+        }
+        
+        PixelFormat pixelFormat( *(drawer->getRenderBuffer()) );
+        RendererBaseType rendererBase( pixelFormat );
+        
+        const agg::rect_i& rect = drawer->getClipBox();
+        rendererBase.clip_box( rect.x1, rect.y1, rect.x2, rect.y2 );
         AllocatorType allocator;
 
         PixelFormat pixelFormatOfData( data );
@@ -109,9 +222,9 @@ public:
         SpanGeneratorType generator( imageAccessor, interpolator );
         
         rasterizer.reset();
-        agg::conv_contour<agg::path_storage> converter( canvas );
         rasterizer.add_path( converter );
         agg::render_scanlines_aa( rasterizer, scanline, rendererBase, allocator, generator );
+        damage( rasterizer.min_x(), rasterizer.min_y(), rasterizer.max_x(), rasterizer.max_y() );
     }
     
     virtual void drawPath( agg::path_storage& path, bool usePen, bool useBrush )
@@ -129,66 +242,69 @@ public:
         const agg::rect_i& rect = drawer->getClipBox();
         rendererBase.clip_box( rect.x1, rect.y1, rect.x2, rect.y2 );
         
-        agg::path_storage* realPath = NULL;
         if ( drawer->getTransform() )
         {
-            realPath = new agg::path_storage;
-            agg::conv_transform<agg::path_storage, agg::trans_affine> converter(
+            agg::conv_transform<agg::path_storage, agg::trans_affine> transformed(
                 path, *(drawer->getTransform()) );
-            realPath->concat_path( converter );
+            drawOutline( transformed, usePen, useBrush, renderer );
         }
         else
-            realPath = &path;
-        
-        AggDrawer::Pen& pen = drawer->getPen();
-        AggDrawer::Brush& brush = drawer->getBrush();
-        if ( useBrush && brush.enabled )
+            drawOutline( path, usePen, useBrush, renderer );
+    }
+    
+    virtual void drawDisplayList( const AggDrawer::DisplayList& list, double dx, double dy, const agg::rgba8* color )
+    {
+        if ( !drawer->getRenderBuffer() )
         {
-            agg::conv_contour<agg::path_storage> contour( *realPath );
-            contour.auto_detect_orientation( true );
-            if ( usePen && pen.enabled ) contour.width( pen.width/2.0 );
-            else contour.width( 0.5 );
-            
-            rasterizer.reset();
-            rasterizer.add_path( contour );
-            renderer.color( brush.color );
-            agg::render_scanlines( rasterizer, scanline, renderer );
+            OSG_NOTICE << "[AggDrawer] The rendering buffer is not allocated" << std::endl;
+            return;
         }
         
-        if ( usePen && pen.enabled )
+        PixelFormat pixelFormat( *(drawer->getRenderBuffer()) );
+        RendererBaseType rendererBase( pixelFormat );
+        RendererType renderer( rendererBase );
+        
+        const agg::rect_i& rect = drawer->getClipBox();
+        rendererBase.clip_box( rect.x1, rect.y1, rect.x2, rect.y2 );
+        
+        // Recorded covers can be moved by whole pixels, other offsets need rasterizing again
+        bool wholePixels = (dx==floor(dx) && dy==floor(dy));
+        bool lastAntiAlias = antiAlias;
+        for ( unsigned int i=0; i<list.size(); ++i )
         {
-            rasterizer.reset();
-            if ( pen.dashStyle.size()>0 )
+            const AggDrawer::DisplayList::Item& item = list.getItem(i);
+            if ( item.antiAlias!=antiAlias ) setAntiAlias( item.antiAlias );
+            
+            const agg::rgba8& itemColor = color ? *color : item.color;
+            if ( wholePixels || !item.path.total_vertices() )
             {
-                agg::conv_dash<agg::path_storage> dash( *realPath );
-                for ( unsigned int i=0; i<pen.dashStyle.size()-1; i+=2 )
-                    dash.add_dash( pen.dashStyle[i]*pen.width, pen.dashStyle[i+1]*pen.width );
-                
-                agg::conv_stroke< agg::conv_dash<agg::path_storage> > stroke( dash );
-                stroke.width( pen.width );
-                rasterizer.add_path( stroke );
+                if ( item.covers.empty() ) continue;
+                agg::serialized_scanlines_adaptor_aa8 source( &(item.covers[0]), item.covers.size(), dx, dy );
+                agg::serialized_scanlines_adaptor_aa8::embedded_scanline sl;
+                fillScanlines( source, sl, itemColor, renderer );
             }
             else
             {
-                agg::conv_stroke<agg::path_storage> stroke( *realPath );
-                stroke.width( pen.width );
-                rasterizer.add_path( stroke );
+                DeferredPathSource source( item.path );
+                agg::trans_affine_translation offset( dx, dy );
+                agg::conv_transform<DeferredPathSource> transformed( source, offset );
+                fillPath( transformed, itemColor, renderer );
             }
-            renderer.color( pen.color );
-            agg::render_scanlines( rasterizer, scanline, renderer );
         }
-        if ( drawer->getTransform() ) delete realPath;
+        if ( lastAntiAlias!=antiAlias ) setAntiAlias( lastAntiAlias );
     }
     
     virtual void drawText( float x, float y, const wchar_t* text )
     {
-        AggDrawer::Font& font = drawer->getFont();
         if ( !drawer->getRenderBuffer() )
         {
             OSG_NOTICE << "[AggDrawer] The rendering buffer is not allocated" << std::endl;
             return;
         }
         
+        osg::ref_ptr<AggFontCache::TextRun> run = getTextRun( text );
+        if ( !run ) return;
+        
         PixelFormat pixelFormat( *(drawer->getRenderBuffer()) );
         RendererBaseType rendererBase( pixelFormat );
         RendererType renderer( rendererBase );
@@ -196,127 +312,626 @@ public:
         const agg::rect_i& rect = drawer->getClipBox();
         rendererBase.clip_box( rect.x1, rect.y1, rect.x2, rect.y2 );
         
-        typedef agg::conv_curve<AggDrawer::Font::ManagerType::path_adaptor_type> CurveType;
-        CurveType curves( font.manager->path_adaptor() );
+        AggFontCache::Gray8AdaptorType gray8Adaptor;
+        AggFontCache::Gray8ScanlineType gray8Scanline;
+        AggFontCache::PathAdaptorType pathAdaptor;
+        typedef agg::conv_curve<AggFontCache::PathAdaptorType> CurveType;
+        CurveType curves( pathAdaptor );
         curves.approximation_scale( 1.0f );
         
-        if ( font.dirty )
-        {
-            // Reload font if necessary
-            updateFont( font );
-            font.dirty = false;
-        }
-        
-        if ( !font.engine->num_faces() ) return;
-        font.engine->hinting( true );
-        font.engine->flip_y( drawer->getFlipped() );
-        font.engine->width( font.width );
-        font.engine->height( font.height );
-        
         // Start rendering the text
-        renderer.color( drawer->getPen().color );
-        const wchar_t* ptr = text;
-        double px = x, py = y;
-        while ( *ptr )
+        const agg::rgba8& color = drawer->getPen().color;
+        for ( unsigned int i=0; i<run->glyphs.size(); ++i )
         {
-            const agg::glyph_cache* glyph = font.manager->glyph( (unsigned int)*ptr );
-            if ( glyph )
+            const AggFontCache::Glyph& glyph = *(run->glyphs[i]);
+            if ( glyph.data.empty() ) continue;
+            
+            double px = x + run->positions[i].x(), py = y + run->positions[i].y();
+            switch ( glyph.type )
             {
-                font.manager->add_kerning( &px, &py );
-                font.manager->init_embedded_adaptors( glyph, px, py );
-                
-                switch ( glyph->data_type )
+            case agg::glyph_data_gray8:
+                gray8Adaptor.init( &(glyph.data[0]), glyph.data.size(), px, py );
+                fillScanlines( gray8Adaptor, gray8Scanline, color, renderer );
+                break;
+            case agg::glyph_data_outline:
+                pathAdaptor.init( &(glyph.data[0]), glyph.data.size(), px, py );
+                if ( drawer->getTransform() )
                 {
-                case agg::glyph_data_gray8:
-                    agg::render_scanlines(
-                        font.manager->gray8_adaptor(), font.manager->gray8_scanline(), renderer );
-                    break;
-                case agg::glyph_data_outline:
-                    rasterizer.reset();
-                    if ( drawer->getTransform() )
-                    {
-                        agg::conv_transform<CurveType, agg::trans_affine> converter(
-                            curves, *(drawer->getTransform()) );
-                        rasterizer.add_path( converter );
-                    }
-                    else
-                        rasterizer.add_path( curves );
-                    agg::render_scanlines( rasterizer, scanline, renderer );
-                    break;
-                default: break;
+                    agg::conv_transform<CurveType, agg::trans_affine> converter(
+                        curves, *(drawer->getTransform()) );
+                    fillPath( converter, color, renderer );
                 }
-                px += glyph->advance_x;
-                py += glyph->advance_y;
+                else
+                    fillPath( curves, color, renderer );
+                break;
+            default: break;
             }
-            ptr++;
         }
     }
     
-    void measureText( float x, float y, const wchar_t* text, float& w, float& h )
+    void measureText( const wchar_t* text, float& w, float& h )
     {
         AggDrawer::Font& font = drawer->getFont();
-        if ( font.dirty )
+        osg::ref_ptr<AggFontCache::TextRun> run = getTextRun( text );
+        if ( !run ) return;
+        
+        w = run->advanceX; if ( w==0.0f ) w = font.width;
+        h = run->advanceY; if ( h==0.0f ) h = font.height;
+    }
+    
+    virtual void flush( AggWorkerPool* workers, int tileSize )
+    {
+        if ( commands.empty() ) return;
+        if ( !drawer->getRenderBuffer() )
         {
-            // Reload font if necessary
-            updateFont( font );
-            font.dirty = false;
+            OSG_NOTICE << "[AggDrawer] The rendering buffer is not allocated" << std::endl;
+            discardCommands();
+            return;
         }
         
-        if ( !font.engine->num_faces() ) return;
-        font.engine->hinting( true );
-        font.engine->flip_y( drawer->getFlipped() );
-        font.engine->width( font.width );
-        font.engine->height( font.height );
+        // Bin commands by the tiles they may change, keeping the order of recording in each tile
+        int w = drawer->s(), h = drawer->t();
+        if ( tileSize<16 ) tileSize = 16;
+        int tilesX = (w + tileSize - 1) / tileSize, tilesY = (h + tileSize - 1) / tileSize;
+        tiles.resize( tilesX * tilesY );
+        for ( int y=0; y<tilesY; ++y )
+        {
+            for ( int x=0; x<tilesX; ++x )
+            {
+                Tile& tile = tiles[y * tilesX + x];
+                tile.rect = agg::rect_i(x * tileSize, y * tileSize, osg::minimum((x + 1) * tileSize, w) - 1,
+                                        osg::minimum((y + 1) * tileSize, h) - 1);
+                tile.commands.clear();
+            }
+        }
         
-        // Start measuring text
-        const wchar_t* ptr = text;
-        double px = x, py = y;
-        while ( *ptr )
+        for ( unsigned int i=0; i<commands.size(); ++i )
         {
-            const agg::glyph_cache* glyph = font.manager->glyph( (unsigned int)*ptr );
-            if ( glyph )
+            const agg::rect_i& bounds = commands[i]->bounds;
+            for ( int y=bounds.y1 / tileSize; y<=bounds.y2 / tileSize; ++y )
             {
-                font.manager->add_kerning( &px, &py );
-                font.manager->init_embedded_adaptors( glyph, px, py );
-                px += glyph->advance_x;
-                py += glyph->advance_y;
+                for ( int x=bounds.x1 / tileSize; x<=bounds.x2 / tileSize; ++x )
+                    tiles[y * tilesX + x].commands.push_back( i );
             }
-            ptr++;
         }
-        w = px - x; if ( w==0.0f ) w = font.width;
-        h = py - y; if ( h==0.0f ) h = font.height;
+        
+        // Tiles don't share any pixel, so they can be rasterized by any worker in any order
+        nextTile.exchange( 0 );
+        if ( workers && tiles.size()>1 )
+        {
+            TileTask task( this );
+            workers->run( &task );
+        }
+        else
+            renderTiles();
+        
+        // Report changes only now that they are really in the buffer
+        for ( unsigned int i=0; i<commands.size(); ++i )
+            drawer->addDirtyRect( commands[i]->bounds );
+        discardCommands();
     }
     
 protected:
-    void updateFont( AggDrawer::Font& font )
+    struct Tile
+    {
+        agg::rect_i rect;
+        std::vector<unsigned int> commands;
+    };
+    
+    struct TileTask : public AggWorkerPool::Task
     {
-        bool fontLoaded = false;
-        switch ( font.drawMode )
+        TileTask( DrawAdapter* a ) : adapter(a) {}
+        virtual void run( int ) { adapter->renderTiles(); }
+        DrawAdapter* adapter;
+    };
+    
+    static void setGamma( agg::rasterizer_scanline_aa<>& ras, bool antiAlias )
+    {
+        if ( antiAlias ) ras.gamma( agg::gamma_linear() );
+        else ras.gamma( agg::gamma_threshold(0.5) );
+    }
+    
+    /** Fill the contour and stroke the outline of a path with current brush and pen */
+    template<typename VertexSource>
+    void drawOutline( VertexSource& path, bool usePen, bool useBrush, RendererType& renderer )
+    {
+        AggDrawer::Pen& pen = drawer->getPen();
+        AggDrawer::Brush& brush = drawer->getBrush();
+        if ( useBrush && brush.enabled )
         {
-        case AggDrawer::Font::GRAY_GRAPH:
-            fontLoaded = font.engine->load_font( font.file.c_str(), 0, agg::glyph_ren_native_gray8 );
-            break;
-        case AggDrawer::Font::OUTLINE_GRAPH:
-            fontLoaded = font.engine->load_font( font.file.c_str(), 0, agg::glyph_ren_outline );
-            break;
-        default:
-            break;
+            agg::conv_contour<VertexSource> contour( path );
+            contour.auto_detect_orientation( true );
+            if ( usePen && pen.enabled ) contour.width( pen.width/2.0 );
+            else contour.width( 0.5 );
+            fillPath( contour, brush.color, renderer );
+        }
+        
+        if ( usePen && pen.enabled )
+        {
+            if ( pen.dashStyle.size()>0 )
+            {
+                agg::conv_dash<VertexSource> dash( path );
+                for ( unsigned int i=0; i<pen.dashStyle.size()-1; i+=2 )
+                    dash.add_dash( pen.dashStyle[i]*pen.width, pen.dashStyle[i+1]*pen.width );
+                
+                agg::conv_stroke< agg::conv_dash<VertexSource> > stroke( dash );
+                stroke.width( pen.width );
+                fillPath( stroke, pen.color, renderer );
+            }
+            else
+            {
+                agg::conv_stroke<VertexSource> stroke( path );
+                stroke.width( pen.width );
+                fillPath( stroke, pen.color, renderer );
+            }
+        }
+    }
+    
+    /** Rasterize a path at once, or record it in deferred mode or into a display list */
+    template<typename VertexSource>
+    void fillPath( VertexSource& vs, const agg::rgba8& color, RendererType& renderer )
+    {
+        AggDrawer::DisplayList* list = drawer->getRecordingList();
+        if ( list )
+        {
+            // Keep the flattened outline and its covers, computed without clipping
+            AggDrawer::DisplayList::Item* item = list->addItem();
+            item->path.concat_path( vs );
+            item->color = color;
+            item->antiAlias = antiAlias;
+            
+            DeferredPathSource source( item->path );
+            setGamma( recordRasterizer, antiAlias );
+            recordRasterizer.reset();
+            recordRasterizer.add_path( source );
+            storeCovers( recordRasterizer, scanline, item->covers );
+            return;
+        }
+        
+        if ( drawer->getDeferred() )
+        {
+            DeferredCommand* command = createCommand( DeferredCommand::FILL, color );
+            command->path.concat_path( vs );
+            addPathCommand( command );
+            return;
+        }
+        
+        rasterizer.reset();
+        rasterizer.add_path( vs );
+        renderer.color( color );
+        agg::render_scanlines( rasterizer, scanline, renderer );
+        damage( rasterizer.min_x(), rasterizer.min_y(), rasterizer.max_x(), rasterizer.max_y() );
+    }
+    
+    /** Render a scanline source (e.g. a gray8 glyph) at once, or record it in deferred mode
+        or into a display list */
+    template<typename SourceType, typename ScanlineType>
+    void fillScanlines( SourceType& source, ScanlineType& sl, const agg::rgba8& color, RendererType& renderer )
+    {
+        AggDrawer::DisplayList* list = drawer->getRecordingList();
+        if ( list )
+        {
+            AggDrawer::DisplayList::Item* item = list->addItem();
+            item->color = color;
+            item->antiAlias = antiAlias;
+            storeCovers( source, sl, item->covers );
+            return;
+        }
+        
+        if ( drawer->getDeferred() )
+        {
+            std::vector<agg::int8u> covers;
+            agg::rect_i bounds = storeCovers( source, sl, covers );
+            if ( covers.empty() ) return;
+            
+            DeferredCommand* command = createCommand( DeferredCommand::SCANLINES, color );
+            command->data.swap( covers );
+            addCommand( command, bounds );
+            return;
+        }
+        
+        renderer.color( color );
+        agg::render_scanlines( source, sl, renderer );
+        damage( source.min_x(), source.min_y(), source.max_x(), source.max_y() );
+    }
+    
+    /** Serialize the covers of a scanline source and return their bounds */
+    template<typename SourceType, typename ScanlineType>
+    agg::rect_i storeCovers( SourceType& source, ScanlineType& sl, std::vector<agg::int8u>& covers )
+    {
+        agg::scanline_storage_aa8 storage;
+        agg::render_scanlines( source, sl, storage );
+        if ( !storage.rewind_scanlines() ) return agg::rect_i(0, 0, -1, -1);
+        
+        covers.resize( storage.byte_size() );
+        storage.serialize( &(covers[0]) );
+        return agg::rect_i(storage.min_x(), storage.min_y(), storage.max_x(), storage.max_y());
+    }
+    
+    DeferredCommand* createCommand( DeferredCommand::Type type, const agg::rgba8& color )
+    {
+        DeferredCommand* command = new DeferredCommand( type, antiAlias );
+        command->color = color;
+        command->clipBox = drawer->getClipBox();
+        return command;
+    }
+    
+    void addPathCommand( DeferredCommand* command )
+    {
+        double x1 = 0.0, y1 = 0.0, x2 = 0.0, y2 = 0.0;
+        if ( !agg::bounding_rect_single(command->path, 0, &x1, &y1, &x2, &y2) )
+        {
+            delete command;
+            return;
         }
         
-        if ( !fontLoaded )
+        // Anti-aliased edges may touch one more pixel on each side
+        addCommand( command, agg::rect_i((int)floor(x1) - 1, (int)floor(y1) - 1,
+                                         (int)ceil(x2) + 1, (int)ceil(y2) + 1) );
+    }
+    
+    bool checkNotRecording( const char* operation )
+    {
+        if ( !drawer->getRecordingList() ) return true;
+        OSG_NOTICE << "[AggDrawer] " << operation << " can't be recorded in a display list" << std::endl;
+        return false;
+    }
+    
+    /** Report pixels changed by immediate drawing, limited to the clip box */
+    void damage( int x1, int y1, int x2, int y2 )
+    {
+        agg::rect_i rect( x1, y1, x2, y2 );
+        if ( rect.clip(drawer->getClipBox()) ) drawer->addDirtyRect( rect );
+    }
+    
+    /** Queue the command if any of its pixels is inside the clip box and the image */
+    void addCommand( DeferredCommand* command, const agg::rect_i& bounds )
+    {
+        command->bounds = bounds;
+        if ( command->bounds.clip(command->clipBox) &&
+             command->bounds.clip(agg::rect_i(0, 0, drawer->s() - 1, drawer->t() - 1)) )
         {
-            OSG_NOTICE << "[AggDrawer] Unable to load font file " << font.file << std::endl;
+            commands.push_back( command );
+        }
+        else
+            delete command;
+    }
+    
+    void discardCommands()
+    {
+        for ( unsigned int i=0; i<commands.size(); ++i )
+            delete commands[i];
+        commands.clear();
+    }
+    
+    /** Rasterize tiles until no one is left, using a rasterizer and scanline of this thread */
+    void renderTiles()
+    {
+        agg::rasterizer_scanline_aa<> tileRasterizer;
+        agg::scanline_p8 tileScanline;
+        AllocatorType allocator;
+        tileRasterizer.clip_box( 0.0, 0.0, drawer->s(), drawer->t() );
+        bool tileAntiAlias = true;
+        setGamma( tileRasterizer, tileAntiAlias );
+        
+        PixelFormat pixelFormat( *(drawer->getRenderBuffer()) );
+        RendererBaseType rendererBase( pixelFormat );
+        RendererType renderer( rendererBase );
+        while ( true )
+        {
+            unsigned int index = ++nextTile - 1;
+            if ( index>=tiles.size() ) break;
+            
+            const Tile& tile = tiles[index];
+            for ( unsigned int i=0; i<tile.commands.size(); ++i )
+            {
+                const DeferredCommand& command = *commands[tile.commands[i]];
+                agg::rect_i clipBox = command.clipBox;
+                if ( !clipBox.clip(tile.rect) ) continue;
+                
+                rendererBase.clip_box( clipBox.x1, clipBox.y1, clipBox.x2, clipBox.y2 );
+                if ( command.antiAlias!=tileAntiAlias )
+                {
+                    tileAntiAlias = command.antiAlias;
+                    setGamma( tileRasterizer, tileAntiAlias );
+                }
+                
+                switch ( command.type )
+                {
+                case DeferredCommand::CLEAR:
+                    rendererBase.copy_bar( clipBox.x1, clipBox.y1, clipBox.x2, clipBox.y2, command.color );
+                    break;
+                case DeferredCommand::PIXELS:
+                    for ( int y=command.bounds.y1; y<=command.bounds.y2; ++y )
+                        rendererBase.copy_hline( command.bounds.x1, y, command.bounds.x2, command.color );
+                    break;
+                case DeferredCommand::FILL:
+                    {
+                        DeferredPathSource path( command.path );
+                        tileRasterizer.reset();
+                        tileRasterizer.add_path( path );
+                        renderer.color( command.color );
+                        renderRows( tileRasterizer, tileScanline, renderer, clipBox.y1, clipBox.y2 );
+                    }
+                    break;
+                case DeferredCommand::SCANLINES:
+                    {
+                        agg::serialized_scanlines_adaptor_aa8 source(
+                            &(command.data[0]), command.data.size(), 0.0, 0.0 );
+                        agg::serialized_scanlines_adaptor_aa8::embedded_scanline sl;
+                        renderer.color( command.color );
+                        renderRows( source, sl, renderer, clipBox.y1, clipBox.y2 );
+                    }
+                    break;
+                case DeferredCommand::IMAGE:
+                    {
+                        agg::rendering_buffer data( const_cast<agg::int8u*>(&(command.data[0])), command.imageWidth,
+                                                    command.imageHeight, command.imageStride );
+                        PixelFormat pixelFormatOfData( data );
+                        InterpolatorType interpolator( command.imageMatrix );
+                        ImageAccessorType imageAccessor( pixelFormatOfData );
+                        SpanGeneratorType generator( imageAccessor, interpolator );
+                        ImageRendererType imageRenderer( rendererBase, allocator, generator );
+                        
+                        DeferredPathSource path( command.path );
+                        tileRasterizer.reset();
+                        tileRasterizer.add_path( path );
+                        renderRows( tileRasterizer, tileScanline, imageRenderer, clipBox.y1, clipBox.y2 );
+                    }
+                    break;
+                default: break;
+                }
+            }
         }
     }
     
+    osg::ref_ptr<AggFontCache::TextRun> getTextRun( const wchar_t* text )
+    {
+        const AggDrawer::Font& font = drawer->getFont();
+        AggFontCache::FaceKey key( font.file, font.width, font.height,
+                                   font.drawMode==AggDrawer::Font::OUTLINE_GRAPH, drawer->getFlipped() );
+        return AggFontCache::instance()->getTextRun( key, text );
+    }
+    
     agg::rasterizer_scanline_aa<> rasterizer;
+    agg::rasterizer_scanline_aa<> recordRasterizer;
     agg::scanline_p8 scanline;
+    bool antiAlias;
+    
+    std::vector<DeferredCommand*> commands;
+    std::vector<Tile> tiles;
+    OpenThreads::Atomic nextTile;
 };
 
+/* AggFontCache */
+
+AggFontCache* AggFontCache::instance()
+{
+    static osg::ref_ptr<AggFontCache> s_instance = new AggFontCache;
+    return s_instance.get();
+}
+
+AggFontCache::AggFontCache()
+:   _selectedFace(NULL), _memoryBudget(8 * 1024 * 1024), _memoryUsage(0)
+{
+}
+
+osg::ref_ptr<AggFontCache::TextRun> AggFontCache::getTextRun( const FaceKey& key, const wchar_t* text )
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+    Face& face = _faces[key];
+    if ( face.failed )
+    {
+        // Try a missing font file again only once in a while, as it may be installed later
+        osg::Timer* timer = osg::Timer::instance();
+        if ( timer->delta_s(face.failedTick, timer->tick())<1.0 ) return NULL;
+        if ( !selectFace(key, face) ) return NULL;
+    }
+    
+    std::wstring str( text );
+    if ( str.empty() ) return new TextRun;
+    
+    std::map< std::wstring, std::pair<osg::ref_ptr<TextRun>, EntryList::iterator> >::iterator itr =
+        face.runs.find( str );
+    if ( itr!=face.runs.end() )
+    {
+        // Glyphs of a recently used run are recently used too, so they are not evicted before it
+        for ( unsigned int i=0; i<str.size(); ++i )
+        {
+            std::map< unsigned int, std::pair<osg::ref_ptr<Glyph>, EntryList::iterator> >::iterator gitr =
+                face.glyphs.find( (unsigned int)str[i] );
+            if ( gitr!=face.glyphs.end() ) _entries.splice( _entries.begin(), _entries, gitr->second.second );
+        }
+        _entries.splice( _entries.begin(), _entries, itr->second.second );
+        return itr->second.first;
+    }
+    
+    // Lay out the text with kerning, relative to its origin
+    osg::ref_ptr<TextRun> run = new TextRun;
+    double px = 0.0, py = 0.0;
+    Glyph* lastGlyph = NULL;
+    for ( unsigned int i=0; i<str.size(); ++i )
+    {
+        Glyph* glyph = getGlyph( key, face, (unsigned int)str[i] );
+        if ( face.failed ) return NULL;
+        if ( !glyph ) continue;
+        
+        if ( lastGlyph && selectFace(key, face) )
+            _engine.add_kerning( lastGlyph->index, glyph->index, &px, &py );
+        run->glyphs.push_back( glyph );
+        run->positions.push_back( osg::Vec2d(px, py) );
+        px += glyph->advanceX;
+        py += glyph->advanceY;
+        lastGlyph = glyph;
+    }
+    run->advanceX = px;
+    run->advanceY = py;
+    
+    unsigned int bytes = sizeof(TextRun) + str.size() * sizeof(wchar_t) +
+                         run->glyphs.size() * (sizeof(osg::ref_ptr<Glyph>) + sizeof(osg::Vec2d));
+    face.runs[str] = std::pair<osg::ref_ptr<TextRun>, EntryList::iterator>(
+        run, addEntry(&face, 0, str, bytes) );
+    evict();
+    return run;
+}
+
+void AggFontCache::setMemoryBudget( unsigned int bytes )
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+    _memoryBudget = bytes;
+    evict();
+}
+
+void AggFontCache::clear()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+    for ( std::map<FaceKey, Face>::iterator itr=_faces.begin(); itr!=_faces.end(); ++itr )
+    {
+        itr->second.glyphs.clear();
+        itr->second.runs.clear();
+    }
+    _entries.clear();
+    _memoryUsage = 0;
+}
+
+bool AggFontCache::selectFace( const FaceKey& key, Face& face )
+{
+    if ( _selectedFace==&face ) return true;
+    
+    // Faces already loaded by the engine are only looked up by name here
+    agg::glyph_rendering renderType = key.outline ? agg::glyph_ren_outline : agg::glyph_ren_native_gray8;
+    if ( !_engine.load_font(key.file.c_str(), 0, renderType) )
+    {
+        if ( !face.failed ) OSG_NOTICE << "[AggDrawer] Unable to load font file " << key.file << std::endl;
+        face.failed = true;
+        face.failedTick = osg::Timer::instance()->tick();
+        _selectedFace = NULL;
+        return false;
+    }
+    
+    face.failed = false;
+    _engine.hinting( true );
+    _engine.flip_y( key.flipped );
+    _engine.width( key.width );
+    _engine.height( key.height );
+    _selectedFace = &face;
+    return true;
+}
+
+AggFontCache::Glyph* AggFontCache::getGlyph( const FaceKey& key, Face& face, unsigned int code )
+{
+    std::map< unsigned int, std::pair<osg::ref_ptr<Glyph>, EntryList::iterator> >::iterator itr =
+        face.glyphs.find( code );
+    if ( itr!=face.glyphs.end() )
+    {
+        _entries.splice( _entries.begin(), _entries, itr->second.second );
+        return itr->second.first.get();
+    }
+    
+    if ( !selectFace(key, face) || !_engine.prepare_glyph(code) ) return NULL;
+    osg::ref_ptr<Glyph> glyph = new Glyph;
+    glyph->data.resize( _engine.data_size() );
+    if ( !glyph->data.empty() ) _engine.write_glyph_to( &(glyph->data[0]) );
+    glyph->type = _engine.data_type();
+    glyph->index = _engine.glyph_index();
+    glyph->advanceX = _engine.advance_x();
+    glyph->advanceY = _engine.advance_y();
+    
+    face.glyphs[code] = std::pair<osg::ref_ptr<Glyph>, EntryList::iterator>(
+        glyph, addEntry(&face, code, std::wstring(), sizeof(Glyph) + glyph->data.size()) );
+    return glyph.get();
+}
+
+AggFontCache::EntryList::iterator AggFontCache::addEntry( Face* face, unsigned int code,
+                                                          const std::wstring& text, unsigned int bytes )
+{
+    Entry entry;
+    entry.face = face;
+    entry.code = code;
+    entry.text = text;
+    entry.bytes = bytes;
+    entry.isRun = !text.empty();
+    _memoryUsage += bytes;
+    return _entries.insert( _entries.begin(), entry );
+}
+
+void AggFontCache::evict()
+{
+    // Glyphs and runs still used by drawers or other runs are released later with their owners
+    while ( _memoryUsage>_memoryBudget && _entries.size()>1 )
+    {
+        const Entry& entry = _entries.back();
+        if ( entry.isRun ) entry.face->runs.erase( entry.text );
+        else entry.face->glyphs.erase( entry.code );
+        _memoryUsage -= entry.bytes;
+        _entries.pop_back();
+    }
+}
+
+/* AggWorkerPool */
+
+void AggWorkerPool::WorkerThread::run()
+{
+    while ( true )
+    {
+        _pool->_startBarrier.block();
+        if ( _pool->_done ) break;
+        
+        _pool->_task->run( _index );
+        _pool->_endBarrier.block();
+    }
+}
+
+AggWorkerPool::AggWorkerPool( int numWorkers )
+:   _startBarrier(numWorkers>1 ? numWorkers : 1), _endBarrier(numWorkers>1 ? numWorkers : 1),
+    _task(NULL), _done(false)
+{
+    for ( int i=1; i<numWorkers; ++i )
+    {
+        WorkerThread* thread = new WorkerThread( this, i );
+        thread->start();
+        _threads.push_back( thread );
+    }
+}
+
+AggWorkerPool::~AggWorkerPool()
+{
+    if ( !_threads.empty() )
+    {
+        // Release all waiting threads with the quit flag set
+        _done = true;
+        _startBarrier.block();
+    }
+    
+    for ( unsigned int i=0; i<_threads.size(); ++i )
+    {
+        _threads[i]->join();
+        delete _threads[i];
+    }
+}
+
+void AggWorkerPool::run( Task* task )
+{
+    if ( !task ) return;
+    if ( _threads.empty() )
+    {
+        task->run( 0 );
+        return;
+    }
+    
+    _task = task;
+    _startBarrier.block();
+    task->run( 0 );
+    _endBarrier.block();
+    _task = NULL;
+}
+
 /* AggDrawer */
 
 AggDrawer::AggDrawer()
-:   _adapter(NULL), _renderBuffer(NULL), _transform(NULL), _flipped(false)
+:   _adapter(NULL), _renderBuffer(NULL), _transform(NULL),
+    _numThreads(OpenThreads::GetNumberOfProcessors()), _tileSize(256),
+    _dirtyRectRatio(1.5f), _maxDirtyRects(16), _flipped(false), _deferred(false)
 {
 }
 
@@ -332,7 +947,9 @@ AggDrawer::AggDrawer( const AggDrawer& copy, const osg::CopyOp& op )
     _renderBuffer(copy._renderBuffer), _transform(copy._transform),
     _clipBox(copy._clipBox), _lastLinePoint(copy._lastLinePoint),
     _pen(copy._pen), _brush(copy._brush), _font(copy._font),
-    _flipped(copy._flipped)
+    _numThreads(copy._numThreads), _tileSize(copy._tileSize),
+    _dirtyRects(copy._dirtyRects), _dirtyRectRatio(copy._dirtyRectRatio), _maxDirtyRects(copy._maxDirtyRects),
+    _flipped(copy._flipped), _deferred(copy._deferred)
 {
 }
 
@@ -419,6 +1036,9 @@ void AggDrawer::destroyRenderer()
     if ( _renderBuffer ) delete _renderBuffer;
     if ( _transform ) delete _transform;
     if ( _adapter ) delete _adapter;
+    _renderBuffer = NULL;
+    _transform = NULL;
+    _adapter = NULL;
 }
 
 #define CHECK_DRAWER() \
@@ -432,6 +1052,121 @@ void AggDrawer::setAntiAlias( bool flag )
     _adapter->setAntiAlias( flag );
 }
 
+void AggDrawer::addDirtyRect( const agg::rect_i& rect )
+{
+    agg::rect_i r = rect;
+    r.normalize();
+    if ( !r.clip(agg::rect_i(0, 0, s() - 1, t() - 1)) ) return;
+    if ( _flipped )
+    {
+        // Rows of the rendering buffer go downwards in a flipped image
+        int y1 = t() - 1 - r.y2;
+        r.y2 = t() - 1 - r.y1;
+        r.y1 = y1;
+    }
+    
+    // Merge with existing rectangles as long as the union doesn't waste too much area
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _dirtyRectMutex );
+    bool merged = true;
+    while ( merged )
+    {
+        merged = false;
+        for ( unsigned int i=0; i<_dirtyRects.size(); ++i )
+        {
+            const agg::rect_i& other = _dirtyRects[i];
+            agg::rect_i u( osg::minimum(r.x1, other.x1), osg::minimum(r.y1, other.y1),
+                           osg::maximum(r.x2, other.x2), osg::maximum(r.y2, other.y2) );
+            double areaR = (double)(r.x2 - r.x1 + 1) * (r.y2 - r.y1 + 1);
+            double areaOther = (double)(other.x2 - other.x1 + 1) * (other.y2 - other.y1 + 1);
+            if ( (double)(u.x2 - u.x1 + 1) * (u.y2 - u.y1 + 1)<=(areaR + areaOther) * _dirtyRectRatio )
+            {
+                r = u;
+                _dirtyRects.erase( _dirtyRects.begin() + i );
+                merged = true;
+                break;
+            }
+        }
+    }
+    _dirtyRects.push_back( r );
+    
+    if ( _dirtyRects.size()>_maxDirtyRects )
+    {
+        for ( unsigned int i=0; i<_dirtyRects.size()-1; ++i )
+        {
+            const agg::rect_i& other = _dirtyRects[i];
+            r = agg::rect_i( osg::minimum(r.x1, other.x1), osg::minimum(r.y1, other.y1),
+                             osg::maximum(r.x2, other.x2), osg::maximum(r.y2, other.y2) );
+        }
+        _dirtyRects.assign( 1, r );
+    }
+    dirty();
+}
+
+void AggDrawer::takeDirtyRects( std::vector<agg::rect_i>& rects )
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _dirtyRectMutex );
+    rects.clear();
+    rects.swap( _dirtyRects );
+}
+
+void AggDrawer::clearDirtyRects()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _dirtyRectMutex );
+    _dirtyRects.clear();
+}
+
+AggDrawer::DisplayList::~DisplayList()
+{
+    for ( unsigned int i=0; i<_items.size(); ++i )
+        delete _items[i];
+}
+
+void AggDrawer::beginDisplayList()
+{
+    if ( _recordingList.valid() )
+        OSG_NOTICE << "[AggDrawer] Last display list is not ended and will be discarded" << std::endl;
+    _recordingList = new DisplayList;
+}
+
+AggDrawer::DisplayList* AggDrawer::endDisplayList()
+{
+    return _recordingList.release();
+}
+
+void AggDrawer::drawDisplayList( const DisplayList* list, const osg::Vec2& offset )
+{
+    CHECK_DRAWER();
+    if ( list ) _adapter->drawDisplayList( *list, offset.x(), offset.y(), NULL );
+}
+
+void AggDrawer::drawDisplayList( const DisplayList* list, const osg::Vec2& offset, int r, int g, int b, int a )
+{
+    CHECK_DRAWER();
+    agg::rgba8 color(r, g, b, a);
+    if ( list ) _adapter->drawDisplayList( *list, offset.x(), offset.y(), &color );
+}
+
+void AggDrawer::setDeferred( bool b )
+{
+    if ( _deferred && !b ) flush();
+    _deferred = b;
+}
+
+void AggDrawer::flush()
+{
+    CHECK_DRAWER();
+    _adapter->flush( getWorkerPool(), _tileSize );
+}
+
+AggWorkerPool* AggDrawer::getWorkerPool()
+{
+    if ( _numThreads>1 && (!_workers || _workers->getNumWorkers()!=_numThreads) )
+        _workers = new AggWorkerPool( _numThreads );
+    else if ( _numThreads<=1 )
+        _workers = NULL;
+    return _workers.get();
+}
+
 void AggDrawer::clear( int r, int g, int b, int a, bool resetClipBox )
 {
     CHECK_DRAWER();
@@ -447,7 +1182,7 @@ void AggDrawer::drawPixels( const osg::Vec2& p0, const osg::Vec2& p1, int r, int
 void AggDrawer::drawImage( const osg::Vec4& src, const osg::Vec4& dst, osg::Image* image )
 {
     CHECK_DRAWER();
-    if ( !image ) return;
+    if ( !image || !image->data() ) return;
     if ( image->getDataType()!=getDataType() )
     {
         OSG_NOTICE << "[AggDrawer] The sub-image to be drawn does not have the same data type "
@@ -456,18 +1191,28 @@ void AggDrawer::drawImage( const osg::Vec4& src, const osg::Vec4& dst, osg::Imag
         return;
     }
     
-    int stride = 0, s = image->s(), t = image->t();
-    switch ( image->getPixelFormat() )
+    int stride = image->getRowSizeInBytes(), s = image->s(), t = image->t();
+    unsigned char* data = image->data();
+    if ( image->getPixelFormat()!=getPixelFormat() )
     {
-    case GL_ALPHA: case GL_LUMINANCE: case GL_INTENSITY: stride = s; break;
-    case GL_RGB: stride = s * 3; break;
-    case GL_RGBA: stride = s * 4; break;
-    default: break;
+        // Automatic pixel format conversion, done again only if the image is modified
+        const ConvertedImage* converted = getConvertedImage( image );
+        if ( !converted )
+        {
+            OSG_NOTICE << "[AggDrawer] The sub-image to be drawn does not have the same pixel format "
+                       << "with the target one. Automatic conversion is not supported either, "
+                       << "so we have to give up" << std::endl;
+            return;
+        }
+        data = const_cast<unsigned char*>( &(converted->data[0]) );
+        stride = s * PixelConverter::getNumComponents( getPixelFormat() );
     }
     
-    unsigned char* data = image->data();
-    agg::rendering_buffer imageBuffer( data, s, t, stride );
+    // Unscaled images at whole pixels are blended row by row, if nothing is transformed or recorded
+    if ( !_transform && !_deferred && !_recordingList.valid() && blitImage(src, dst, data, stride, s, t) )
+        return;
     
+    agg::rendering_buffer imageBuffer( data, s, t, stride );
     agg::path_storage canvas;
     canvas.move_to( dst.x(), dst.y() );
     canvas.line_to( dst.x() + dst.z(), dst.y() );
@@ -479,43 +1224,185 @@ void AggDrawer::drawImage( const osg::Vec4& src, const osg::Vec4& dst, osg::Imag
     imageMatrix.multiply( agg::trans_affine_translation(-src.x(), -src.y()) );
     imageMatrix.multiply( agg::trans_affine_scaling(dst.z() / src.z(), dst.w() / src.w()) );
     imageMatrix.multiply( agg::trans_affine_translation(dst.x(), dst.y()) );
+    _adapter->drawData( canvas, imageMatrix, imageBuffer );
+}
+
+const AggDrawer::ConvertedImage* AggDrawer::getConvertedImage( osg::Image* image )
+{
+    unsigned int numComponents = PixelConverter::getNumComponents( getPixelFormat() );
+    if ( !numComponents || !PixelConverter::getNumComponents(image->getPixelFormat()) ) return NULL;
     
-    if ( image->getPixelFormat()!=getPixelFormat() )
+    ConvertedImageMap::iterator itr = _convertedImages.find( image );
+    if ( itr!=_convertedImages.end() && itr->second.image.valid() &&
+         itr->second.modifiedCount==image->getModifiedCount() && itr->second.pixelFormat==getPixelFormat() )
     {
-        switch ( getPixelFormat() )
-        {
-        case GL_ALPHA: case GL_LUMINANCE: case GL_INTENSITY: stride = s; break;
-        case GL_RGB: stride = s * 3; break;
-        case GL_RGBA: stride = s * 4; break;
-        default: stride = 0; break;
-        }
-        agg::int8u* newData = new agg::int8u[t * stride];
-        agg::rendering_buffer newBuffer( newData, s, t, stride );
-        
-        // Automatic pixel format conversion
-        GLenum srcFormat = image->getPixelFormat();
-        GLenum dstFormat = getPixelFormat();
-        if ( srcFormat==GL_RGB && dstFormat==GL_RGBA )
+        return &(itr->second);
+    }
+    
+    if ( itr==_convertedImages.end() )
+    {
+        // Forget deleted images before adding a new one
+        for ( ConvertedImageMap::iterator citr=_convertedImages.begin(); citr!=_convertedImages.end(); )
         {
-            agg::color_conv( &newBuffer, &imageBuffer, agg::color_conv_rgb24_to_rgba32() );
+            if ( !citr->second.image.valid() ) _convertedImages.erase( citr++ );
+            else ++citr;
         }
-        else if ( srcFormat==GL_RGBA && dstFormat==GL_RGB )
+        if ( _convertedImages.size()>=16 ) _convertedImages.erase( _convertedImages.begin() );
+        itr = _convertedImages.insert( ConvertedImageMap::value_type(image, ConvertedImage()) ).first;
+    }
+    
+    ConvertedImage& converted = itr->second;
+    converted.image = image;
+    converted.modifiedCount = image->getModifiedCount();
+    converted.pixelFormat = getPixelFormat();
+    
+    int stride = image->s() * numComponents;
+    converted.data.resize( stride * image->t() );
+    for ( int r=0; r<image->t(); ++r )
+    {
+        PixelConverter::convertRow( image->data(0, r), image->getPixelFormat(),
+                                    &(converted.data[r * stride]), getPixelFormat(), image->s() );
+    }
+    return &converted;
+}
+
+bool AggDrawer::blitImage( const osg::Vec4& src, const osg::Vec4& dst, const unsigned char* data,
+                           int stride, int s, int t )
+{
+    int sx = (int)src.x(), sy = (int)src.y(), w = (int)src.z(), h = (int)src.w();
+    int dx = (int)dst.x(), dy = (int)dst.y();
+    if ( sx!=src.x() || sy!=src.y() || w!=src.z() || h!=src.w() || dx!=dst.x() || dy!=dst.y() ||
+         dst.z()!=src.z() || dst.w()!=src.w() ) return false;
+    if ( sx<0 || sy<0 || w<=0 || h<=0 || sx + w>s || sy + h>t ) return false;
+    
+    agg::rect_i rect( dx, dy, dx + w - 1, dy + h - 1 );
+    if ( !rect.clip(_clipBox) || !rect.clip(agg::rect_i(0, 0, this->s() - 1, this->t() - 1)) )
+        return true;
+    
+    // Images converted to RGBA may have alpha values, others are only copied as Agg does
+    unsigned int numComponents = PixelConverter::getNumComponents( getPixelFormat() );
+    unsigned int length = rect.x2 - rect.x1 + 1;
+    for ( int y=rect.y1; y<=rect.y2; ++y )
+    {
+        const unsigned char* srcRow = data + (sy + y - dy) * stride + (sx + rect.x1 - dx) * numComponents;
+        unsigned char* dstRow = _renderBuffer->row_ptr(y) + rect.x1 * numComponents;
+        if ( numComponents==4 ) PixelConverter::blendRow( srcRow, dstRow, length );
+        else memcpy( dstRow, srcRow, length * numComponents );
+    }
+    addDirtyRect( rect );
+    return true;
+}
+
+template<typename PixelFormat, typename CalculatorType>
+static void blurWithAgg( agg::rendering_buffer& buffer, const agg::rect_i& rect, float radius,
+                         bool recursive, void (*stackBlur)(PixelFormat&, unsigned, unsigned) )
+{
+    PixelFormat pixelFormat( buffer );
+    agg::rendering_buffer areaBuffer;
+    PixelFormat area( areaBuffer );
+    if ( !area.attach(pixelFormat, rect.x1, rect.y1, rect.x2, rect.y2) ) return;
+    
+    if ( recursive )
+    {
+        agg::recursive_blur<typename PixelFormat::color_type, CalculatorType> blur;
+        blur.blur( area, radius );
+    }
+    else
+    {
+        // Stack blur can't go beyond 254 pixels
+        unsigned int r = (unsigned int)osg::clampBetween( radius + 0.5f, 0.0f, 254.0f );
+        stackBlur( area, r, r );
+    }
+}
+
+void AggDrawer::blur( float radius, BlurMode mode )
+{
+    CHECK_DRAWER();
+    if ( _deferred ) flush();
+    
+    agg::rect_i rect = _clipBox;
+    if ( radius<=0.0f || !rect.clip(agg::rect_i(0, 0, s() - 1, t() - 1)) ) return;
+    
+    GLenum format = getPixelFormat();
+    if ( mode==BOX_BLUR )
+    {
+        unsigned int numComponents = PixelConverter::getNumComponents( format );
+        ImageEffects::boxBlur( _renderBuffer->row_ptr(rect.y1) + rect.x1 * numComponents, _renderBuffer->stride(),
+                               rect.x2 - rect.x1 + 1, rect.y2 - rect.y1 + 1, numComponents, radius, getWorkerPool() );
+    }
+    else
+    {
+        bool recursive = (mode==RECURSIVE_BLUR);
+        switch ( format )
         {
-            agg::color_conv( &newBuffer, &imageBuffer, agg::color_conv_rgba32_to_rgb24() );
+        case GL_RGBA:
+            blurWithAgg<agg::pixfmt_rgba32, agg::recursive_blur_calc_rgba<> >(
+                *_renderBuffer, rect, radius, recursive, agg::stack_blur_rgba32<agg::pixfmt_rgba32> );
+            break;
+        case GL_RGB:
+            blurWithAgg<agg::pixfmt_rgb24, agg::recursive_blur_calc_rgb<> >(
+                *_renderBuffer, rect, radius, recursive, agg::stack_blur_rgb24<agg::pixfmt_rgb24> );
+            break;
+        default:
+            blurWithAgg<agg::pixfmt_gray8, agg::recursive_blur_calc_gray<> >(
+                *_renderBuffer, rect, radius, recursive, agg::stack_blur_gray8<agg::pixfmt_gray8> );
+            break;
         }
-        else
+    }
+    addDirtyRect( rect );
+}
+
+void AggDrawer::drawShadow( const osg::Vec2& offset, float radius, int r, int g, int b, int a )
+{
+    CHECK_DRAWER();
+    if ( getPixelFormat()!=GL_RGBA )
+    {
+        OSG_NOTICE << "[AggDrawer] Shadows and glows can only be drawn on RGBA images" << std::endl;
+        return;
+    }
+    if ( _deferred ) flush();
+    
+    agg::rect_i rect = _clipBox;
+    if ( !rect.clip(agg::rect_i(0, 0, s() - 1, t() - 1)) ) return;
+    
+    // Blur the alpha values with a border of 3 sigma, where the shadow spreads out
+    int border = (int)ceil(osg::maximum(radius, 0.0f) * 1.5f) + 1;
+    int w = rect.x2 - rect.x1 + 1 + border * 2, h = rect.y2 - rect.y1 + 1 + border * 2;
+    std::vector<unsigned char> mask( w * h, 0 );
+    for ( int y=rect.y1; y<=rect.y2; ++y )
+    {
+        const unsigned char* row = _renderBuffer->row_ptr(y) + rect.x1 * 4;
+        unsigned char* maskRow = &mask[(y - rect.y1 + border) * w + border];
+        for ( int x=rect.x1; x<=rect.x2; ++x, row+=4 ) *(maskRow++) = row[3];
+    }
+    ImageEffects::boxBlur( &mask[0], w, w, h, 1, radius, getWorkerPool() );
+    
+    // Composite the shadow behind current pixels
+    int dx = (int)floor(offset.x() + 0.5f), dy = (int)floor(offset.y() + 0.5f);
+    unsigned int color[3] = { (unsigned int)r, (unsigned int)g, (unsigned int)b };
+    for ( int y=rect.y1; y<=rect.y2; ++y )
+    {
+        int my = y - dy - rect.y1 + border;
+        if ( my<0 || my>=h ) continue;
+        
+        unsigned char* row = _renderBuffer->row_ptr(y) + rect.x1 * 4;
+        for ( int x=rect.x1; x<=rect.x2; ++x, row+=4 )
         {
-            OSG_NOTICE << "[AggDrawer] The sub-image to be drawn does not have the same pixel format "
-                       << "with the target one. Automatic conversion is not supported either, "
-                       << "so we have to give up" << std::endl;
-            delete[] newData;
-            return;
+            int mx = x - dx - rect.x1 + border;
+            if ( mx<0 || mx>=w ) continue;
+            
+            unsigned int sa = (mask[my * w + mx] * a + 127) / 255;
+            unsigned int da = row[3];
+            if ( !sa || da==255 ) continue;
+            
+            // Alpha values scaled by 255: out = dst over shadow
+            unsigned int outA = da * 255 + sa * (255 - da);
+            for ( int c=0; c<3; ++c )
+                row[c] = (unsigned char)((row[c] * da * 255 + color[c] * sa * (255 - da) + outA / 2) / outA);
+            row[3] = (unsigned char)((outA + 127) / 255);
         }
-        _adapter->drawData( canvas, imageMatrix, newBuffer );
-        delete[] newData;
     }
-    else
-        _adapter->drawData( canvas, imageMatrix, imageBuffer );
+    addDirtyRect( rect );
 }
 
 void AggDrawer::drawLine( const osg::Vec2& p0, const osg::Vec2& p1 )
@@ -810,7 +1697,7 @@ void AggDrawer::drawText( const osg::Vec2& pos, const wchar_t* text )
     _adapter->drawText( pos.x(), pos.y(), text );
 }
 
-osg::Vec2 AggDrawer::measureText( const osg::Vec2& pos, const wchar_t* text )
+osg::Vec2 AggDrawer::measureText( const osg::Vec2&, const wchar_t* text )
 {
     float w = 0.0f, h = 0.0f;
     if ( !canDraw() )
@@ -819,7 +1706,7 @@ osg::Vec2 AggDrawer::measureText( const osg::Vec2& pos, const wchar_t* text )
         return osg::Vec2(w, h);
     }
     
-    _adapter->measureText( pos.x(), pos.y(), text, w, h );
+    _adapter->measureText( text, w, h );
     return osg::Vec2(w, h);
 }
 
@@ -895,3 +1782,77 @@ void AggDrawer::setTransformAlongLineSegment( const osg::Vec2& s, const osg::Vec
     else
         _transform->premultiply( agg::trans_affine_line_segment(s.x(), s.y(), e.x(), e.y(), length) );
 }
+
+/* AggSubloadCallback */
+
+AggSubloadCallback::AggSubloadCallback( AggDrawer* drawer, UploadMode mode )
+:   _drawer(drawer), _mode(mode)
+{
+}
+
+void AggSubloadCallback::load( const osg::Texture2D& texture, osg::State& state ) const
+{
+    unsigned int contextID = state.getContextID();
+    unsigned int modifiedCount = _drawer->getModifiedCount();
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        collectDirtyRects();
+        _pendingRects[contextID].clear();
+        _loaded[contextID] = 1;
+    }
+    
+    glPixelStorei( GL_UNPACK_ALIGNMENT, _drawer->getPacking() );
+    glTexImage2D( GL_TEXTURE_2D, 0, _drawer->getInternalTextureFormat(), _drawer->s(), _drawer->t(), 0,
+                  _drawer->getPixelFormat(), _drawer->getDataType(), _drawer->data() );
+    texture.getModifiedCount(contextID) = modifiedCount;
+}
+
+void AggSubloadCallback::subload( const osg::Texture2D& texture, osg::State& state ) const
+{
+    // Read the count before taking the changes, so that a change made in between is uploaded next time
+    unsigned int contextID = state.getContextID();
+    unsigned int modifiedCount = _drawer->getModifiedCount();
+    if ( texture.getModifiedCount(contextID)==modifiedCount ) return;
+    
+    std::vector<agg::rect_i> rects;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        collectDirtyRects();
+        rects.swap( _pendingRects[contextID] );
+    }
+    
+    UploadMode mode = _mode;
+#ifndef GL_UNPACK_ROW_LENGTH
+    mode = UPLOAD_ROWS;
+#else
+    if ( mode==UPLOAD_REGIONS ) glPixelStorei( GL_UNPACK_ROW_LENGTH, _drawer->s() );
+#endif
+    
+    glPixelStorei( GL_UNPACK_ALIGNMENT, _drawer->getPacking() );
+    for ( unsigned int i=0; i<rects.size(); ++i )
+    {
+        const agg::rect_i& r = rects[i];
+        int x = (mode==UPLOAD_ROWS) ? 0 : r.x1;
+        int w = (mode==UPLOAD_ROWS) ? _drawer->s() : (r.x2 - r.x1 + 1);
+        glTexSubImage2D( GL_TEXTURE_2D, 0, x, r.y1, w, r.y2 - r.y1 + 1,
+                         _drawer->getPixelFormat(), _drawer->getDataType(), _drawer->data(x, r.y1) );
+    }
+    
+#ifdef GL_UNPACK_ROW_LENGTH
+    if ( mode==UPLOAD_REGIONS ) glPixelStorei( GL_UNPACK_ROW_LENGTH, 0 );
+#endif
+    texture.getModifiedCount(contextID) = modifiedCount;
+}
+
+void AggSubloadCallback::collectDirtyRects() const
+{
+    std::vector<agg::rect_i> rects;
+    _drawer->takeDirtyRects( rects );
+    if ( rects.empty() ) return;
+    
+    // Contexts without the texture will upload the whole image when loading it
+    for ( unsigned int i=0; i<_pendingRects.size(); ++i )
+    {
+        if ( _loaded[i] ) _pendingRects[i].insert( _pendingRects[i].end(), rects.begin(), rects.end() );
+    }
+}
@@ -2,6 +2,13 @@
 #define H_DRAWER2D
 
 #include <osg/Image>
+#include <osg/Texture2D>
+#include <osg/Timer>
+#include <osg/Vec2d>
+#include <osg/observer_ptr>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Barrier>
 #include <font_freetype/agg_font_freetype.h>
 #include <agg_renderer_scanline.h>
 #include <agg_rendering_buffer.h>
@@ -10,11 +17,153 @@
 #include <agg_pixfmt_gray.h>
 #include <agg_pixfmt_rgb.h>
 #include <agg_pixfmt_rgba.h>
+#include <list>
+#include <map>
 
 // TODO
-// Image effects (blend, blur...)
 // Boolean operation
-// Font cache pool (FreeType side?)
+
+/** The process-wide glyph cache shared by fonts of all AggDrawer objects. Faces are loaded once and
+    kept by (file, size, render mode, Y direction); rasterized glyphs and laid-out text runs are
+    evicted in least-recently-used order when the memory budget is exceeded. It is thread-safe */
+class AggFontCache : public osg::Referenced
+{
+public:
+    typedef agg::font_engine_freetype_int32 EngineType;
+    typedef EngineType::path_adaptor_type PathAdaptorType;
+    typedef EngineType::gray8_adaptor_type Gray8AdaptorType;
+    typedef Gray8AdaptorType::embedded_scanline Gray8ScanlineType;
+    
+    struct FaceKey
+    {
+        std::string file;
+        float width, height;
+        bool outline, flipped;
+        
+        FaceKey( const std::string& f, float w, float h, bool o, bool fl )
+        : file(f), width(w), height(h), outline(o), flipped(fl) {}
+        
+        bool operator<( const FaceKey& rhs ) const
+        {
+            if ( file!=rhs.file ) return file<rhs.file;
+            if ( width!=rhs.width ) return width<rhs.width;
+            if ( height!=rhs.height ) return height<rhs.height;
+            if ( outline!=rhs.outline ) return outline<rhs.outline;
+            return flipped<rhs.flipped;
+        }
+    };
+    
+    /** A rasterized glyph (serialized gray8 scanlines) or a glyph outline (serialized path) */
+    struct Glyph : public osg::Referenced
+    {
+        std::vector<agg::int8u> data;
+        agg::glyph_data_type type;
+        unsigned int index;
+        double advanceX, advanceY;
+    };
+    
+    /** Glyphs of a text and their kerned positions relative to the text origin */
+    struct TextRun : public osg::Referenced
+    {
+        std::vector< osg::ref_ptr<Glyph> > glyphs;
+        std::vector<osg::Vec2d> positions;
+        double advanceX, advanceY;
+        TextRun() : advanceX(0.0), advanceY(0.0) {}
+    };
+    
+    static AggFontCache* instance();
+    
+    /** Get the laid-out glyphs of a text, or NULL if the font can't be loaded. A font file which failed
+        to load is tried again after a second */
+    osg::ref_ptr<TextRun> getTextRun( const FaceKey& key, const wchar_t* text );
+    
+    /** Set maximum bytes of cached glyphs and text runs */
+    void setMemoryBudget( unsigned int bytes );
+    unsigned int getMemoryBudget() const { return _memoryBudget; }
+    unsigned int getMemoryUsage() const { return _memoryUsage; }
+    
+    /** Remove all cached glyphs and text runs; loaded faces are kept */
+    void clear();
+    
+protected:
+    AggFontCache();
+    virtual ~AggFontCache() {}
+    
+    struct Face;
+    struct Entry
+    {
+        Face* face;
+        unsigned int code;  // Glyph entries only
+        std::wstring text;  // Text run entries only
+        unsigned int bytes;
+        bool isRun;
+    };
+    typedef std::list<Entry> EntryList;
+    
+    struct Face
+    {
+        std::map< unsigned int, std::pair<osg::ref_ptr<Glyph>, EntryList::iterator> > glyphs;
+        std::map< std::wstring, std::pair<osg::ref_ptr<TextRun>, EntryList::iterator> > runs;
+        osg::Timer_t failedTick;  // Last time the font file couldn't be loaded
+        bool failed;
+        Face() : failedTick(0), failed(false) {}
+    };
+    
+    bool selectFace( const FaceKey& key, Face& face );
+    Glyph* getGlyph( const FaceKey& key, Face& face, unsigned int code );
+    EntryList::iterator addEntry( Face* face, unsigned int code, const std::wstring& text, unsigned int bytes );
+    void evict();
+    
+    EngineType _engine;
+    std::map<FaceKey, Face> _faces;
+    const Face* _selectedFace;
+    EntryList _entries;  // Most recently used first
+    unsigned int _memoryBudget;
+    unsigned int _memoryUsage;
+    OpenThreads::Mutex _mutex;
+};
+
+/** A fixed pool of threads kept by an AggDrawer, so that flush() doesn't start new threads every time.
+    The calling thread works as worker 0 */
+class AggWorkerPool : public osg::Referenced
+{
+public:
+    struct Task
+    {
+        virtual ~Task() {}
+        virtual void run( int worker ) = 0;
+    };
+    
+    /** Create the pool with specified number of workers, including the calling thread */
+    AggWorkerPool( int numWorkers );
+    
+    /** Number of workers, including the calling thread */
+    int getNumWorkers() const { return (int)_threads.size() + 1; }
+    
+    /** Run the task on every worker and block until all of them return */
+    void run( Task* task );
+    
+protected:
+    virtual ~AggWorkerPool();
+    
+    class WorkerThread : public OpenThreads::Thread
+    {
+    public:
+        WorkerThread( AggWorkerPool* pool, int index ) : _pool(pool), _index(index) {}
+        virtual void run();
+        
+    protected:
+        AggWorkerPool* _pool;
+        int _index;
+    };
+    friend class WorkerThread;
+    
+    std::vector<WorkerThread*> _threads;
+    OpenThreads::Barrier _startBarrier;
+    OpenThreads::Barrier _endBarrier;
+    Task* _task;
+    bool _done;
+};
 
 /** The 2D drawing class using Agg to render directly on images */
 class AggDrawer : public osg::Image
@@ -36,28 +185,44 @@ public:
         Brush() : color(255, 255, 255, 255), enabled(true) {}
     };
     
+    /** Font settings; faces and glyphs are shared by all drawers in AggFontCache */
     struct Font
     {
         enum DrawMode { GRAY_GRAPH, OUTLINE_GRAPH };
-        typedef agg::font_cache_manager<agg::font_engine_freetype_int32> ManagerType;
-        
-        agg::font_engine_freetype_int32* engine;
-        ManagerType* manager;
         std::string file;
         DrawMode drawMode;
         float width, height;
-        bool dirty;
         
-        Font() : drawMode(GRAY_GRAPH), width(1.0f), height(1.0f), dirty(true)
-        { engine = new agg::font_engine_freetype_int32; manager = new ManagerType(*engine); }
+        Font() : drawMode(GRAY_GRAPH), width(1.0f), height(1.0f) {}
+    };
+    
+    /** Flattened and transformed outlines and their anti-aliased covers recorded by
+        beginDisplayList()/endDisplayList(), to be replayed with drawDisplayList() */
+    class DisplayList : public osg::Referenced
+    {
+    public:
+        struct Item
+        {
+            agg::path_storage path;  // Empty for recorded glyph bitmaps
+            std::vector<agg::int8u> covers;  // Serialized scanlines, without clipping
+            agg::rgba8 color;
+            bool antiAlias;
+        };
+        
+        unsigned int size() const { return _items.size(); }
+        const Item& getItem( unsigned int i ) const { return *_items[i]; }
+        Item* addItem() { _items.push_back(new Item); return _items.back(); }
         
-        ~Font() { if (manager) delete manager; if (engine) delete engine; }
+    protected:
+        virtual ~DisplayList();
+        std::vector<Item*> _items;
     };
     
     class DrawAdapterBase
     {
     public:
         DrawAdapterBase( AggDrawer* d ) : drawer(d) {}
+        virtual ~DrawAdapterBase() {}
         virtual void setAntiAlias( bool flag ) = 0;
         virtual void clear( const agg::rgba8& color, bool resetClipBox ) = 0;
         virtual void drawPixels( int x0, int y0, int x1, int y1, const agg::rgba8& color ) = 0;
@@ -65,7 +230,10 @@ public:
                                agg::rendering_buffer& data ) = 0;
         virtual void drawPath( agg::path_storage& path, bool usePen, bool useBrush ) = 0;
         virtual void drawText( float x, float y, const wchar_t* text ) = 0;
-        virtual void measureText( float x, float y, const wchar_t* text, float& w, float& h ) = 0;
+        virtual void measureText( const wchar_t* text, float& w, float& h ) = 0;
+        virtual void flush( AggWorkerPool* workers, int tileSize ) = 0;
+        virtual void drawDisplayList( const DisplayList& list, double dx, double dy,
+                                      const agg::rgba8* color ) = 0;
         
     protected:
         AggDrawer* drawer;
@@ -120,7 +288,6 @@ public:
             return;
         _font.file = file;
         _font.drawMode = (outline?Font::OUTLINE_GRAPH:Font::GRAY_GRAPH);
-        _font.dirty = true;
     }
     const std::string& getFontFile() const { return _font.file; }
     bool isFontOutline() const { return _font.drawMode==Font::OUTLINE_GRAPH; }
@@ -138,6 +305,52 @@ public:
     /** Set to use anti-alias or not */
     void setAntiAlias( bool flag );
     
+    /** Set to record draw commands instead of rasterizing them at once; call flush() to rasterize
+        them in parallel screen tiles. The result is the same as drawing in immediate mode */
+    void setDeferred( bool b );
+    bool getDeferred() const { return _deferred; }
+    
+    /** Set number of threads used by flush() and box blurs, including the calling thread. They are
+        started when first needed and kept until the number changes or the drawer is deleted */
+    void setNumThreads( int num ) { _numThreads = num; }
+    int getNumThreads() const { return _numThreads; }
+    
+    /** Set width and height of the screen tiles used by flush() */
+    void setTileSize( int size ) { _tileSize = size; }
+    int getTileSize() const { return _tileSize; }
+    
+    /** Rasterize all recorded commands in deferred mode */
+    void flush();
+    
+    /** Start recording all following paths and texts into a new display list, instead of drawing them.
+        Clearing, drawing pixels and images are not recorded */
+    void beginDisplayList();
+    
+    /** Stop recording and return the display list */
+    DisplayList* endDisplayList();
+    DisplayList* getRecordingList() { return _recordingList.get(); }
+    
+    /** Replay a display list with an offset. Offsets of whole pixels reuse the recorded covers,
+        and others rasterize the recorded outlines again */
+    void drawDisplayList( const DisplayList* list, const osg::Vec2& offset=osg::Vec2() );
+    
+    /** Replay a display list with an offset, and draw all its items in specified color */
+    void drawDisplayList( const DisplayList* list, const osg::Vec2& offset, int r, int g, int b, int a=255 );
+    
+    /** Add a changed area in drawing coordinates; it's clipped and converted to image rows, and
+        the image is dirtied. Called by all drawing functions */
+    void addDirtyRect( const agg::rect_i& rect );
+    
+    /** Move the changed areas (in image rows) since last call into rects, used for partial texture
+        uploads. It may be called from the draw thread while another thread is drawing */
+    void takeDirtyRects( std::vector<agg::rect_i>& rects );
+    void clearDirtyRects();
+    
+    /** Merge two changed areas if their union is at most 'ratio' times larger than both,
+        and merge all of them if there are more than maxRects */
+    void setDirtyRectCoalescing( float ratio, unsigned int maxRects )
+    { _dirtyRectRatio = ratio; _maxDirtyRects = maxRects; }
+    
     /** Clear the buffer */
     void clear( int r, int g, int b, int a=255, bool resetClipBox=false );
     
@@ -151,9 +364,25 @@ public:
         if (image) drawImage(osg::Vec4(0.0f, 0.0f, image->s(), image->t()), dst, image);
     }
     
-    /** Draw an image at src(x, y, w, h) onto current one at dst(x, y, w, h) */
+    /** Draw an image at src(x, y, w, h) onto current one at dst(x, y, w, h). Images of other pixel formats
+        are converted and cached until they are modified. Unscaled images at whole pixels are blended
+        directly if there is no transform, and without deferred mode or display lists */
     void drawImage( const osg::Vec4& src, const osg::Vec4& dst, osg::Image* image );
     
+    enum BlurMode { BOX_BLUR, STACK_BLUR, RECURSIVE_BLUR };
+    
+    /** Blur pixels inside the clip box. BOX_BLUR approximates a Gaussian of sigma = radius / 2 with
+        3 box passes in parallel threads (see setNumThreads()); the other modes use Agg's blur classes */
+    void blur( float radius, BlurMode mode=BOX_BLUR );
+    
+    /** Draw a blurred shadow of the pixels inside the clip box behind them, moved by whole pixels.
+        It works only on RGBA images, as the shadow is made from alpha values */
+    void drawShadow( const osg::Vec2& offset, float radius, int r, int g, int b, int a=255 );
+    
+    /** Draw a blurred glow around the pixels inside the clip box */
+    void drawGlow( float radius, int r, int g, int b, int a=255 )
+    { drawShadow( osg::Vec2(), radius, r, g, b, a ); }
+    
     /** Draw a line from p0 to p1 */
     void drawLine( const osg::Vec2& p0, const osg::Vec2& p1 );
     
@@ -267,7 +496,7 @@ public:
     /** Draw text at specified left-bottom position */
     void drawText( const osg::Vec2& pos, const wchar_t* text );
     
-    /** Compute size of text but not really render them */
+    /** Compute size of text but not really render them; the size doesn't depend on the position */
     osg::Vec2 measureText( const osg::Vec2& pos, const wchar_t* text );
     
     /** Draw a filled arrowhead with provided paramters (p-to-top, p-to-back, height, sunken) */
@@ -312,6 +541,22 @@ public:
 protected:
     virtual ~AggDrawer();
     
+    struct ConvertedImage
+    {
+        osg::observer_ptr<osg::Image> image;
+        std::vector<unsigned char> data;
+        unsigned int modifiedCount;
+        GLenum pixelFormat;
+    };
+    typedef std::map<osg::Image*, ConvertedImage> ConvertedImageMap;
+    
+    const ConvertedImage* getConvertedImage( osg::Image* image );
+    bool blitImage( const osg::Vec4& src, const osg::Vec4& dst, const unsigned char* data,
+                    int stride, int s, int t );
+    
+    /** Return the worker threads for current number of threads, or NULL for a single thread */
+    AggWorkerPool* getWorkerPool();
+    
     DrawAdapterBase* _adapter;
     agg::rendering_buffer* _renderBuffer;
     agg::trans_affine* _transform;
@@ -320,7 +565,47 @@ protected:
     Pen _pen;
     Brush _brush;
     Font _font;
+    osg::ref_ptr<AggWorkerPool> _workers;
+    int _numThreads;
+    int _tileSize;
+    std::vector<agg::rect_i> _dirtyRects;
+    OpenThreads::Mutex _dirtyRectMutex;
+    float _dirtyRectRatio;
+    unsigned int _maxDirtyRects;
+    osg::ref_ptr<DisplayList> _recordingList;
+    ConvertedImageMap _convertedImages;
     bool _flipped;
+    bool _deferred;
+};
+
+/** Texture subload callback which only uploads the changed areas of an AggDrawer image.
+    Mipmaps are not updated, so use a non-mipmapped MIN_FILTER on the texture */
+class AggSubloadCallback : public osg::Texture2D::SubloadCallback
+{
+public:
+    enum UploadMode
+    {
+        UPLOAD_ROWS,    // Upload whole rows of changed areas, as one contiguous block each
+        UPLOAD_REGIONS  // Upload changed areas only
+    };
+    
+    AggSubloadCallback( AggDrawer* drawer, UploadMode mode=UPLOAD_REGIONS );
+    
+    void setUploadMode( UploadMode mode ) { _mode = mode; }
+    UploadMode getUploadMode() const { return _mode; }
+    
+    virtual void load( const osg::Texture2D& texture, osg::State& state ) const;
+    virtual void subload( const osg::Texture2D& texture, osg::State& state ) const;
+    
+protected:
+    /** Move changed areas of the drawer to the lists of all graphics contexts */
+    void collectDirtyRects() const;
+    
+    osg::ref_ptr<AggDrawer> _drawer;
+    mutable osg::buffered_object< std::vector<agg::rect_i> > _pendingRects;
+    mutable osg::buffered_value<int> _loaded;
+    mutable OpenThreads::Mutex _mutex;
+    UploadMode _mode;
 };
 
 #endif
@@ -0,0 +1,234 @@
+#include <OpenThreads/Atomic>
+#include <algorithm>
+#include <vector>
+#include <cstring>
+#include <cmath>
+#include "ImageEffects.h"
+#include "Drawer2D.h"
+
+#if !defined(OSGAGG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2))
+#   define OSGAGG_USE_SSE2
+#   include <emmintrin.h>
+#endif
+
+/* Line kernels, working on 4 float channels per pixel */
+
+static void loadLine( const unsigned char* src, int step, unsigned int numComponents, float* line, int length )
+{
+#ifdef OSGAGG_USE_SSE2
+    if ( numComponents==4 && step==4 )
+    {
+        const __m128i zero = _mm_setzero_si128();
+        for ( int i=0; i<length; ++i, src+=4, line+=4 )
+        {
+            int pixel = 0;
+            memcpy( &pixel, src, 4 );
+            __m128i v = _mm_unpacklo_epi16( _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), zero), zero );
+            _mm_storeu_ps( line, _mm_cvtepi32_ps(v) );
+        }
+        return;
+    }
+#endif
+    for ( int i=0; i<length; ++i, src+=step, line+=4 )
+    {
+        for ( unsigned int c=0; c<4; ++c )
+            line[c] = c<numComponents ? (float)src[c] : 0.0f;
+    }
+}
+
+static void storeLine( const float* line, unsigned char* dst, int step, unsigned int numComponents, int length )
+{
+#ifdef OSGAGG_USE_SSE2
+    if ( numComponents==4 && step==4 )
+    {
+        // Round to nearest and saturate 4 channels at once
+        const __m128i zero = _mm_setzero_si128();
+        for ( int i=0; i<length; ++i, line+=4, dst+=4 )
+        {
+            __m128i v = _mm_cvtps_epi32( _mm_loadu_ps(line) );
+            v = _mm_packus_epi16( _mm_packs_epi32(v, zero), zero );
+            int pixel = _mm_cvtsi128_si32( v );
+            memcpy( dst, &pixel, 4 );
+        }
+        return;
+    }
+#endif
+    for ( int i=0; i<length; ++i, line+=4, dst+=step )
+    {
+        for ( unsigned int c=0; c<numComponents; ++c )
+        {
+            int v = (int)(line[c] + 0.5f);
+            dst[c] = (unsigned char)(v<0 ? 0 : (v>255 ? 255 : v));
+        }
+    }
+}
+
+/** A box filter with running sums, clamping at both ends of the line. Pixels are 'step' floats
+    apart. The SSE2 loop is split so that only pixels near the ends need clamped indices */
+static void boxPass( const float* in, float* out, int length, int step, int radius )
+{
+    float scale = 1.0f / (float)(2 * radius + 1);
+    int last = length - 1;
+#ifdef OSGAGG_USE_SSE2
+    int headEnd = std::min(radius + 1, length), tailBegin = std::max(length - radius - 1, headEnd);
+    __m128 sum = _mm_mul_ps( _mm_loadu_ps(in), _mm_set1_ps((float)(radius + 1)) );
+    for ( int j=1; j<=radius; ++j )
+        sum = _mm_add_ps( sum, _mm_loadu_ps(in + std::min(j, last) * step) );
+    
+    __m128 scale4 = _mm_set1_ps( scale ), first = _mm_loadu_ps( in ), end = _mm_loadu_ps( in + last * step );
+    int i = 0;
+    for ( ; i<headEnd; ++i )
+    {
+        _mm_storeu_ps( out + i * step, _mm_mul_ps(sum, scale4) );
+        __m128 added = _mm_loadu_ps( in + std::min(i + radius + 1, last) * step );
+        sum = _mm_add_ps( sum, _mm_sub_ps(added, first) );
+    }
+    
+    for ( ; i<tailBegin; ++i )
+    {
+        _mm_storeu_ps( out + i * step, _mm_mul_ps(sum, scale4) );
+        __m128 added = _mm_loadu_ps( in + (i + radius + 1) * step );
+        __m128 removed = _mm_loadu_ps( in + (i - radius) * step );
+        sum = _mm_add_ps( sum, _mm_sub_ps(added, removed) );
+    }
+    
+    for ( ; i<length; ++i )
+    {
+        _mm_storeu_ps( out + i * step, _mm_mul_ps(sum, scale4) );
+        __m128 removed = _mm_loadu_ps( in + (i - radius) * step );
+        sum = _mm_add_ps( sum, _mm_sub_ps(end, removed) );
+    }
+#else
+    float sum[4];
+    for ( int c=0; c<4; ++c )
+    {
+        sum[c] = in[c] * (float)(radius + 1);
+        for ( int j=1; j<=radius; ++j ) sum[c] += in[std::min(j, last) * step + c];
+    }
+    
+    for ( int i=0; i<length; ++i )
+    {
+        const float* added = in + std::min(i + radius + 1, last) * step;
+        const float* removed = in + std::max(i - radius, 0) * step;
+        for ( int c=0; c<4; ++c )
+        {
+            out[i * step + c] = sum[c] * scale;
+            sum[c] += added[c] - removed[c];
+        }
+    }
+#endif
+}
+
+/* Parallel passes */
+
+class BlurJob : public AggWorkerPool::Task
+{
+public:
+    BlurJob( unsigned char* d, int s, int w, int h, unsigned int n, const int* r, bool v )
+    :   data(d), stride(s), width(w), height(h), numComponents(n), radii(r), vertical(v)
+    { numItems = vertical ? (width + blockSize - 1) / blockSize : (height + blockSize - 1) / blockSize; }
+    
+    /** Process blocks of rows or columns until no one is left */
+    virtual void run( int worker )
+    {
+        // A block of columns is kept in row order, so rows are loaded and stored as a whole
+        int size = vertical ? height * blockSize * 4 : width * 4;
+        std::vector<float> lineA(size), lineB(size);
+        while ( true )
+        {
+            int index = ++nextItem - 1;
+            if ( index>=numItems ) break;
+            
+            int begin = index * blockSize, end = std::min(begin + blockSize, vertical ? width : height);
+            if ( vertical )
+            {
+                int numColumns = end - begin, step = numColumns * 4;
+                for ( int y=0; y<height; ++y )
+                {
+                    loadLine( data + y * stride + begin * numComponents, numComponents, numComponents,
+                              &lineA[y * step], numColumns );
+                }
+                
+                for ( int x=0; x<numColumns; ++x )
+                    blurLine( &lineA[x * 4], &lineB[x * 4], height, step );
+                
+                for ( int y=0; y<height; ++y )
+                {
+                    storeLine( &lineB[y * step], data + y * stride + begin * numComponents,
+                               numComponents, numComponents, numColumns );
+                }
+            }
+            else
+            {
+                for ( int y=begin; y<end; ++y )
+                {
+                    unsigned char* row = data + y * stride;
+                    loadLine( row, numComponents, numComponents, &lineA[0], width );
+                    blurLine( &lineA[0], &lineB[0], width, 4 );
+                    storeLine( &lineB[0], row, numComponents, numComponents, width );
+                }
+            }
+        }
+    }
+    
+    int getNumItems() const { return numItems; }
+    
+    enum { blockSize=16 };
+    OpenThreads::Atomic nextItem;
+
+protected:
+    /** Apply 3 box passes; the result is in temp */
+    void blurLine( float* line, float* temp, int length, int step )
+    {
+        boxPass( line, temp, length, step, radii[0] );
+        boxPass( temp, line, length, step, radii[1] );
+        boxPass( line, temp, length, step, radii[2] );
+    }
+    
+    unsigned char* data;
+    int stride, width, height;
+    unsigned int numComponents;
+    const int* radii;
+    int numItems;
+    bool vertical;
+};
+
+static void runBlurJob( BlurJob& job, AggWorkerPool* workers )
+{
+    // A single block isn't worth waking up the other workers
+    if ( workers && job.getNumItems()>1 ) workers->run( &job );
+    else job.run( 0 );
+}
+
+/* ImageEffects */
+
+void ImageEffects::boxBlur( unsigned char* data, int stride, int width, int height,
+                            unsigned int numComponents, double radius, AggWorkerPool* workers )
+{
+    if ( width<=0 || height<=0 || numComponents<1 || numComponents>4 ) return;
+    
+    int radii[3];
+    computeBoxRadii( radius * 0.5, radii, 3 );
+    if ( !radii[0] && !radii[1] && !radii[2] ) return;
+    
+    // Rows first, then columns; all rows are done before any column begins
+    BlurJob rowJob( data, stride, width, height, numComponents, radii, false );
+    runBlurJob( rowJob, workers );
+    
+    BlurJob columnJob( data, stride, width, height, numComponents, radii, true );
+    runBlurJob( columnJob, workers );
+}
+
+void ImageEffects::computeBoxRadii( double sigma, int* radii, int n )
+{
+    // Box widths from W. Jarosz, "Fast Image Convolutions"
+    double variance = 12.0 * sigma * sigma;
+    int widthLow = (int)floor( sqrt(variance / n + 1.0) );
+    if ( widthLow % 2==0 ) widthLow--;
+    if ( widthLow<1 ) widthLow = 1;
+    
+    int numLow = (int)floor( (variance - n * widthLow * widthLow - 4.0 * n * widthLow - 3.0 * n)
+                             / (-4.0 * widthLow - 4.0) + 0.5 );
+    for ( int i=0; i<n; ++i )
+        radii[i] = ((i<numLow ? widthLow : widthLow + 2) - 1) / 2;
+}
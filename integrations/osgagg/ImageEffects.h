@@ -0,0 +1,22 @@
+#ifndef H_IMAGEEFFECTS
+#define H_IMAGEEFFECTS
+
+class AggWorkerPool;
+
+/** Fast image effects on 8-bit pixels, used by AggDrawer::blur() and AggDrawer::drawShadow().
+    The passes work on rows and column blocks on the workers of the drawer, with SSE2 on x86 unless
+    OSGAGG_NO_SIMD is defined */
+class ImageEffects
+{
+public:
+    /** Approximate a Gaussian blur (sigma = radius / 2, as agg::recursive_blur) with 3 box passes
+        on each direction. Rows begin at data + y * stride, so the stride may be negative.
+        Without workers, all passes run on the calling thread */
+    static void boxBlur( unsigned char* data, int stride, int width, int height,
+                         unsigned int numComponents, double radius, AggWorkerPool* workers=NULL );
+    
+    /** Compute sizes of n box filters whose cascade approximates a Gaussian of sigma */
+    static void computeBoxRadii( double sigma, int* radii, int n );
+};
+
+#endif
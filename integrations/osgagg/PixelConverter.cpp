@@ -0,0 +1,299 @@
+#include <cstring>
+#include "PixelConverter.h"
+
+#if !defined(OSGAGG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2))
+#   define OSGAGG_USE_SSE2
+#   include <emmintrin.h>
+#   if defined(__SSSE3__)
+#       define OSGAGG_USE_SSSE3
+#       include <tmmintrin.h>
+#   endif
+#endif
+
+/* Scalar pixel readers (to RGBA) and writers (from RGBA) */
+
+struct ReadAlpha { enum { size=1 }; static void read( const unsigned char* p, unsigned char* c )
+{ c[0] = c[1] = c[2] = 255; c[3] = p[0]; } };
+
+struct ReadLuminance { enum { size=1 }; static void read( const unsigned char* p, unsigned char* c )
+{ c[0] = c[1] = c[2] = p[0]; c[3] = 255; } };
+
+struct ReadIntensity { enum { size=1 }; static void read( const unsigned char* p, unsigned char* c )
+{ c[0] = c[1] = c[2] = c[3] = p[0]; } };
+
+struct ReadRGB { enum { size=3 }; static void read( const unsigned char* p, unsigned char* c )
+{ c[0] = p[0]; c[1] = p[1]; c[2] = p[2]; c[3] = 255; } };
+
+struct ReadBGR { enum { size=3 }; static void read( const unsigned char* p, unsigned char* c )
+{ c[0] = p[2]; c[1] = p[1]; c[2] = p[0]; c[3] = 255; } };
+
+struct ReadRGBA { enum { size=4 }; static void read( const unsigned char* p, unsigned char* c )
+{ c[0] = p[0]; c[1] = p[1]; c[2] = p[2]; c[3] = p[3]; } };
+
+struct ReadBGRA { enum { size=4 }; static void read( const unsigned char* p, unsigned char* c )
+{ c[0] = p[2]; c[1] = p[1]; c[2] = p[0]; c[3] = p[3]; } };
+
+struct WriteAlpha { enum { size=1 }; static void write( const unsigned char* c, unsigned char* p )
+{ p[0] = c[3]; } };
+
+struct WriteGray { enum { size=1 }; static void write( const unsigned char* c, unsigned char* p )
+{ p[0] = (unsigned char)((c[0] * 77 + c[1] * 150 + c[2] * 29) >> 8); } };
+
+struct WriteRGB { enum { size=3 }; static void write( const unsigned char* c, unsigned char* p )
+{ p[0] = c[0]; p[1] = c[1]; p[2] = c[2]; } };
+
+struct WriteBGR { enum { size=3 }; static void write( const unsigned char* c, unsigned char* p )
+{ p[0] = c[2]; p[1] = c[1]; p[2] = c[0]; } };
+
+struct WriteRGBA { enum { size=4 }; static void write( const unsigned char* c, unsigned char* p )
+{ p[0] = c[0]; p[1] = c[1]; p[2] = c[2]; p[3] = c[3]; } };
+
+struct WriteBGRA { enum { size=4 }; static void write( const unsigned char* c, unsigned char* p )
+{ p[0] = c[2]; p[1] = c[1]; p[2] = c[0]; p[3] = c[3]; } };
+
+template<typename ReaderType, typename WriterType>
+static void convertPixels( const unsigned char* src, unsigned char* dst, unsigned int width )
+{
+    unsigned char color[4];
+    for ( unsigned int i=0; i<width; ++i )
+    {
+        ReaderType::read( src, color );
+        WriterType::write( color, dst );
+        src += ReaderType::size;
+        dst += WriterType::size;
+    }
+}
+
+template<typename ReaderType>
+static bool convertPixelsFrom( const unsigned char* src, unsigned char* dst, GLenum dstFormat, unsigned int width )
+{
+    switch ( dstFormat )
+    {
+    case GL_ALPHA: convertPixels<ReaderType, WriteAlpha>( src, dst, width ); return true;
+    case GL_LUMINANCE: case GL_INTENSITY: convertPixels<ReaderType, WriteGray>( src, dst, width ); return true;
+    case GL_RGB: convertPixels<ReaderType, WriteRGB>( src, dst, width ); return true;
+    case GL_BGR: convertPixels<ReaderType, WriteBGR>( src, dst, width ); return true;
+    case GL_RGBA: convertPixels<ReaderType, WriteRGBA>( src, dst, width ); return true;
+    case GL_BGRA: convertPixels<ReaderType, WriteBGRA>( src, dst, width ); return true;
+    default: return false;
+    }
+}
+
+static bool isGray( GLenum format )
+{ return format==GL_ALPHA || format==GL_LUMINANCE || format==GL_INTENSITY; }
+
+#ifdef OSGAGG_USE_SSE2
+
+/** Convert as many pixels as possible with SIMD kernels, and return the number of converted ones */
+static unsigned int convertPixelsSIMD( const unsigned char* src, GLenum srcFormat,
+                                       unsigned char* dst, GLenum dstFormat, unsigned int width )
+{
+    unsigned int i = 0;
+    bool srcRGBA = (srcFormat==GL_RGBA || srcFormat==GL_BGRA);
+    bool dstRGBA = (dstFormat==GL_RGBA || dstFormat==GL_BGRA);
+    if ( srcRGBA && dstRGBA && srcFormat!=dstFormat )
+    {
+        // Swap R and B of 4 pixels at once
+        const __m128i maskAG = _mm_set1_epi32( 0xFF00FF00 );
+        const __m128i maskRB = _mm_set1_epi32( 0x00FF00FF );
+        for ( ; i + 4<=width; i+=4 )
+        {
+            __m128i p = _mm_loadu_si128( (const __m128i*)(src + i * 4) );
+            __m128i rb = _mm_and_si128( p, maskRB );
+            rb = _mm_or_si128( _mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16) );
+            _mm_storeu_si128( (__m128i*)(dst + i * 4), _mm_or_si128(_mm_and_si128(p, maskAG), rb) );
+        }
+    }
+    else if ( isGray(srcFormat) && dstRGBA )
+    {
+        // Expand 16 gray values to (c, c, c, a) pixels
+        const __m128i full = _mm_set1_epi8( (char)0xFF );
+        for ( ; i + 16<=width; i+=16 )
+        {
+            __m128i v = _mm_loadu_si128( (const __m128i*)(src + i) );
+            __m128i c = (srcFormat==GL_ALPHA) ? full : v;
+            __m128i a = (srcFormat==GL_LUMINANCE) ? full : v;
+            __m128i ccLow = _mm_unpacklo_epi8( c, c ), ccHigh = _mm_unpackhi_epi8( c, c );
+            __m128i caLow = _mm_unpacklo_epi8( c, a ), caHigh = _mm_unpackhi_epi8( c, a );
+            __m128i* out = (__m128i*)(dst + i * 4);
+            _mm_storeu_si128( out, _mm_unpacklo_epi16(ccLow, caLow) );
+            _mm_storeu_si128( out + 1, _mm_unpackhi_epi16(ccLow, caLow) );
+            _mm_storeu_si128( out + 2, _mm_unpacklo_epi16(ccHigh, caHigh) );
+            _mm_storeu_si128( out + 3, _mm_unpackhi_epi16(ccHigh, caHigh) );
+        }
+    }
+    else if ( srcRGBA && isGray(dstFormat) )
+    {
+        // Weighted sums of 8 pixels with madd, or their alpha values
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i weights = (srcFormat==GL_RGBA) ? _mm_set_epi16( 0, 29, 150, 77, 0, 29, 150, 77 )
+                                                     : _mm_set_epi16( 0, 77, 150, 29, 0, 77, 150, 29 );
+        for ( ; i + 8<=width; i+=8 )
+        {
+            __m128i p0 = _mm_loadu_si128( (const __m128i*)(src + i * 4) );
+            __m128i p1 = _mm_loadu_si128( (const __m128i*)(src + i * 4 + 16) );
+            __m128i v0, v1;
+            if ( dstFormat==GL_ALPHA )
+            {
+                v0 = _mm_srli_epi32( p0, 24 );
+                v1 = _mm_srli_epi32( p1, 24 );
+            }
+            else
+            {
+                __m128i s[4];
+                s[0] = _mm_madd_epi16( _mm_unpacklo_epi8(p0, zero), weights );
+                s[1] = _mm_madd_epi16( _mm_unpackhi_epi8(p0, zero), weights );
+                s[2] = _mm_madd_epi16( _mm_unpacklo_epi8(p1, zero), weights );
+                s[3] = _mm_madd_epi16( _mm_unpackhi_epi8(p1, zero), weights );
+                for ( int k=0; k<4; ++k )
+                {
+                    s[k] = _mm_add_epi32( s[k], _mm_srli_epi64(s[k], 32) );
+                    s[k] = _mm_shuffle_epi32( s[k], _MM_SHUFFLE(3, 3, 2, 0) );
+                }
+                v0 = _mm_srli_epi32( _mm_unpacklo_epi64(s[0], s[1]), 8 );
+                v1 = _mm_srli_epi32( _mm_unpacklo_epi64(s[2], s[3]), 8 );
+            }
+            _mm_storel_epi64( (__m128i*)(dst + i), _mm_packus_epi16(_mm_packs_epi32(v0, v1), zero) );
+        }
+    }
+#ifdef OSGAGG_USE_SSSE3
+    else if ( (srcFormat==GL_RGB || srcFormat==GL_BGR) && dstRGBA )
+    {
+        // Shuffle 4 pixels at once; 16 bytes are read, so stop 2 pixels before the end
+        const __m128i alpha = _mm_set1_epi32( 0xFF000000 );
+        const __m128i shuffle = ((srcFormat==GL_RGB)==(dstFormat==GL_RGBA))
+            ? _mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 )
+            : _mm_setr_epi8( 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1 );
+        for ( ; i + 6<=width; i+=4 )
+        {
+            __m128i p = _mm_loadu_si128( (const __m128i*)(src + i * 3) );
+            _mm_storeu_si128( (__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(p, shuffle), alpha) );
+        }
+    }
+    else if ( srcRGBA && (dstFormat==GL_RGB || dstFormat==GL_BGR) )
+    {
+        const __m128i shuffle = ((srcFormat==GL_RGBA)==(dstFormat==GL_RGB))
+            ? _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 )
+            : _mm_setr_epi8( 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1 );
+        for ( ; i + 4<=width; i+=4 )
+        {
+            __m128i p = _mm_shuffle_epi8( _mm_loadu_si128((const __m128i*)(src + i * 4)), shuffle );
+            int last = _mm_cvtsi128_si32( _mm_srli_si128(p, 8) );
+            _mm_storel_epi64( (__m128i*)(dst + i * 3), p );
+            memcpy( dst + i * 3 + 8, &last, 4 );
+        }
+    }
+#endif
+    return i;
+}
+
+#endif
+
+/* PixelConverter */
+
+unsigned int PixelConverter::getNumComponents( GLenum format )
+{
+    switch ( format )
+    {
+    case GL_ALPHA: case GL_LUMINANCE: case GL_INTENSITY: return 1;
+    case GL_RGB: case GL_BGR: return 3;
+    case GL_RGBA: case GL_BGRA: return 4;
+    default: return 0;
+    }
+}
+
+bool PixelConverter::convertRow( const unsigned char* src, GLenum srcFormat,
+                                 unsigned char* dst, GLenum dstFormat, unsigned int width )
+{
+#ifdef OSGAGG_USE_SSE2
+    unsigned int numConverted = convertPixelsSIMD( src, srcFormat, dst, dstFormat, width );
+    if ( numConverted==width ) return true;
+    src += numConverted * getNumComponents(srcFormat);
+    dst += numConverted * getNumComponents(dstFormat);
+    width -= numConverted;
+#endif
+    return convertRowScalar( src, srcFormat, dst, dstFormat, width );
+}
+
+void PixelConverter::blendRow( const unsigned char* src, unsigned char* dst, unsigned int width )
+{
+#ifdef OSGAGG_USE_SSE2
+    // dst = (dst * (256 - a) + src * a) >> 8 for colors and a + da - ((a * da + 255) >> 8) for alpha,
+    // all fitting in 16 bits; pixels with full alpha are copied and transparent ones unchanged
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi32( 255 );
+    const __m128i base = _mm_set1_epi16( 256 );
+    const __m128i mask = _mm_set1_epi16( 255 );
+    const __m128i alphaLanes = _mm_set_epi16( -1, 0, 0, 0, -1, 0, 0, 0 );
+    unsigned int i = 0;
+    for ( ; i + 4<=width; i+=4 )
+    {
+        __m128i s = _mm_loadu_si128( (const __m128i*)(src + i * 4) );
+        __m128i a = _mm_srli_epi32( s, 24 );
+        if ( _mm_movemask_epi8(_mm_cmpeq_epi32(a, zero))==0xFFFF ) continue;
+        
+        __m128i opaque = _mm_cmpeq_epi32( a, full );
+        __m128i* out = (__m128i*)(dst + i * 4);
+        if ( _mm_movemask_epi8(opaque)==0xFFFF ) { _mm_storeu_si128( out, s ); continue; }
+        
+        __m128i d = _mm_loadu_si128( out );
+        a = _mm_or_si128( a, _mm_slli_epi32(a, 16) );
+        __m128i result[2];
+        for ( int k=0; k<2; ++k )
+        {
+            __m128i a16 = k ? _mm_unpackhi_epi32( a, a ) : _mm_unpacklo_epi32( a, a );
+            __m128i s16 = k ? _mm_unpackhi_epi8( s, zero ) : _mm_unpacklo_epi8( s, zero );
+            __m128i d16 = k ? _mm_unpackhi_epi8( d, zero ) : _mm_unpacklo_epi8( d, zero );
+            __m128i color = _mm_srli_epi16( _mm_add_epi16(_mm_mullo_epi16(d16, _mm_sub_epi16(base, a16)),
+                                                          _mm_mullo_epi16(s16, a16)), 8 );
+            __m128i alpha = _mm_sub_epi16( _mm_add_epi16(a16, d16),
+                                           _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(a16, d16), mask), 8) );
+            result[k] = _mm_or_si128( _mm_andnot_si128(alphaLanes, color), _mm_and_si128(alphaLanes, alpha) );
+        }
+        
+        __m128i blended = _mm_packus_epi16( result[0], result[1] );
+        _mm_storeu_si128( out, _mm_or_si128(_mm_and_si128(opaque, s), _mm_andnot_si128(opaque, blended)) );
+    }
+    if ( i<width ) blendRowScalar( src + i * 4, dst + i * 4, width - i );
+#else
+    blendRowScalar( src, dst, width );
+#endif
+}
+
+bool PixelConverter::convertRowScalar( const unsigned char* src, GLenum srcFormat,
+                                       unsigned char* dst, GLenum dstFormat, unsigned int width )
+{
+    if ( srcFormat==dstFormat || (isGray(srcFormat) && isGray(dstFormat)) )
+    {
+        memcpy( dst, src, width * getNumComponents(srcFormat) );
+        return getNumComponents(srcFormat)>0;
+    }
+    
+    switch ( srcFormat )
+    {
+    case GL_ALPHA: return convertPixelsFrom<ReadAlpha>( src, dst, dstFormat, width );
+    case GL_LUMINANCE: return convertPixelsFrom<ReadLuminance>( src, dst, dstFormat, width );
+    case GL_INTENSITY: return convertPixelsFrom<ReadIntensity>( src, dst, dstFormat, width );
+    case GL_RGB: return convertPixelsFrom<ReadRGB>( src, dst, dstFormat, width );
+    case GL_BGR: return convertPixelsFrom<ReadBGR>( src, dst, dstFormat, width );
+    case GL_RGBA: return convertPixelsFrom<ReadRGBA>( src, dst, dstFormat, width );
+    case GL_BGRA: return convertPixelsFrom<ReadBGRA>( src, dst, dstFormat, width );
+    default: return false;
+    }
+}
+
+void PixelConverter::blendRowScalar( const unsigned char* src, unsigned char* dst, unsigned int width )
+{
+    for ( unsigned int i=0; i<width; ++i, src+=4, dst+=4 )
+    {
+        unsigned int alpha = src[3];
+        if ( alpha==255 )
+            memcpy( dst, src, 4 );
+        else if ( alpha>0 )
+        {
+            for ( int c=0; c<3; ++c )
+                dst[c] = (unsigned char)((dst[c] * (256 - alpha) + src[c] * alpha) >> 8);
+            dst[3] = (unsigned char)((alpha + dst[3]) - ((alpha * dst[3] + 255) >> 8));
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef H_PIXELCONVERTER
+#define H_PIXELCONVERTER
+
+#include <osg/Image>
+
+/** Row kernels for converting and blending 8-bit pixels, used by AggDrawer::drawImage().
+    SSE2 versions (and SSSE3 ones if enabled by the compiler) are used on x86 unless
+    OSGAGG_NO_SIMD is defined; scalar versions give the same results everywhere else */
+class PixelConverter
+{
+public:
+    /** Number of bytes of a pixel in supported formats: GL_ALPHA, GL_LUMINANCE, GL_INTENSITY,
+        GL_RGB, GL_BGR, GL_RGBA and GL_BGRA; 0 if the format is not supported */
+    static unsigned int getNumComponents( GLenum format );
+    
+    /** Convert a row of pixels. Gray pixels are expanded as (l, l, l, 255) for luminance,
+        (i, i, i, i) for intensity and (255, 255, 255, a) for alpha; color pixels are reduced to
+        gray with the (77, 150, 29) / 256 weights as Agg does */
+    static bool convertRow( const unsigned char* src, GLenum srcFormat,
+                            unsigned char* dst, GLenum dstFormat, unsigned int width );
+    
+    /** Blend a row of non-premultiplied RGBA (or BGRA) pixels onto the same kind of pixels.
+        The results are the same as agg::pixfmt_rgba32::blend_color_hspan() without covers */
+    static void blendRow( const unsigned char* src, unsigned char* dst, unsigned int width );
+    
+    /** Scalar versions of above kernels */
+    static bool convertRowScalar( const unsigned char* src, GLenum srcFormat,
+                                  unsigned char* dst, GLenum dstFormat, unsigned int width );
+    static void blendRowScalar( const unsigned char* src, unsigned char* dst, unsigned int width );
+};
+
+#endif
@@ -2,11 +2,15 @@
 
 #include <osg/Image>
 #include <osg/MatrixTransform>
+#include <osg/Timer>
 #include <osgDB/ReadFile>
 #include <osgGA/StateSetManipulator>
 #include <osgViewer/ViewerEventHandlers>
 #include <osgViewer/Viewer>
+#include <util/agg_color_conv_rgb8.h>
+#include <cstring>
 
+#include "PixelConverter.h"
 #include "Drawer2D.h"
 
 osg::Node* createImageQuad( osg::Image* image, const osg::Vec3& corner )
@@ -15,6 +19,14 @@ osg::Node* createImageQuad( osg::Image* image, const osg::Vec3& corner )
     texture->setImage( image );
     texture->setResizeNonPowerOfTwoHint( false );
     
+    AggDrawer* drawer = dynamic_cast<AggDrawer*>( image );
+    if ( drawer )
+    {
+        // Only upload changed areas of the drawer later
+        texture->setFilter( osg::Texture::MIN_FILTER, osg::Texture::LINEAR );
+        texture->setSubloadCallback( new AggSubloadCallback(drawer) );
+    }
+    
     osg::ref_ptr<osg::Drawable> quad = osg::createTexturedQuadGeometry(
         corner, osg::Vec3(1.0f, 0.0f, 0.0f), osg::Vec3(0.0f, 0.0f, 1.0f) );
     quad->getOrCreateStateSet()->setTextureAttributeAndModes( 0, texture.get() );
@@ -29,9 +41,204 @@ osg::Node* createImageQuad( osg::Image* image, const osg::Vec3& corner )
     return geode.release();
 }
 
+class GaugeCallback : public osg::NodeCallback
+{
+public:
+    GaugeCallback( AggDrawer* image, const osg::Vec2& center, float radius )
+    :   _image(image), _center(center), _radius(radius) {}
+    
+    virtual void operator()( osg::Node* node, osg::NodeVisitor* nv )
+    {
+        // Redraw a small gauge every frame, and only its area will be uploaded
+        float angle = nv->getFrameStamp() ? nv->getFrameStamp()->getSimulationTime() : 0.0f;
+        _image->setPenWidth( 2.0f );
+        _image->setPenColor( 255, 255, 255 );
+        _image->setBrushColor( 40, 40, 40 );
+        _image->drawCircle( _center, _radius, true );
+        
+        _image->setPenColor( 255, 0, 0 );
+        _image->drawLine( _center, _center + osg::Vec2(cosf(angle), sinf(angle)) * (_radius * 0.8f) );
+        traverse( node, nv );
+    }
+    
+protected:
+    osg::ref_ptr<AggDrawer> _image;
+    osg::Vec2 _center;
+    float _radius;
+};
+
+void drawRandomShapes( AggDrawer* image, int size, int numShapes )
+{
+    srand( 0 );
+    image->clear( 0, 0, 100, 80 );
+    for ( int i=0; i<numShapes; ++i )
+    {
+        osg::Vec2 pos( rand() % size, rand() % size );
+        float radius = 2.0f + (float)(rand() % 60);
+        image->setPenColor( rand() % 256, rand() % 256, rand() % 256, 128 + rand() % 128 );
+        image->setBrushColor( rand() % 256, rand() % 256, rand() % 256, rand() % 256 );
+        image->setPenWidth( 1.0f + (float)(rand() % 5) );
+        switch ( i % 4 )
+        {
+        case 0: image->drawCircle( pos, radius, (i % 8)==0 ); break;
+        case 1: image->drawLine( pos, osg::Vec2(rand() % size, rand() % size) ); break;
+        case 2: image->drawRoundedRectangle( pos, radius * 2.0f, radius, 5.0f, true ); break;
+        default: image->drawPie( pos, radius, 0.2f, 2.0f ); break;
+        }
+    }
+}
+
+int runBenchmark( int size, int numShapes )
+{
+    osg::ref_ptr<AggDrawer> serialImage = new AggDrawer;
+    serialImage->allocateImage( size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE );
+    
+    osg::Timer_t t0 = osg::Timer::instance()->tick();
+    drawRandomShapes( serialImage.get(), size, numShapes );
+    std::cout << "Serial: " << osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick()) << "ms" << std::endl;
+    
+    const int numThreads[4] = { 1, 4, 8, 16 };
+    for ( int i=0; i<4; ++i )
+    {
+        osg::ref_ptr<AggDrawer> image = new AggDrawer;
+        image->allocateImage( size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE );
+        image->setDeferred( true );
+        image->setNumThreads( numThreads[i] );
+        
+        t0 = osg::Timer::instance()->tick();
+        drawRandomShapes( image.get(), size, numShapes );
+        osg::Timer_t t1 = osg::Timer::instance()->tick();
+        image->flush();
+        osg::Timer_t t2 = osg::Timer::instance()->tick();
+        
+        bool identical = memcmp( image->data(), serialImage->data(), image->getTotalSizeInBytes() )==0;
+        std::cout << "Deferred, " << numThreads[i] << " threads: Record " << osg::Timer::instance()->delta_m(t0, t1)
+                  << "ms, Flush " << osg::Timer::instance()->delta_m(t1, t2) << "ms, "
+                  << (identical ? "identical to serial" : "DIFFERENT from serial") << std::endl;
+    }
+    
+    // Small frames flushed one after another, where the threads of the drawer are reused
+    int numFrameShapes = osg::maximum(numShapes / 100, 1);
+    for ( int i=0; i<4; ++i )
+    {
+        osg::ref_ptr<AggDrawer> image = new AggDrawer;
+        image->allocateImage( size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE );
+        image->setDeferred( true );
+        image->setNumThreads( numThreads[i] );
+        
+        t0 = osg::Timer::instance()->tick();
+        for ( int f=0; f<100; ++f )
+        {
+            drawRandomShapes( image.get(), size, numFrameShapes );
+            image->flush();
+        }
+        std::cout << "Deferred, " << numThreads[i] << " threads: 100 frames of " << numFrameShapes << " shapes "
+                  << osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick()) / 100.0 << "ms per frame" << std::endl;
+    }
+    
+    // Map symbols drawn one by one, compared with replaying a recorded display list
+    osg::ref_ptr<AggDrawer> symbolImage = new AggDrawer;
+    symbolImage->allocateImage( size, size, 1, GL_RGBA, GL_UNSIGNED_BYTE );
+    symbolImage->setPenWidth( 2.0f );
+    std::vector<osg::Vec2> symbolPositions;
+    for ( int i=0; i<5000; ++i )
+        symbolPositions.push_back( osg::Vec2(rand() % size, rand() % size) );
+    
+    t0 = osg::Timer::instance()->tick();
+    for ( unsigned int i=0; i<symbolPositions.size(); ++i )
+    {
+        const osg::Vec2& pos = symbolPositions[i];
+        symbolImage->drawCircle( pos, 8.0f, true );
+        symbolImage->drawRoundedRectangle( pos + osg::Vec2(0.0f, 12.0f), 16.0f, 6.0f, 2.0f, true );
+    }
+    osg::Timer_t t1 = osg::Timer::instance()->tick();
+    
+    symbolImage->beginDisplayList();
+    symbolImage->drawCircle( osg::Vec2(), 8.0f, true );
+    symbolImage->drawRoundedRectangle( osg::Vec2(0.0f, 12.0f), 16.0f, 6.0f, 2.0f, true );
+    osg::ref_ptr<AggDrawer::DisplayList> symbol = symbolImage->endDisplayList();
+    
+    osg::Timer_t t2 = osg::Timer::instance()->tick();
+    for ( unsigned int i=0; i<symbolPositions.size(); ++i )
+        symbolImage->drawDisplayList( symbol.get(), symbolPositions[i] );
+    osg::Timer_t t3 = osg::Timer::instance()->tick();
+    std::cout << "5000 symbols: Direct " << osg::Timer::instance()->delta_m(t0, t1) << "ms, Display list "
+              << osg::Timer::instance()->delta_m(t2, t3) << "ms" << std::endl;
+    
+    // Pixel format conversion, compared with Agg's color_conv()
+    osg::ref_ptr<osg::Image> sprite = new osg::Image;
+    sprite->allocateImage( 256, 256, 1, GL_RGB, GL_UNSIGNED_BYTE );
+    for ( unsigned int i=0; i<sprite->getTotalSizeInBytes(); ++i ) sprite->data()[i] = rand() % 256;
+    
+    std::vector<unsigned char> convertedData( 256 * 256 * 4 );
+    agg::rendering_buffer spriteBuffer( sprite->data(), 256, 256, 256 * 3 );
+    agg::rendering_buffer convertedBuffer( &(convertedData[0]), 256, 256, 256 * 4 );
+    t0 = osg::Timer::instance()->tick();
+    for ( int i=0; i<100; ++i )
+        agg::color_conv( &convertedBuffer, &spriteBuffer, agg::color_conv_rgb24_to_rgba32() );
+    t1 = osg::Timer::instance()->tick();
+    for ( int i=0; i<100; ++i )
+    {
+        for ( int r=0; r<256; ++r )
+            PixelConverter::convertRow( sprite->data(0, r), GL_RGB, &(convertedData[r * 256 * 4]), GL_RGBA, 256 );
+    }
+    t2 = osg::Timer::instance()->tick();
+    std::cout << "100 RGB to RGBA conversions: Agg " << osg::Timer::instance()->delta_m(t0, t1) << "ms, "
+              << "PixelConverter " << osg::Timer::instance()->delta_m(t1, t2) << "ms" << std::endl;
+    
+    // Blending translucent images, compared with Agg's image spans (forced by an identity transform)
+    osg::ref_ptr<osg::Image> translucentSprite = new osg::Image;
+    translucentSprite->allocateImage( 256, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE );
+    for ( unsigned int i=0; i<translucentSprite->getTotalSizeInBytes(); ++i )
+        translucentSprite->data()[i] = rand() % 256;
+    
+    t0 = osg::Timer::instance()->tick();
+    symbolImage->translate( 0.0f, 0.0f );
+    for ( int i=0; i<200; ++i )
+        symbolImage->drawImage( symbolPositions[i], 256.0f, 256.0f, translucentSprite.get() );
+    symbolImage->resetTransform();
+    t1 = osg::Timer::instance()->tick();
+    for ( int i=0; i<200; ++i )
+        symbolImage->drawImage( symbolPositions[i], 256.0f, 256.0f, translucentSprite.get() );
+    t2 = osg::Timer::instance()->tick();
+    std::cout << "200 translucent images: Agg " << osg::Timer::instance()->delta_m(t0, t1) << "ms, "
+              << "Row blending " << osg::Timer::instance()->delta_m(t1, t2) << "ms" << std::endl;
+    
+    // Blurring a 2048x2048 RGBA image, with box passes in threads and Agg's blur classes
+    osg::ref_ptr<AggDrawer> blurImage = new AggDrawer;
+    blurImage->allocateImage( 2048, 2048, 1, GL_RGBA, GL_UNSIGNED_BYTE );
+    std::cout << "Blurring 2048x2048 with radius 16:";
+    for ( int i=0; i<3; ++i )
+    {
+        memcpy( blurImage->data(), symbolImage->data(), osg::minimum(blurImage->getTotalSizeInBytes(),
+                                                                    symbolImage->getTotalSizeInBytes()) );
+        blurImage->setNumThreads( numThreads[i] );
+        t0 = osg::Timer::instance()->tick();
+        blurImage->blur( 16.0f );
+        std::cout << " Box (" << numThreads[i] << " threads) "
+                  << osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick()) << "ms,";
+    }
+    
+    t0 = osg::Timer::instance()->tick();
+    blurImage->blur( 16.0f, AggDrawer::STACK_BLUR );
+    t1 = osg::Timer::instance()->tick();
+    blurImage->blur( 16.0f, AggDrawer::RECURSIVE_BLUR );
+    t2 = osg::Timer::instance()->tick();
+    std::cout << " Stack " << osg::Timer::instance()->delta_m(t0, t1) << "ms, Recursive "
+              << osg::Timer::instance()->delta_m(t1, t2) << "ms" << std::endl;
+    return 0;
+}
+
 int main( int argc, char** argv )
 {
     osg::ArgumentParser arguments( &argc, argv );
+    
+    // Headless rasterization benchmark, e.g. --benchmark 4096 --shapes 20000
+    int benchmarkSize = 0, numShapes = 20000;
+    arguments.read( "--shapes", numShapes );
+    if ( arguments.read("--benchmark", benchmarkSize) )
+        return runBenchmark( benchmarkSize, numShapes );
+    
     osgViewer::Viewer viewer;
     
     osg::ref_ptr<AggDrawer> image = new AggDrawer;
@@ -90,6 +297,7 @@ int main( int argc, char** argv )
     
     osg::ref_ptr<osg::Group> root = new osg::Group;
     root->addChild( createImageQuad(image.get(), osg::Vec3()) );
+    root->addUpdateCallback( new GaugeCallback(image.get(), osg::Vec2(900.0f, 900.0f), 60.0f) );
     root->addChild( osgDB::readNodeFiles(arguments) );
     
     viewer.addEventHandler( new osgGA::StateSetManipulator(viewer.getCamera()->getOrCreateStateSet()) );
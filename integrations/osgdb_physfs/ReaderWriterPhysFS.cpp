@@ -5,9 +5,168 @@
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReadFile>
+#include <OpenThreads/Condition>
+#include <OpenThreads/Mutex>
+#include <OpenThreads/ScopedLock>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
+#include <vector>
 
+/** Limits the number of PhysFS reads running at the same time, 0 means no limit. A slot is
+    only held while PhysFS opens, reads or seeks, never while a reader parses, so nested reads
+    of the same thread can't wait for themselves */
+class PhysFSReadSlots
+{
+public:
+    PhysFSReadSlots() : _maximum(0), _used(0) {}
+    
+    /** Must be set before any thread reads */
+    void setMaximum( unsigned int maximum ) { _maximum = maximum; }
+    
+    void acquire()
+    {
+        if ( !_maximum ) return;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        while ( _used>=_maximum ) _condition.wait( &_mutex );
+        _used++;
+    }
+    
+    void release()
+    {
+        if ( !_maximum ) return;
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mutex );
+        _used--;
+        _condition.signal();
+    }
+    
+    struct ScopedSlot
+    {
+        ScopedSlot( PhysFSReadSlots& slots ) : _slots(slots) { _slots.acquire(); }
+        ~ScopedSlot() { _slots.release(); }
+        PhysFSReadSlots& _slots;
+    };
+    
+protected:
+    OpenThreads::Mutex _mutex;
+    OpenThreads::Condition _condition;
+    unsigned int _maximum, _used;
+};
+
+/** Read-only stream buffer over a PhysFS file, filled by reading ahead in blocks of the
+    given size. Large reads go straight into the caller's memory and seeks within the
+    current block don't touch the file. Each access to the file takes one of the given read
+    slots. The file is closed with the buffer. */
+class PhysFSStreamBuf : public std::streambuf
+{
+public:
+    PhysFSStreamBuf( PHYSFS_File* handle, unsigned int bufferSize, PhysFSReadSlots& slots )
+    :   _handle(handle), _slots(slots), _buffer(std::max(bufferSize, 16u)), _bufferStart(0)
+    { setg( &_buffer[0], &_buffer[0], &_buffer[0] ); }
+    
+    virtual ~PhysFSStreamBuf()
+    { PHYSFS_close( _handle ); }
+    
+protected:
+    virtual int_type underflow()
+    {
+        if ( gptr()<egptr() ) return traits_type::to_int_type( *gptr() );
+        
+        _bufferStart += egptr() - eback();
+        PHYSFS_sint64 count = read( &_buffer[0], _buffer.size() );
+        if ( count<=0 )
+        {
+            setg( &_buffer[0], &_buffer[0], &_buffer[0] );
+            return traits_type::eof();
+        }
+        setg( &_buffer[0], &_buffer[0], &_buffer[0] + count );
+        return traits_type::to_int_type( *gptr() );
+    }
+    
+    virtual std::streamsize xsgetn( char* s, std::streamsize n )
+    {
+        std::streamsize done = std::min<std::streamsize>( n, egptr() - gptr() );
+        memcpy( s, gptr(), done );
+        gbump( (int)done );
+        if ( done==n ) return n;
+        
+        // Only small reads go through the buffer, larger ones would just be copied once more
+        if ( n - done<(std::streamsize)_buffer.size() )
+            return done + std::streambuf::xsgetn( s + done, n - done );
+        
+        _bufferStart += egptr() - eback();
+        setg( &_buffer[0], &_buffer[0], &_buffer[0] );
+        while ( done<n )
+        {
+            PHYSFS_uint32 size = (PHYSFS_uint32)std::min<std::streamsize>( n - done, 0x40000000 );
+            PHYSFS_sint64 count = read( s + done, size );
+            if ( count<=0 ) break;
+            done += count; _bufferStart += count;
+        }
+        return done;
+    }
+    
+    virtual std::streamsize showmanyc()
+    {
+        PHYSFS_sint64 length = PHYSFS_fileLength( _handle );
+        if ( length<0 ) return 0;
+        
+        PHYSFS_sint64 remaining = length - (_bufferStart + (egptr() - eback()));
+        return remaining>0 ? (std::streamsize)remaining : -1;
+    }
+    
+    virtual pos_type seekoff( off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which )
+    {
+        PHYSFS_sint64 pos = off;
+        if ( dir==std::ios_base::cur )
+            pos += _bufferStart + (gptr() - eback());
+        else if ( dir==std::ios_base::end )
+        {
+            PHYSFS_sint64 length = PHYSFS_fileLength( _handle );
+            if ( length<0 ) return pos_type(off_type(-1));
+            pos += length;
+        }
+        return seekpos( pos_type(off_type(pos)), which );
+    }
+    
+    virtual pos_type seekpos( pos_type sp, std::ios_base::openmode which )
+    {
+        PHYSFS_sint64 pos = (off_type)sp;
+        if ( !(which & std::ios_base::in) || pos<0 ) return pos_type(off_type(-1));
+        
+        // Stay in the current block if possible, e.g. when a reader checks a header and rewinds
+        PHYSFS_sint64 bufferEnd = _bufferStart + (egptr() - eback());
+        if ( pos>=_bufferStart && pos<=bufferEnd )
+        {
+            setg( eback(), eback() + (pos - _bufferStart), egptr() );
+            return sp;
+        }
+        
+        PhysFSReadSlots::ScopedSlot slot( _slots );
+        if ( !PHYSFS_seek(_handle, (PHYSFS_uint64)pos) ) return pos_type(off_type(-1));
+        _bufferStart = pos;
+        setg( &_buffer[0], &_buffer[0], &_buffer[0] );
+        return sp;
+    }
+    
+    PHYSFS_sint64 read( char* s, PHYSFS_uint32 size )
+    {
+        PhysFSReadSlots::ScopedSlot slot( _slots );
+        return PHYSFS_read( _handle, s, 1, size );
+    }
+    
+    PHYSFS_File* _handle;
+    PhysFSReadSlots& _slots;
+    std::vector<char> _buffer;
+    PHYSFS_sint64 _bufferStart;  // file offset of eback()
+};
+
+/** The DatabasePager may call the plugin from several threads at once. Each read opens a
+    PhysFS file of its own, which is never shared with other threads, so members of the same
+    or different archives are decompressed in parallel. Set OSG_PHYSFS_MAX_PARALLEL_READS to
+    limit how many PhysFS reads run at the same time, e.g. 1 to serialize all reads. */
 class ReaderWriterPhysFS : public osgDB::ReaderWriter
 {
 public:
@@ -15,6 +174,9 @@ public:
     {
         PHYSFS_init( NULL );
         supportsExtension( "physfs", "PhysicsFS virtual file system" );
+        
+        const char* maxReads = getenv( "OSG_PHYSFS_MAX_PARALLEL_READS" );
+        if ( maxReads ) _readSlots.setMaximum( getMaxParallelReads(maxReads) );
     }
     
     virtual ~ReaderWriterPhysFS()
@@ -31,11 +193,11 @@ public:
         osgDB::ReaderWriter* rw = handleOptions(fileName, options);
         if ( !rw ) return ReadResult::FILE_NOT_HANDLED;
         
-        std::string buffer;
-        if ( !readDataFromVFS(buffer, fileName) )
-            return ReadResult::ERROR_IN_READING_FILE;
+        PHYSFS_File* handle = openFromVFS( fileName );
+        if ( !handle ) return ReadResult::ERROR_IN_READING_FILE;
         
-        std::stringstream in; in << buffer;
+        PhysFSStreamBuf buffer( handle, getReadAheadSize(options), _readSlots );
+        std::istream in( &buffer );
         return rw->readNode( in, options );
     }
     
@@ -48,11 +210,11 @@ public:
         osgDB::ReaderWriter* rw = handleOptions(fileName, options);
         if ( !rw ) return ReadResult::FILE_NOT_HANDLED;
         
-        std::string buffer;
-        if ( !readDataFromVFS(buffer, fileName) )
-            return ReadResult::ERROR_IN_READING_FILE;
+        PHYSFS_File* handle = openFromVFS( fileName );
+        if ( !handle ) return ReadResult::ERROR_IN_READING_FILE;
         
-        std::stringstream in; in << buffer;
+        PhysFSStreamBuf buffer( handle, getReadAheadSize(options), _readSlots );
+        std::istream in( &buffer );
         return rw->readImage( in, options );
     }
     
@@ -70,32 +232,46 @@ public:
     }
     
 protected:
-    bool readDataFromVFS( std::string& buffer, const std::string& fileName ) const
+    PHYSFS_File* openFromVFS( const std::string& fileName ) const
     {
+        PhysFSReadSlots::ScopedSlot slot( _readSlots );
         PHYSFS_File* handle = PHYSFS_openRead( fileName.c_str() );
         if ( !handle )
-        {
             OSG_NOTICE << "[ReaderWriterPhysFS] Cannot open requested file: " << fileName << std::endl;
-            return false;
-        }
+        return handle;
+    }
+    
+    unsigned int getReadAheadSize( const Options* options ) const
+    {
+        // Set by options->setPluginStringData("readAheadSize", "<bytes>")
+        std::string value = options ? options->getPluginStringData("readAheadSize") : std::string();
+        if ( value.empty() ) return 65536;
         
-        PHYSFS_sint64 filesize = PHYSFS_fileLength( handle );
-        if ( filesize<=0 )
+        // Garbage or non-positive values fall back to the default, huge ones are clamped
+        // so that each stream never allocates more than 64 MB
+        char* end = NULL;
+        long size = strtol( value.c_str(), &end, 10 );
+        if ( end==value.c_str() || *end!='\0' || size<=0 )
         {
-            OSG_NOTICE << "[ReaderWriterPhysFS] Cannot determine file size: " << fileName << std::endl;
-            return false;
+            OSG_NOTICE << "[ReaderWriterPhysFS] Invalid readAheadSize " << value
+                       << ", using 65536 bytes" << std::endl;
+            return 65536;
         }
-        
-        buffer.resize( filesize + 1 );
-        PHYSFS_sint64 count = PHYSFS_read( handle, &(buffer[0]), filesize, 1 );
-        PHYSFS_close( handle );
-        
-        if ( count<0 )
+        return (unsigned int)std::min( size, 64L * 1024 * 1024 );
+    }
+    
+    unsigned int getMaxParallelReads( const char* value ) const
+    {
+        // Garbage or negative values keep the reads unlimited, huge ones are clamped
+        char* end = NULL;
+        long count = strtol( value, &end, 10 );
+        if ( end==value || *end!='\0' || count<0 )
         {
-            OSG_NOTICE << "[ReaderWriterPhysFS] Cannot read file data: " << fileName << std::endl;
-            return false;
+            OSG_NOTICE << "[ReaderWriterPhysFS] Invalid OSG_PHYSFS_MAX_PARALLEL_READS " << value
+                       << ", reads are not limited" << std::endl;
+            return 0;
         }
-        return true;
+        return (unsigned int)std::min( count, 1024L );
     }
     
     osgDB::ReaderWriter* handleOptions( const std::string& fileName, const Options* options ) const
@@ -110,16 +286,23 @@ protected:
         while ( std::getline(ss, line) )
         {
             std::string archiveName = osgDB::findDataFile( line, options );
-            if ( !archiveName.empty() && _readPhysfsFiles.find(archiveName)==_readPhysfsFiles.end() )
-            {
-                PHYSFS_addToSearchPath( archiveName.c_str(), 1 );
+            if ( archiveName.empty() ) continue;
+            
+            // Mount each archive once, even if several threads ask for it at the same time
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock( _mountMutex );
+            if ( _readPhysfsFiles.find(archiveName)!=_readPhysfsFiles.end() ) continue;
+            
+            if ( PHYSFS_addToSearchPath(archiveName.c_str(), 1) )
                 _readPhysfsFiles.insert( archiveName );
-            }
+            else
+                OSG_NOTICE << "[ReaderWriterPhysFS] Cannot mount archive: " << archiveName << std::endl;
         }
         return rw;
     }
     
+    mutable OpenThreads::Mutex _mountMutex;
     mutable std::set<std::string> _readPhysfsFiles;
+    mutable PhysFSReadSlots _readSlots;
 };
 
 REGISTER_OSGPLUGIN( physfs, ReaderWriterPhysFS )
@@ -0,0 +1,171 @@
+#include <physfs.h>
+
+#include <osg/ArgumentParser>
+#include <osg/Timer>
+#include <osgDB/FileNameUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+#include <OpenThreads/Thread>
+#include <iostream>
+#include <sstream>
+
+#ifndef WIN32
+#include <sys/resource.h>
+#endif
+
+double getPeakMemoryMB()
+{
+#ifndef WIN32
+    struct rusage usage;
+    getrusage( RUSAGE_SELF, &usage );
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#else
+    return 0.0;
+#endif
+}
+
+/** Reads the member the way the plugin used to, into a string and then a stringstream */
+osg::ref_ptr<osg::Object> readByCopy( const std::string& member, bool image )
+{
+    osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(
+        osgDB::getLowerCaseFileExtension(member) );
+    PHYSFS_File* handle = rw ? PHYSFS_openRead( member.c_str() ) : NULL;
+    if ( !handle ) return NULL;
+    
+    std::string buffer;
+    buffer.resize( PHYSFS_fileLength(handle) + 1 );
+    PHYSFS_read( handle, &(buffer[0]), buffer.size() - 1, 1 );
+    PHYSFS_close( handle );
+    
+    std::stringstream in; in << buffer;
+    if ( image ) return rw->readImage( in ).getImage();
+    return rw->readNode( in ).getNode();
+}
+
+bool readMember( const std::string& member, bool image, bool copy, const osgDB::Options* options )
+{
+    osg::ref_ptr<osg::Object> object;
+    if ( copy ) object = readByCopy( member, image );
+    else if ( image ) object = osgDB::readImageFile( member + ".physfs", options );
+    else object = osgDB::readNodeFile( member + ".physfs", options );
+    
+    if ( !object ) OSG_WARN << "Failed to read " << member << std::endl;
+    return object.valid();
+}
+
+/** Reads members one after another like a DatabasePager thread */
+class ReadThread : public OpenThreads::Thread
+{
+public:
+    ReadThread( const std::vector<std::string>& members, int first, int count,
+                bool image, bool copy, const osgDB::Options* options )
+    :   numFailed(0), _members(members), _first(first), _count(count),
+        _image(image), _copy(copy), _options(options) {}
+    
+    virtual void run()
+    {
+        for ( int i=0; i<_count; ++i )
+        {
+            if ( !readMember(_members[(_first + i) % _members.size()], _image, _copy, _options.get()) )
+                numFailed++;
+        }
+    }
+    
+    int numFailed;
+    
+protected:
+    std::vector<std::string> _members;
+    int _first, _count;
+    bool _image, _copy;
+    osg::ref_ptr<const osgDB::Options> _options;
+};
+
+int main( int argc, char** argv )
+{
+    osg::ArgumentParser arguments( &argc, argv );
+    arguments.getApplicationUsage()->setDescription( arguments.getApplicationName() +
+        " is the example which measures the time and memory of reading members of an archive with the osgdb_physfs plugin from one or more threads.");
+    arguments.getApplicationUsage()->setCommandLineUsage( arguments.getApplicationName() +
+        " [options] archive.zip member.osgb [member2.osgb ...]");
+    arguments.getApplicationUsage()->addCommandLineOption( "--image", "Read the member as an image" );
+    arguments.getApplicationUsage()->addCommandLineOption( "--copy", "Read the whole member into memory first, as the plugin used to" );
+    arguments.getApplicationUsage()->addCommandLineOption( "--read-ahead <bytes>", "Read-ahead buffer size of the plugin stream" );
+    arguments.getApplicationUsage()->addCommandLineOption( "--repeat <n>", "Number of members each thread reads" );
+    arguments.getApplicationUsage()->addCommandLineOption( "--threads <n>", "Number of threads reading members at the same time" );
+    arguments.getApplicationUsage()->addCommandLineOption( "-h or --help", "Display this information" );
+    if ( arguments.read("-h") || arguments.read("--help") )
+    {
+        arguments.getApplicationUsage()->write( std::cout );
+        return 1;
+    }
+    
+    int repeat = 5, numThreads = 1;
+    std::string readAhead;
+    bool image = arguments.read("--image"), copy = arguments.read("--copy");
+    arguments.read( "--repeat", repeat );
+    arguments.read( "--threads", numThreads );
+    arguments.read( "--read-ahead", readAhead );
+    
+    if ( arguments.argc()<3 )
+    {
+        arguments.getApplicationUsage()->write( std::cout );
+        return 1;
+    }
+    
+    std::string archive = arguments[1];
+    std::vector<std::string> members;
+    for ( int i=2; i<arguments.argc(); ++i ) members.push_back( arguments[i] );
+    
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options;
+    options->setOptionString( archive );
+    if ( !readAhead.empty() ) options->setPluginStringData( "readAheadSize", readAhead );
+    
+    // The plugin may not have initialized PhysFS yet, or may use a copy of its own
+    if ( !PHYSFS_isInit() ) PHYSFS_init( argv[0] );
+    PHYSFS_addToSearchPath( archive.c_str(), 1 );
+    std::vector<double> memberSizes;
+    for ( unsigned int i=0; i<members.size(); ++i )
+    {
+        PHYSFS_File* handle = PHYSFS_openRead( members[i].c_str() );
+        if ( !handle )
+        {
+            OSG_WARN << "Cannot open " << members[i] << " in " << archive << std::endl;
+            return 1;
+        }
+        memberSizes.push_back( (double)PHYSFS_fileLength(handle) );
+        PHYSFS_close( handle );
+    }
+    
+    // Load the plugin and mount the archive before timing
+    double baseMemory = getPeakMemoryMB(), totalSize = 0.0;
+    if ( !readMember(members[0], image, copy, options.get()) ) return 1;
+    
+    std::vector<ReadThread*> threads;
+    for ( int t=0; t<numThreads; ++t )
+    {
+        threads.push_back( new ReadThread(members, t, repeat, image, copy, options.get()) );
+        for ( int i=0; i<repeat; ++i ) totalSize += memberSizes[(t + i) % members.size()];
+    }
+    
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for ( int t=0; t<numThreads; ++t ) threads[t]->start();
+    
+    int numFailed = 0;
+    for ( int t=0; t<numThreads; ++t )
+    {
+        threads[t]->join();
+        numFailed += threads[t]->numFailed;
+        delete threads[t];
+    }
+    
+    double elapsed = osg::Timer::instance()->delta_s( start, osg::Timer::instance()->tick() );
+    std::cout << (copy ? "Copy: " : "Stream: ") << numThreads << " threads read " << numThreads * repeat
+              << " members of " << totalSize / (1024.0 * 1024.0) << " MB in " << elapsed << "s, "
+              << totalSize / (elapsed * 1024.0 * 1024.0) << " MB/s, " << numFailed << " failed"
+              << ", peak memory " << getPeakMemoryMB() << " MB (" << baseMemory << " MB before reading)" << std::endl;
+    return numFailed>0 ? 1 : 0;
+}
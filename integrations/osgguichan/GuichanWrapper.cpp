@@ -1,8 +1,31 @@
 #include "GuichanWrapper.h"
+#include <osg/Version>
 #include <osgDB/ReadFile>
 #include <osgDB/FileUtils>
 #include <osgGA/EventVisitor>
 
+#ifndef GL_FRAMEBUFFER_BINDING_EXT
+#   define GL_FRAMEBUFFER_BINDING_EXT 0x8CA6
+#endif
+
+static bool isFrameBufferSupported( osg::State& state )
+{
+#if OSG_MIN_VERSION_REQUIRED(3,3,2)
+    return state.get<osg::GLExtensions>()->isFrameBufferObjectSupported;
+#else
+    return osg::FBOExtensions::instance(state.getContextID(), true)->isSupported();
+#endif
+}
+
+static void bindFrameBuffer( osg::State& state, GLuint fbo )
+{
+#if OSG_MIN_VERSION_REQUIRED(3,3,2)
+    state.get<osg::GLExtensions>()->glBindFramebuffer( GL_FRAMEBUFFER_EXT, fbo );
+#else
+    osg::FBOExtensions::instance(state.getContextID(), true)->glBindFramebuffer( GL_FRAMEBUFFER_EXT, fbo );
+#endif
+}
+
 gcn::Image* GuichanImageLoader::load( const std::string& filename, bool convertToDisplayFormat )
 {
     osg::Image* osgImage = osgDB::readImageFile( filename );
@@ -213,13 +236,28 @@ void GuichanEventInput::convertModKeyValue( gcn::KeyInput& keyInput, int modkey
     keyInput.setMetaPressed( (modkey&osgGA::GUIEventAdapter::MODKEY_META)!=0 );
 }
 
+GuichanGraphics::GuichanGraphics()
+:   _premultipliedState(NULL)
+{
+    // Color is blended as usual, but alpha is accumulated so that the result is premultiplied
+    _premultipliedBlendFunc = new osg::BlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+                                                  GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+}
+
+void GuichanGraphics::_beginDraw()
+{
+    gcn::OpenGLGraphics::_beginDraw();
+    if ( _premultipliedState )
+        _premultipliedBlendFunc->apply( *_premultipliedState );
+}
+
 GuichanDrawable::GuichanDrawable()
-:   _activeContextID(0), _initialized(false)
+:   _activeContextID(0), _numRedrawnAreas(0), _initialized(false), _retained(false)
 {
     _container = new gcn::Container;
     _container->setOpaque( false );
     
-    _graphics = new gcn::OpenGLGraphics;
+    _graphics = new GuichanGraphics;
     _imageLoader = new GuichanImageLoader;
     _input = new GuichanEventInput(this);
     
@@ -237,7 +275,8 @@ GuichanDrawable::GuichanDrawable( const GuichanDrawable& copy, const osg::CopyOp
 :   osg::Drawable(copy, copyop),
     _input(copy._input), _gui(copy._gui), _container(copy._container),
     _graphics(copy._graphics), _imageLoader(copy._imageLoader),
-    _activeContextID(copy._activeContextID), _initialized(copy._initialized)
+    _texture(copy._texture), _fbo(copy._fbo), _activeContextID(copy._activeContextID),
+    _numRedrawnAreas(copy._numRedrawnAreas), _initialized(copy._initialized), _retained(copy._retained)
 {
 }
 
@@ -253,7 +292,7 @@ GuichanDrawable::~GuichanDrawable()
 void GuichanDrawable::setContainerSize( int x, int y, int width, int height )
 {
     _container->setDimension( gcn::Rectangle(x, y, width, height) );
-    static_cast<gcn::OpenGLGraphics*>(_graphics)->setTargetPlane( width, height );
+    static_cast<GuichanGraphics*>(_graphics)->setTargetPlane( width, height );
 }
 
 void GuichanDrawable::drawImplementation( osg::RenderInfo& renderInfo ) const
@@ -280,9 +319,101 @@ void GuichanDrawable::drawImplementation( osg::RenderInfo& renderInfo ) const
         state->disableTexCoordPointer( 0 );
         
         glPushAttrib( GL_ALL_ATTRIB_BITS );
-        _gui->draw();
+        if ( !_retained || !drawRetained(*state) )
+            _gui->draw();
         glPopAttrib();
     }
     else
         std::cout << "Multiple contexts are not supported at present!" << std::endl;
 }
+
+void GuichanDrawable::releaseGLObjects( osg::State* state ) const
+{
+    osg::Drawable::releaseGLObjects( state );
+    if ( _texture.valid() ) _texture->releaseGLObjects( state );
+    if ( _fbo.valid() ) _fbo->releaseGLObjects( state );
+}
+
+bool GuichanDrawable::drawRetained( osg::State& state ) const
+{
+    GuichanGraphics* graphics = static_cast<GuichanGraphics*>( _graphics );
+    int width = graphics->getTargetPlaneWidth(), height = graphics->getTargetPlaneHeight();
+    if ( width<=0 || height<=0 || !isFrameBufferSupported(state) ) return false;
+    
+    if ( !_texture || _texture->getTextureWidth()!=width || _texture->getTextureHeight()!=height )
+    {
+        if ( _texture.valid() ) _texture->releaseGLObjects( &state );
+        if ( _fbo.valid() ) _fbo->releaseGLObjects( &state );
+        _texture = new osg::Texture2D;
+        _texture->setTextureSize( width, height );
+        _texture->setInternalFormat( GL_RGBA );
+        _texture->setFilter( osg::Texture2D::MIN_FILTER, osg::Texture2D::NEAREST );
+        _texture->setFilter( osg::Texture2D::MAG_FILTER, osg::Texture2D::NEAREST );
+        _texture->setWrap( osg::Texture2D::WRAP_S, osg::Texture2D::CLAMP_TO_EDGE );
+        _texture->setWrap( osg::Texture2D::WRAP_T, osg::Texture2D::CLAMP_TO_EDGE );
+        
+        _fbo = new osg::FrameBufferObject;
+        _fbo->setAttachment( osg::Camera::COLOR_BUFFER, osg::FrameBufferAttachment(_texture.get()) );
+        _container->invalidate( gcn::Rectangle(-_container->getX(), -_container->getY(), width, height) );
+    }
+    
+    // Redraw invalidated areas only, clearing them first as widgets may not be opaque.
+    // The areas never overlap, so no pixel is cleared after it is drawn or blended twice
+    const std::vector<gcn::Rectangle>& areas = _gui->getInvalidatedAreas();
+    _numRedrawnAreas = areas.size();
+    if ( _numRedrawnAreas>0 )
+    {
+        GLint lastFBO = 0, lastViewport[4];
+        glGetIntegerv( GL_FRAMEBUFFER_BINDING_EXT, &lastFBO );
+        glGetIntegerv( GL_VIEWPORT, lastViewport );
+        _fbo->apply( state, osg::FrameBufferObject::READ_DRAW );
+        
+        glViewport( 0, 0, width, height );
+        glEnable( GL_SCISSOR_TEST );
+        glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
+        for ( unsigned int i=0; i<areas.size(); ++i )
+        {
+            const gcn::Rectangle& area = areas[i];
+            glScissor( area.x, height - area.y - area.height, area.width, area.height );
+            glClear( GL_COLOR_BUFFER_BIT );
+        }
+        
+        graphics->setPremultipliedState( &state );
+        _gui->drawInvalidated();
+        graphics->setPremultipliedState( NULL );
+        bindFrameBuffer( state, lastFBO );
+        glViewport( lastViewport[0], lastViewport[1], lastViewport[2], lastViewport[3] );
+    }
+    
+    // Draw the texture over the screen, with flipped texture coordinates as the GUI is top-down
+    glMatrixMode( GL_PROJECTION );
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho( 0.0, (double)width, (double)height, 0.0, -1.0, 1.0 );
+    glMatrixMode( GL_MODELVIEW );
+    glPushMatrix();
+    glLoadIdentity();
+    
+    state.setActiveTextureUnit( 0 );
+    state.applyTextureAttribute( 0, _texture.get() );
+    glEnable( GL_TEXTURE_2D );
+    glDisable( GL_LIGHTING );
+    glDisable( GL_DEPTH_TEST );
+    glDisable( GL_SCISSOR_TEST );
+    glEnable( GL_BLEND );
+    glBlendFunc( GL_ONE, GL_ONE_MINUS_SRC_ALPHA );
+    glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE );
+    
+    glBegin( GL_QUADS );
+    glTexCoord2f( 0.0f, 1.0f ); glVertex2i( 0, 0 );
+    glTexCoord2f( 0.0f, 0.0f ); glVertex2i( 0, height );
+    glTexCoord2f( 1.0f, 0.0f ); glVertex2i( width, height );
+    glTexCoord2f( 1.0f, 1.0f ); glVertex2i( width, 0 );
+    glEnd();
+    
+    glMatrixMode( GL_PROJECTION );
+    glPopMatrix();
+    glMatrixMode( GL_MODELVIEW );
+    glPopMatrix();
+    return true;
+}
@@ -10,8 +10,11 @@
 #include <guichan/opengl.hpp>
 #include <guichan/opengl/openglimage.hpp>
 
+#include <osg/BlendFunc>
 #include <osg/Camera>
 #include <osg/Drawable>
+#include <osg/FrameBufferObject>
+#include <osg/Texture2D>
 #include <osgGA/GUIEventHandler>
 #include <queue>
 
@@ -47,6 +50,23 @@ protected:
     std::queue<gcn::MouseInput> _mouseInputQueue;
 };
 
+/** OpenGL graphics which may keep the alpha channel premultiplied, for drawing into a texture
+    which is blended to the screen later */
+class GuichanGraphics : public gcn::OpenGLGraphics
+{
+public:
+    GuichanGraphics();
+    
+    /** Set the state to apply the premultiplied blending with, or NULL for normal blending */
+    void setPremultipliedState( osg::State* state ) { _premultipliedState = state; }
+    
+    virtual void _beginDraw();
+    
+protected:
+    osg::ref_ptr<osg::BlendFunc> _premultipliedBlendFunc;
+    osg::State* _premultipliedState;
+};
+
 class GuichanDrawable : public osg::Drawable
 {
 public:
@@ -64,18 +84,35 @@ public:
     gcn::Gui* getGUIElement() { return _gui; }
     const gcn::Gui* getGUIElement() const { return _gui; }
     
+    /** Set if the GUI is kept in a texture and only invalidated areas of it are redrawn.
+        Frames without any changes only draw one textured quad then. Disabled by default */
+    void setRetained( bool b ) { _retained = b; _container->invalidate(); }
+    bool getRetained() const { return _retained; }
+    
+    /** Number of areas redrawn into the texture in the last frame, in retained mode */
+    unsigned int getNumRedrawnAreas() const { return _numRedrawnAreas; }
+    
     virtual void drawImplementation( osg::RenderInfo& renderInfo ) const;
+    virtual void releaseGLObjects( osg::State* state=0 ) const;
     
 protected:
     virtual ~GuichanDrawable();
     
+    /** Redraw invalidated areas into the texture and draw the texture. Returns false if
+        the texture can't be rendered to, so that the GUI should be drawn directly */
+    bool drawRetained( osg::State& state ) const;
+    
     GuichanEventInput* _input;
     gcn::Gui* _gui;
     gcn::Container* _container;
     gcn::Graphics* _graphics;
     gcn::ImageLoader* _imageLoader;
+    mutable osg::ref_ptr<osg::Texture2D> _texture;
+    mutable osg::ref_ptr<osg::FrameBufferObject> _fbo;
     mutable unsigned int _activeContextID;
+    mutable unsigned int _numRedrawnAreas;
     mutable bool _initialized;
+    bool _retained;
 };
 
 #endif
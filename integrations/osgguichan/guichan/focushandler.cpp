@@ -508,6 +508,7 @@ namespace gcn
     void FocusHandler::distributeFocusLostEvent(const Event& focusEvent)
     {
         Widget* sourceWidget = focusEvent.getSource();
+        sourceWidget->invalidate();
 
         std::list<FocusListener*> focusListeners = sourceWidget->_getFocusListeners();
 
@@ -523,6 +524,7 @@ namespace gcn
     void FocusHandler::distributeFocusGainedEvent(const Event& focusEvent)
     {
         Widget* sourceWidget = focusEvent.getSource();
+        sourceWidget->invalidate();
 
         std::list<FocusListener*> focusListeners = sourceWidget->_getFocusListeners();
 
@@ -61,6 +61,46 @@
 
 namespace gcn
 {
+    namespace
+    {
+        /*
+         * A copy of a widget's listeners, as listeners may be removed while
+         * an event is distributed. Short lists, the usual case, are copied
+         * to the stack so that distributing events allocates no memory.
+         */
+        template <class T>
+        class ListenerCopy
+        {
+        public:
+            ListenerCopy(const std::list<T*>& listeners)
+                : mSize(0)
+            {
+                typename std::list<T*>::const_iterator iter;
+                for (iter = listeners.begin(); iter != listeners.end(); ++iter)
+                {
+                    if (mSize < MaxStackListeners)
+                        mStackListeners[mSize] = *iter;
+                    else
+                        mHeapListeners.push_back(*iter);
+                    mSize++;
+                }
+            }
+
+            unsigned int size() const { return mSize; }
+
+            T* operator[](unsigned int i) const
+            {
+                return i < MaxStackListeners ? mStackListeners[i] : mHeapListeners[i - MaxStackListeners];
+            }
+
+        protected:
+            enum { MaxStackListeners = 8 };
+            T* mStackListeners[MaxStackListeners];
+            std::vector<T*> mHeapListeners;
+            unsigned int mSize;
+        };
+    }
+
     Gui::Gui()
             :mTop(NULL),
              mGraphics(NULL),
@@ -99,6 +139,7 @@ namespace gcn
         if (top != NULL)
         {
             top->_setFocusHandler(mFocusHandler);
+            top->invalidate();
         }
 
         mTop = top;
@@ -162,6 +203,54 @@ namespace gcn
         mGraphics->_beginDraw();
         mTop->_draw(mGraphics);
         mGraphics->_endDraw();
+        mTop->_clearInvalidatedAreas();
+    }
+
+    unsigned int Gui::drawInvalidated()
+    {
+        if (mTop == NULL)
+            throw GCN_EXCEPTION("No top widget set");
+
+        if (mGraphics == NULL)
+            throw GCN_EXCEPTION("No graphics set");
+
+        const std::vector<Rectangle>& areas = mTop->_getInvalidatedAreas();
+        unsigned int numAreas = areas.size();
+        if (numAreas == 0 || !mTop->isVisible())
+        {
+            mTop->_clearInvalidatedAreas();
+            return 0;
+        }
+
+        mGraphics->_beginDraw();
+
+        for (unsigned int i = 0; i < numAreas; ++i)
+        {
+            const Rectangle& area = areas[i];
+            mGraphics->pushClipArea(area);
+
+            // Move the origin back to the top left corner of the screen
+            // while keeping the area as clip area
+            mGraphics->pushClipArea(Rectangle(-area.x,
+                                              -area.y,
+                                              area.x + area.width,
+                                              area.y + area.height));
+            mTop->_draw(mGraphics);
+            mGraphics->popClipArea();
+            mGraphics->popClipArea();
+        }
+
+        mGraphics->_endDraw();
+        mTop->_clearInvalidatedAreas();
+        return numAreas;
+    }
+
+    const std::vector<Rectangle>& Gui::getInvalidatedAreas() const
+    {
+        if (mTop == NULL)
+            throw GCN_EXCEPTION("No top widget set");
+
+        return mTop->_getInvalidatedAreas();
     }
 
     void Gui::focusNone()
@@ -302,19 +391,19 @@ namespace gcn
     {
         // Get tha last widgets with the mouse using the
         // last known mouse position.
-        std::set<Widget*> mLastWidgetsWithMouse = getWidgetsAt(mLastMouseX, mLastMouseY);
+        getWidgetsAt(mLastMouseX, mLastMouseY, mLastWidgetsWithMouse);
 
         // Check if the mouse has left the application window.
         if (mouseInput.getX() < 0
             || mouseInput.getY() < 0
             || !mTop->getDimension().isContaining(mouseInput.getX(), mouseInput.getY()))
         {
-            std::set<Widget*>::const_iterator iter;
-            for (iter = mLastWidgetsWithMouse.begin(); 
-                 iter != mLastWidgetsWithMouse.end();
-                 iter++)
+            for (unsigned int i = 0; i < mLastWidgetsWithMouse.size(); ++i)
             {
-                distributeMouseEvent((*iter),
+                if (!Widget::widgetExists(mLastWidgetsWithMouse[i]))
+                    continue;
+
+                distributeMouseEvent(mLastWidgetsWithMouse[i],
                                      MouseEvent::Exited,
                                      mouseInput.getButton(),
                                      mouseInput.getX(),
@@ -329,26 +418,21 @@ namespace gcn
             // Calculate which widgets should receive a mouse exited event
             // and which should receive a mouse entered event by using the 
             // last known mouse position and the latest mouse position.
-            std::set<Widget*> mWidgetsWithMouse = getWidgetsAt(mouseInput.getX(), mouseInput.getY());
-            std::set<Widget*> mWidgetsWithMouseExited;
-            std::set<Widget*> mWidgetsWithMouseEntered;
-            std::set_difference(mLastWidgetsWithMouse.begin(),
-                                mLastWidgetsWithMouse.end(),
-                                mWidgetsWithMouse.begin(),
-                                mWidgetsWithMouse.end(),
-                                std::inserter(mWidgetsWithMouseExited, mWidgetsWithMouseExited.begin()));
-            std::set_difference(mWidgetsWithMouse.begin(),
-                                mWidgetsWithMouse.end(),
-                                mLastWidgetsWithMouse.begin(),
-                                mLastWidgetsWithMouse.end(),
-                                std::inserter(mWidgetsWithMouseEntered, mWidgetsWithMouseEntered.begin()));
-
-            std::set<Widget*>::const_iterator iter;
-            for (iter = mWidgetsWithMouseExited.begin(); 
-                 iter != mWidgetsWithMouseExited.end();
-                 iter++)
+            // Both lists begin with the top widget and go down through
+            // parents and children, so they only differ after a common part.
+            getWidgetsAt(mouseInput.getX(), mouseInput.getY(), mWidgetsWithMouse);
+            unsigned int common = 0;
+            while (common < mLastWidgetsWithMouse.size()
+                   && common < mWidgetsWithMouse.size()
+                   && mLastWidgetsWithMouse[common] == mWidgetsWithMouse[common])
+                common++;
+
+            for (unsigned int i = mLastWidgetsWithMouse.size(); i > common; --i)
             {
-                distributeMouseEvent((*iter),
+                if (!Widget::widgetExists(mLastWidgetsWithMouse[i - 1]))
+                    continue;
+
+                distributeMouseEvent(mLastWidgetsWithMouse[i - 1],
                                      MouseEvent::Exited,
                                      mouseInput.getButton(),
                                      mouseInput.getX(),
@@ -362,11 +446,14 @@ namespace gcn
                 mLastMousePressTimeStamp = 0;
             }
 
-            for (iter = mWidgetsWithMouseEntered.begin(); 
-                 iter != mWidgetsWithMouseEntered.end();
-                 iter++)
+            for (unsigned int i = common; i < mWidgetsWithMouse.size(); ++i)
             {
-                Widget* widget = (*iter);
+                Widget* widget = mWidgetsWithMouse[i];
+
+                // The widget may have been deleted by an earlier event.
+                if (!Widget::widgetExists(widget))
+                    break;
+
                 // If a widget has modal mouse input focus we
                 // only want to send entered events to that widget
                 // and the widget's parents.
@@ -536,21 +623,28 @@ namespace gcn
         return parent;
     }
 
-    std::set<Widget*> Gui::getWidgetsAt(int x, int y)
+    void Gui::getWidgetsAt(int x, int y, std::vector<Widget*>& widgets)
     {
-        std::set<Widget*> result;
+        widgets.clear();
 
+        // The absolute position is followed down the widgets, rather
+        // than computed for each of them from the top widget.
         Widget* widget = mTop;
+        int absoluteX = mTop->getX();
+        int absoluteY = mTop->getY();
 
         while (widget != NULL)
         {
-            result.insert(widget);
-            int absoluteX, absoluteY;
-            widget->getAbsolutePosition(absoluteX, absoluteY);
-            widget = widget->getWidgetAt(x - absoluteX, y - absoluteY);
+            widgets.push_back(widget);
+            Widget* child = widget->getWidgetAt(x - absoluteX, y - absoluteY);
+            if (child != NULL)
+            {
+                Rectangle childrenArea = widget->getChildrenArea();
+                absoluteX += childrenArea.x + child->getX();
+                absoluteY += childrenArea.y + child->getY();
+            }
+            widget = child;
         }
-
-        return result;
     }
 
     Widget* Gui::getMouseEventSource(int x, int y)
@@ -627,41 +721,45 @@ namespace gcn
                 mouseEvent.mX = x - widgetX;
                 mouseEvent.mY = y - widgetY;
                 mouseEvent.mDistributor = widget;                      
-                std::list<MouseListener*> mouseListeners = widget->_getMouseListeners();
+                ListenerCopy<MouseListener> mouseListeners(widget->_getMouseListeners());
+
+                // Widgets may change their look on any event but a plain move,
+                // e.g. buttons on entered, exited, pressed and released events
+                if (mouseListeners.size() > 0 && type != MouseEvent::Moved)
+                    widget->invalidate();
 
                 // Send the event to all mouse listeners of the widget.
-                for (std::list<MouseListener*>::iterator it = mouseListeners.begin();
-                     it != mouseListeners.end();
-                     ++it)
+                for (unsigned int i = 0; i < mouseListeners.size(); ++i)
                 {
+                    MouseListener* listener = mouseListeners[i];
                     switch (mouseEvent.getType())
                     {
                       case MouseEvent::Entered:
-                          (*it)->mouseEntered(mouseEvent);
+                          listener->mouseEntered(mouseEvent);
                           break;
                       case MouseEvent::Exited:
-                          (*it)->mouseExited(mouseEvent);
+                          listener->mouseExited(mouseEvent);
                           break;
                       case MouseEvent::Moved:
-                          (*it)->mouseMoved(mouseEvent);
+                          listener->mouseMoved(mouseEvent);
                           break;
                       case MouseEvent::Pressed:
-                          (*it)->mousePressed(mouseEvent);
+                          listener->mousePressed(mouseEvent);
                           break;
                       case MouseEvent::Released:
-                          (*it)->mouseReleased(mouseEvent);
+                          listener->mouseReleased(mouseEvent);
                           break;
                       case MouseEvent::WheelMovedUp:
-                          (*it)->mouseWheelMovedUp(mouseEvent);
+                          listener->mouseWheelMovedUp(mouseEvent);
                           break;
                       case MouseEvent::WheelMovedDown:
-                          (*it)->mouseWheelMovedDown(mouseEvent);
+                          listener->mouseWheelMovedDown(mouseEvent);
                           break;
                       case MouseEvent::Dragged:
-                          (*it)->mouseDragged(mouseEvent);
+                          listener->mouseDragged(mouseEvent);
                           break;
                       case MouseEvent::Clicked:
-                          (*it)->mouseClicked(mouseEvent);
+                          listener->mouseClicked(mouseEvent);
                           break;
                       default:
                           throw GCN_EXCEPTION("Unknown mouse event type.");
@@ -718,20 +816,22 @@ namespace gcn
             if (widget->isEnabled())
             {
                 keyEvent.mDistributor = widget;
-                std::list<KeyListener*> keyListeners = widget->_getKeyListeners();
+                ListenerCopy<KeyListener> keyListeners(widget->_getKeyListeners());
+
+                if (keyListeners.size() > 0)
+                    widget->invalidate();
             
                 // Send the event to all key listeners of the source widget.
-                for (std::list<KeyListener*>::iterator it = keyListeners.begin();
-                     it != keyListeners.end();
-                     ++it)
+                for (unsigned int i = 0; i < keyListeners.size(); ++i)
                 {
+                    KeyListener* listener = keyListeners[i];
                     switch (keyEvent.getType())
                     {
                       case KeyEvent::Pressed:
-                          (*it)->keyPressed(keyEvent);
+                          listener->keyPressed(keyEvent);
                           break;
                       case KeyEvent::Released:
-                          (*it)->keyReleased(keyEvent);
+                          listener->keyReleased(keyEvent);
                           break;
                       default:
                           throw GCN_EXCEPTION("Unknown key event type.");
@@ -818,14 +918,11 @@ namespace gcn
     {
         // Get all widgets at the last known mouse position
         // and send them a mouse exited event.
-        std::set<Widget*> mWidgetsWithMouse = getWidgetsAt(mLastMouseX, mLastMouseY);
+        getWidgetsAt(mLastMouseX, mLastMouseY, mWidgetsWithMouse);
        
-        std::set<Widget*>::const_iterator iter;
-        for (iter = mWidgetsWithMouse.begin(); 
-             iter != mWidgetsWithMouse.end();
-             iter++)
+        for (unsigned int i = 0; i < mWidgetsWithMouse.size(); ++i)
         {
-            distributeMouseEvent((*iter),
+            distributeMouseEvent(mWidgetsWithMouse[i],
                                  MouseEvent::Exited,
                                  mLastMousePressButton,
                                  mLastMouseX,
@@ -841,14 +938,11 @@ namespace gcn
     {
         // Get all widgets at the last known mouse position
         // and send them a mouse entered event.
-        std::set<Widget*> mWidgetsWithMouse = getWidgetsAt(mLastMouseX, mLastMouseY);
+        getWidgetsAt(mLastMouseX, mLastMouseY, mWidgetsWithMouse);
        
-        std::set<Widget*>::const_iterator iter;
-        for (iter = mWidgetsWithMouse.begin(); 
-             iter != mWidgetsWithMouse.end();
-             iter++)
+        for (unsigned int i = 0; i < mWidgetsWithMouse.size(); ++i)
         {
-            distributeMouseEvent((*iter),
+            distributeMouseEvent(mWidgetsWithMouse[i],
                                  MouseEvent::Entered,
                                  mLastMousePressButton,
                                  mLastMouseX,
@@ -45,12 +45,13 @@
 #define GCN_GUI_HPP
 
 #include <list>
-#include <set>
+#include <vector>
 
 #include "guichan/keyevent.hpp"
 #include "guichan/mouseevent.hpp"
 #include "guichan/mouseinput.hpp"
 #include "guichan/platform.hpp"
+#include "guichan/rectangle.hpp"
 
 namespace gcn
 {
@@ -185,6 +186,30 @@ namespace gcn
          */
         virtual void draw();
 
+        /**
+         * Draws only the areas of the GUI invalidated since the last call
+         * to draw or drawInvalidated. Each area is drawn with a clip area
+         * set, so only widgets touching it are drawn. The areas are not
+         * cleared first; this is left to the caller, which normally keeps
+         * the previous drawing in a texture. The areas never overlap, so
+         * each pixel is drawn once.
+         *
+         * @return The number of areas drawn.
+         * @see getInvalidatedAreas, Widget::invalidate
+         * @since 0.9.0
+         */
+        virtual unsigned int drawInvalidated();
+
+        /**
+         * Gets the areas to be drawn by the next call to drawInvalidated,
+         * in screen coordinates.
+         *
+         * @return The invalidated areas, which never overlap.
+         * @see drawInvalidated, Widget::invalidate
+         * @since 0.9.0
+         */
+        const std::vector<Rectangle>& getInvalidatedAreas() const;
+
         /**
          * Focuses none of the widgets in the Gui.
          *
@@ -394,14 +419,17 @@ namespace gcn
         virtual Widget* getKeyEventSource();
 
         /**
-         * Gets all widgets a certain coordinate in the Gui.
+         * Gets all widgets a certain coordinate in the Gui, from the top
+         * widget down to the widget directly under the coordinate. Each
+         * widget is a parent of the next one.
          *
          * @param x The x coordinate.
          * @param y The y coordinate.
-         * @return A set of all widgets at the specified coordinate.
+         * @param widgets Filled with the widgets at the specified coordinate.
+         *                It is cleared first, and reused to avoid allocations.
          * @since 0.9.0
          */
-        virtual std::set<Widget*> getWidgetsAt(int x, int y);
+        virtual void getWidgetsAt(int x, int y, std::vector<Widget*>& widgets);
 
         /**
          * Holds the top widget.
@@ -495,6 +523,13 @@ namespace gcn
          * when the same button is released.
          */
         int mLastMouseDragButton;
+
+        /**
+         * Holds the widgets at the current and the last mouse position,
+         * kept between calls so that no memory is allocated for them.
+         */
+        std::vector<Widget*> mWidgetsWithMouse;
+        std::vector<Widget*> mLastWidgetsWithMouse;
     };
 }
 
@@ -62,12 +62,195 @@
 #include "guichan/widgetlistener.hpp"
 
 #include <algorithm>
+#include <cmath>
 
 namespace gcn
 {
+    namespace
+    {
+        /*
+         * A set of all widget instances, hashed by their addresses with
+         * linear probing, so that checking if a widget exists doesn't
+         * depend on the number of widgets.
+         */
+        class WidgetInstances
+        {
+        public:
+            WidgetInstances() : mSlots(64, (Widget*)NULL), mSize(0), mUsed(0) { }
+
+            void insert(Widget* widget)
+            {
+                if ((mUsed + 1) * 2 > mSlots.size())
+                    rehash();
+
+                size_t i = findSlot(widget);
+                if (mSlots[i] == NULL)
+                    mUsed++;
+
+                mSlots[i] = widget;
+                mSize++;
+            }
+
+            void erase(const Widget* widget)
+            {
+                size_t i = findSlot(widget);
+                if (mSlots[i] == widget)
+                {
+                    mSlots[i] = removed();
+                    mSize--;
+                }
+            }
+
+            bool contains(const Widget* widget) const
+            {
+                if (widget == NULL)
+                    return false;
+
+                return mSlots[findSlot(widget)] == widget;
+            }
+
+            size_t getNumSlots() const { return mSlots.size(); }
+
+            /*
+             * Gets the widget in a slot, NULL if the slot is empty.
+             */
+            Widget* getWidget(size_t slot) const
+            {
+                return mSlots[slot] == removed() ? NULL : mSlots[slot];
+            }
+
+        protected:
+            /*
+             * Marks slots of removed widgets, so that probing goes on.
+             */
+            static Widget* removed() { return reinterpret_cast<Widget*>(1); }
+
+            /*
+             * Finds the slot of a widget, or else the first free slot
+             * where it could be inserted.
+             */
+            size_t findSlot(const Widget* widget) const
+            {
+                size_t mask = mSlots.size() - 1;
+                size_t i = ((size_t)widget >> 3) * 2654435761u & mask;
+                size_t freeSlot = mSlots.size();
+                while (mSlots[i] != NULL)
+                {
+                    if (mSlots[i] == widget)
+                        return i;
+
+                    if (mSlots[i] == removed() && freeSlot == mSlots.size())
+                        freeSlot = i;
+
+                    i = (i + 1) & mask;
+                }
+
+                return freeSlot < mSlots.size() ? freeSlot : i;
+            }
+
+            /*
+             * Rebuilds the table without removed slots, growing it if
+             * it is more than a quarter full.
+             */
+            void rehash()
+            {
+                size_t numSlots = 64;
+                while (numSlots < mSize * 4)
+                    numSlots *= 2;
+
+                std::vector<Widget*> slots(numSlots, (Widget*)NULL);
+                slots.swap(mSlots);
+                mSize = 0;
+                mUsed = 0;
+
+                for (size_t i = 0; i < slots.size(); ++i)
+                {
+                    if (slots[i] != NULL && slots[i] != removed())
+                        insert(slots[i]);
+                }
+            }
+
+            std::vector<Widget*> mSlots;
+            size_t mSize;
+            size_t mUsed;
+        };
+
+        WidgetInstances& getWidgetInstances()
+        {
+            // Created on first use, as widgets may be static objects
+            static WidgetInstances instances;
+            return instances;
+        }
+
+        /*
+         * Adds the parts of an area not covered by another one, which are
+         * up to four strips around their intersection.
+         */
+        void subtractArea(const Rectangle& area,
+                          const Rectangle& other,
+                          std::vector<Rectangle>& parts)
+        {
+            Rectangle common = area.intersection(other);
+            Rectangle pieces[4] =
+            {
+                Rectangle(area.x, area.y, area.width, common.y - area.y),
+                Rectangle(area.x, common.y + common.height, area.width,
+                          area.y + area.height - common.y - common.height),
+                Rectangle(area.x, common.y, common.x - area.x, common.height),
+                Rectangle(common.x + common.width, common.y,
+                          area.x + area.width - common.x - common.width, common.height)
+            };
+
+            for (unsigned int i = 0; i < 4; ++i)
+            {
+                if (!pieces[i].isEmpty())
+                    parts.push_back(pieces[i]);
+            }
+        }
+
+        /*
+         * Merges an area into the one growing the least, and then any
+         * other areas overlapping the result, so that none overlap.
+         */
+        void mergeArea(std::vector<Rectangle>& areas, const Rectangle& area)
+        {
+            unsigned int best = 0;
+            int bestGrowth = 0;
+            for (unsigned int i = 0; i < areas.size(); ++i)
+            {
+                Rectangle merged = areas[i] + area;
+                int growth = merged.width * merged.height - areas[i].width * areas[i].height;
+                if (i == 0 || growth < bestGrowth)
+                {
+                    best = i;
+                    bestGrowth = growth;
+                }
+            }
+
+            Rectangle merged = areas[best] + area;
+            areas.erase(areas.begin() + best);
+
+            std::vector<Rectangle>::iterator iter = areas.begin();
+            while (iter != areas.end())
+            {
+                if (iter->isIntersecting(merged))
+                {
+                    merged = merged + *iter;
+                    areas.erase(iter);
+                    iter = areas.begin();
+                }
+                else
+                {
+                    ++iter;
+                }
+            }
+
+            areas.push_back(merged);
+        }
+    }
+
     Font* Widget::mGlobalFont = NULL;
     DefaultFont Widget::mDefaultFont;
-    std::list<Widget*> Widget::mWidgetInstances;
 
     Widget::Widget()
             : mForegroundColor(0x000000),
@@ -83,9 +266,13 @@ namespace gcn
               mTabIn(true),
               mTabOut(true),
               mEnabled(true),
-              mCurrentFont(NULL)
+              mCurrentFont(NULL),
+              mChildrenGridCellWidth(0),
+              mChildrenGridCellHeight(0),
+              mChildrenGridColumns(0),
+              mChildrenGridDirty(true)
     {
-        mWidgetInstances.push_back(this);
+        getWidgetInstances().insert(this);
     }
 
     Widget::~Widget()
@@ -106,7 +293,7 @@ namespace gcn
 
         _setFocusHandler(NULL);
 
-        mWidgetInstances.remove(this);
+        getWidgetInstances().erase(this);
     }
 
     void Widget::drawFrame(Graphics* graphics)
@@ -207,7 +394,19 @@ namespace gcn
     void Widget::setDimension(const Rectangle& dimension)
     { 
         Rectangle oldDimension = mDimension;
-        mDimension = dimension;
+
+        if (dimension.x != oldDimension.x || dimension.y != oldDimension.y
+            || dimension.width != oldDimension.width
+            || dimension.height != oldDimension.height)
+        {
+            // Redraw both where the widget was and where it is now
+            invalidate();
+            mDimension = dimension;
+            invalidate();
+
+            if (mParent != NULL)
+                mParent->mChildrenGridDirty = true;
+        }
 
         if (mDimension.width != oldDimension.width
             || mDimension.height != oldDimension.height)
@@ -224,7 +423,9 @@ namespace gcn
 
     void Widget::setFrameSize(unsigned int frameSize)
     {
+        invalidate();
         mFrameSize = frameSize;
+        invalidate();
     }
 
     unsigned int Widget::getFrameSize() const
@@ -303,7 +504,10 @@ namespace gcn
         else if(!visible)
             distributeHiddenEvent();
 
+        // Only one of the calls stores an area, as hidden widgets are skipped
+        invalidate();
         mVisible = visible;
+        invalidate();
     }
 
     bool Widget::isVisible() const
@@ -317,6 +521,7 @@ namespace gcn
     void Widget::setBaseColor(const Color& color)
     {
         mBaseColor = color;
+        invalidate();
     }
 
     const Color& Widget::getBaseColor() const
@@ -327,6 +532,7 @@ namespace gcn
     void Widget::setForegroundColor(const Color& color)
     {
         mForegroundColor = color;
+        invalidate();
     }
 
     const Color& Widget::getForegroundColor() const
@@ -337,6 +543,7 @@ namespace gcn
     void Widget::setBackgroundColor(const Color& color)
     {
         mBackgroundColor = color;
+        invalidate();
     }
 
     const Color& Widget::getBackgroundColor() const
@@ -347,6 +554,7 @@ namespace gcn
     void Widget::setSelectionColor(const Color& color)
     {
         mSelectionColor = color;
+        invalidate();
     }
 
     const Color& Widget::getSelectionColor() const
@@ -478,11 +686,15 @@ namespace gcn
     {
         mGlobalFont = font;
 
-        std::list<Widget*>::iterator iter;
-        for (iter = mWidgetInstances.begin(); iter != mWidgetInstances.end(); ++iter)
+        WidgetInstances& instances = getWidgetInstances();
+        for (size_t i = 0; i < instances.getNumSlots(); ++i)
         {
-            if ((*iter)->mCurrentFont == NULL)
-                (*iter)->fontChanged();
+            Widget* widget = instances.getWidget(i);
+            if (widget != NULL && widget->mCurrentFont == NULL)
+            {
+                widget->fontChanged();
+                widget->invalidate();
+            }
         }
     }
 
@@ -490,18 +702,12 @@ namespace gcn
     {
         mCurrentFont = font;
         fontChanged();
+        invalidate();
     }
 
     bool Widget::widgetExists(const Widget* widget)
     {
-        std::list<Widget*>::const_iterator iter;
-        for (iter = mWidgetInstances.begin(); iter != mWidgetInstances.end(); ++iter)
-        {
-            if (*iter == widget)
-                return true;
-        }
-
-        return false;
+        return getWidgetInstances().contains(widget);
     }
 
     bool Widget::isTabInEnabled() const
@@ -536,6 +742,7 @@ namespace gcn
     void Widget::setEnabled(bool enabled)
     {
         mEnabled = enabled;
+        invalidate();
     }
 
     bool Widget::isEnabled() const
@@ -613,6 +820,29 @@ namespace gcn
         x -= r.x;
         y -= r.y;
 
+        if (mChildrenGridDirty)
+            buildChildrenGrid();
+
+        if (mChildrenGridColumns > 0)
+        {
+            if (!mChildrenGridArea.isContaining(x, y))
+                return NULL;
+
+            int column = (x - mChildrenGridArea.x) / mChildrenGridCellWidth;
+            int row = (y - mChildrenGridArea.y) / mChildrenGridCellHeight;
+            const std::vector<Widget*>& cell = mChildrenGrid[row * mChildrenGridColumns + column];
+
+            std::vector<Widget*>::const_reverse_iterator iter;
+            for (iter = cell.rbegin(); iter != cell.rend(); iter++)
+            {
+                Widget* widget = (*iter);
+                if (widget->isVisible() && widget->getDimension().isContaining(x, y))
+                    return widget;
+            }
+
+            return NULL;
+        }
+
         std::list<Widget*>::reverse_iterator iter;
         for (iter = mChildren.rbegin(); iter != mChildren.rend(); iter++)
         {
@@ -624,6 +854,77 @@ namespace gcn
         return NULL;
     }
 
+    void Widget::buildChildrenGrid()
+    {
+        mChildrenGridDirty = false;
+
+        // Checking a few children is faster than using a grid
+        unsigned int count = 0;
+        std::list<Widget*>::const_iterator iter;
+        for (iter = mChildren.begin(); iter != mChildren.end() && count < mMinChildrenForGrid; iter++)
+            count++;
+
+        if (count < mMinChildrenForGrid)
+        {
+            mChildrenGrid.clear();
+            mChildrenGridColumns = 0;
+            return;
+        }
+
+        // The grid covers all children, with about two children per cell
+        int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+        int numChildren = 0;
+        for (iter = mChildren.begin(); iter != mChildren.end(); iter++)
+        {
+            const Rectangle& dimension = (*iter)->getDimension();
+            if (dimension.isEmpty())
+                continue;
+
+            if (numChildren == 0 || dimension.x < x1) x1 = dimension.x;
+            if (numChildren == 0 || dimension.y < y1) y1 = dimension.y;
+            if (numChildren == 0 || dimension.x + dimension.width > x2) x2 = dimension.x + dimension.width;
+            if (numChildren == 0 || dimension.y + dimension.height > y2) y2 = dimension.y + dimension.height;
+            numChildren++;
+        }
+
+        int size = (int)std::ceil(std::sqrt(numChildren / 2.0));
+        if (size < 1)
+            size = 1;
+
+        mChildrenGridArea = Rectangle(x1, y1, x2 - x1, y2 - y1);
+        mChildrenGridCellWidth = (mChildrenGridArea.width + size - 1) / size;
+        mChildrenGridCellHeight = (mChildrenGridArea.height + size - 1) / size;
+        mChildrenGridColumns = size;
+
+        // Cells are cleared rather than recreated, to keep their memory
+        mChildrenGrid.resize(size * size);
+        for (unsigned int i = 0; i < mChildrenGrid.size(); ++i)
+            mChildrenGrid[i].clear();
+
+        if (numChildren == 0)
+        {
+            mChildrenGridArea = Rectangle();
+            return;
+        }
+
+        for (iter = mChildren.begin(); iter != mChildren.end(); iter++)
+        {
+            const Rectangle& dimension = (*iter)->getDimension();
+            if (dimension.isEmpty())
+                continue;
+
+            int column1 = (dimension.x - x1) / mChildrenGridCellWidth;
+            int row1 = (dimension.y - y1) / mChildrenGridCellHeight;
+            int column2 = (dimension.x + dimension.width - 1 - x1) / mChildrenGridCellWidth;
+            int row2 = (dimension.y + dimension.height - 1 - y1) / mChildrenGridCellHeight;
+            for (int row = row1; row <= row2; ++row)
+            {
+                for (int column = column1; column <= column2; ++column)
+                    mChildrenGrid[row * size + column].push_back(*iter);
+            }
+        }
+    }
+
     const std::list<MouseListener*>& Widget::_getMouseListeners()
     {
         return mMouseListeners;
@@ -824,11 +1125,13 @@ namespace gcn
         for (iter = mChildren.begin(); iter != mChildren.end(); iter++)
         {
             Widget* widget = (*iter);
+            widget->invalidate();
             widget->_setFocusHandler(NULL);
             widget->_setParent(NULL);
         }
 
         mChildren.clear();
+        mChildrenGridDirty = true;
     }
 
     void Widget::remove(Widget* widget)
@@ -838,7 +1141,9 @@ namespace gcn
         {
             if (*iter == widget)
             {
+                widget->invalidate();
                 mChildren.erase(iter);
+                mChildrenGridDirty = true;
                 widget->_setFocusHandler(NULL);
                 widget->_setParent(NULL);
                 return;
@@ -851,6 +1156,7 @@ namespace gcn
     void Widget::add(Widget* widget)
     {
         mChildren.push_back(widget);
+        mChildrenGridDirty = true;
 
         if (mInternalFocusHandler == NULL)
             widget->_setFocusHandler(_getFocusHandler());
@@ -858,6 +1164,10 @@ namespace gcn
             widget->_setFocusHandler(mInternalFocusHandler);
 
         widget->_setParent(this);
+
+        // Areas marked before the widget was added are covered by this
+        widget->mInvalidatedAreas.clear();
+        widget->invalidate();
     }
 
     void Widget::moveToTop(Widget* widget)
@@ -870,6 +1180,8 @@ namespace gcn
 
         mChildren.remove(widget);
         mChildren.push_back(widget);
+        mChildrenGridDirty = true;
+        widget->invalidate();
     }
 
     void Widget::moveToBottom(Widget* widget)
@@ -882,6 +1194,8 @@ namespace gcn
 
         mChildren.remove(widget);
         mChildren.push_front(widget);
+        mChildrenGridDirty = true;
+        widget->invalidate();
     }
 
     void Widget::focusNext()
@@ -962,14 +1276,24 @@ namespace gcn
 
         const Rectangle& childrenArea = getChildrenArea();
         graphics->pushClipArea(childrenArea);
+        ClipRectangle clipArea = graphics->getCurrentClipArea();
 
         std::list<Widget*>::const_iterator iter;
         for (iter = mChildren.begin(); iter != mChildren.end(); iter++)
         {
             Widget* widget = (*iter);
+            const Rectangle& dimension = widget->getDimension();
+            int frameSize = (int)widget->getFrameSize();
+            Rectangle area(clipArea.xOffset + dimension.x - frameSize,
+                           clipArea.yOffset + dimension.y - frameSize,
+                           dimension.width + 2 * frameSize,
+                           dimension.height + 2 * frameSize);
+
             // Only draw a widget if it's visible and if it visible
-            // inside the children area.
-            if (widget->isVisible() && childrenArea.isIntersecting(widget->getDimension()))
+            // inside the children area. Widgets outside the clip area,
+            // such as the ones not touched by a redrawn area, are skipped.
+            if (widget->isVisible() && childrenArea.isIntersecting(widget->getDimension())
+                && area.isIntersecting(clipArea))
                 widget->_draw(graphics);
         }
 
@@ -977,6 +1301,95 @@ namespace gcn
         graphics->popClipArea();
     }
 
+    void Widget::invalidate()
+    {
+        int frameSize = (int)mFrameSize;
+        invalidate(Rectangle(-frameSize,
+                             -frameSize,
+                             mDimension.width + 2 * frameSize,
+                             mDimension.height + 2 * frameSize));
+    }
+
+    void Widget::invalidate(const Rectangle& area)
+    {
+        if (!mVisible || area.isEmpty())
+            return;
+
+        Rectangle absoluteArea = area;
+        absoluteArea.x += mDimension.x;
+        absoluteArea.y += mDimension.y;
+
+        // Walk up to the top widget, clipping by each children area
+        Widget* top = this;
+        while (top->mParent != NULL)
+        {
+            top = top->mParent;
+            if (!top->mVisible)
+                return;
+
+            Rectangle childrenArea = top->getChildrenArea();
+            absoluteArea = absoluteArea.intersection(Rectangle(0, 0, childrenArea.width, childrenArea.height));
+            if (absoluteArea.isEmpty())
+                return;
+
+            absoluteArea.x += top->mDimension.x + childrenArea.x;
+            absoluteArea.y += top->mDimension.y + childrenArea.y;
+        }
+
+        // Keep the areas disjoint, as they are drawn one after another and
+        // translucent widgets would be blended twice where they overlap
+        std::vector<Rectangle>& areas = top->mInvalidatedAreas;
+        std::vector<Rectangle>::iterator iter;
+        for (iter = areas.begin(); iter != areas.end();)
+        {
+            if (iter->isContaining(absoluteArea))
+                return;
+
+            if (absoluteArea.isContaining(*iter))
+                iter = areas.erase(iter);
+            else
+                ++iter;
+        }
+
+        std::vector<Rectangle> parts(1, absoluteArea);
+        while (!parts.empty())
+        {
+            Rectangle part = parts.back();
+            parts.pop_back();
+
+            for (iter = areas.begin(); iter != areas.end(); ++iter)
+            {
+                if (iter->isIntersecting(part))
+                    break;
+            }
+
+            if (iter != areas.end())
+            {
+                if (!iter->isContaining(part))
+                    subtractArea(part, *iter, parts);
+            }
+            else if (areas.size() < mMaxInvalidatedAreas)
+            {
+                areas.push_back(part);
+            }
+            else
+            {
+                // Too many areas, merge into the existing ones
+                mergeArea(areas, part);
+            }
+        }
+    }
+
+    const std::vector<Rectangle>& Widget::_getInvalidatedAreas() const
+    {
+        return mInvalidatedAreas;
+    }
+
+    void Widget::_clearInvalidatedAreas()
+    {
+        mInvalidatedAreas.clear();
+    }
+
     void Widget::_logic()
     {
         logic();
@@ -46,6 +46,7 @@
 
 #include <list>
 #include <string>
+#include <vector>
 
 #include "guichan/color.hpp"
 #include "guichan/rectangle.hpp"
@@ -726,7 +727,8 @@ namespace gcn
 
         /**
          * Checks if a widget exists or not, that is if it still exists
-         * an instance of the object.
+         * an instance of the object. The check takes constant time, as
+         * all instances are kept in a hash set.
          *
          * @param widget The widget to check.
          * @return True if an instance of the widget exists, false otherwise.
@@ -848,6 +850,9 @@ namespace gcn
          * NOTE: This always returns NULL if the widget is not
          *       a container.
          *
+         * Widgets with many children keep them in a grid, so only the
+         * children near the position are checked.
+         *
          * @param x The x coordinate of the widget to get.
          * @param y The y coordinate of the widget to get.
          * @return The widget at the specified coodinate, NULL
@@ -1025,6 +1030,57 @@ namespace gcn
          */
         virtual void showPart(Rectangle rectangle);
 
+        /**
+         * Marks the whole widget, including its frame, as needing to be
+         * redrawn. Functions changing the look of a widget call this, so
+         * widgets only need to call it themselves when they change what
+         * they draw in any other way.
+         *
+         * @see Gui::drawInvalidated
+         * @since 0.9.0
+         */
+        void invalidate();
+
+        /**
+         * Marks a part of the widget as needing to be redrawn. The area is
+         * clipped by the children areas of the widget's parents and stored
+         * in the top widget in absolute coordinates. Nothing is stored if
+         * the widget or one of its parents is not visible. Parts already
+         * stored are left out, so the stored areas never overlap.
+         *
+         * @param area The area to redraw, relative to the widget's position.
+         * @see Gui::drawInvalidated
+         * @since 0.9.0
+         */
+        void invalidate(const Rectangle& area);
+
+        /**
+         * Gets the areas marked by invalidate in this widget and all its
+         * children. The list is only filled for the top widget.
+         *
+         * WARNING: This function is used internally and should not
+         *          be called or overloaded unless you know what you
+         *          are doing.
+         *
+         * @return The invalidated areas in absolute coordinates, which
+         *         never overlap.
+         * @see _clearInvalidatedAreas
+         * @since 0.9.0
+         */
+        const std::vector<Rectangle>& _getInvalidatedAreas() const;
+
+        /**
+         * Clears the areas marked by invalidate, after they are redrawn.
+         *
+         * WARNING: This function is used internally and should not
+         *          be called or overloaded unless you know what you
+         *          are doing.
+         *
+         * @see _getInvalidatedAreas
+         * @since 0.9.0
+         */
+        void _clearInvalidatedAreas();
+
     protected:
         /**
          * Distributes an action event to all action listeners
@@ -1125,6 +1181,13 @@ namespace gcn
          */
         const std::list<Widget*>& getChildren() const;
 
+        /**
+         * Rebuilds the grid of children used by getWidgetAt.
+         *
+         * @since 0.9.0
+         */
+        void buildChildrenGrid();
+
         /**
          * Holds the mouse listeners of the widget.
          */
@@ -1253,14 +1316,49 @@ namespace gcn
         static Font* mGlobalFont;
 
         /**
-         * Holds a list of all instances of widgets.
+         * Holds all children of the widget.
+         */
+        std::list<Widget*> mChildren;
+
+        /**
+         * Holds the areas to be redrawn, if the widget is a top widget.
          */
-        static std::list<Widget*> mWidgetInstances;
+        std::vector<Rectangle> mInvalidatedAreas;
 
         /**
-         * Holds all children of the widget.
+         * The maximum number of invalidated areas kept before they are merged.
          */
-        std::list<Widget*> mChildren;
+        static const unsigned int mMaxInvalidatedAreas = 16;
+
+        /**
+         * Holds the children in cells of a grid, in the order they are drawn,
+         * for finding the child at a position. It is only built for widgets
+         * with many children, and rebuilt after children are added, removed,
+         * reordered, moved or resized.
+         */
+        std::vector<std::vector<Widget*> > mChildrenGrid;
+
+        /**
+         * Holds the area covered by the grid, relative to the children area.
+         */
+        Rectangle mChildrenGridArea;
+
+        /**
+         * Holds the size of a cell and the number of columns of the grid.
+         */
+        int mChildrenGridCellWidth;
+        int mChildrenGridCellHeight;
+        int mChildrenGridColumns;
+
+        /**
+         * True if the grid has to be rebuilt before it is used.
+         */
+        bool mChildrenGridDirty;
+
+        /**
+         * The number of children needed for building a grid of them.
+         */
+        static const unsigned int mMinChildrenForGrid = 32;
     };
 }
 
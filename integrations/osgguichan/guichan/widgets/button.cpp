@@ -92,6 +92,7 @@ namespace gcn
     void Button::setCaption(const std::string& caption)
     {
         mCaption = caption;
+        invalidate();
     }
 
     const std::string& Button::getCaption() const
@@ -102,6 +103,7 @@ namespace gcn
     void Button::setAlignment(Graphics::Alignment alignment)
     {
         mAlignment = alignment;
+        invalidate();
     }
 
     Graphics::Alignment Button::getAlignment() const
@@ -112,6 +114,7 @@ namespace gcn
     void Button::setSpacing(unsigned int spacing)
     {
         mSpacing = spacing;
+        invalidate();
     }
 
     unsigned int Button::getSpacing() const
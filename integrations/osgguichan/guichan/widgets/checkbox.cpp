@@ -135,6 +135,7 @@ namespace gcn
     void CheckBox::setSelected(bool selected)
     {
         mSelected = selected;
+        invalidate();
     }
 
     const std::string &CheckBox::getCaption() const
@@ -145,6 +146,7 @@ namespace gcn
     void CheckBox::setCaption(const std::string& caption)
     {
         mCaption = caption;
+        invalidate();
     }
 
     void CheckBox::keyPressed(KeyEvent& keyEvent)
@@ -74,6 +74,7 @@ namespace gcn
     void Container::setOpaque(bool opaque)
     {
         mOpaque = opaque;
+        invalidate();
     }
 
     bool Container::isOpaque() const
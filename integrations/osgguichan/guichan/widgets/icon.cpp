@@ -97,6 +97,7 @@ namespace gcn
         mInternalImage = false;
         setSize(mImage->getWidth(),
                 mImage->getHeight());
+        invalidate();
     }
 
     const Image* Icon::getImage() const
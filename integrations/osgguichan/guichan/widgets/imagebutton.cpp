@@ -95,6 +95,7 @@ namespace gcn
 
         mImage = image;
         mInternalImage = false;
+        invalidate();
     }
 
     const Image* ImageButton::getImage() const
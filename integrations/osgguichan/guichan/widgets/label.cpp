@@ -75,11 +75,13 @@ namespace gcn
     void Label::setCaption(const std::string& caption)
     {
         mCaption = caption;
+        invalidate();
     }
 
     void Label::setAlignment(Graphics::Alignment alignment)
     {
         mAlignment = alignment;
+        invalidate();
     }
 
     Graphics::Alignment Label::getAlignment() const
@@ -199,6 +199,7 @@ namespace gcn
         showPart(scroll);
 
         distributeValueChangedEvent();
+        invalidate();
     }
 
     void ListBox::keyPressed(KeyEvent& keyEvent)
@@ -296,6 +297,7 @@ namespace gcn
         mSelected = -1;
         mListModel = listModel;
         adjustSize();
+        invalidate();
     }
 
     ListModel* ListBox::getListModel() const
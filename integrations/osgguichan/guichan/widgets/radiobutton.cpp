@@ -216,6 +216,7 @@ namespace gcn
         }
 
         mSelected = selected;
+        invalidate();
     }
 
     const std::string &RadioButton::getCaption() const
@@ -226,6 +227,7 @@ namespace gcn
     void RadioButton::setCaption(const std::string caption)
     {
         mCaption = caption;
+        invalidate();
     }
 
     void RadioButton::keyPressed(KeyEvent& keyEvent)
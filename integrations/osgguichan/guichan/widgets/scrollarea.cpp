@@ -69,6 +69,8 @@ namespace gcn
         mRightButtonScrollAmount = 10;
         mIsVerticalMarkerDragged = false;
         mIsHorizontalMarkerDragged =false;
+        mHBarVisible = false;
+        mVBarVisible = false;
         mOpaque = true;
 
         addMouseListener(this);
@@ -91,6 +93,8 @@ namespace gcn
         mRightButtonScrollAmount = 10;
         mIsVerticalMarkerDragged = false;
         mIsHorizontalMarkerDragged =false;
+        mHBarVisible = false;
+        mVBarVisible = false;
         mOpaque = true;
 
         setContent(content);
@@ -116,6 +120,8 @@ namespace gcn
         mRightButtonScrollAmount = 10;
         mIsVerticalMarkerDragged = false;
         mIsHorizontalMarkerDragged =false;
+        mHBarVisible = false;
+        mVBarVisible = false;
         mOpaque = true;
 
         setContent(content);
@@ -183,6 +189,7 @@ namespace gcn
     void ScrollArea::setVerticalScrollAmount(int vScroll)
     {
         int max = getVerticalMaxScroll();
+        int oldVScroll = mVScroll;
 
         mVScroll = vScroll;
 
@@ -191,6 +198,9 @@ namespace gcn
 
         if (vScroll < 0)
             mVScroll = 0;
+
+        if (mVScroll != oldVScroll)
+            invalidate();
     }
 
     int ScrollArea::getVerticalScrollAmount() const
@@ -201,6 +211,7 @@ namespace gcn
     void ScrollArea::setHorizontalScrollAmount(int hScroll)
     {
         int max = getHorizontalMaxScroll();
+        int oldHScroll = mHScroll;
 
         mHScroll = hScroll;
 
@@ -208,6 +219,9 @@ namespace gcn
             mHScroll = max;
         else if (hScroll < 0)
             mHScroll = 0;
+
+        if (mHScroll != oldHScroll)
+            invalidate();
     }
 
     int ScrollArea::getHorizontalScrollAmount() const
@@ -773,8 +787,13 @@ namespace gcn
 
     void ScrollArea::logic()
     {
+        bool hBarVisible = mHBarVisible;
+        bool vBarVisible = mVBarVisible;
         checkPolicies();
 
+        if (mHBarVisible != hBarVisible || mVBarVisible != vBarVisible)
+            invalidate();
+
         setVerticalScrollAmount(getVerticalScrollAmount());
         setHorizontalScrollAmount(getHorizontalScrollAmount());
 
@@ -1171,6 +1190,7 @@ namespace gcn
     void ScrollArea::setOpaque(bool opaque)
     {
         mOpaque = opaque;
+        invalidate();
     }
     
     bool ScrollArea::isOpaque() const
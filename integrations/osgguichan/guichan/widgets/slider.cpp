@@ -93,6 +93,7 @@ namespace gcn
     {
         mScaleStart = scaleStart;
         mScaleEnd = scaleEnd;
+        invalidate();
     }
 
     double Slider::getScaleStart() const
@@ -103,6 +104,7 @@ namespace gcn
     void Slider::setScaleStart(double scaleStart)
     {
         mScaleStart = scaleStart;
+        invalidate();
     }
 
     double Slider::getScaleEnd() const
@@ -113,6 +115,7 @@ namespace gcn
     void Slider::setScaleEnd(double scaleEnd)
     {
         mScaleEnd = scaleEnd;
+        invalidate();
     }
 
     void Slider::draw(gcn::Graphics* graphics)
@@ -214,6 +217,8 @@ namespace gcn
 
     void Slider::setValue(double value)
     {
+        invalidate();
+
         if (value > getScaleEnd())
         {
             mValue = getScaleEnd();
@@ -242,6 +247,7 @@ namespace gcn
     void Slider::setMarkerLength(int length)
     {
         mMarkerLength = length;
+        invalidate();
     }
 
     void Slider::keyPressed(KeyEvent& keyEvent)
@@ -283,6 +289,7 @@ namespace gcn
     void Slider::setOrientation(Slider::Orientation orientation)
     {
         mOrientation = orientation;
+        invalidate();
     }
 
     Slider::Orientation Slider::getOrientation() const
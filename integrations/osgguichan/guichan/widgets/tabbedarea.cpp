@@ -234,6 +234,8 @@ namespace gcn
                 mWidgetContainer->add(mTabs[i].second);
             }
         }
+
+        invalidate();
     }
 
     int TabbedArea::getSelectedTabIndex() const
@@ -258,6 +260,7 @@ namespace gcn
     void TabbedArea::setOpaque(bool opaque)
     {
         mOpaque = opaque;
+        invalidate();
     }
 
     bool TabbedArea::isOpaque() const
@@ -85,6 +85,7 @@ namespace gcn
     {
         mText->setContent(text);
         adjustSize();
+        invalidate();
     }
 
     void TextBox::draw(Graphics* graphics)
@@ -212,6 +213,7 @@ namespace gcn
     void TextBox::setCaretPosition(unsigned int position)
     {
         mText->setCaretPosition(position);
+        invalidate();
     }
 
     unsigned int TextBox::getCaretPosition() const
@@ -223,11 +225,13 @@ namespace gcn
     {
         mText->setCaretRow(row);
         mText->setCaretColumn(column);
+        invalidate();
     }
 
     void TextBox::setCaretRow(int row)
     {
         mText->setCaretRow(row);
+        invalidate();
     }
 
     unsigned int TextBox::getCaretRow() const
@@ -238,6 +242,7 @@ namespace gcn
     void TextBox::setCaretColumn(int column)
     {
         mText->setCaretColumn(column);
+        invalidate();
     }
 
     unsigned int TextBox::getCaretColumn() const
@@ -254,6 +259,7 @@ namespace gcn
     {
         mText->setRow(row, text);
         adjustSize();
+        invalidate();
     }
 
     unsigned int TextBox::getNumberOfRows() const
@@ -279,6 +285,7 @@ namespace gcn
     void TextBox::setEditable(bool editable)
     {
         mEditable = editable;
+        invalidate();
     }
 
     bool TextBox::isEditable() const
@@ -300,5 +307,6 @@ namespace gcn
     void TextBox::setOpaque(bool opaque)
     {
         mOpaque = opaque;
+        invalidate();
     }
 }
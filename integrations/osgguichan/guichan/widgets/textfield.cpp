@@ -84,6 +84,7 @@ namespace gcn
     void TextField::setText(const std::string& text)
     {
         mText->setRow(0, text);
+        invalidate();
     }
 
     void TextField::draw(Graphics* graphics)
@@ -234,6 +235,7 @@ namespace gcn
     void TextField::setCaretPosition(unsigned int position)
     {
         mText->setCaretPosition(position);
+        invalidate();
     }
 
     unsigned int TextField::getCaretPosition() const
@@ -254,5 +256,6 @@ namespace gcn
     void TextField::setEditable(bool editable)
     {
         mEditable = editable;
+        invalidate();
     }
 }
@@ -86,6 +86,7 @@ namespace gcn
     void Window::setPadding(unsigned int padding)
     {
         mPadding = padding;
+        invalidate();
     }
 
     unsigned int Window::getPadding() const
@@ -96,6 +97,7 @@ namespace gcn
     void Window::setTitleBarHeight(unsigned int height)
     {
         mTitleBarHeight = height;
+        invalidate();
     }
 
     unsigned int Window::getTitleBarHeight() const
@@ -106,6 +108,7 @@ namespace gcn
     void Window::setCaption(const std::string& caption)
     {
         mCaption = caption;
+        invalidate();
     }
 
     const std::string& Window::getCaption() const
@@ -116,6 +119,7 @@ namespace gcn
     void Window::setAlignment(Graphics::Alignment alignment)
     {
         mAlignment = alignment;
+        invalidate();
     }
 
     Graphics::Alignment Window::getAlignment() const
@@ -278,6 +282,7 @@ namespace gcn
     void Window::setOpaque(bool opaque)
     {
         mOpaque = opaque;
+        invalidate();
     }
 
     bool Window::isOpaque() const
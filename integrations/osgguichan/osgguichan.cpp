@@ -1,9 +1,11 @@
 #include <osg/Image>
 #include <osg/MatrixTransform>
+#include <osg/Timer>
 #include <osgDB/ReadFile>
 #include <osgGA/StateSetManipulator>
 #include <osgViewer/ViewerEventHandlers>
 #include <osgViewer/Viewer>
+#include <sstream>
 
 #include "GuichanWrapper.h"
 
@@ -39,11 +41,172 @@ protected:
     osg::observer_ptr<osg::Camera> _camera;
 };
 
+/* A software renderer counting primitives, to measure GUI drawing without a graphics context.
+   It blends like the GL renderer, so pixels drawn twice show up in the comparison */
+class SoftwareGraphics : public gcn::Graphics
+{
+public:
+    SoftwareGraphics( int w, int h ) : _pixels(w * h, 0), _width(w), _height(h), _numPrimitives(0) {}
+    
+    using gcn::Graphics::drawImage;
+    using gcn::Graphics::drawRectangle;
+    using gcn::Graphics::fillRectangle;
+    
+    virtual void _beginDraw() { pushClipArea( gcn::Rectangle(0, 0, _width, _height) ); }
+    virtual void _endDraw() { popClipArea(); }
+    
+    virtual void drawImage( const gcn::Image*, int, int, int dstX, int dstY, int width, int height )
+    { fill( dstX, dstY, width, height ); }
+    
+    virtual void drawPoint( int x, int y ) { fill( x, y, 1, 1 ); }
+    virtual void drawLine( int x1, int y1, int x2, int y2 )
+    {
+        int steps = osg::maximum( abs(x2 - x1), abs(y2 - y1) );
+        for ( int i=0; i<=steps; ++i )
+        {
+            if ( !steps ) { fill( x1, y1, 1, 1 ); break; }
+            fill( x1 + (x2 - x1) * i / steps, y1 + (y2 - y1) * i / steps, 1, 1 );
+        }
+    }
+    
+    virtual void drawRectangle( const gcn::Rectangle& r )
+    {
+        fill( r.x, r.y, r.width, 1 ); fill( r.x, r.y + r.height - 1, r.width, 1 );
+        fill( r.x, r.y, 1, r.height ); fill( r.x + r.width - 1, r.y, 1, r.height );
+    }
+    
+    virtual void fillRectangle( const gcn::Rectangle& r ) { fill( r.x, r.y, r.width, r.height ); }
+    virtual void setColor( const gcn::Color& color ) { _color = color; }
+    virtual const gcn::Color& getColor() const { return _color; }
+    
+    /** Set the area to transparent black, as glClear() does with the texture */
+    void clear( const gcn::Rectangle& r )
+    {
+        gcn::Rectangle area = r.intersection( gcn::Rectangle(0, 0, _width, _height) );
+        for ( int j=area.y; j<area.y + area.height; ++j )
+            std::fill( &_pixels[j * _width + area.x], &_pixels[j * _width + area.x] + area.width, 0 );
+    }
+    
+    std::vector<unsigned int>& getPixels() { return _pixels; }
+    unsigned int getNumPrimitives() const { return _numPrimitives; }
+    
+protected:
+    void fill( int x, int y, int w, int h )
+    {
+        const gcn::ClipRectangle& clip = getCurrentClipArea();
+        gcn::Rectangle area = gcn::Rectangle(x + clip.xOffset, y + clip.yOffset, w, h).intersection( clip );
+        if ( area.isEmpty() ) return;
+        
+        // Blend the color over the pixels, which are stored as 0xAARRGGBB
+        unsigned int src[4] = { (unsigned int)_color.b, (unsigned int)_color.g,
+                                (unsigned int)_color.r, 255 }, alpha = _color.a;
+        for ( int j=area.y; j<area.y + area.height; ++j )
+        {
+            unsigned int* pixel = &_pixels[j * _width + area.x];
+            for ( int i=0; i<area.width; ++i, ++pixel )
+            {
+                unsigned int value = 0;
+                for ( int c=0; c<4; ++c )
+                {
+                    unsigned int dst = (*pixel >> (c * 8)) & 0xff;
+                    value |= ((src[c] * alpha + dst * (255 - alpha) + 127) / 255) << (c * 8);
+                }
+                *pixel = value;
+            }
+        }
+        _numPrimitives++;
+    }
+    
+    std::vector<unsigned int> _pixels;
+    gcn::Color _color;
+    int _width, _height;
+    unsigned int _numPrimitives;
+};
+
+int runBenchmark( int numWidgets, int numFrames )
+{
+    // One label changes in each frame, like a panel showing a live value
+    std::vector<unsigned int> results[2];
+    for ( int retained=0; retained<2; ++retained )
+    {
+        SoftwareGraphics graphics( 1024, 768 );
+        gcn::Container container;
+        container.setDimension( gcn::Rectangle(0, 0, 1024, 768) );
+        container.setOpaque( false );  // as in GuichanDrawable
+        
+        std::vector<gcn::Widget*> widgets;
+        for ( int i=0; i<numWidgets; ++i )
+        {
+            gcn::Widget* widget = NULL;
+            if ( i % 2 ) widget = new gcn::Button( "Button" );
+            else widget = new gcn::Label( "Label" );
+            widget->setSize( 60, 20 );
+            container.add( widget, (i * 64) % 1024, (i * 64) / 1024 * 24 % 768 );
+            widgets.push_back( widget );
+        }
+        
+        // A translucent panel moves by a few pixels in each frame, so its old and new areas overlap
+        gcn::Container panel;
+        panel.setBaseColor( gcn::Color(255, 255, 255, 128) );
+        panel.setSize( 200, 100 );
+        container.add( &panel, 0, 400 );
+        
+        gcn::Gui gui;
+        gui.setGraphics( &graphics );
+        gui.setTop( &container );
+        
+        std::stringstream ss;
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        for ( int f=0; f<numFrames; ++f )
+        {
+            ss.str( "" ); ss << f;
+            static_cast<gcn::Label*>( widgets[0] )->setCaption( ss.str() );
+            panel.setPosition( (f * 5) % 800, 400 );
+            if ( retained )
+            {
+                // Clear invalidated areas as GuichanDrawable does with the texture
+                const std::vector<gcn::Rectangle>& areas = gui.getInvalidatedAreas();
+                for ( unsigned int i=0; i<areas.size(); ++i )
+                    graphics.clear( areas[i] );
+                gui.drawInvalidated();
+            }
+            else
+            {
+                std::fill( graphics.getPixels().begin(), graphics.getPixels().end(), 0 );
+                gui.draw();
+            }
+        }
+        
+        std::cout << (retained ? "Retained: " : "Full redraw: ") << numFrames << " frames of " << numWidgets
+                  << " widgets, " << graphics.getNumPrimitives() << " primitives, "
+                  << osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick()) << "ms" << std::endl;
+        results[retained] = graphics.getPixels();
+        
+        gui.setTop( NULL );
+        container.remove( &panel );
+        for ( unsigned int i=0; i<widgets.size(); ++i ) delete widgets[i];
+    }
+    
+    if ( results[0]!=results[1] )
+    {
+        std::cout << "Retained drawing differs from full redraw" << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
 int main( int argc, char** argv )
 {
     osg::ArgumentParser arguments( &argc, argv );
     
+    // Headless drawing benchmark, e.g. --benchmark 200 --frames 1000
+    int numWidgets = 0, numFrames = 1000;
+    arguments.read( "--frames", numFrames );
+    if ( arguments.read("--benchmark", numWidgets) )
+        return runBenchmark( numWidgets, numFrames );
+    
     osg::ref_ptr<GuichanDrawable> guichan = new GuichanDrawable;
+    guichan->setRetained( arguments.read("--retained") );
     
     gcn::Button* button = new gcn::Button( "Button" );
     button->setSize( 240, 60 );
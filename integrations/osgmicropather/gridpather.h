@@ -0,0 +1,514 @@
+/*
+GridPather - a grid specialized A* / Jump Point Search solver used next to MicroPather.
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely.
+*/
+
+
+#ifndef GRINNINGLIZARD_GRIDPATHER_INCLUDED
+#define GRINNINGLIZARD_GRIDPATHER_INCLUDED
+
+/** @page gridpather GridPather
+
+	MicroPather solves any graph through the Graph callbacks, which costs a virtual call and
+	a vector of StateCost per expanded state, plus a hash lookup per neighbor. Most maps in
+	games are simple grids, so GridPather works directly on a width x height passability
+	map instead:
+	- Nodes are cell indices into flat arrays (cost, parent, heap position), so there is
+	  no hashing and no pointer casting of states. The map is stored with a border of
+	  blocked cells, so neighbor tests need no bounds checks.
+	- The closed set is a bitset.
+	- With a uniform cost model and 8-connected movement, Jump Point Search is used, which
+	  skips the symmetric paths of open areas and expands only a fraction of the cells.
+	- With any other cost model, a plain A* over the 4 or 8 neighbors is used.
+
+	Diagonal moves are only allowed if both orthogonal cells are passable (no corner cutting).
+	Returned paths contain every cell from start to end, like MicroPather::Solve().
+*/
+
+#include <vector>
+#include <float.h>
+#include <string.h>
+
+namespace micropather
+{
+	/// A cell of a grid path.
+	struct GridPoint
+	{
+		int x, y;
+	};
+
+
+	/**
+		Cost model of a uniform 8-connected grid: straight steps cost 1, diagonal steps
+		cost sqrt(2). This is the model solved with Jump Point Search.
+
+		A cost model for GridPather must provide:
+		- enum UNIFORM: non-zero if every straight step and every diagonal step cost the same
+		- bool Diagonal() const: whether diagonal moves are allowed
+		- float Cost( int from, int to, bool diagonal ) const: cost of moving between 2 adjacent cells
+		- float Estimate( int dx, int dy ) const: admissible estimate for the given cell offset
+	*/
+	struct OctileGridCost
+	{
+		enum { UNIFORM = 1 };
+
+		bool Diagonal() const						{ return true; }
+		float Cost( int, int, bool diagonal ) const	{ return diagonal ? 1.41421356f : 1.0f; }
+		float Estimate( int dx, int dy ) const {
+			if ( dx < 0 ) dx = -dx;
+			if ( dy < 0 ) dy = -dy;
+			return dx < dy ? 0.41421356f*(float)dx + (float)dy : 0.41421356f*(float)dy + (float)dx;
+		}
+	};
+
+
+	/**
+		Cost model with a weight per cell, applied to the steps entering the cell. Weights
+		must be >= minWeight so that the estimate stays admissible.
+	*/
+	struct CellWeightGridCost
+	{
+		enum { UNIFORM = 0 };
+
+		CellWeightGridCost( const float* w=0, float minW=1.0f, bool diag=true )
+			: weights( w ), minWeight( minW ), diagonal( diag ) {}
+
+		bool Diagonal() const { return diagonal; }
+		float Cost( int, int to, bool diag ) const {
+			return weights[to] * ( diag ? 1.41421356f : 1.0f );
+		}
+		float Estimate( int dx, int dy ) const {
+			if ( dx < 0 ) dx = -dx;
+			if ( dy < 0 ) dy = -dy;
+			if ( !diagonal )
+				return minWeight * (float)( dx + dy );
+			return minWeight * ( dx < dy ? 0.41421356f*(float)dx + (float)dy : 0.41421356f*(float)dy + (float)dx );
+		}
+
+		const float* weights;
+		float minWeight;
+		bool diagonal;
+	};
+
+
+	/**
+		Grid path solver, templated on the cost model. The map is copied by SetMap(), so
+		the solver must be given the map again whenever it changes.
+	*/
+	template< typename CostModel >
+	class GridPather
+	{
+	  public:
+		enum
+		{
+			SOLVED,
+			NO_SOLUTION,
+			START_END_SAME,
+		};
+
+		GridPather( const CostModel& model = CostModel() )
+			: costModel( model ), width( 0 ), height( 0 ), stride( 0 ), goalIndex( -1 ), frame( 0 ), nodesExpanded( 0 ) {}
+
+		/**
+			Set the passability map. A cell is passable if its value is 0, like the map
+			data of the osgmicropather example.
+		*/
+		void SetMap( const int* data, int _width, int _height );
+
+		/// Change the passability of a single cell.
+		void SetPassable( int x, int y, bool passable )	{ passableMap[ ToIndex( x, y ) ] = passable ? 1 : 0; }
+		bool IsPassable( int x, int y ) const {
+			return x >= 0 && x < width && y >= 0 && y < height && passableMap[ ToIndex( x, y ) ] != 0;
+		}
+
+		void SetCostModel( const CostModel& model )	{ costModel = model; }
+		const CostModel& GetCostModel() const		{ return costModel; }
+
+		/**
+			Solve for the path from start to end.
+
+			@param path			Output, every cell of the path from start to end. Empty if not found.
+			@param totalCost	Output, the cost of the path, if found.
+			@return				Success or failure, expressed as SOLVED, NO_SOLUTION, or START_END_SAME.
+		*/
+		int Solve( int startX, int startY, int endX, int endY, std::vector< GridPoint >* path, float* totalCost );
+
+		/// Return the number of cells taken from the open queue by the last Solve().
+		unsigned NodesExpanded() const	{ return nodesExpanded; }
+
+	  private:
+		GridPather( const GridPather& );	// undefined and unsupported
+		void operator=( const GridPather& );
+
+		// Internal indices include the border: the cell (x, y) is at (y+1)*stride + x+1.
+		int ToIndex( int x, int y ) const	{ return ( y+1 )*stride + x+1; }
+		int ToCell( int index ) const		{ return ( index/stride - 1 )*width + index%stride - 1; }
+		bool Walkable( int index ) const	{ return passableMap[index] != 0; }
+		bool IsClosed( int index ) const	{ return ( closed[index >> 5] & ( 1u << ( index & 31 ) ) ) != 0; }
+		void SetClosed( int index )			{ closed[index >> 5] |= 1u << ( index & 31 ); }
+
+		float Estimate( int index ) const	{ return costModel.Estimate( goalIndex % stride - index % stride, goalIndex / stride - index / stride ); }
+
+		void Relax( int from, int to, float stepCost );
+		void ExpandNeighbors( int index );
+		void ExpandJumpPoints( int index );
+		int Jump( int index, int dx, int dy ) const;
+		float LineCost( int from, int to ) const;
+		void BuildPath( int endIndex, std::vector< GridPoint >* path ) const;
+
+		// Indexed binary heap on fCost
+		void HeapPush( int index );
+		int HeapPop();
+		void HeapSiftUp( int pos );
+		void HeapSiftDown( int pos );
+
+		CostModel costModel;
+		int width, height, stride;
+		int goalIndex;
+		unsigned frame;						// incremented with every solve; stale cells have an older visited value
+		unsigned nodesExpanded;
+
+		std::vector< unsigned char > passableMap;
+		std::vector< unsigned >	visited;	// frame in which gCost/parent of the cell are valid
+		std::vector< float >	gCost;
+		std::vector< float >	fCost;
+		std::vector< int >		parent;
+		std::vector< int >		heapIndex;	// position in the open heap, -1 if not open
+		std::vector< unsigned >	closed;		// bitset of expanded cells
+		std::vector< int >		heap;
+	};
+
+
+	template< typename CostModel >
+	void GridPather<CostModel>::SetMap( const int* data, int _width, int _height )
+	{
+		width = _width;
+		height = _height;
+		stride = width + 2;
+		const size_t count = (size_t)stride * (size_t)( height + 2 );
+		passableMap.assign( count, 0 );
+		for( int y=0; y<height; ++y ) {
+			for( int x=0; x<width; ++x )
+				passableMap[ ToIndex( x, y ) ] = data[ y*width + x ] == 0 ? 1 : 0;
+		}
+
+		visited.assign( count, 0 );
+		gCost.resize( count );
+		fCost.resize( count );
+		parent.resize( count );
+		heapIndex.resize( count );
+		closed.resize( ( count + 31 ) / 32 );
+		frame = 0;
+	}
+
+
+	template< typename CostModel >
+	int GridPather<CostModel>::Solve( int startX, int startY, int endX, int endY,
+									  std::vector< GridPoint >* path, float* totalCost )
+	{
+		path->clear();
+		*totalCost = 0.0f;
+		nodesExpanded = 0;
+		if ( startX == endX && startY == endY )
+			return START_END_SAME;
+		if ( !IsPassable( startX, startY ) || !IsPassable( endX, endY ) )
+			return NO_SOLUTION;
+
+		if ( ++frame == 0 ) {
+			// Wrapped around, so old values could look current.
+			visited.assign( visited.size(), 0 );
+			frame = 1;
+		}
+		memset( &closed[0], 0, closed.size() * sizeof( unsigned ) );
+		heap.resize( 0 );
+
+		const int startIndex = ToIndex( startX, startY );
+		const int endIndex = ToIndex( endX, endY );
+		goalIndex = endIndex;
+		visited[startIndex] = frame;
+		gCost[startIndex] = 0.0f;
+		parent[startIndex] = -1;
+		fCost[startIndex] = Estimate( startIndex );
+		HeapPush( startIndex );
+
+		const bool jps = CostModel::UNIFORM && costModel.Diagonal();
+		while ( !heap.empty() )
+		{
+			int index = HeapPop();
+			++nodesExpanded;
+			if ( index == endIndex ) {
+				*totalCost = gCost[index];
+				BuildPath( index, path );
+				return SOLVED;
+			}
+
+			SetClosed( index );
+			if ( jps )
+				ExpandJumpPoints( index );
+			else
+				ExpandNeighbors( index );
+		}
+		return NO_SOLUTION;
+	}
+
+
+	template< typename CostModel >
+	void GridPather<CostModel>::Relax( int from, int to, float stepCost )
+	{
+		if ( IsClosed( to ) )
+			return;
+
+		const float newCost = gCost[from] + stepCost;
+		if ( visited[to] != frame ) {
+			visited[to] = frame;
+			gCost[to] = newCost;
+			parent[to] = from;
+			fCost[to] = newCost + Estimate( to );
+			HeapPush( to );
+		}
+		else if ( newCost < gCost[to] ) {
+			// Decrease key: the estimate of a cell doesn't change.
+			fCost[to] += newCost - gCost[to];
+			gCost[to] = newCost;
+			parent[to] = from;
+			HeapSiftUp( heapIndex[to] );
+		}
+	}
+
+
+	template< typename CostModel >
+	void GridPather<CostModel>::ExpandNeighbors( int index )
+	{
+		static const int dirs[8][2] = { {1,0}, {0,1}, {-1,0}, {0,-1}, {1,1}, {-1,1}, {-1,-1}, {1,-1} };
+		const int numDirs = costModel.Diagonal() ? 8 : 4;
+
+		for( int i=0; i<numDirs; ++i )
+		{
+			const int dx = dirs[i][0], dy = dirs[i][1];
+			const int to = index + dy*stride + dx;
+			if ( !Walkable( to ) )
+				continue;
+			const bool diagonal = dx != 0 && dy != 0;
+			if ( diagonal && !( Walkable( index+dx ) && Walkable( index+dy*stride ) ) )
+				continue;
+			Relax( index, to, costModel.Cost( ToCell( index ), ToCell( to ), diagonal ) );
+		}
+	}
+
+
+	/*
+		Jump Point Search (Harabor & Grastien 2011), in the variant without corner cutting.
+		The neighbors of a cell are pruned by the direction it was reached from, and each
+		remaining direction is followed until a jump point (a cell with a forced neighbor,
+		or the goal) is found.
+	*/
+	template< typename CostModel >
+	void GridPather<CostModel>::ExpandJumpPoints( int index )
+	{
+		int dirs[8][2];
+		int numDirs = 0;
+
+		if ( parent[index] < 0 )
+		{
+			static const int all[8][2] = { {1,0}, {0,1}, {-1,0}, {0,-1}, {1,1}, {-1,1}, {-1,-1}, {1,-1} };
+			for( int i=0; i<8; ++i ) {
+				dirs[i][0] = all[i][0];
+				dirs[i][1] = all[i][1];
+			}
+			numDirs = 8;
+		}
+		else
+		{
+			const int x = index % stride, y = index / stride;
+			const int px = parent[index] % stride, py = parent[index] / stride;
+			const int dx = ( x > px ) - ( x < px );
+			const int dy = ( y > py ) - ( y < py );
+
+			if ( dx && dy ) {
+				dirs[numDirs][0] = 0;	dirs[numDirs][1] = dy;	++numDirs;
+				dirs[numDirs][0] = dx;	dirs[numDirs][1] = 0;	++numDirs;
+				dirs[numDirs][0] = dx;	dirs[numDirs][1] = dy;	++numDirs;
+			}
+			else if ( dx ) {
+				dirs[numDirs][0] = dx;	dirs[numDirs][1] = 0;	++numDirs;
+				dirs[numDirs][0] = dx;	dirs[numDirs][1] = 1;	++numDirs;
+				dirs[numDirs][0] = dx;	dirs[numDirs][1] = -1;	++numDirs;
+				dirs[numDirs][0] = 0;	dirs[numDirs][1] = 1;	++numDirs;
+				dirs[numDirs][0] = 0;	dirs[numDirs][1] = -1;	++numDirs;
+			}
+			else {
+				dirs[numDirs][0] = 0;	dirs[numDirs][1] = dy;	++numDirs;
+				dirs[numDirs][0] = 1;	dirs[numDirs][1] = dy;	++numDirs;
+				dirs[numDirs][0] = -1;	dirs[numDirs][1] = dy;	++numDirs;
+				dirs[numDirs][0] = 1;	dirs[numDirs][1] = 0;	++numDirs;
+				dirs[numDirs][0] = -1;	dirs[numDirs][1] = 0;	++numDirs;
+			}
+		}
+
+		for( int i=0; i<numDirs; ++i )
+		{
+			const int dx = dirs[i][0], dy = dirs[i][1];
+			const int next = index + dy*stride + dx;
+			if ( !Walkable( next ) )
+				continue;
+			if ( dx && dy && !( Walkable( index+dx ) && Walkable( index+dy*stride ) ) )
+				continue;
+
+			const int jumpPoint = Jump( next, dx, dy );
+			if ( jumpPoint >= 0 )
+				Relax( index, jumpPoint, LineCost( index, jumpPoint ) );
+		}
+	}
+
+
+	template< typename CostModel >
+	int GridPather<CostModel>::Jump( int index, int dx, int dy ) const
+	{
+		// Iterative, so that long straight runs on large maps don't recurse deeply.
+		const int ox = dx, oy = dy*stride;
+		while ( true )
+		{
+			if ( !Walkable( index ) )
+				return -1;
+			if ( index == goalIndex )
+				return index;
+
+			if ( dx && dy ) {
+				// A diagonal step is a jump point if a straight jump from it finds one.
+				if ( Jump( index+ox, dx, 0 ) >= 0 || Jump( index+oy, 0, dy ) >= 0 )
+					return index;
+			}
+			else if ( dx ) {
+				if ( ( Walkable( index-stride ) && !Walkable( index-ox-stride ) ) ||
+					 ( Walkable( index+stride ) && !Walkable( index-ox+stride ) ) )
+					return index;
+			}
+			else {
+				if ( ( Walkable( index-1 ) && !Walkable( index-oy-1 ) ) ||
+					 ( Walkable( index+1 ) && !Walkable( index-oy+1 ) ) )
+					return index;
+			}
+
+			if ( !( Walkable( index+ox ) && Walkable( index+oy ) ) )
+				return -1;
+			index += ox + oy;
+		}
+	}
+
+
+	template< typename CostModel >
+	float GridPather<CostModel>::LineCost( int from, int to ) const
+	{
+		// Jump points are always on a straight or diagonal line from their parent,
+		// and all steps of a uniform cost model cost the same.
+		int dx = to % stride - from % stride;
+		int dy = to / stride - from / stride;
+		if ( dx < 0 ) dx = -dx;
+		if ( dy < 0 ) dy = -dy;
+		if ( dx && dy )
+			return (float)dx * costModel.Cost( ToCell( from ), ToCell( to ), true );
+		return (float)( dx + dy ) * costModel.Cost( ToCell( from ), ToCell( to ), false );
+	}
+
+
+	template< typename CostModel >
+	void GridPather<CostModel>::BuildPath( int endIndex, std::vector< GridPoint >* path ) const
+	{
+		// Walk back the jump points, and fill in the cells between them.
+		for( int index = endIndex; index >= 0; index = parent[index] )
+		{
+			GridPoint p = { index % stride - 1, index / stride - 1 };
+			path->push_back( p );
+
+			const int from = parent[index];
+			if ( from < 0 )
+				break;
+			const int fx = from % stride - 1, fy = from / stride - 1;
+			const int dx = ( fx > p.x ) - ( fx < p.x );
+			const int dy = ( fy > p.y ) - ( fy < p.y );
+			for( GridPoint q = { p.x+dx, p.y+dy }; q.x != fx || q.y != fy; q.x += dx, q.y += dy )
+				path->push_back( q );
+		}
+
+		for( size_t i=0, j=path->size()-1; i<j; ++i, --j ) {
+			GridPoint temp = (*path)[i];
+			(*path)[i] = (*path)[j];
+			(*path)[j] = temp;
+		}
+	}
+
+
+	template< typename CostModel >
+	void GridPather<CostModel>::HeapPush( int index )
+	{
+		heap.push_back( index );
+		heapIndex[index] = (int)heap.size() - 1;
+		HeapSiftUp( heapIndex[index] );
+	}
+
+
+	template< typename CostModel >
+	int GridPather<CostModel>::HeapPop()
+	{
+		const int top = heap[0];
+		const int last = heap.back();
+		heap.pop_back();
+		if ( !heap.empty() ) {
+			heap[0] = last;
+			heapIndex[last] = 0;
+			HeapSiftDown( 0 );
+		}
+		heapIndex[top] = -1;
+		return top;
+	}
+
+
+	template< typename CostModel >
+	void GridPather<CostModel>::HeapSiftUp( int pos )
+	{
+		const int index = heap[pos];
+		const float cost = fCost[index];
+		while ( pos > 0 ) {
+			const int up = ( pos-1 ) >> 1;
+			if ( !( cost < fCost[heap[up]] ) )
+				break;
+			heap[pos] = heap[up];
+			heapIndex[heap[pos]] = pos;
+			pos = up;
+		}
+		heap[pos] = index;
+		heapIndex[index] = pos;
+	}
+
+
+	template< typename CostModel >
+	void GridPather<CostModel>::HeapSiftDown( int pos )
+	{
+		const int size = (int)heap.size();
+		const int index = heap[pos];
+		const float cost = fCost[index];
+		while ( true ) {
+			int child = pos*2 + 1;
+			if ( child >= size )
+				break;
+			if ( child+1 < size && fCost[heap[child+1]] < fCost[heap[child]] )
+				++child;
+			if ( !( fCost[heap[child]] < cost ) )
+				break;
+			heap[pos] = heap[child];
+			heapIndex[heap[pos]] = pos;
+			pos = child;
+		}
+		heap[pos] = index;
+		heapIndex[index] = pos;
+	}
+};	// namespace micropather
+
+#endif
@@ -0,0 +1,492 @@
+/*
+HierarchicalPather - hierarchical path abstraction (HPA*) for grid maps, used next to MicroPather.
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely.
+*/
+
+#include <algorithm>
+#include <functional>
+#include <stdlib.h>
+#include <float.h>
+
+#include "hierarchicalpather.h"
+
+using namespace std;
+using namespace micropather;
+
+// Entrances up to this length get a single transition in their middle
+static const int MAX_SINGLE_ENTRANCE = 6;
+
+
+HierarchicalPather::HierarchicalPather( int _clusterSize, unsigned _cacheSize )
+	: clusterSize( _clusterSize > 2 ? _clusterSize : 2 ),
+	  width( 0 ), height( 0 ), clustersX( 0 ), clustersY( 0 ),
+	  frame( 0 ), nodesExpanded( 0 ), cacheSize( _cacheSize ), cacheHits( 0 )
+{
+}
+
+
+HierarchicalPather::~HierarchicalPather()
+{
+}
+
+
+unsigned HierarchicalPather::NumAbstractNodes() const
+{
+	unsigned count = 0;
+	for( unsigned i=0; i<clusters.size(); ++i )
+		count += (unsigned)clusters[i].nodes.size();
+	return count;
+}
+
+
+int HierarchicalPather::FindNode( int cluster, int cell ) const
+{
+	const vector< Node >& nodes = clusters[cluster].nodes;
+	for( unsigned i=0; i<nodes.size(); ++i ) {
+		if ( nodes[i].cell == cell )
+			return (int)i;
+	}
+	return -1;
+}
+
+
+float HierarchicalPather::Estimate( int cellA, int cellB ) const
+{
+	int dx = cellA % width - cellB % width;
+	int dy = cellA / width - cellB / width;
+	if ( dx < 0 ) dx = -dx;
+	if ( dy < 0 ) dy = -dy;
+	return dx < dy ? 0.41421356f*(float)dx + (float)dy : 0.41421356f*(float)dy + (float)dx;
+}
+
+
+void HierarchicalPather::SetMap( const int* data, int _width, int _height )
+{
+	width = _width;
+	height = _height;
+	passable.resize( width * height );
+	for( int i=0; i<width*height; ++i )
+		passable[i] = data[i] == 0 ? 1 : 0;
+
+	clustersX = ( width + clusterSize - 1 ) / clusterSize;
+	clustersY = ( height + clusterSize - 1 ) / clusterSize;
+	clusters.resize( clustersX * clustersY );
+	for( int cy=0; cy<clustersY; ++cy ) {
+		for( int cx=0; cx<clustersX; ++cx ) {
+			Cluster& cl = clusters[ cy*clustersX + cx ];
+			cl.x0 = cx * clusterSize;
+			cl.y0 = cy * clusterSize;
+			cl.w = min( clusterSize, width - cl.x0 );
+			cl.h = min( clusterSize, height - cl.y0 );
+		}
+	}
+
+	for( int cy=0; cy<clustersY; ++cy ) {
+		for( int cx=0; cx<clustersX; ++cx )
+			BuildBorders( cx, cy );
+	}
+	for( unsigned i=0; i<clusters.size(); ++i )
+		BuildCluster( (int)i );
+	cache.clear();
+}
+
+
+void HierarchicalPather::UpdateRegion( const int* data, int x0, int y0, int x1, int y1 )
+{
+	x0 = max( x0, 0 );				y0 = max( y0, 0 );
+	x1 = min( x1, width-1 );		y1 = min( y1, height-1 );
+	if ( x0 > x1 || y0 > y1 )
+		return;
+
+	for( int y=y0; y<=y1; ++y ) {
+		for( int x=x0; x<=x1; ++x )
+			passable[ y*width + x ] = data[ y*width + x ] == 0 ? 1 : 0;
+	}
+
+	// The borders of the changed clusters, including the ones shared with their left and
+	// top neighbors. Recomputing an unchanged border gives the same transitions.
+	int cx0 = x0 / clusterSize, cy0 = y0 / clusterSize;
+	int cx1 = x1 / clusterSize, cy1 = y1 / clusterSize;
+	for( int cy=max( cy0-1, 0 ); cy<=cy1; ++cy ) {
+		for( int cx=max( cx0-1, 0 ); cx<=cx1; ++cx )
+			BuildBorders( cx, cy );
+	}
+
+	// The changed clusters and their 4 neighbors, whose nodes on the shared borders may differ
+	for( int cy=max( cy0-1, 0 ); cy<=min( cy1+1, clustersY-1 ); ++cy ) {
+		for( int cx=max( cx0-1, 0 ); cx<=min( cx1+1, clustersX-1 ); ++cx ) {
+			bool insideX = cx >= cx0 && cx <= cx1;
+			bool insideY = cy >= cy0 && cy <= cy1;
+			if ( insideX || insideY )
+				BuildCluster( cy*clustersX + cx );
+		}
+	}
+}
+
+
+void HierarchicalPather::BuildBorders( int cx, int cy )
+{
+	Cluster& cl = clusters[ cy*clustersX + cx ];
+	cl.right.resize( 0 );
+	cl.bottom.resize( 0 );
+	if ( cx+1 < clustersX )
+		AddTransitions( &cl.right, cl.x0 + cl.w - 1, cl.y0, 1, 0, cl.h );
+	if ( cy+1 < clustersY )
+		AddTransitions( &cl.bottom, cl.x0, cl.y0 + cl.h - 1, 0, 1, cl.w );
+}
+
+
+void HierarchicalPather::AddTransitions( vector< Transition >* border, int xA, int yA, int dx, int dy, int length )
+{
+	// Walk along the border (perpendicular to the crossing direction dx, dy) and collect
+	// the runs where both sides are passable
+	int runStart = -1;
+	for( int i=0; i<=length; ++i ) {
+		int x = xA + i*dy;
+		int y = yA + i*dx;
+		bool open = i < length && Passable( x, y ) && Passable( x+dx, y+dy );
+		if ( open ) {
+			if ( runStart < 0 )
+				runStart = i;
+			continue;
+		}
+		if ( runStart < 0 )
+			continue;
+
+		int runEnd = i-1;
+		int picks[2] = { runStart + ( runEnd - runStart ) / 2, -1 };
+		if ( runEnd - runStart + 1 >= MAX_SINGLE_ENTRANCE ) {
+			picks[0] = runStart;
+			picks[1] = runEnd;
+		}
+		for( int k=0; k<2 && picks[k] >= 0; ++k ) {
+			Transition t;
+			t.cellA = ( yA + picks[k]*dx ) * width + xA + picks[k]*dy;
+			t.cellB = t.cellA + dy*width + dx;
+			border->push_back( t );
+		}
+		runStart = -1;
+	}
+}
+
+
+void HierarchicalPather::BuildCluster( int cluster )
+{
+	Cluster& cl = clusters[cluster];
+	int cx = cluster % clustersX, cy = cluster / clustersX;
+
+	// Collect the transitions on all 4 borders; a corner cell may be used by 2 of them
+	vector< Transition > links( cl.right.begin(), cl.right.end() );
+	links.insert( links.end(), cl.bottom.begin(), cl.bottom.end() );
+	for( int side=0; side<2; ++side ) {
+		if ( side == 0 && cx == 0 ) continue;
+		if ( side == 1 && cy == 0 ) continue;
+
+		const vector< Transition >& other = side == 0 ? clusters[ cluster-1 ].right : clusters[ cluster-clustersX ].bottom;
+		for( unsigned i=0; i<other.size(); ++i ) {
+			Transition t = { other[i].cellB, other[i].cellA };
+			links.push_back( t );
+		}
+	}
+
+	cl.nodes.resize( 0 );
+	for( unsigned i=0; i<links.size(); ++i ) {
+		int index = FindNode( cluster, links[i].cellA );
+		if ( index < 0 ) {
+			Node node;
+			node.cell = links[i].cellA;
+			cl.nodes.push_back( node );
+			index = (int)cl.nodes.size() - 1;
+		}
+		cl.nodes[index].partners.push_back( links[i].cellB );
+	}
+
+	// Distances between the nodes inside the cluster; costs are symmetric
+	unsigned n = (unsigned)cl.nodes.size();
+	cl.dist.assign( n*n, FLT_MAX );
+	for( unsigned i=0; i<n; ++i ) {
+		cl.dist[ i*n + i ] = 0.0f;
+		if ( i+1 == n )
+			break;
+
+		SearchCluster( cluster, cl.nodes[i].cell, -1, &localDist, 0 );
+		for( unsigned j=i+1; j<n; ++j ) {
+			int cell = cl.nodes[j].cell;
+			float d = localDist[ ( cell / width - cl.y0 ) * cl.w + cell % width - cl.x0 ];
+			cl.dist[ i*n + j ] = d;
+			cl.dist[ j*n + i ] = d;
+		}
+	}
+
+	++cl.version;
+	cl.searchFrame = 0;
+}
+
+
+void HierarchicalPather::SearchCluster( int cluster, int source, int target, vector< float >* dist, vector< int >* parent )
+{
+	// Dijkstra over the cells of one cluster, indexed locally
+	static const int DX[8] = { 1, 0, -1, 0, 1, 1, -1, -1 };
+	static const int DY[8] = { 0, 1, 0, -1, 1, -1, 1, -1 };
+
+	const Cluster& cl = clusters[cluster];
+	dist->assign( cl.w * cl.h, FLT_MAX );
+	if ( parent )
+		parent->assign( cl.w * cl.h, -1 );
+
+	int sourceLocal = ( source / width - cl.y0 ) * cl.w + source % width - cl.x0;
+	int targetLocal = target < 0 ? -1 : ( target / width - cl.y0 ) * cl.w + target % width - cl.x0;
+	(*dist)[sourceLocal] = 0.0f;
+	localOpen.resize( 0 );
+	localOpen.push_back( make_pair( 0.0f, sourceLocal ) );
+
+	while ( !localOpen.empty() ) {
+		pop_heap( localOpen.begin(), localOpen.end(), greater< pair< float, int > >() );
+		float g = localOpen.back().first;
+		int local = localOpen.back().second;
+		localOpen.pop_back();
+		if ( g > (*dist)[local] )
+			continue;
+		if ( local == targetLocal )
+			break;
+
+		int lx = local % cl.w, ly = local / cl.w;
+		for( int d=0; d<8; ++d ) {
+			int nx = lx + DX[d], ny = ly + DY[d];
+			if ( nx < 0 || nx >= cl.w || ny < 0 || ny >= cl.h )
+				continue;
+			if ( !passable[ ( cl.y0 + ny ) * width + cl.x0 + nx ] )
+				continue;
+
+			float cost = 1.0f;
+			if ( d >= 4 ) {
+				// No corner cutting: both straight neighbors must be passable
+				if ( !passable[ ( cl.y0 + ly ) * width + cl.x0 + nx ] || !passable[ ( cl.y0 + ny ) * width + cl.x0 + lx ] )
+					continue;
+				cost = 1.41421356f;
+			}
+
+			int next = ny * cl.w + nx;
+			if ( g + cost < (*dist)[next] ) {
+				(*dist)[next] = g + cost;
+				if ( parent )
+					(*parent)[next] = local;
+				localOpen.push_back( make_pair( g + cost, next ) );
+				push_heap( localOpen.begin(), localOpen.end(), greater< pair< float, int > >() );
+			}
+		}
+	}
+}
+
+
+void HierarchicalPather::TouchCluster( int cluster )
+{
+	Cluster& cl = clusters[cluster];
+	if ( cl.searchFrame == frame )
+		return;
+
+	unsigned n = (unsigned)cl.nodes.size();
+	cl.g.assign( n, FLT_MAX );
+	cl.parentCluster.assign( n, -1 );
+	cl.parentNode.assign( n, -1 );
+	cl.closed.assign( n, 0 );
+	cl.searchFrame = frame;
+}
+
+
+void HierarchicalPather::Push( int cluster, int node, float g, int parentCluster, int parentNode, int goalCell )
+{
+	TouchCluster( cluster );
+	Cluster& cl = clusters[cluster];
+	if ( cl.closed[node] || g >= cl.g[node] )
+		return;
+
+	cl.g[node] = g;
+	cl.parentCluster[node] = parentCluster;
+	cl.parentNode[node] = parentNode;
+
+	OpenEntry entry = { g + Estimate( cl.nodes[node].cell, goalCell ), g, cluster, node };
+	open.push_back( entry );
+	push_heap( open.begin(), open.end() );
+}
+
+
+int HierarchicalPather::Solve( int startX, int startY, int endX, int endY, vector< GridPoint >* waypoints, float* totalCost )
+{
+	waypoints->resize( 0 );
+	*totalCost = 0.0f;
+	nodesExpanded = 0;
+
+	if ( startX == endX && startY == endY )
+		return START_END_SAME;
+	if ( !Passable( startX, startY ) || !Passable( endX, endY ) )
+		return NO_SOLUTION;
+
+	int startCell = startY*width + startX;
+	int goalCell = endY*width + endX;
+
+	// Repeated query: reuse the result while the clusters it passes are unchanged
+	PathCache::iterator cached = cache.find( make_pair( startCell, goalCell ) );
+	if ( cached != cache.end() ) {
+		const CachedPath& entry = cached->second;
+		bool valid = true;
+		for( unsigned i=0; i<entry.clusters.size() && valid; ++i )
+			valid = clusters[ entry.clusters[i] ].version == entry.versions[i];
+
+		if ( valid ) {
+			++cacheHits;
+			*waypoints = entry.waypoints;
+			*totalCost = entry.cost;
+			return SOLVED;
+		}
+		cache.erase( cached );
+	}
+
+	++frame;
+	open.resize( 0 );
+	int startCluster = ClusterOf( startX, startY );
+	int goalCluster = ClusterOf( endX, endY );
+	const Cluster& sc = clusters[startCluster];
+	const Cluster& gc = clusters[goalCluster];
+
+	// Connect start and end to the nodes of their clusters
+	SearchCluster( startCluster, startCell, -1, &localDist, 0 );
+	startDist.swap( localDist );
+	SearchCluster( goalCluster, goalCell, -1, &localDist, 0 );
+	goalDist.swap( localDist );
+
+	float best = FLT_MAX;
+	int bestCluster = -1, bestNode = -1;
+	if ( startCluster == goalCluster )
+		best = startDist[ ( endY - sc.y0 ) * sc.w + endX - sc.x0 ];
+
+	for( unsigned i=0; i<sc.nodes.size(); ++i ) {
+		int cell = sc.nodes[i].cell;
+		float d = startDist[ ( cell / width - sc.y0 ) * sc.w + cell % width - sc.x0 ];
+		if ( d < FLT_MAX )
+			Push( startCluster, (int)i, d, -1, -1, goalCell );
+	}
+
+	while ( !open.empty() ) {
+		pop_heap( open.begin(), open.end() );
+		OpenEntry entry = open.back();
+		open.pop_back();
+		if ( entry.f >= best )
+			break;
+
+		Cluster& cl = clusters[entry.cluster];
+		if ( cl.closed[entry.node] || entry.g > cl.g[entry.node] )
+			continue;
+		cl.closed[entry.node] = 1;
+		++nodesExpanded;
+
+		const Node& node = cl.nodes[entry.node];
+		if ( entry.cluster == goalCluster ) {
+			float d = goalDist[ ( node.cell / width - gc.y0 ) * gc.w + node.cell % width - gc.x0 ];
+			if ( d < FLT_MAX && entry.g + d < best ) {
+				best = entry.g + d;
+				bestCluster = entry.cluster;
+				bestNode = entry.node;
+			}
+		}
+
+		unsigned n = (unsigned)cl.nodes.size();
+		for( unsigned i=0; i<n; ++i ) {
+			float d = cl.dist[ entry.node*n + i ];
+			if ( (int)i != entry.node && d < FLT_MAX )
+				Push( entry.cluster, (int)i, entry.g + d, entry.cluster, entry.node, goalCell );
+		}
+		for( unsigned i=0; i<node.partners.size(); ++i ) {
+			int partner = node.partners[i];
+			int partnerCluster = ClusterOfCell( partner );
+			Push( partnerCluster, FindNode( partnerCluster, partner ), entry.g + 1.0f, entry.cluster, entry.node, goalCell );
+		}
+	}
+
+	if ( best == FLT_MAX )
+		return NO_SOLUTION;
+
+	GridPoint end = { endX, endY };
+	waypoints->push_back( end );
+	for( int c=bestCluster, i=bestNode; c >= 0; ) {
+		const Cluster& cl = clusters[c];
+		GridPoint pt = { cl.nodes[i].cell % width, cl.nodes[i].cell / width };
+		waypoints->push_back( pt );
+		int pc = cl.parentCluster[i];
+		i = cl.parentNode[i];
+		c = pc;
+	}
+	GridPoint start = { startX, startY };
+	waypoints->push_back( start );
+	reverse( waypoints->begin(), waypoints->end() );
+	*totalCost = best;
+
+	if ( cacheSize > 0 ) {
+		if ( cache.size() >= cacheSize )
+			cache.clear();
+
+		CachedPath& entry = cache[ make_pair( startCell, goalCell ) ];
+		entry.waypoints = *waypoints;
+		entry.cost = best;
+		for( unsigned i=0; i<waypoints->size(); ++i ) {
+			int c = ClusterOf( (*waypoints)[i].x, (*waypoints)[i].y );
+			if ( find( entry.clusters.begin(), entry.clusters.end(), c ) == entry.clusters.end() ) {
+				entry.clusters.push_back( c );
+				entry.versions.push_back( clusters[c].version );
+			}
+		}
+	}
+	return SOLVED;
+}
+
+
+bool HierarchicalPather::RefineSegment( const GridPoint& a, const GridPoint& b, vector< GridPoint >* path )
+{
+	if ( !Passable( a.x, a.y ) || !Passable( b.x, b.y ) )
+		return false;
+
+	int clusterA = ClusterOf( a.x, a.y );
+	if ( clusterA != ClusterOf( b.x, b.y ) ) {
+		// Transition between 2 clusters
+		if ( abs( a.x - b.x ) + abs( a.y - b.y ) != 1 )
+			return false;
+		path->push_back( b );
+		return true;
+	}
+
+	const Cluster& cl = clusters[clusterA];
+	SearchCluster( clusterA, a.y*width + a.x, b.y*width + b.x, &localDist, &localParent );
+	int local = ( b.y - cl.y0 ) * cl.w + b.x - cl.x0;
+	if ( localDist[local] == FLT_MAX )
+		return false;
+
+	size_t first = path->size();
+	for( ; localParent[local] >= 0; local = localParent[local] ) {
+		GridPoint pt = { cl.x0 + local % cl.w, cl.y0 + local / cl.w };
+		path->push_back( pt );
+	}
+	reverse( path->begin() + first, path->end() );
+	return true;
+}
+
+
+bool HierarchicalPather::Refine( const vector< GridPoint >& waypoints, vector< GridPoint >* path )
+{
+	path->resize( 0 );
+	if ( waypoints.empty() )
+		return false;
+
+	path->push_back( waypoints[0] );
+	for( unsigned i=1; i<waypoints.size(); ++i ) {
+		if ( !RefineSegment( waypoints[i-1], waypoints[i], path ) )
+			return false;
+	}
+	return true;
+}
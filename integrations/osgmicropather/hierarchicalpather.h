@@ -0,0 +1,179 @@
+/*
+HierarchicalPather - hierarchical path abstraction (HPA*) for grid maps, used next to MicroPather.
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely.
+*/
+
+
+#ifndef GRINNINGLIZARD_HIERARCHICALPATHER_INCLUDED
+#define GRINNINGLIZARD_HIERARCHICALPATHER_INCLUDED
+
+/** @page hierarchicalpather HierarchicalPather
+
+	Long distance queries on large maps expand a huge number of cells, even with GridPather.
+	HierarchicalPather (Botea, Mueller & Schaeffer: "Near Optimal Hierarchical Path-Finding")
+	splits the grid into square clusters:
+	- Entrances are the runs of passable cells on both sides of a cluster border. Each run
+	  gets one transition in its middle, or two at its ends for long runs. The cells of the
+	  transitions are the abstract nodes.
+	- The distances between the abstract nodes of a cluster are precomputed with searches
+	  limited to the cluster.
+	- A query connects start and end to the nodes of their clusters, searches the small
+	  abstract graph and returns waypoints. Refine() or RefineSegment() turns waypoints
+	  into cells on demand, each segment staying inside one cluster.
+
+	When the map changes, UpdateRegion() only recomputes the borders and clusters touching
+	the changed cells. Solved queries are cached, and a cached path is reused as long as none
+	of the clusters it passes was recomputed.
+
+	Movement is 8-connected with costs 1 and sqrt(2) and no corner cutting, like
+	GridPather<OctileGridCost>. Paths are near optimal (usually within a few percent).
+*/
+
+#include <vector>
+#include <map>
+#include "gridpather.h"
+
+namespace micropather
+{
+	class HierarchicalPather
+	{
+	  public:
+		enum
+		{
+			SOLVED,
+			NO_SOLUTION,
+			START_END_SAME,
+		};
+
+		/**
+			@param clusterSize	Width and height of the clusters in cells. Larger clusters give
+								smaller abstract graphs but more expensive updates and refinements.
+			@param cacheSize	Maximum number of cached query results.
+		*/
+		HierarchicalPather( int clusterSize=32, unsigned cacheSize=1024 );
+		~HierarchicalPather();
+
+		/// Set the map (passable cells are 0) and build the whole abstract graph.
+		void SetMap( const int* data, int width, int height );
+
+		/**
+			Apply the changed cells in [x0, x1] x [y0, y1] (inclusive) of the map data, which has
+			the size given to SetMap(), and only rebuild the affected clusters.
+		*/
+		void UpdateRegion( const int* data, int x0, int y0, int x1, int y1 );
+
+		/**
+			Solve for the abstract path from start to end.
+
+			@param waypoints	Output, the start, the transition cells to pass and the end.
+								Consecutive waypoints are in the same cluster or adjacent.
+			@param totalCost	Output, the cost of the path, if found.
+			@return				Success or failure, expressed as SOLVED, NO_SOLUTION, or START_END_SAME.
+		*/
+		int Solve( int startX, int startY, int endX, int endY, std::vector< GridPoint >* waypoints, float* totalCost );
+
+		/// Append the cells from a to b (excluding a) for 2 consecutive waypoints.
+		bool RefineSegment( const GridPoint& a, const GridPoint& b, std::vector< GridPoint >* path );
+
+		/// Return every cell of a path given as waypoints by Solve().
+		bool Refine( const std::vector< GridPoint >& waypoints, std::vector< GridPoint >* path );
+
+		/// Remove all cached query results.
+		void ClearCache()						{ cache.clear(); }
+
+		int ClusterSize() const					{ return clusterSize; }
+		unsigned NumAbstractNodes() const;
+		unsigned CacheHits() const				{ return cacheHits; }
+		unsigned NodesExpanded() const			{ return nodesExpanded; }
+
+	  private:
+		HierarchicalPather( const HierarchicalPather& );	// undefined and unsupported
+		void operator=( const HierarchicalPather& );
+
+		struct Transition
+		{
+			int cellA, cellB;	// passable cells on both sides of a border
+		};
+
+		struct Node
+		{
+			int cell;
+			std::vector< int > partners;	// cells in neighbor clusters connected with cost 1
+		};
+
+		struct Cluster
+		{
+			Cluster() : x0( 0 ), y0( 0 ), w( 0 ), h( 0 ), version( 0 ), searchFrame( 0 ) {}
+
+			int x0, y0, w, h;
+			std::vector< Node > nodes;
+			std::vector< float > dist;			// nodes x nodes, FLT_MAX if not connected inside the cluster
+			std::vector< Transition > right;	// transitions to the cluster on the right
+			std::vector< Transition > bottom;	// transitions to the cluster below
+			unsigned version;					// incremented whenever the nodes are rebuilt
+
+			// Abstract search state, valid if searchFrame is the current frame
+			unsigned searchFrame;
+			std::vector< float > g;
+			std::vector< int > parentCluster, parentNode;
+			std::vector< char > closed;
+		};
+
+		struct OpenEntry
+		{
+			float f, g;
+			int cluster, node;
+			bool operator<( const OpenEntry& rhs ) const	{ return f > rhs.f; }	// smallest first in a max heap
+		};
+
+		struct CachedPath
+		{
+			std::vector< GridPoint > waypoints;
+			std::vector< int > clusters;
+			std::vector< unsigned > versions;
+			float cost;
+		};
+
+		bool Passable( int x, int y ) const {
+			return x >= 0 && x < width && y >= 0 && y < height && passable[ y*width + x ] != 0;
+		}
+		int ClusterOf( int x, int y ) const	{ return ( y / clusterSize ) * clustersX + x / clusterSize; }
+		int ClusterOfCell( int cell ) const	{ return ClusterOf( cell % width, cell / width ); }
+		int FindNode( int cluster, int cell ) const;
+		float Estimate( int cellA, int cellB ) const;
+
+		void BuildBorders( int cx, int cy );
+		void AddTransitions( std::vector< Transition >* border, int xA, int yA, int dx, int dy, int length );
+		void BuildCluster( int cluster );
+		void SearchCluster( int cluster, int source, int target, std::vector< float >* dist, std::vector< int >* parent );
+		void TouchCluster( int cluster );
+		void Push( int cluster, int node, float g, int parentCluster, int parentNode, int goalCell );
+
+		int clusterSize;
+		int width, height;
+		int clustersX, clustersY;
+		std::vector< unsigned char > passable;
+		std::vector< Cluster > clusters;
+
+		unsigned frame;
+		unsigned nodesExpanded;
+		std::vector< OpenEntry > open;
+		std::vector< float > startDist, goalDist, localDist;
+		std::vector< int > localParent;
+		std::vector< std::pair< float, int > > localOpen;
+
+		typedef std::map< std::pair< int, int >, CachedPath > PathCache;
+		PathCache cache;
+		unsigned cacheSize;
+		unsigned cacheHits;
+	};
+};	// namespace micropather
+
+#endif
@@ -36,16 +36,178 @@ distribution.
 //#define DEBUG_PATH_DEEP
 //#define TRACK_COLLISION
 
+// Use the sorted linked list of the original MicroPather as the open queue,
+// to compare against the heap (see MicroPather::NodesExpanded()).
+//#define MICROPATHER_LIST_OPENQUEUE
+
 
 #include "micropather.h"
 
 using namespace std;
 using namespace micropather;
 
+#ifndef MICROPATHER_LIST_OPENQUEUE
+
+/*
+	The open queue is an indexed binary heap ordered by totalCost. Every node in
+	the heap knows its position (openIndex), so a node whose cost decreased can be
+	moved up in O(log n) instead of being re-sorted into a list.
+*/
 class OpenQueue
 {
   public:
-	OpenQueue( Graph* _graph )
+	OpenQueue( Graph* _graph, std::vector< PathNode* >* _heap )
+	{ 
+		graph = _graph; 
+		heap = _heap;
+		heap->resize( 0 );
+	}
+	~OpenQueue()	{}
+
+	void Push( PathNode* pNode );
+	PathNode* Pop();
+	void Update( PathNode* pNode );
+    
+	bool Empty()	{ return heap->empty(); }
+
+  private:
+	OpenQueue( const OpenQueue& );	// undefined and unsupported
+	void operator=( const OpenQueue& );
+
+	void SiftUp( int index );
+	void SiftDown( int index );
+	void Place( PathNode* pNode, int index ) {
+		(*heap)[index] = pNode;
+		pNode->openIndex = index;
+	}
+	#ifdef DEBUG
+	void CheckHeap();
+	#endif
+  
+	std::vector< PathNode* >* heap;
+	Graph* graph;	// for debugging
+};
+
+
+void OpenQueue::Push( PathNode* pNode )
+{
+	
+	MPASSERT( pNode->inOpen == 0 );
+	MPASSERT( pNode->inClosed == 0 );
+	
+#ifdef DEBUG_PATH_DEEP
+	printf( "Open Push: " );
+	graph->PrintStateInfo( pNode->state );
+	printf( " total=%.1f\n", pNode->totalCost );		
+#endif
+	
+	MPASSERT( pNode->totalCost < FLT_MAX );
+	heap->push_back( pNode );
+	pNode->openIndex = (int)heap->size() - 1;
+	pNode->inOpen = 1;
+	SiftUp( pNode->openIndex );
+#ifdef DEBUG
+	CheckHeap();
+#endif
+}
+
+PathNode* OpenQueue::Pop()
+{
+	MPASSERT( !heap->empty() );
+	PathNode* pNode = heap->front();
+	PathNode* last = heap->back();
+	heap->pop_back();
+	if ( last != pNode ) {
+		Place( last, 0 );
+		SiftDown( 0 );
+	}
+#ifdef DEBUG
+	CheckHeap();
+#endif
+	
+	MPASSERT( pNode->inClosed == 0 );
+	MPASSERT( pNode->inOpen == 1 );
+	pNode->inOpen = 0;
+	pNode->openIndex = -1;
+	
+#ifdef DEBUG_PATH_DEEP
+	printf( "Open Pop: " );
+	graph->PrintStateInfo( pNode->state );
+	printf( " total=%.1f\n", pNode->totalCost );		
+#endif
+	
+	return pNode;
+}
+
+void OpenQueue::Update( PathNode* pNode )
+{
+#ifdef DEBUG_PATH_DEEP
+	printf( "Open Update: " );		
+	graph->PrintStateInfo( pNode->state );
+	printf( " total=%.1f\n", pNode->totalCost );		
+#endif
+	
+	MPASSERT( pNode->inOpen );
+	MPASSERT( (*heap)[pNode->openIndex] == pNode );
+	
+	// The solvers only ever lower the cost of an open node, but handle
+	// both directions to keep the heap valid.
+	SiftUp( pNode->openIndex );
+	SiftDown( pNode->openIndex );
+#ifdef DEBUG
+	CheckHeap();
+#endif
+}
+
+void OpenQueue::SiftUp( int index )
+{
+	PathNode** h = &(*heap)[0];
+	PathNode* pNode = h[index];
+	while ( index > 0 ) {
+		int parent = (index-1) >> 1;
+		if ( !( pNode->totalCost < h[parent]->totalCost ) )
+			break;
+		Place( h[parent], index );
+		index = parent;
+	}
+	Place( pNode, index );
+}
+
+void OpenQueue::SiftDown( int index )
+{
+	PathNode** h = &(*heap)[0];
+	const int size = (int)heap->size();
+	PathNode* pNode = h[index];
+	while ( true ) {
+		int child = index*2 + 1;
+		if ( child >= size )
+			break;
+		if ( child+1 < size && h[child+1]->totalCost < h[child]->totalCost )
+			++child;
+		if ( !( h[child]->totalCost < pNode->totalCost ) )
+			break;
+		Place( h[child], index );
+		index = child;
+	}
+	Place( pNode, index );
+}
+
+#ifdef DEBUG
+void OpenQueue::CheckHeap()
+{
+	for( unsigned i=0; i<heap->size(); ++i ) {
+		MPASSERT( (*heap)[i]->openIndex == (int)i );
+		MPASSERT( i == 0 || (*heap)[(i-1)/2]->totalCost <= (*heap)[i]->totalCost );
+	}
+}
+#endif
+
+#else
+
+class OpenQueue
+{
+  public:
+	OpenQueue( Graph* _graph, std::vector< PathNode* >* )
 	{ 
 		graph = _graph; 
 		sentinel = (PathNode*) sentinelMem;
@@ -157,6 +319,8 @@ void OpenQueue::Update( PathNode* pNode )
 	}
 }
 
+#endif
+
 
 class ClosedSet
 {
@@ -447,7 +611,8 @@ MicroPather::MicroPather( Graph* _graph, unsigned allocate, unsigned typicalAdja
 	:	pathNodePool( allocate, typicalAdjacent ),
 		graph( _graph ),
 		frame( 0 ),
-		checksum( 0 )
+		checksum( 0 ),
+		nodesExpanded( 0 )
 {}
 
 
@@ -655,8 +820,9 @@ int MicroPather::Solve( void* startNode, void* endNode, vector< void* >* path, f
 		return START_END_SAME;
 
 	++frame;
+	nodesExpanded = 0;
 
-	OpenQueue open( graph );
+	OpenQueue open( graph, &openHeap );
 	ClosedSet closed( graph );
 	
 	PathNode* newPathNode = pathNodePool.GetPathNode(	frame, 
@@ -672,6 +838,7 @@ int MicroPather::Solve( void* startNode, void* endNode, vector< void* >* path, f
 	while ( !open.Empty() )
 	{
 		PathNode* node = open.Pop();
+		++nodesExpanded;
 		
 		if ( node->state == endNode )
 		{
@@ -760,8 +927,9 @@ int MicroPather::SolveForNearStates( void* startState, std::vector< StateCost >*
 	*/
 
 	++frame;
+	nodesExpanded = 0;
 
-	OpenQueue open( graph );			// nodes to look at
+	OpenQueue open( graph, &openHeap );	// nodes to look at
 	ClosedSet closed( graph );
 
 	nodeCostVec.resize(0);
@@ -778,6 +946,7 @@ int MicroPather::SolveForNearStates( void* startState, std::vector< StateCost >*
 	while ( !open.Empty() )
 	{
 		PathNode* node = open.Pop();	// smallest dist
+		++nodesExpanded;
 		closed.Add( node );				// add to the things we've looked at
 		closedSentinel.AddBefore( node );
 			
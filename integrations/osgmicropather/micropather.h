@@ -178,7 +178,8 @@ namespace micropather
 		int cacheIndex;			// position in cache
 
 		PathNode *child[2];		// Binary search in the hash table. [left, right]
-		PathNode *next, *prev;	// used by open queue
+		PathNode *next, *prev;	// used by the free list, the near states list and the list open queue
+		int openIndex;			// position in the open queue heap
 
 		bool inOpen;
 		bool inClosed;
@@ -367,6 +368,12 @@ namespace micropather
 		*/
 		MP_UPTR Checksum()	{ return checksum; }
 
+		/**
+			Return the number of states taken from the open queue by the last Solve() or
+			SolveForNearStates(). Useful for profiling.
+		*/
+		unsigned NodesExpanded()	{ return nodesExpanded; }
+
 		// Debugging function to return all states that were used by the last "solve" 
 		void StatesInPool( std::vector< void* >* stateVec );
 
@@ -385,10 +392,12 @@ namespace micropather
 		PathNodePool				pathNodePool;
 		std::vector< StateCost >	stateCostVec;	// local to Solve, but put here to reduce memory allocation
 		std::vector< NodeCost >		nodeCostVec;	// local to Solve, but put here to reduce memory allocation
+		std::vector< PathNode* >	openHeap;		// local to Solve, but put here to reduce memory allocation
 
 		Graph* graph;
 		unsigned frame;						// incremented with every solve, used to determine if cached data needs to be refreshed
 		MP_UPTR checksum;						// the checksum of the last successful "Solve".
+		unsigned nodesExpanded;					// number of states popped from the open queue in the last solve
 		
 	};
 };	// namespace grinliz
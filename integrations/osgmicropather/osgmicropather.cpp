@@ -1,6 +1,7 @@
 #include <osg/ShapeDrawable>
 #include <osg/Geometry>
 #include <osg/MatrixTransform>
+#include <osg/Timer>
 #include <osgDB/ReadFile>
 #include <osgUtil/SmoothingVisitor>
 #include <osgGA/StateSetManipulator>
@@ -8,6 +9,8 @@
 #include <osgViewer/Viewer>
 
 #include "micropather.h"
+#include "gridpather.h"
+#include "hierarchicalpather.h"
 
 class PathFindingHandler : public micropather::Graph
 {
@@ -25,11 +28,33 @@ public:
     
     void setMapData( const int* data, int x, int y )
     {
+        if ( x==_mapX && y==_mapY && !_mapData.empty() )
+        {
+            // Same map size: only rebuild the hierarchical clusters around the changed cells
+            int minX = x, minY = y, maxX = -1, maxY = -1;
+            for ( int i=0; i<x*y; ++i )
+            {
+                if ( _mapData[i]==data[i] ) continue;
+                _mapData[i] = data[i];
+                minX = osg::minimum(minX, i % x); maxX = osg::maximum(maxX, i % x);
+                minY = osg::minimum(minY, i / x); maxY = osg::maximum(maxY, i / x);
+            }
+            
+            if ( maxX<0 ) return;
+            _gridPather.SetMap( data, x, y );
+            _hierarchicalPather.UpdateRegion( data, minX, minY, maxX, maxY );
+            _pather->Reset();
+            return;
+        }
+        
         _mapData.resize( x*y );
         for ( unsigned int i=0; i<_mapData.size(); ++i )
             _mapData[i] = *(data + i);
         _mapX = x;
         _mapY = y;
+        _gridPather.SetMap( data, x, y );
+        _hierarchicalPather.SetMap( data, x, y );
+        _pather->Reset();
     }
     
     void addDirectionCost( const osg::Vec2& dir, float weight )
@@ -59,6 +84,42 @@ public:
         return false;
     }
     
+    /** Find path with the grid solver: 8 directions with uniform costs, no corner cutting */
+    bool findGridPath( int startX, int startY, int endX, int endY, std::vector<osg::Vec2>& result )
+    {
+        float totalCost = 0.0f;
+        std::vector<micropather::GridPoint> path;
+        int rtn = _gridPather.Solve( startX, startY, endX, endY, &path, &totalCost );
+        if ( rtn==micropather::GridPather<micropather::OctileGridCost>::SOLVED )
+        {
+            result.resize( path.size() );
+            for ( unsigned int i=0; i<path.size(); ++i )
+                result[i] = osg::Vec2((float)path[i].x, (float)path[i].y);
+            return true;
+        }
+        return false;
+    }
+    
+    /** Find path on the cluster abstraction (near optimal), and refine it to cells */
+    bool findHierarchicalPath( int startX, int startY, int endX, int endY, std::vector<osg::Vec2>& result )
+    {
+        float totalCost = 0.0f;
+        std::vector<micropather::GridPoint> waypoints, path;
+        int rtn = _hierarchicalPather.Solve( startX, startY, endX, endY, &waypoints, &totalCost );
+        if ( rtn==micropather::HierarchicalPather::SOLVED && _hierarchicalPather.Refine(waypoints, &path) )
+        {
+            result.resize( path.size() );
+            for ( unsigned int i=0; i<path.size(); ++i )
+                result[i] = osg::Vec2((float)path[i].x, (float)path[i].y);
+            return true;
+        }
+        return false;
+    }
+    
+    micropather::MicroPather* getPather() { return _pather; }
+    micropather::GridPather<micropather::OctileGridCost>& getGridPather() { return _gridPather; }
+    micropather::HierarchicalPather& getHierarchicalPather() { return _hierarchicalPather; }
+    
     virtual float LeastCostEstimate( void* start, void* end )
     {
         int startX=0, startY=0, endX=0, endY=0;
@@ -106,12 +167,13 @@ protected:
     
     void convertNodeToXY( void* node, int& x, int& y )
     {
-         y = (int)node / _mapX;
-         x = (int)node - y * _mapX;
+         int index = (int)(MP_UPTR)node;
+         y = index / _mapX;
+         x = index - y * _mapX;
     }
     
     void* convertXYToNode( int x, int y )
-    { return (void*)(y * _mapX + x); }
+    { return (void*)(MP_UPTR)(y * _mapX + x); }
     
     struct DirectionCost
     {
@@ -121,6 +183,8 @@ protected:
     std::vector<DirectionCost> _costList;
     std::vector<int> _mapData;
     micropather::MicroPather* _pather;
+    micropather::GridPather<micropather::OctileGridCost> _gridPather;
+    micropather::HierarchicalPather _hierarchicalPather;
     int _mapX, _mapY;
 };
 
@@ -152,8 +216,68 @@ osg::AnimationPathCallback* createAnimationPathCallback( osg::Vec3Array* vertice
     return apcb.release();    
 }
 
+int runBenchmark( int size, int numQueries )
+{
+    // Random obstacles on a quarter of the cells, 8 directions
+    std::vector<int> mapData( size * size );
+    srand( 0 );
+    for ( unsigned int i=0; i<mapData.size(); ++i )
+        mapData[i] = (rand() % 4)==0 ? 1 : 0;
+    
+    PathFindingHandler pathFinder;
+    pathFinder.addDirectionCost( osg::Vec2(1.0f, 0.0f), 1.0f );
+    pathFinder.addDirectionCost( osg::Vec2(0.0f, -1.0f), 1.0f );
+    pathFinder.addDirectionCost( osg::Vec2(-1.0f, 0.0f), 1.0f );
+    pathFinder.addDirectionCost( osg::Vec2(0.0f, 1.0f), 1.0f );
+    pathFinder.addDirectionCost( osg::Vec2(1.0f, 1.0f), 1.414f );
+    pathFinder.addDirectionCost( osg::Vec2(1.0f, -1.0f), 1.414f );
+    pathFinder.addDirectionCost( osg::Vec2(-1.0f, 1.0f), 1.414f );
+    pathFinder.addDirectionCost( osg::Vec2(-1.0f, -1.0f), 1.414f );
+    pathFinder.setMapData( &(mapData[0]), size, size );
+    
+    double totalTime = 0.0, totalExpanded = 0.0, gridTime = 0.0, gridExpanded = 0.0, hpaTime = 0.0;
+    int numSolved = 0, numGridSolved = 0, numHpaSolved = 0;
+    for ( int i=0; i<numQueries; ++i )
+    {
+        int start = 0, end = 0;
+        do { start = rand() % (size * size); } while ( mapData[start]!=0 );
+        do { end = rand() % (size * size); } while ( mapData[end]!=0 );
+        
+        std::vector<osg::Vec2> result;
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        if ( pathFinder.findPath(start % size, start / size, end % size, end / size, result) ) numSolved++;
+        totalTime += osg::Timer::instance()->delta_s( t0, osg::Timer::instance()->tick() );
+        totalExpanded += pathFinder.getPather()->NodesExpanded();
+        
+        t0 = osg::Timer::instance()->tick();
+        if ( pathFinder.findGridPath(start % size, start / size, end % size, end / size, result) ) numGridSolved++;
+        gridTime += osg::Timer::instance()->delta_s( t0, osg::Timer::instance()->tick() );
+        gridExpanded += pathFinder.getGridPather().NodesExpanded();
+        
+        t0 = osg::Timer::instance()->tick();
+        if ( pathFinder.findHierarchicalPath(start % size, start / size, end % size, end / size, result) ) numHpaSolved++;
+        hpaTime += osg::Timer::instance()->delta_s( t0, osg::Timer::instance()->tick() );
+    }
+    
+    std::cout << "Grid: " << size << "x" << size << ", Queries: " << numQueries << std::endl;
+    std::cout << "MicroPather: " << numSolved << " solved, Time: " << totalTime * 1000.0
+              << "ms, Nodes expanded per second: " << (totalTime>0.0 ? totalExpanded / totalTime : 0.0) << std::endl;
+    std::cout << "GridPather (JPS): " << numGridSolved << " solved, Time: " << gridTime * 1000.0
+              << "ms, Nodes expanded per second: " << (gridTime>0.0 ? gridExpanded / gridTime : 0.0) << std::endl;
+    std::cout << "HierarchicalPather: " << numHpaSolved << " solved, Time: " << hpaTime * 1000.0
+              << "ms, Abstract nodes: " << pathFinder.getHierarchicalPather().NumAbstractNodes() << std::endl;
+    return 0;
+}
+
 int main( int argc, char** argv )
 {
+    // Headless solver benchmark, e.g. --benchmark 1024 --queries 100
+    osg::ArgumentParser arguments( &argc, argv );
+    int benchmarkSize = 0, numQueries = 100;
+    arguments.read( "--queries", numQueries );
+    if ( arguments.read("--benchmark", benchmarkSize) )
+        return runBenchmark( benchmarkSize, numQueries );
+    
     // Create path properties
     const int mapData[10 * 10] =
     { 
@@ -41,7 +41,8 @@ enum FONSalign {
 enum FONSerrorCode {
 	// Font atlas is full.
 	FONS_ATLAS_FULL = 1,
-	// Scratch memory used to render glyphs is full, requested size reported in 'val', you may need to bump up FONS_SCRATCH_BUF_SIZE.		
+	// Scratch memory used to render glyphs could not be allocated, requested size reported in 'val'.
+	// The scratch buffer grows as needed, FONS_SCRATCH_BUF_SIZE is only its initial size.
 	FONS_SCRATCH_FULL = 2,
 	// Calls to fonsPushState has created too large stack, if you need deep state stack bump up FONS_MAX_STATES.
 	FONS_STATES_OVERFLOW = 3,
@@ -74,6 +75,7 @@ struct FONStextIter {
 	short isize, iblur;
 	struct FONSfont* font;
 	int prevGlyphIndex;
+	int page;
 	const char* str;
 	const char* next;
 	const char* end;
@@ -94,6 +96,14 @@ void fonsGetAtlasSize(FONScontext* s, int* width, int* height);
 int fonsExpandAtlas(FONScontext* s, int width, int height);
 // Resets the whole stash.
 int fonsResetAtlas(FONScontext* stash, int width, int height);
+// Starts a new atlas page of specified size, glyphs on earlier pages stay cached. Each glyph
+// (and FONStextIter::page) records the page it is on, the texture data and the dirty rect are
+// those of the current page. This is meant for renderers which keep a texture per page, the
+// render callbacks in FONSparams only ever see the current page.
+// Returns the new page index, or FONS_INVALID if FONS_MAX_PAGES is reached.
+int fonsAddAtlasPage(FONScontext* stash, int width, int height);
+// Returns the index of the current atlas page.
+int fonsGetAtlasPage(FONScontext* stash);
 
 // Add fonts
 int fonsAddFont(FONScontext* s, const char* name, const char* path);
@@ -125,6 +135,18 @@ void fonsVertMetrics(FONScontext* s, float* ascender, float* descender, float* l
 int fonsTextIterInit(FONScontext* stash, FONStextIter* iter, float x, float y, const char* str, const char* end);
 int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, struct FONSquad* quad);
 
+// Glyph prewarming: rasterizes glyphs of the current font, size and blur ahead of drawing.
+// fonsPrewarmBegin() collects the codepoints which are not cached yet and returns NULL if there
+// are none. fonsPrewarmRasterize() must then be called once for each task in [0, fonsPrewarmTaskCount()),
+// these calls may run in parallel threads and do not touch the stash. fonsPrewarmEnd() packs
+// the glyphs into the atlas (tallest first) and frees the job, returning the number of glyphs added.
+// The stash must not be used between fonsPrewarmBegin() and fonsPrewarmEnd().
+typedef struct FONSprewarm FONSprewarm;
+FONSprewarm* fonsPrewarmBegin(FONScontext* s, const unsigned int* codepoints, int ncodepoints, int ntasks);
+int fonsPrewarmTaskCount(FONSprewarm* job);
+void fonsPrewarmRasterize(FONSprewarm* job, int task);
+int fonsPrewarmEnd(FONScontext* s, FONSprewarm* job);
+
 // Pull texture changes
 const unsigned char* fonsGetTextureData(FONScontext* stash, int* width, int* height);
 int fonsValidateTexture(FONScontext* s, int* dirty);
@@ -139,6 +161,18 @@ void fonsDrawDebug(FONScontext* s, float x, float y);
 
 #define FONS_NOTUSED(v)  (void)sizeof(v)
 
+// Bump allocator for glyph rasterization. Requests which do not fit are served by malloc
+// and the buffer grows to the peak usage when reset, so complex glyphs never fail.
+struct FONSscratch
+{
+	unsigned char* data;
+	int size;
+	int used;
+	int peak;
+	void* overflow;
+};
+typedef struct FONSscratch FONSscratch;
+
 #ifdef FONS_USE_FREETYPE
 
 #include <ft2build.h>
@@ -245,6 +279,8 @@ static void fons__tmpfree(void* ptr, void* up);
 #define STBTT_free(x,u)      fons__tmpfree(x,u)
 #include "stb_truetype.h"
 
+static FONSscratch* fons__getScratch(FONScontext* stash);
+
 struct FONSttFontImpl {
 	stbtt_fontinfo font;
 };
@@ -261,7 +297,7 @@ int fons__tt_loadFont(FONScontext *context, FONSttFontImpl *font, unsigned char
 	int stbError;
 	FONS_NOTUSED(dataSize);
 
-	font->font.userdata = context;
+	font->font.userdata = fons__getScratch(context);
 	stbError = stbtt_InitFont(&font->font, data, 0);
 	return stbError;
 }
@@ -309,6 +345,9 @@ int fons__tt_getGlyphKernAdvance(FONSttFontImpl *font, int glyph1, int glyph2)
 #ifndef FONS_HASH_LUT_SIZE
 #	define FONS_HASH_LUT_SIZE 256
 #endif
+#ifndef FONS_MAX_PAGES
+#	define FONS_MAX_PAGES 16
+#endif
 #ifndef FONS_INIT_FONTS
 #	define FONS_INIT_FONTS 4
 #endif
@@ -336,6 +375,11 @@ static unsigned int fons__hashint(unsigned int a)
 	return a;
 }
 
+static unsigned int fons__hashglyph(unsigned int codepoint, short isize, short iblur)
+{
+	return fons__hashint(codepoint ^ fons__hashint(((unsigned int)isize << 8) | (unsigned int)iblur));
+}
+
 static int fons__mini(int a, int b)
 {
 	return a < b ? a : b;
@@ -352,6 +396,7 @@ struct FONSglyph
 	int index;
 	int next;
 	short size, blur;
+	short page;
 	short x0,y0,x1,y1;
 	short xadv,xoff,yoff;
 };
@@ -370,7 +415,8 @@ struct FONSfont
 	FONSglyph* glyphs;
 	int cglyphs;
 	int nglyphs;
-	int lut[FONS_HASH_LUT_SIZE];
+	int* lut;
+	int clut;
 };
 typedef struct FONSfont FONSfont;
 
@@ -399,12 +445,21 @@ struct FONSatlas
 };
 typedef struct FONSatlas FONSatlas;
 
+struct FONSpage
+{
+	int width, height;
+	float itw, ith;
+};
+typedef struct FONSpage FONSpage;
+
 struct FONScontext
 {
 	FONSparams params;
 	float itw,ith;
 	unsigned char* texData;
 	int dirtyRect[4];
+	FONSpage pages[FONS_MAX_PAGES];
+	int npages;
 	FONSfont** fonts;
 	FONSatlas* atlas;
 	int cfonts;
@@ -413,29 +468,73 @@ struct FONScontext
 	float tcoords[FONS_VERTEX_COUNT*2];
 	unsigned int colors[FONS_VERTEX_COUNT];
 	int nverts;
-	unsigned char* scratch;
-	int nscratch;
+	FONSscratch scratch;
 	FONSstate states[FONS_MAX_STATES];
 	int nstates;
 	void (*handleError)(void* uptr, int error, int val);
 	void* errorUptr;
 };
 
+static FONSscratch* fons__getScratch(FONScontext* stash)
+{
+	return &stash->scratch;
+}
+
+static int fons__initScratch(FONSscratch* scratch)
+{
+	memset(scratch, 0, sizeof(FONSscratch));
+	scratch->data = (unsigned char*)malloc(FONS_SCRATCH_BUF_SIZE);
+	if (scratch->data == NULL) return 0;
+	scratch->size = FONS_SCRATCH_BUF_SIZE;
+	return 1;
+}
+
+static void fons__resetScratch(FONSscratch* scratch)
+{
+	// Free overflow blocks, and make the buffer big enough for the largest glyph so far.
+	while (scratch->overflow != NULL) {
+		void* next = *(void**)scratch->overflow;
+		free(scratch->overflow);
+		scratch->overflow = next;
+	}
+	if (scratch->peak > scratch->size) {
+		int size = scratch->peak + scratch->peak/2;
+		unsigned char* data = (unsigned char*)realloc(scratch->data, size);
+		if (data != NULL) {
+			scratch->data = data;
+			scratch->size = size;
+		}
+	}
+	scratch->used = 0;
+	scratch->peak = 0;
+}
+
+static void fons__freeScratch(FONSscratch* scratch)
+{
+	fons__resetScratch(scratch);
+	if (scratch->data) free(scratch->data);
+	scratch->data = NULL;
+}
+
 static void* fons__tmpalloc(size_t size, void* up)
 {
 	unsigned char* ptr;
-	FONScontext* stash = (FONScontext*)up;
+	FONSscratch* scratch = (FONSscratch*)up;
 
 	// 16-byte align the returned pointer
 	size = (size + 0xf) & ~0xf;
-
-	if (stash->nscratch+(int)size > FONS_SCRATCH_BUF_SIZE) {
-		if (stash->handleError)
-			stash->handleError(stash->errorUptr, FONS_SCRATCH_FULL, stash->nscratch+(int)size);
-		return NULL;
+	scratch->peak += (int)size;
+
+	if (scratch->used+(int)size > scratch->size) {
+		// Keep a 16-byte header to chain the block for fons__resetScratch().
+		ptr = (unsigned char*)malloc(size + 16);
+		if (ptr == NULL) return NULL;
+		*(void**)ptr = scratch->overflow;
+		scratch->overflow = ptr;
+		return ptr + 16;
 	}
-	ptr = stash->scratch + stash->nscratch;
-	stash->nscratch += (int)size;
+	ptr = scratch->data + scratch->used;
+	scratch->used += (int)size;
 	return ptr;
 }
 
@@ -688,6 +787,14 @@ static void fons__addWhiteRect(FONScontext* stash, int w, int h)
 	stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], gy+h);
 }
 
+static void fons__setPage(FONScontext* stash, int page)
+{
+	stash->pages[page].width = stash->params.width;
+	stash->pages[page].height = stash->params.height;
+	stash->pages[page].itw = stash->itw;
+	stash->pages[page].ith = stash->ith;
+}
+
 FONScontext* fonsCreateInternal(FONSparams* params)
 {
 	FONScontext* stash = NULL;
@@ -700,8 +807,7 @@ FONScontext* fonsCreateInternal(FONSparams* params)
 	stash->params = *params;
 
 	// Allocate scratch buffer.
-	stash->scratch = (unsigned char*)malloc(FONS_SCRATCH_BUF_SIZE);
-	if (stash->scratch == NULL) goto error;
+	if (!fons__initScratch(&stash->scratch)) goto error;
 
 	// Initialize implementation library
 	if (!fons__tt_init(stash)) goto error;
@@ -724,6 +830,8 @@ FONScontext* fonsCreateInternal(FONSparams* params)
 	// Create texture for the cache.
 	stash->itw = 1.0f/stash->params.width;
 	stash->ith = 1.0f/stash->params.height;
+	fons__setPage(stash, 0);
+	stash->npages = 1;
 	stash->texData = (unsigned char*)malloc(stash->params.width * stash->params.height);
 	if (stash->texData == NULL) goto error;
 	memset(stash->texData, 0, stash->params.width * stash->params.height);
@@ -818,6 +926,7 @@ static void fons__freeFont(FONSfont* font)
 {
 	if (font == NULL) return;
 	if (font->glyphs) free(font->glyphs);
+	if (font->lut) free(font->lut);
 	if (font->freeData && font->data) free(font->data);
 	free(font);
 }
@@ -840,6 +949,10 @@ static int fons__allocFont(FONScontext* stash)
 	font->cglyphs = FONS_INIT_GLYPHS;
 	font->nglyphs = 0;
 
+	font->lut = (int*)malloc(sizeof(int) * FONS_HASH_LUT_SIZE);
+	if (font->lut == NULL) goto error;
+	font->clut = FONS_HASH_LUT_SIZE;
+
 	stash->fonts[stash->nfonts++] = font;
 	return stash->nfonts-1;
 
@@ -890,7 +1003,7 @@ int fonsAddFontMem(FONScontext* stash, const char* name, unsigned char* data, in
 	font->name[sizeof(font->name)-1] = '\0';
 
 	// Init hash lookup.
-	for (i = 0; i < FONS_HASH_LUT_SIZE; ++i)
+	for (i = 0; i < font->clut; ++i)
 		font->lut[i] = -1;
 
 	// Read in the font data.
@@ -899,7 +1012,7 @@ int fonsAddFontMem(FONScontext* stash, const char* name, unsigned char* data, in
 	font->freeData = (unsigned char)freeData;
 
 	// Init font
-	stash->nscratch = 0;
+	fons__resetScratch(&stash->scratch);
 	if (!fons__tt_loadFont(stash, &font->font, data, dataSize)) goto error;
 
 	// Store normalized line height. The real line height is got
@@ -1006,40 +1119,45 @@ static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int
 //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
-static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
-								 short isize, short iblur)
+static FONSglyph* fons__findGlyph(FONSfont* font, unsigned int codepoint, short isize, short iblur)
 {
-	int i, g, advance, lsb, x0, y0, x1, y1, gw, gh, gx, gy, x, y;
-	float scale;
-	FONSglyph* glyph = NULL;
-	unsigned int h;
-	float size = isize/10.0f;
-	int pad, added;
-	unsigned char* bdst;
-	unsigned char* dst;
-
-	if (isize < 2) return NULL;
-	if (iblur > 20) iblur = 20;
-	pad = iblur+2;
-
-	// Reset allocator.
-	stash->nscratch = 0;
-
-	// Find code point and size.
-	h = fons__hashint(codepoint) & (FONS_HASH_LUT_SIZE-1);
-	i = font->lut[h];
+	int i = font->lut[fons__hashglyph(codepoint, isize, iblur) & (font->clut-1)];
 	while (i != -1) {
 		if (font->glyphs[i].codepoint == codepoint && font->glyphs[i].size == isize && font->glyphs[i].blur == iblur)
 			return &font->glyphs[i];
 		i = font->glyphs[i].next;
 	}
+	return NULL;
+}
 
-	// Could not find glyph, create it.
-	scale = fons__tt_getPixelHeightScale(&font->font, size);
-	g = fons__tt_getGlyphIndex(&font->font, codepoint);
-	fons__tt_buildGlyphBitmap(&font->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1);
-	gw = x1-x0 + pad*2;
-	gh = y1-y0 + pad*2;
+static int fons__growLut(FONSfont* font)
+{
+	int i, clut = font->clut * 2;
+	int* lut = (int*)realloc(font->lut, sizeof(int) * clut);
+	if (lut == NULL) return 0;
+	font->lut = lut;
+	font->clut = clut;
+
+	// Rehash all glyphs.
+	for (i = 0; i < clut; i++)
+		font->lut[i] = -1;
+	for (i = 0; i < font->nglyphs; i++) {
+		FONSglyph* glyph = &font->glyphs[i];
+		unsigned int h = fons__hashglyph(glyph->codepoint, glyph->size, glyph->blur) & (clut-1);
+		glyph->next = font->lut[h];
+		font->lut[h] = i;
+	}
+	return 1;
+}
+
+// Finds a free spot in the atlas for a glyph of gw*gh pixels and adds it to the font,
+// the caller is responsible for filling in the pixels.
+static FONSglyph* fons__addGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint, short isize, short iblur,
+								 int index, int gw, int gh, short xadv, short xoff, short yoff)
+{
+	int gx, gy, added;
+	unsigned int h;
+	FONSglyph* glyph = NULL;
 
 	// Find free spot for the rect in the atlas
 	added = fons__atlasAddRect(stash->atlas, gw, gh, &gx, &gy);
@@ -1052,22 +1170,69 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 
 	// Init glyph.
 	glyph = fons__allocGlyph(font);
+	if (glyph == NULL) return NULL;
 	glyph->codepoint = codepoint;
 	glyph->size = isize;
 	glyph->blur = iblur;
-	glyph->index = g;
+	glyph->page = (short)(stash->npages-1);
+	glyph->index = index;
 	glyph->x0 = (short)gx;
 	glyph->y0 = (short)gy;
 	glyph->x1 = (short)(glyph->x0+gw);
 	glyph->y1 = (short)(glyph->y0+gh);
-	glyph->xadv = (short)(scale * advance * 10.0f);
-	glyph->xoff = (short)(x0 - pad);
-	glyph->yoff = (short)(y0 - pad);
+	glyph->xadv = xadv;
+	glyph->xoff = xoff;
+	glyph->yoff = yoff;
 	glyph->next = 0;
 
-	// Insert char to hash lookup.
-	glyph->next = font->lut[h];
-	font->lut[h] = font->nglyphs-1;
+	// Insert char to hash lookup, the table doubles when there are more glyphs than slots.
+	if (font->nglyphs <= font->clut || fons__growLut(font) == 0) {
+		h = fons__hashglyph(codepoint, isize, iblur) & (font->clut-1);
+		glyph->next = font->lut[h];
+		font->lut[h] = font->nglyphs-1;
+	}
+
+	stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
+	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
+	stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
+	stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
+
+	return glyph;
+}
+
+static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
+								 short isize, short iblur)
+{
+	int g, advance, lsb, x0, y0, x1, y1, gw, gh, x, y;
+	float scale;
+	FONSglyph* glyph = NULL;
+	float size = isize/10.0f;
+	int pad;
+	unsigned char* bdst;
+	unsigned char* dst;
+
+	if (isize < 2) return NULL;
+	if (iblur > 20) iblur = 20;
+	pad = iblur+2;
+
+	// Find code point and size.
+	glyph = fons__findGlyph(font, codepoint, isize, iblur);
+	if (glyph != NULL)
+		return glyph;
+
+	// Reset allocator.
+	fons__resetScratch(&stash->scratch);
+
+	// Could not find glyph, create it.
+	scale = fons__tt_getPixelHeightScale(&font->font, size);
+	g = fons__tt_getGlyphIndex(&font->font, codepoint);
+	fons__tt_buildGlyphBitmap(&font->font, g, size, scale, &advance, &lsb, &x0, &y0, &x1, &y1);
+	gw = x1-x0 + pad*2;
+	gh = y1-y0 + pad*2;
+
+	glyph = fons__addGlyph(stash, font, codepoint, isize, iblur, g, gw, gh,
+						   (short)(scale * advance * 10.0f), (short)(x0 - pad), (short)(y0 - pad));
+	if (glyph == NULL) return NULL;
 
 	// Rasterize
 	dst = &stash->texData[(glyph->x0+pad) + (glyph->y0+pad) * stash->params.width];
@@ -1096,24 +1261,201 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 
 	// Blur
 	if (iblur > 0) {
-		stash->nscratch = 0;
+		fons__resetScratch(&stash->scratch);
 		bdst = &stash->texData[glyph->x0 + glyph->y0 * stash->params.width];
 		fons__blur(stash, bdst, gw,gh, stash->params.width, iblur);
 	}
 
-	stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
-	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
-	stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
-	stash->dirtyRect[3] = fons__maxi(stash->dirtyRect[3], glyph->y1);
-
 	return glyph;
 }
 
+struct FONSprewarmGlyph
+{
+	unsigned int codepoint;
+	int index;
+	int offset;
+	short w, h;
+	short xadv, xoff, yoff;
+};
+typedef struct FONSprewarmGlyph FONSprewarmGlyph;
+
+struct FONSprewarm
+{
+	FONSfont* font;
+	short isize, iblur;
+	float scale;
+	FONSprewarmGlyph* glyphs;
+	int nglyphs;
+	int ntasks;
+	unsigned char* pixels;
+};
+
+static int fons__cmpCodepoint(const void* a, const void* b)
+{
+	unsigned int ca = *(const unsigned int*)a;
+	unsigned int cb = *(const unsigned int*)b;
+	return ca < cb ? -1 : (ca > cb ? 1 : 0);
+}
+
+static int fons__cmpPrewarmGlyph(const void* a, const void* b)
+{
+	const FONSprewarmGlyph* ga = (const FONSprewarmGlyph*)a;
+	const FONSprewarmGlyph* gb = (const FONSprewarmGlyph*)b;
+	if (ga->h != gb->h)
+		return gb->h - ga->h;
+	return gb->w - ga->w;
+}
+
+static void fons__freePrewarm(FONSprewarm* job)
+{
+	if (job == NULL) return;
+	if (job->glyphs) free(job->glyphs);
+	if (job->pixels) free(job->pixels);
+	free(job);
+}
+
+FONSprewarm* fonsPrewarmBegin(FONScontext* stash, const unsigned int* codepoints, int ncodepoints, int ntasks)
+{
+	FONSstate* state;
+	FONSprewarm* job = NULL;
+	unsigned int* sorted = NULL;
+	int i, n = 0, npixels = 0, pad;
+	int advance, lsb, x0, y0, x1, y1;
+	float size;
+
+	if (stash == NULL || codepoints == NULL || ncodepoints <= 0) return NULL;
+	state = fons__getState(stash);
+	if (state->font < 0 || state->font >= stash->nfonts) return NULL;
+	if (stash->fonts[state->font]->data == NULL) return NULL;
+
+	job = (FONSprewarm*)malloc(sizeof(FONSprewarm));
+	if (job == NULL) goto error;
+	memset(job, 0, sizeof(FONSprewarm));
+	job->font = stash->fonts[state->font];
+	job->isize = (short)(state->size*10.0f);
+	job->iblur = (short)state->blur;
+	if (job->isize < 2) goto error;
+	if (job->iblur > 20) job->iblur = 20;
+	size = job->isize/10.0f;
+	pad = job->iblur+2;
+	job->scale = fons__tt_getPixelHeightScale(&job->font->font, size);
+
+	// Sort codepoints to skip duplicates.
+	sorted = (unsigned int*)malloc(sizeof(unsigned int) * ncodepoints);
+	if (sorted == NULL) goto error;
+	memcpy(sorted, codepoints, sizeof(unsigned int) * ncodepoints);
+	qsort(sorted, ncodepoints, sizeof(unsigned int), fons__cmpCodepoint);
+
+	job->glyphs = (FONSprewarmGlyph*)malloc(sizeof(FONSprewarmGlyph) * ncodepoints);
+	if (job->glyphs == NULL) goto error;
+
+	// Measure new glyphs and lay out their bitmaps one after another.
+	for (i = 0; i < ncodepoints; i++) {
+		FONSprewarmGlyph* glyph;
+		if (i > 0 && sorted[i] == sorted[i-1]) continue;
+		if (fons__findGlyph(job->font, sorted[i], job->isize, job->iblur) != NULL) continue;
+		glyph = &job->glyphs[n++];
+		glyph->codepoint = sorted[i];
+		glyph->index = fons__tt_getGlyphIndex(&job->font->font, sorted[i]);
+		fons__tt_buildGlyphBitmap(&job->font->font, glyph->index, size, job->scale, &advance, &lsb, &x0, &y0, &x1, &y1);
+		glyph->w = (short)(x1-x0 + pad*2);
+		glyph->h = (short)(y1-y0 + pad*2);
+		glyph->xadv = (short)(job->scale * advance * 10.0f);
+		glyph->xoff = (short)(x0 - pad);
+		glyph->yoff = (short)(y0 - pad);
+		glyph->offset = npixels;
+		npixels += glyph->w * glyph->h;
+	}
+	free(sorted);
+	sorted = NULL;
+	if (n == 0) goto error;
+	job->nglyphs = n;
+
+	// Cleared pixels leave the one pixel empty border around each glyph.
+	job->pixels = (unsigned char*)calloc(npixels, 1);
+	if (job->pixels == NULL) goto error;
+
+#ifdef FONS_USE_FREETYPE
+	// FreeType faces can not be used from several threads at once.
+	job->ntasks = 1;
+#else
+	job->ntasks = fons__mini(fons__maxi(ntasks, 1), n);
+#endif
+	return job;
+
+error:
+	if (sorted) free(sorted);
+	fons__freePrewarm(job);
+	return NULL;
+}
+
+int fonsPrewarmTaskCount(FONSprewarm* job)
+{
+	return job != NULL ? job->ntasks : 0;
+}
+
+void fonsPrewarmRasterize(FONSprewarm* job, int task)
+{
+	FONSttFontImpl font;
+	FONSscratch scratch;
+	int i, pad, advance, lsb, x0, y0, x1, y1;
+	float size;
+
+	if (job == NULL || task < 0 || task >= job->ntasks) return;
+	if (!fons__initScratch(&scratch)) return;
+
+	// Each task has its own copy of the font info, pointing to its own scratch memory.
+	font = job->font->font;
+#ifndef FONS_USE_FREETYPE
+	font.font.userdata = &scratch;
+#endif
+	size = job->isize/10.0f;
+	pad = job->iblur+2;
+
+	// Interleave glyphs between tasks, so that each gets a similar mix of simple and complex ones.
+	for (i = task; i < job->nglyphs; i += job->ntasks) {
+		FONSprewarmGlyph* glyph = &job->glyphs[i];
+		unsigned char* dst = &job->pixels[glyph->offset];
+		fons__tt_buildGlyphBitmap(&font, glyph->index, size, job->scale, &advance, &lsb, &x0, &y0, &x1, &y1);
+		fons__tt_renderGlyphBitmap(&font, dst + pad + pad*glyph->w, glyph->w-pad*2, glyph->h-pad*2, glyph->w,
+								   job->scale, job->scale, glyph->index);
+		if (job->iblur > 0)
+			fons__blur(NULL, dst, glyph->w, glyph->h, glyph->w, job->iblur);
+		fons__resetScratch(&scratch);
+	}
+	fons__freeScratch(&scratch);
+}
+
+int fonsPrewarmEnd(FONScontext* stash, FONSprewarm* job)
+{
+	int i, y, nadded = 0;
+	if (job == NULL) return 0;
+
+	if (stash != NULL) {
+		// Pack tallest glyphs first, so that each skyline level is filled with glyphs of similar height.
+		qsort(job->glyphs, job->nglyphs, sizeof(FONSprewarmGlyph), fons__cmpPrewarmGlyph);
+		for (i = 0; i < job->nglyphs; i++) {
+			FONSprewarmGlyph* pg = &job->glyphs[i];
+			FONSglyph* glyph;
+			if (fons__findGlyph(job->font, pg->codepoint, job->isize, job->iblur) != NULL) continue;
+			glyph = fons__addGlyph(stash, job->font, pg->codepoint, job->isize, job->iblur,
+								   pg->index, pg->w, pg->h, pg->xadv, pg->xoff, pg->yoff);
+			if (glyph == NULL) break;
+			for (y = 0; y < pg->h; y++)
+				memcpy(&stash->texData[glyph->x0 + (glyph->y0+y) * stash->params.width], &job->pixels[pg->offset + y*pg->w], pg->w);
+			nadded++;
+		}
+	}
+
+	fons__freePrewarm(job);
+	return nadded;
+}
+
 static void fons__getQuad(FONScontext* stash, FONSfont* font,
 						   int prevGlyphIndex, FONSglyph* glyph,
 						   float scale, float spacing, float* x, float* y, FONSquad* q)
 {
-	float rx,ry,xoff,yoff,x0,y0,x1,y1;
+	float rx,ry,xoff,yoff,x0,y0,x1,y1,itw,ith;
 
 	if (prevGlyphIndex != -1) {
 		float adv = fons__tt_getGlyphKernAdvance(&font->font, prevGlyphIndex, glyph->index) * scale;
@@ -1129,6 +1471,8 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 	y0 = (float)(glyph->y0+1);
 	x1 = (float)(glyph->x1-1);
 	y1 = (float)(glyph->y1-1);
+	itw = stash->pages[glyph->page].itw;
+	ith = stash->pages[glyph->page].ith;
 
 	if (stash->params.flags & FONS_ZERO_TOPLEFT) {
 		rx = (float)(int)(*x + xoff);
@@ -1139,10 +1483,10 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 		q->x1 = rx + x1 - x0;
 		q->y1 = ry + y1 - y0;
 
-		q->s0 = x0 * stash->itw;
-		q->t0 = y0 * stash->ith;
-		q->s1 = x1 * stash->itw;
-		q->t1 = y1 * stash->ith;
+		q->s0 = x0 * itw;
+		q->t0 = y0 * ith;
+		q->s1 = x1 * itw;
+		q->t1 = y1 * ith;
 	} else {
 		rx = (float)(int)(*x + xoff);
 		ry = (float)(int)(*y - yoff);
@@ -1152,10 +1496,10 @@ static void fons__getQuad(FONScontext* stash, FONSfont* font,
 		q->x1 = rx + x1 - x0;
 		q->y1 = ry - y1 + y0;
 
-		q->s0 = x0 * stash->itw;
-		q->t0 = y0 * stash->ith;
-		q->s1 = x1 * stash->itw;
-		q->t1 = y1 * stash->ith;
+		q->s0 = x0 * itw;
+		q->t0 = y0 * ith;
+		q->s1 = x1 * itw;
+		q->t1 = y1 * ith;
 	}
 
 	*x += (int)(glyph->xadv / 10.0f + 0.5f);
@@ -1347,6 +1691,7 @@ int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad* quad)
 		if (glyph != NULL)
 			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
 		iter->prevGlyphIndex = glyph != NULL ? glyph->index : -1;
+		iter->page = glyph != NULL ? glyph->page : 0;
 		break;
 	}
 	iter->next = str;
@@ -1563,7 +1908,7 @@ void fonsDeleteInternal(FONScontext* stash)
 	if (stash->atlas) fons__deleteAtlas(stash->atlas);
 	if (stash->fonts) free(stash->fonts);
 	if (stash->texData) free(stash->texData);
-	if (stash->scratch) free(stash->scratch);
+	fons__freeScratch(&stash->scratch);
 	free(stash);
 }
 
@@ -1633,6 +1978,7 @@ int fonsExpandAtlas(FONScontext* stash, int width, int height)
 	stash->params.height = height;
 	stash->itw = 1.0f/stash->params.width;
 	stash->ith = 1.0f/stash->params.height;
+	fons__setPage(stash, stash->npages-1);
 
 	return 1;
 }
@@ -1669,7 +2015,7 @@ int fonsResetAtlas(FONScontext* stash, int width, int height)
 	for (i = 0; i < stash->nfonts; i++) {
 		FONSfont* font = stash->fonts[i];
 		font->nglyphs = 0;
-		for (j = 0; j < FONS_HASH_LUT_SIZE; j++)
+		for (j = 0; j < font->clut; j++)
 			font->lut[j] = -1;
 	}
 
@@ -1677,6 +2023,8 @@ int fonsResetAtlas(FONScontext* stash, int width, int height)
 	stash->params.height = height;
 	stash->itw = 1.0f/stash->params.width;
 	stash->ith = 1.0f/stash->params.height;
+	fons__setPage(stash, 0);
+	stash->npages = 1;
 
 	// Add white rect at 0,0 for debug drawing.
 	fons__addWhiteRect(stash, 2,2);
@@ -1684,5 +2032,47 @@ int fonsResetAtlas(FONScontext* stash, int width, int height)
 	return 1;
 }
 
+int fonsAddAtlasPage(FONScontext* stash, int width, int height)
+{
+	if (stash == NULL) return FONS_INVALID;
+	if (stash->npages >= FONS_MAX_PAGES) return FONS_INVALID;
+
+	// Flush pending glyphs.
+	fons__flush(stash);
+
+	// Create new texture
+	if (stash->params.renderResize != NULL) {
+		if (stash->params.renderResize(stash->params.userPtr, width, height) == 0)
+			return FONS_INVALID;
+	}
+
+	// Start with an empty atlas, glyphs of earlier pages are kept.
+	stash->texData = (unsigned char*)realloc(stash->texData, width * height);
+	if (stash->texData == NULL) return FONS_INVALID;
+	memset(stash->texData, 0, width * height);
+	fons__atlasReset(stash->atlas, width, height);
+
+	// Reset dirty rect
+	stash->dirtyRect[0] = width;
+	stash->dirtyRect[1] = height;
+	stash->dirtyRect[2] = 0;
+	stash->dirtyRect[3] = 0;
+
+	stash->params.width = width;
+	stash->params.height = height;
+	stash->itw = 1.0f/stash->params.width;
+	stash->ith = 1.0f/stash->params.height;
+	fons__setPage(stash, stash->npages);
+	stash->npages++;
+
+	return stash->npages-1;
+}
+
+int fonsGetAtlasPage(FONScontext* stash)
+{
+	if (stash == NULL) return FONS_INVALID;
+	return stash->npages-1;
+}
+
 
 #endif
@@ -33,13 +33,17 @@
 
 #define NVG_INIT_FONTIMAGE_SIZE  512
 #define NVG_MAX_FONTIMAGE_SIZE   2048
-#define NVG_MAX_FONTIMAGES       4
+// Font atlas pages, the first one grows up to NVG_MAX_FONTIMAGE_SIZE and others start at that size.
+#ifndef NVG_MAX_FONTIMAGES
+#define NVG_MAX_FONTIMAGES       8
+#endif
 
 #define NVG_INIT_COMMANDS_SIZE 256
 #define NVG_INIT_POINTS_SIZE 128
 #define NVG_INIT_PATHS_SIZE 16
 #define NVG_INIT_VERTS_SIZE 256
 #define NVG_MAX_STATES 32
+#define NVG_TESS_KEY_SIZE 7
 
 #define NVG_KAPPA90 0.5522847493f	// Length proportional to radius of a cubic bezier handle for 90deg arcs.
 
@@ -104,6 +108,38 @@ struct NVGpathCache {
 };
 typedef struct NVGpathCache NVGpathCache;
 
+// Tessellated paths kept between frames, looked up by their transformed commands and style.
+struct NVGtessEntry {
+	unsigned int hash;
+	int next;			// Next entry in the same bucket, or -1.
+	int newer, older;	// Neighbours in least recently used order, or -1.
+	int lastFrame;
+	float key[NVG_TESS_KEY_SIZE];
+	float* commands;
+	int ncommands;
+	int ccommands;
+	NVGpath* paths;
+	int npaths;
+	int cpaths;
+	NVGvertex* verts;
+	int nverts;
+	int cverts;
+	float bounds[4];
+};
+typedef struct NVGtessEntry NVGtessEntry;
+
+struct NVGtessCache {
+	NVGtessEntry* entries;
+	int nentries;
+	int centries;
+	int* buckets;
+	int nbuckets;
+	int frame;
+	int newest, oldest;
+	int fullFrame;		// Frame in which all entries are in use.
+};
+typedef struct NVGtessCache NVGtessCache;
+
 struct NVGcontext {
 	NVGparams params;
 	float* commands;
@@ -113,6 +149,7 @@ struct NVGcontext {
 	NVGstate states[NVG_MAX_STATES];
 	int nstates;
 	NVGpathCache* cache;
+	NVGtessCache* tessCache;
 	float tessTol;
 	float distTol;
 	float fringeWidth;
@@ -120,6 +157,9 @@ struct NVGcontext {
 	struct FONScontext* fs;
 	int fontImages[NVG_MAX_FONTIMAGES];
 	int fontImageIdx;
+	int retiredFontImages[NVG_MAX_FONTIMAGES];
+	int nretiredFontImages;
+	int fontAtlasFull;
 	int drawCallCount;
 	int fillTriCount;
 	int strokeTriCount;
@@ -192,6 +232,53 @@ error:
 	return NULL;
 }
 
+static void nvg__deleteTessCache(NVGtessCache* c)
+{
+	int i;
+	if (c == NULL) return;
+	if (c->entries != NULL) {
+		for (i = 0; i < c->nentries; i++) {
+			free(c->entries[i].commands);
+			free(c->entries[i].paths);
+			free(c->entries[i].verts);
+		}
+		free(c->entries);
+	}
+	if (c->buckets != NULL) free(c->buckets);
+	free(c);
+}
+
+void nvgTessellationCache(NVGcontext* ctx, int maxEntries)
+{
+	NVGtessCache* c;
+	int i;
+
+	nvg__deleteTessCache(ctx->tessCache);
+	ctx->tessCache = NULL;
+	if (maxEntries <= 0) return;
+
+	c = (NVGtessCache*)malloc(sizeof(NVGtessCache));
+	if (c == NULL) return;
+	memset(c, 0, sizeof(NVGtessCache));
+
+	c->nbuckets = 1;
+	while (c->nbuckets < maxEntries*2)
+		c->nbuckets <<= 1;
+	c->entries = (NVGtessEntry*)malloc(sizeof(NVGtessEntry)*maxEntries);
+	c->buckets = (int*)malloc(sizeof(int)*c->nbuckets);
+	if (c->entries == NULL || c->buckets == NULL) {
+		nvg__deleteTessCache(c);
+		return;
+	}
+	c->centries = maxEntries;
+	c->newest = c->oldest = -1;
+	c->fullFrame = -1;
+	for (i = 0; i < c->nbuckets; i++)
+		c->buckets[i] = -1;
+
+	ctx->tessCache = c;
+}
+
 static void nvg__setDevicePixelRatio(NVGcontext* ctx, float ratio)
 {
 	ctx->tessTol = 0.25f / ratio;
@@ -200,6 +287,16 @@ static void nvg__setDevicePixelRatio(NVGcontext* ctx, float ratio)
 	ctx->devicePxRatio = ratio;
 }
 
+static int nvg__allocTextAtlas(NVGcontext* ctx);
+
+static void nvg__fontError(void* uptr, int error, int val)
+{
+	NVGcontext* ctx = (NVGcontext*)uptr;
+	NVG_NOTUSED(val);
+	if (error == FONS_ATLAS_FULL)
+		nvg__allocTextAtlas(ctx);
+}
+
 NVGcontext* nvgCreateInternal(NVGparams* params)
 {
 	FONSparams fontParams;
@@ -239,6 +336,7 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	fontParams.userPtr = NULL;
 	ctx->fs = fonsCreateInternal(&fontParams);
 	if (ctx->fs == NULL) goto error;
+	fonsSetErrorCallback(ctx->fs, nvg__fontError, ctx);
 
 	// Create font texture
 	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, fontParams.width, fontParams.height, 0, NULL);
@@ -263,6 +361,7 @@ void nvgDeleteInternal(NVGcontext* ctx)
 	if (ctx == NULL) return;
 	if (ctx->commands != NULL) free(ctx->commands);
 	if (ctx->cache != NULL) nvg__deletePathCache(ctx->cache);
+	if (ctx->tessCache != NULL) nvg__deleteTessCache(ctx->tessCache);
 
 	if (ctx->fs)
 		fonsDeleteInternal(ctx->fs);
@@ -273,6 +372,8 @@ void nvgDeleteInternal(NVGcontext* ctx)
 			ctx->fontImages[i] = 0;
 		}
 	}
+	for (i = 0; i < ctx->nretiredFontImages; i++)
+		nvgDeleteImage(ctx, ctx->retiredFontImages[i]);
 
 	if (ctx->params.renderDelete != NULL)
 		ctx->params.renderDelete(ctx->params.userPtr);
@@ -288,6 +389,8 @@ void nvgBeginFrame(NVGcontext* ctx, int windowWidth, int windowHeight, float dev
 
 	ctx->nstates = 0;
 	nvgSave(ctx);
+	if (ctx->tessCache != NULL)
+		ctx->tessCache->frame++;
 	nvgReset(ctx);
 
 	nvg__setDevicePixelRatio(ctx, devicePixelRatio);
@@ -307,31 +410,25 @@ void nvgCancelFrame(NVGcontext* ctx)
 
 void nvgEndFrame(NVGcontext* ctx)
 {
+	int i;
 	ctx->params.renderFlush(ctx->params.userPtr);
-	if (ctx->fontImageIdx != 0) {
-		int fontImage = ctx->fontImages[ctx->fontImageIdx];
-		int i, j, iw, ih;
-		// delete images that smaller than current one
-		if (fontImage == 0)
-			return;
-		nvgImageSize(ctx, fontImage, &iw, &ih);
-		for (i = j = 0; i < ctx->fontImageIdx; i++) {
-			if (ctx->fontImages[i] != 0) {
-				int nw, nh;
-				nvgImageSize(ctx, ctx->fontImages[i], &nw, &nh);
-				if (nw < iw || nh < ih)
-					nvgDeleteImage(ctx, ctx->fontImages[i]);
-				else
-					ctx->fontImages[j++] = ctx->fontImages[i];
-			}
+
+	// Delete font images replaced by larger ones in this frame.
+	for (i = 0; i < ctx->nretiredFontImages; i++)
+		nvgDeleteImage(ctx, ctx->retiredFontImages[i]);
+	ctx->nretiredFontImages = 0;
+
+	// If all atlas pages are full, start over with the first one.
+	if (ctx->fontAtlasFull) {
+		int iw, ih;
+		for (i = 1; i <= ctx->fontImageIdx; i++) {
+			nvgDeleteImage(ctx, ctx->fontImages[i]);
+			ctx->fontImages[i] = 0;
 		}
-		// make current font image to first
-		ctx->fontImages[j++] = ctx->fontImages[0];
-		ctx->fontImages[0] = fontImage;
+		nvgImageSize(ctx, ctx->fontImages[0], &iw, &ih);
+		fonsResetAtlas(ctx->fs, iw, ih);
 		ctx->fontImageIdx = 0;
-		// clear all images after j
-		for (i = j; i < NVG_MAX_FONTIMAGES; i++)
-			ctx->fontImages[i] = 0;
+		ctx->fontAtlasFull = 0;
 	}
 }
 
@@ -1840,6 +1937,177 @@ static int nvg__expandFill(NVGcontext* ctx, float w, int lineJoin, float miterLi
 
 
 // Draw
+static unsigned int nvg__hashTess(const float* commands, int ncommands, const float* key)
+{
+	// FNV-1a over 32-bit words of the commands and the key, with a final mix so that the low
+	// bits used for buckets depend on all bits.
+	unsigned int h = 2166136261u, word;
+	int i;
+	for (i = 0; i < ncommands; i++) {
+		memcpy(&word, &commands[i], sizeof(word));
+		h = (h ^ word) * 16777619u;
+	}
+	for (i = 0; i < NVG_TESS_KEY_SIZE; i++) {
+		memcpy(&word, &key[i], sizeof(word));
+		h = (h ^ word) * 16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+static void nvg__unlinkTessLRU(NVGtessCache* c, int idx)
+{
+	NVGtessEntry* e = &c->entries[idx];
+	if (e->newer != -1) c->entries[e->newer].older = e->older;
+	else c->newest = e->older;
+	if (e->older != -1) c->entries[e->older].newer = e->newer;
+	else c->oldest = e->newer;
+}
+
+static void nvg__linkTessLRU(NVGtessCache* c, int idx)
+{
+	NVGtessEntry* e = &c->entries[idx];
+	e->newer = -1;
+	e->older = c->newest;
+	if (c->newest != -1) c->entries[c->newest].newer = idx;
+	else c->oldest = idx;
+	c->newest = idx;
+}
+
+static NVGtessEntry* nvg__findTess(NVGcontext* ctx, unsigned int hash, const float* key)
+{
+	NVGtessCache* c = ctx->tessCache;
+	int i = c->buckets[hash & (c->nbuckets-1)];
+	while (i != -1) {
+		NVGtessEntry* e = &c->entries[i];
+		if (e->hash == hash && e->ncommands == ctx->ncommands
+			&& memcmp(e->key, key, sizeof(e->key)) == 0
+			&& memcmp(e->commands, ctx->commands, sizeof(float)*ctx->ncommands) == 0) {
+			e->lastFrame = c->frame;
+			if (c->newest != i) {
+				nvg__unlinkTessLRU(c, i);
+				nvg__linkTessLRU(c, i);
+			}
+			return e;
+		}
+		i = e->next;
+	}
+	return NULL;
+}
+
+static int nvg__reserveTess(void** ptr, int* cap, int n, int size)
+{
+	void* p;
+	if (n <= *cap) return 1;
+	p = realloc(*ptr, (size_t)size*n);
+	if (p == NULL) return 0;
+	*ptr = p;
+	*cap = n;
+	return 1;
+}
+
+static NVGtessEntry* nvg__storeTess(NVGcontext* ctx, unsigned int hash, const float* key)
+{
+	NVGtessCache* c = ctx->tessCache;
+	NVGpathCache* cache = ctx->cache;
+	NVGtessEntry* e;
+	int i, idx, nverts = 0;
+	int* link;
+
+	if (c->nentries < c->centries) {
+		idx = c->nentries++;
+		e = &c->entries[idx];
+		memset(e, 0, sizeof(NVGtessEntry));
+	} else {
+		// Evict the least recently used entry. If it is used in this frame, the cache is too
+		// small for the frame, and the rest of it is not cached to avoid thrashing.
+		idx = c->oldest;
+		if (c->fullFrame == c->frame || c->entries[idx].lastFrame == c->frame) {
+			c->fullFrame = c->frame;
+			return NULL;
+		}
+		e = &c->entries[idx];
+		nvg__unlinkTessLRU(c, idx);
+		link = &c->buckets[e->hash & (c->nbuckets-1)];
+		while (*link != idx)
+			link = &c->entries[*link].next;
+		*link = e->next;
+	}
+
+	e->hash = hash;
+	e->lastFrame = c->frame;
+	memcpy(e->key, key, sizeof(e->key));
+	e->next = c->buckets[hash & (c->nbuckets-1)];
+	c->buckets[hash & (c->nbuckets-1)] = idx;
+	nvg__linkTessLRU(c, idx);
+
+	for (i = 0; i < cache->npaths; i++) {
+		NVGpath* path = &cache->paths[i];
+		if (path->nfill > 0) nverts = nvg__maxi(nverts, (int)(path->fill - cache->verts) + path->nfill);
+		if (path->nstroke > 0) nverts = nvg__maxi(nverts, (int)(path->stroke - cache->verts) + path->nstroke);
+	}
+
+	if (!nvg__reserveTess((void**)&e->commands, &e->ccommands, ctx->ncommands, sizeof(float))
+		|| !nvg__reserveTess((void**)&e->paths, &e->cpaths, cache->npaths, sizeof(NVGpath))
+		|| !nvg__reserveTess((void**)&e->verts, &e->cverts, nverts, sizeof(NVGvertex))) {
+		// Keep the entry linked but never matching.
+		e->ncommands = -1;
+		e->npaths = 0;
+		return NULL;
+	}
+
+	memcpy(e->commands, ctx->commands, sizeof(float)*ctx->ncommands);
+	e->ncommands = ctx->ncommands;
+	memcpy(e->paths, cache->paths, sizeof(NVGpath)*cache->npaths);
+	e->npaths = cache->npaths;
+	memcpy(e->verts, cache->verts, sizeof(NVGvertex)*nverts);
+	e->nverts = nverts;
+	memcpy(e->bounds, cache->bounds, sizeof(e->bounds));
+
+	// Point the copied paths to the copied vertices.
+	for (i = 0; i < e->npaths; i++) {
+		NVGpath* path = &e->paths[i];
+		if (path->nfill > 0) path->fill = e->verts + (path->fill - cache->verts);
+		if (path->nstroke > 0) path->stroke = e->verts + (path->stroke - cache->verts);
+	}
+	return e;
+}
+
+// Flattens and expands current path, or reuses the result of an earlier call with the same
+// commands and style. Returns the cached copy, or NULL if the result is only in ctx->cache.
+static NVGtessEntry* nvg__tessellate(NVGcontext* ctx, int stroke, float w, int lineCap, int lineJoin, float miterLimit)
+{
+	NVGtessEntry* e;
+	float key[NVG_TESS_KEY_SIZE];
+	unsigned int hash = 0;
+
+	if (ctx->tessCache != NULL) {
+		key[0] = (float)stroke;
+		key[1] = w;
+		key[2] = (float)lineCap;
+		key[3] = (float)lineJoin;
+		key[4] = miterLimit;
+		key[5] = ctx->tessTol;
+		key[6] = ctx->distTol;
+		hash = nvg__hashTess(ctx->commands, ctx->ncommands, key);
+		e = nvg__findTess(ctx, hash, key);
+		if (e != NULL) return e;
+	}
+
+	nvg__flattenPaths(ctx);
+	if (stroke)
+		nvg__expandStroke(ctx, w, lineCap, lineJoin, miterLimit);
+	else
+		nvg__expandFill(ctx, w, lineJoin, miterLimit);
+
+	if (ctx->tessCache == NULL) return NULL;
+	return nvg__storeTess(ctx, hash, key);
+}
+
 void nvgBeginPath(NVGcontext* ctx)
 {
 	ctx->ncommands = 0;
@@ -2089,24 +2357,29 @@ void nvgFill(NVGcontext* ctx)
 	NVGstate* state = nvg__getState(ctx);
 	const NVGpath* path;
 	NVGpaint fillPaint = state->fill;
-	int i;
+	NVGtessEntry* tess;
+	const NVGpath* paths;
+	const float* bounds;
+	int i, npaths;
 
-	nvg__flattenPaths(ctx);
 	if (ctx->params.edgeAntiAlias)
-		nvg__expandFill(ctx, ctx->fringeWidth, NVG_MITER, 2.4f);
+		tess = nvg__tessellate(ctx, 0, ctx->fringeWidth, NVG_BUTT, NVG_MITER, 2.4f);
 	else
-		nvg__expandFill(ctx, 0.0f, NVG_MITER, 2.4f);
+		tess = nvg__tessellate(ctx, 0, 0.0f, NVG_BUTT, NVG_MITER, 2.4f);
+	paths = tess != NULL ? tess->paths : ctx->cache->paths;
+	npaths = tess != NULL ? tess->npaths : ctx->cache->npaths;
+	bounds = tess != NULL ? tess->bounds : ctx->cache->bounds;
 
 	// Apply global alpha
 	fillPaint.innerColor.a *= state->alpha;
 	fillPaint.outerColor.a *= state->alpha;
 
 	ctx->params.renderFill(ctx->params.userPtr, &fillPaint, &state->scissor, ctx->fringeWidth,
-						   ctx->cache->bounds, ctx->cache->paths, ctx->cache->npaths);
+						   bounds, paths, npaths);
 
 	// Count triangles
-	for (i = 0; i < ctx->cache->npaths; i++) {
-		path = &ctx->cache->paths[i];
+	for (i = 0; i < npaths; i++) {
+		path = &paths[i];
 		ctx->fillTriCount += path->nfill-2;
 		ctx->fillTriCount += path->nstroke-2;
 		ctx->drawCallCount += 2;
@@ -2119,8 +2392,10 @@ void nvgStroke(NVGcontext* ctx)
 	float scale = nvg__getAverageScale(state->xform);
 	float strokeWidth = nvg__clampf(state->strokeWidth * scale, 0.0f, 200.0f);
 	NVGpaint strokePaint = state->stroke;
+	NVGtessEntry* tess;
 	const NVGpath* path;
-	int i;
+	const NVGpath* paths;
+	int i, npaths;
 
 	if (strokeWidth < ctx->fringeWidth) {
 		// If the stroke width is less than pixel size, use alpha to emulate coverage.
@@ -2135,19 +2410,19 @@ void nvgStroke(NVGcontext* ctx)
 	strokePaint.innerColor.a *= state->alpha;
 	strokePaint.outerColor.a *= state->alpha;
 
-	nvg__flattenPaths(ctx);
-
 	if (ctx->params.edgeAntiAlias)
-		nvg__expandStroke(ctx, strokeWidth*0.5f + ctx->fringeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
+		tess = nvg__tessellate(ctx, 1, strokeWidth*0.5f + ctx->fringeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
 	else
-		nvg__expandStroke(ctx, strokeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
+		tess = nvg__tessellate(ctx, 1, strokeWidth*0.5f, state->lineCap, state->lineJoin, state->miterLimit);
+	paths = tess != NULL ? tess->paths : ctx->cache->paths;
+	npaths = tess != NULL ? tess->npaths : ctx->cache->npaths;
 
 	ctx->params.renderStroke(ctx->params.userPtr, &strokePaint, &state->scissor, ctx->fringeWidth,
-							 strokeWidth, ctx->cache->paths, ctx->cache->npaths);
+							 strokeWidth, paths, npaths);
 
 	// Count triangles
-	for (i = 0; i < ctx->cache->npaths; i++) {
-		path = &ctx->cache->paths[i];
+	for (i = 0; i < npaths; i++) {
+		path = &paths[i];
 		ctx->strokeTriCount += path->nstroke-2;
 		ctx->drawCallCount++;
 	}
@@ -2244,35 +2519,56 @@ static void nvg__flushTextTexture(NVGcontext* ctx)
 
 static int nvg__allocTextAtlas(NVGcontext* ctx)
 {
-	int iw, ih;
+	int iw = 0, ih = 0, image;
 	nvg__flushTextTexture(ctx);
-	if (ctx->fontImageIdx >= NVG_MAX_FONTIMAGES-1)
+	if (ctx->fontAtlasFull)
 		return 0;
-	// if next fontImage already have a texture
-	if (ctx->fontImages[ctx->fontImageIdx+1] != 0)
-		nvgImageSize(ctx, ctx->fontImages[ctx->fontImageIdx+1], &iw, &ih);
-	else { // calculate the new font image size and create it.
-		nvgImageSize(ctx, ctx->fontImages[ctx->fontImageIdx], &iw, &ih);
+
+	// Grow the current page, keeping its glyphs. The old image may still be used by text
+	// drawn in this frame, so it is deleted at the end of the frame.
+	fonsGetAtlasSize(ctx->fs, &iw, &ih);
+	if ((iw < NVG_MAX_FONTIMAGE_SIZE || ih < NVG_MAX_FONTIMAGE_SIZE) && ctx->nretiredFontImages < NVG_MAX_FONTIMAGES) {
 		if (iw > ih)
 			ih *= 2;
 		else
 			iw *= 2;
-		if (iw > NVG_MAX_FONTIMAGE_SIZE || ih > NVG_MAX_FONTIMAGE_SIZE)
-			iw = ih = NVG_MAX_FONTIMAGE_SIZE;
-		ctx->fontImages[ctx->fontImageIdx+1] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, 0, NULL);
+		iw = nvg__mini(iw, NVG_MAX_FONTIMAGE_SIZE);
+		ih = nvg__mini(ih, NVG_MAX_FONTIMAGE_SIZE);
+		image = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, 0, NULL);
+		if (image != 0 && fonsExpandAtlas(ctx->fs, iw, ih)) {
+			ctx->retiredFontImages[ctx->nretiredFontImages++] = ctx->fontImages[ctx->fontImageIdx];
+			ctx->fontImages[ctx->fontImageIdx] = image;
+			nvg__flushTextTexture(ctx); // upload existing glyphs
+			return 1;
+		}
+		if (image != 0)
+			nvgDeleteImage(ctx, image);
 	}
-	++ctx->fontImageIdx;
-	fonsResetAtlas(ctx->fs, iw, ih);
-	return 1;
+
+	// Start a new page, glyphs on earlier pages stay valid.
+	if (ctx->fontImageIdx < NVG_MAX_FONTIMAGES-1) {
+		iw = ih = NVG_MAX_FONTIMAGE_SIZE;
+		image = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, 0, NULL);
+		if (image != 0 && fonsAddAtlasPage(ctx->fs, iw, ih) != FONS_INVALID) {
+			ctx->fontImages[++ctx->fontImageIdx] = image;
+			return 1;
+		}
+		if (image != 0)
+			nvgDeleteImage(ctx, image);
+	}
+
+	// No more room in this frame, see nvgEndFrame().
+	ctx->fontAtlasFull = 1;
+	return 0;
 }
 
-static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts)
+static void nvg__renderText(NVGcontext* ctx, int image, NVGvertex* verts, int nverts)
 {
 	NVGstate* state = nvg__getState(ctx);
 	NVGpaint paint = state->fill;
 
 	// Render triangles.
-	paint.image = ctx->fontImages[ctx->fontImageIdx];
+	paint.image = image;
 
 	// Apply global alpha
 	paint.innerColor.a *= state->alpha;
@@ -2287,13 +2583,14 @@ static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts)
 float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char* end)
 {
 	NVGstate* state = nvg__getState(ctx);
-	FONStextIter iter, prevIter;
+	FONStextIter iter;
 	FONSquad q;
 	NVGvertex* verts;
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
 	int cverts = 0;
 	int nverts = 0;
+	int image = 0;
 
 	if (end == NULL)
 		end = string + strlen(string);
@@ -2311,22 +2608,18 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
 	if (verts == NULL) return x;
 
 	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end);
-	prevIter = iter;
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
 		float c[4*2];
-		if (iter.prevGlyphIndex == -1) { // can not retrieve glyph?
-			if (!nvg__allocTextAtlas(ctx))
-				break; // no memory :(
+		if (iter.prevGlyphIndex == -1) // can not retrieve glyph, all atlas pages are full
+			continue;
+		// Glyphs may be on different pages (or on a page which has grown), draw each run separately.
+		if (ctx->fontImages[iter.page] != image) {
 			if (nverts != 0) {
-				nvg__renderText(ctx, verts, nverts);
+				nvg__renderText(ctx, image, verts, nverts);
 				nverts = 0;
 			}
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-			if (iter.prevGlyphIndex == -1) // still can not find glyph?
-				break;
+			image = ctx->fontImages[iter.page];
 		}
-		prevIter = iter;
 		// Transform corners.
 		nvgTransformPoint(&c[0],&c[1], state->xform, q.x0*invscale, q.y0*invscale);
 		nvgTransformPoint(&c[2],&c[3], state->xform, q.x1*invscale, q.y0*invscale);
@@ -2346,7 +2639,8 @@ float nvgText(NVGcontext* ctx, float x, float y, const char* string, const char*
 	// TODO: add back-end bit to do this just once per frame. 
 	nvg__flushTextTexture(ctx);
 
-	nvg__renderText(ctx, verts, nverts);
+	if (nverts != 0)
+		nvg__renderText(ctx, image, verts, nverts);
 
 	return iter.x;
 }
@@ -2389,7 +2683,7 @@ int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string,
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONStextIter iter;
 	FONSquad q;
 	int npos = 0;
 
@@ -2408,13 +2702,7 @@ int nvgTextGlyphPositions(NVGcontext* ctx, float x, float y, const char* string,
 	fonsSetFont(ctx->fs, state->fontId);
 
 	fonsTextIterInit(ctx->fs, &iter, x*scale, y*scale, string, end);
-	prevIter = iter;
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
 		positions[npos].str = iter.str;
 		positions[npos].x = iter.x * invscale;
 		positions[npos].minx = nvg__minf(iter.x, q.x0) * invscale;
@@ -2438,7 +2726,7 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 	NVGstate* state = nvg__getState(ctx);
 	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
 	float invscale = 1.0f / scale;
-	FONStextIter iter, prevIter;
+	FONStextIter iter;
 	FONSquad q;
 	int nrows = 0;
 	float rowStartX = 0;
@@ -2473,13 +2761,7 @@ int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, floa
 	breakRowWidth *= scale;
 
 	fonsTextIterInit(ctx->fs, &iter, 0, 0, string, end);
-	prevIter = iter;
 	while (fonsTextIterNext(ctx->fs, &iter, &q)) {
-		if (iter.prevGlyphIndex < 0 && nvg__allocTextAtlas(ctx)) { // can not retrieve glyph?
-			iter = prevIter;
-			fonsTextIterNext(ctx->fs, &iter, &q); // try again
-		}
-		prevIter = iter;
 		switch (iter.codepoint) {
 			case 9:			// \t
 			case 11:		// \v
@@ -2749,4 +3031,57 @@ void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* descender, float* l
 	if (lineh != NULL)
 		*lineh *= invscale;
 }
+
+static void nvg__prewarmTask(void* taskPtr, int index)
+{
+	fonsPrewarmRasterize((FONSprewarm*)taskPtr, index);
+}
+
+int nvgPrewarmText(NVGcontext* ctx, const char* string, const char* end, int numTasks, NVGrunTasksFunc runTasks, void* uptr)
+{
+	NVGstate* state = nvg__getState(ctx);
+	float scale = nvg__getFontScale(state) * ctx->devicePxRatio;
+	unsigned int* codepoints;
+	unsigned int utf8state = 0;
+	int ncodepoints = 0, nadded, i;
+	FONSprewarm* job;
+
+	if (state->fontId == FONS_INVALID) return 0;
+
+	if (end == NULL)
+		end = string + strlen(string);
+
+	if (string == end) return 0;
+
+	fonsSetSize(ctx->fs, state->fontSize*scale);
+	fonsSetSpacing(ctx->fs, state->letterSpacing*scale);
+	fonsSetBlur(ctx->fs, state->fontBlur*scale);
+	fonsSetAlign(ctx->fs, state->textAlign);
+	fonsSetFont(ctx->fs, state->fontId);
+
+	// Decode the text, there are never more codepoints than bytes.
+	codepoints = (unsigned int*)malloc(sizeof(unsigned int) * (end - string));
+	if (codepoints == NULL) return 0;
+	for (; string != end; ++string) {
+		if (fons__decutf8(&utf8state, &codepoints[ncodepoints], *(const unsigned char*)string))
+			continue;
+		ncodepoints++;
+	}
+
+	job = fonsPrewarmBegin(ctx->fs, codepoints, ncodepoints, numTasks);
+	free(codepoints);
+	if (job == NULL) return 0;
+
+	numTasks = fonsPrewarmTaskCount(job);
+	if (runTasks != NULL) {
+		runTasks(uptr, nvg__prewarmTask, job, numTasks);
+	} else {
+		for (i = 0; i < numTasks; i++)
+			fonsPrewarmRasterize(job, i);
+	}
+
+	nadded = fonsPrewarmEnd(ctx->fs, job);
+	nvg__flushTextTexture(ctx);
+	return nadded;
+}
 // vim: ft=c nu noet ts=4
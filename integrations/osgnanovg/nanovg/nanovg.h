@@ -123,6 +123,11 @@ void nvgCancelFrame(NVGcontext* ctx);
 // Ends drawing flushing remaining render state.
 void nvgEndFrame(NVGcontext* ctx);
 
+// Keeps tessellated fills and strokes of up to maxEntries paths between frames. A path whose
+// transformed commands and style hash to an earlier result reuses its vertices instead of
+// being flattened and expanded again. Zero (the default) disables the cache.
+void nvgTessellationCache(NVGcontext* ctx, int maxEntries);
+
 //
 // Color utils
 //
@@ -547,6 +552,16 @@ void nvgTextMetrics(NVGcontext* ctx, float* ascender, float* descender, float* l
 // Words longer than the max width are slit at nearest character (i.e. no hyphenation).
 int nvgTextBreakLines(NVGcontext* ctx, const char* string, const char* end, float breakRowWidth, NVGtextRow* rows, int maxRows);
 
+// Rasterizes the glyphs of the specified text into the font atlas ahead of drawing, so that the first frame
+// showing a large character set (e.g. CJK text) does not stall. Glyphs are made for the current font face,
+// size, blur, transform and pixel ratio, in the same way nvgText() would. The work is split into numTasks tasks:
+// if runTasks is not NULL, it is called once and must call task(taskPtr, i) for each i in [0, numTasks),
+// possibly from parallel threads, before returning. Otherwise the tasks run on the calling thread.
+// Returns the number of glyphs added to the atlas.
+typedef void (*NVGtaskFunc)(void* taskPtr, int index);
+typedef void (*NVGrunTasksFunc)(void* uptr, NVGtaskFunc task, void* taskPtr, int numTasks);
+int nvgPrewarmText(NVGcontext* ctx, const char* string, const char* end, int numTasks, NVGrunTasksFunc runTasks, void* uptr);
+
 //
 // Internal Render API
 //
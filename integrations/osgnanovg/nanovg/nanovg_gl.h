@@ -32,6 +32,9 @@ enum NVGcreateFlags {
 	NVG_STENCIL_STROKES	= 1<<1,
 	// Flag indicating that additional debug checks are done.
 	NVG_DEBUG 			= 1<<2,
+	// Flag indicating that vertices and uniforms are streamed through ring buffers (persistently
+	// mapped if supported), and consecutive calls with the same paint are merged into single draws.
+	NVG_BATCHING		= 1<<3,
 };
 
 #if defined NANOVG_GL2_IMPLEMENTATION
@@ -51,6 +54,21 @@ enum NVGcreateFlags {
 
 #define NANOVG_GL_USE_STATE_FILTER (1)
 
+// Ring buffers need glMapBufferRange() and fences; buffer storage makes them persistently mapped.
+#if defined NANOVG_GLEW
+#  define NANOVG_GL_USE_RING 1
+#  define glnvg__ringSupported() (GLEW_ARB_map_buffer_range && GLEW_ARB_sync)
+#  if defined GL_ARB_buffer_storage
+#    define NANOVG_GL_USE_PERSISTENT 1
+#    define glnvg__persistentSupported() (GLEW_ARB_buffer_storage)
+#  endif
+#elif defined NANOVG_GL3 || defined NANOVG_GLES3
+#  define NANOVG_GL_USE_RING 1
+#  define glnvg__ringSupported() 1
+#endif
+
+#define NANOVG_GL_RING_SEGMENTS 3
+
 // Creates NanoVG contexts for different OpenGL (ES) versions.
 // Flags should be combination of the create flags above.
 
@@ -210,6 +228,20 @@ struct GLNVGfragUniforms {
 };
 typedef struct GLNVGfragUniforms GLNVGfragUniforms;
 
+#if NANOVG_GL_USE_RING
+// A buffer of NANOVG_GL_RING_SEGMENTS segments written in turn, one per frame. A fence waits
+// for the GPU only if it still reads the segment written that many frames ago.
+struct GLNVGring {
+	GLuint buf;
+	GLenum target;
+	int segmentSize;
+	int segment;
+	unsigned char* mapped;
+	GLsync fences[NANOVG_GL_RING_SEGMENTS];
+};
+typedef struct GLNVGring GLNVGring;
+#endif
+
 struct GLNVGcontext {
 	GLNVGshader shader;
 	GLNVGtexture* textures;
@@ -223,9 +255,24 @@ struct GLNVGcontext {
 #endif
 #if NANOVG_GL_USE_UNIFORMBUFFER
 	GLuint fragBuf;
+	GLuint fragBufInUse;
+	int fragBase;
+	int fragAlign;
 #endif
 	int fragSize;
 	int flags;
+#if NANOVG_GL_USE_RING
+	int useRing;
+	GLNVGring vertRing;
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	GLNVGring fragRing;
+#endif
+#endif
+
+	// Draw ranges of merged calls
+	GLint* mergeFirst;
+	GLsizei* mergeCount;
+	int cmerge;
 
 	// Per frame buffers
 	GLNVGcall* calls;
@@ -248,6 +295,7 @@ struct GLNVGcontext {
 	GLenum stencilFunc;
 	GLint stencilFuncRef;
 	GLuint stencilFuncMask;
+	int boundUniforms;
 	#endif
 };
 typedef struct GLNVGcontext GLNVGcontext;
@@ -667,6 +715,18 @@ static int glnvg__renderCreate(void* uptr)
 	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
 #endif
 	gl->fragSize = sizeof(GLNVGfragUniforms) + align - sizeof(GLNVGfragUniforms) % align;
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	gl->fragBufInUse = gl->fragBuf;
+	gl->fragAlign = align;
+#endif
+
+#if NANOVG_GL_USE_RING
+	gl->useRing = (gl->flags & NVG_BATCHING) && glnvg__ringSupported();
+	gl->vertRing.target = GL_ARRAY_BUFFER;
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	gl->fragRing.target = GL_UNIFORM_BUFFER;
+#endif
+#endif
 
 	glnvg__checkError(gl, "create done");
 
@@ -917,12 +977,19 @@ static GLNVGfragUniforms* nvg__fragUniformPtr(GLNVGcontext* gl, int i);
 
 static void glnvg__setUniforms(GLNVGcontext* gl, int uniformOffset, int image)
 {
+#if NANOVG_GL_USE_STATE_FILTER
+	if (gl->boundUniforms != uniformOffset) {
+		gl->boundUniforms = uniformOffset;
+#endif
 #if NANOVG_GL_USE_UNIFORMBUFFER
-	glBindBufferRange(GL_UNIFORM_BUFFER, GLNVG_FRAG_BINDING, gl->fragBuf, uniformOffset, sizeof(GLNVGfragUniforms));
+	glBindBufferRange(GL_UNIFORM_BUFFER, GLNVG_FRAG_BINDING, gl->fragBufInUse, gl->fragBase + uniformOffset, sizeof(GLNVGfragUniforms));
 #else
 	GLNVGfragUniforms* frag = nvg__fragUniformPtr(gl, uniformOffset);
 	glUniform4fv(gl->shader.loc[GLNVG_LOC_FRAG], NANOVG_GL_UNIFORMARRAY_SIZE, &(frag->uniformArray[0][0]));
 #endif
+#if NANOVG_GL_USE_STATE_FILTER
+	}
+#endif
 
 	if (image != 0) {
 		GLNVGtexture* tex = glnvg__findTexture(gl, image);
@@ -1056,6 +1123,187 @@ static void glnvg__triangles(GLNVGcontext* gl, GLNVGcall* call)
 	glDrawArrays(GL_TRIANGLES, call->triangleOffset, call->triangleCount);
 }
 
+static int glnvg__allocMerge(GLNVGcontext* gl, int n)
+{
+	if (n > gl->cmerge) {
+		GLint* first;
+		GLsizei* count;
+		int cmerge = glnvg__maxi(n, 128) + gl->cmerge/2; // 1.5x Overallocate
+		first = (GLint*)realloc(gl->mergeFirst, sizeof(GLint) * cmerge);
+		if (first == NULL) return 0;
+		gl->mergeFirst = first;
+		count = (GLsizei*)realloc(gl->mergeCount, sizeof(GLsizei) * cmerge);
+		if (count == NULL) return 0;
+		gl->mergeCount = count;
+		gl->cmerge = cmerge;
+	}
+	return 1;
+}
+
+static void glnvg__multiDrawArrays(GLNVGcontext* gl, GLenum mode, int n)
+{
+#if defined NANOVG_GLES2 || defined NANOVG_GLES3
+	int i;
+	for (i = 0; i < n; i++)
+		glDrawArrays(mode, gl->mergeFirst[i], gl->mergeCount[i]);
+#else
+	glMultiDrawArrays(mode, gl->mergeFirst, gl->mergeCount, n);
+#endif
+}
+
+// Returns how many calls from the i'th one can be drawn together: convex fills, triangles or
+// simple strokes of the same type, image and uniforms.
+static int glnvg__countMergeable(GLNVGcontext* gl, int i)
+{
+	GLNVGcall* call = &gl->calls[i];
+	int n = 1;
+
+	if (call->type == GLNVG_FILL || (call->type == GLNVG_STROKE && (gl->flags & NVG_STENCIL_STROKES)))
+		return 1;
+
+	while (i + n < gl->ncalls) {
+		GLNVGcall* next = &gl->calls[i + n];
+		GLNVGcall* prev = &gl->calls[i + n - 1];
+		if (next->type != call->type || next->image != call->image || next->uniformOffset != call->uniformOffset)
+			break;
+		if (call->type == GLNVG_TRIANGLES && next->triangleOffset != prev->triangleOffset + prev->triangleCount)
+			break;
+		n++;
+	}
+	return n;
+}
+
+static void glnvg__mergedDraw(GLNVGcontext* gl, GLNVGcall* calls, int ncalls)
+{
+	GLNVGcall* call = &calls[0];
+	int i, j, n = 0;
+
+	glnvg__setUniforms(gl, call->uniformOffset, call->image);
+	glnvg__checkError(gl, "merged calls");
+
+	if (call->type == GLNVG_TRIANGLES) {
+		GLNVGcall* last = &calls[ncalls-1];
+		glDrawArrays(GL_TRIANGLES, call->triangleOffset, last->triangleOffset + last->triangleCount - call->triangleOffset);
+		return;
+	}
+
+	for (i = 0; i < ncalls; i++)
+		n += calls[i].pathCount;
+	if (!glnvg__allocMerge(gl, n)) {
+		for (i = 0; i < ncalls; i++) {
+			if (call->type == GLNVG_CONVEXFILL) glnvg__convexFill(gl, &calls[i]);
+			else glnvg__stroke(gl, &calls[i]);
+		}
+		return;
+	}
+
+	// All fans go before all fringes. Calls with the same uniforms paint the same color at each
+	// pixel, and blending such layers in another order gives the same result (up to rounding).
+	if (call->type == GLNVG_CONVEXFILL) {
+		n = 0;
+		for (i = 0; i < ncalls; i++) {
+			GLNVGpath* paths = &gl->paths[calls[i].pathOffset];
+			for (j = 0; j < calls[i].pathCount; j++, n++) {
+				gl->mergeFirst[n] = paths[j].fillOffset;
+				gl->mergeCount[n] = paths[j].fillCount;
+			}
+		}
+		glnvg__multiDrawArrays(gl, GL_TRIANGLE_FAN, n);
+	}
+
+	if (call->type == GLNVG_STROKE || (gl->flags & NVG_ANTIALIAS)) {
+		n = 0;
+		for (i = 0; i < ncalls; i++) {
+			GLNVGpath* paths = &gl->paths[calls[i].pathOffset];
+			for (j = 0; j < calls[i].pathCount; j++, n++) {
+				gl->mergeFirst[n] = paths[j].strokeOffset;
+				gl->mergeCount[n] = paths[j].strokeCount;
+			}
+		}
+		glnvg__multiDrawArrays(gl, GL_TRIANGLE_STRIP, n);
+	}
+}
+
+#if NANOVG_GL_USE_RING
+static void glnvg__deleteRing(GLNVGring* ring)
+{
+	int i;
+	for (i = 0; i < NANOVG_GL_RING_SEGMENTS; i++) {
+		if (ring->fences[i] != NULL)
+			glDeleteSync(ring->fences[i]);
+		ring->fences[i] = NULL;
+	}
+	if (ring->buf != 0) {
+		if (ring->mapped != NULL) {
+			glBindBuffer(ring->target, ring->buf);
+			glUnmapBuffer(ring->target);
+		}
+		glDeleteBuffers(1, &ring->buf);
+	}
+	ring->buf = 0;
+	ring->mapped = NULL;
+	ring->segmentSize = 0;
+	ring->segment = 0;
+}
+
+// Copies data into the next segment of the ring and returns its offset in the bound buffer.
+static int glnvg__uploadRing(GLNVGring* ring, const void* data, int size, int align)
+{
+	int offset;
+
+	if (ring->buf == 0 || size > ring->segmentSize) {
+		// Grow by half to avoid reallocating when sizes change slightly.
+		int segmentSize = glnvg__maxi(size + size/2, 4096);
+		segmentSize = (segmentSize + align - 1) / align * align;
+		glnvg__deleteRing(ring);
+		glGenBuffers(1, &ring->buf);
+		glBindBuffer(ring->target, ring->buf);
+#if NANOVG_GL_USE_PERSISTENT
+		if (glnvg__persistentSupported()) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(ring->target, segmentSize * NANOVG_GL_RING_SEGMENTS, NULL, flags | GL_DYNAMIC_STORAGE_BIT);
+			ring->mapped = (unsigned char*)glMapBufferRange(ring->target, 0, segmentSize * NANOVG_GL_RING_SEGMENTS, flags);
+		} else
+#endif
+		glBufferData(ring->target, segmentSize * NANOVG_GL_RING_SEGMENTS, NULL, GL_STREAM_DRAW);
+		ring->segmentSize = segmentSize;
+	} else {
+		glBindBuffer(ring->target, ring->buf);
+	}
+
+	if (ring->fences[ring->segment] != NULL) {
+		glClientWaitSync(ring->fences[ring->segment], GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)1000000000);
+		glDeleteSync(ring->fences[ring->segment]);
+		ring->fences[ring->segment] = NULL;
+	}
+
+	offset = ring->segment * ring->segmentSize;
+	if (size > 0) {
+		if (ring->mapped != NULL) {
+			memcpy(ring->mapped + offset, data, size);
+		} else {
+			void* ptr = glMapBufferRange(ring->target, offset, size,
+										 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (ptr != NULL) {
+				memcpy(ptr, data, size);
+				glUnmapBuffer(ring->target);
+			} else {
+				glBufferSubData(ring->target, offset, size, data);
+			}
+		}
+	}
+	return offset;
+}
+
+// Marks the segment written in this frame as in use until the GPU has drawn it.
+static void glnvg__fenceRing(GLNVGring* ring)
+{
+	if (ring->buf == 0) return;
+	ring->fences[ring->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	ring->segment = (ring->segment + 1) % NANOVG_GL_RING_SEGMENTS;
+}
+#endif
+
 static void glnvg__renderCancel(void* uptr) {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
 	gl->nverts = 0;
@@ -1067,7 +1315,7 @@ static void glnvg__renderCancel(void* uptr) {
 static void glnvg__renderFlush(void* uptr)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
-	int i;
+	int i, vertBase = 0;
 
 	if (gl->ncalls > 0) {
 
@@ -1093,35 +1341,62 @@ static void glnvg__renderFlush(void* uptr)
 		gl->stencilFunc = GL_ALWAYS;
 		gl->stencilFuncRef = 0;
 		gl->stencilFuncMask = 0xffffffff;
+		gl->boundUniforms = -1;
 		#endif
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
 		// Upload ubo for frag shaders
-		glBindBuffer(GL_UNIFORM_BUFFER, gl->fragBuf);
-		glBufferData(GL_UNIFORM_BUFFER, gl->nuniforms * gl->fragSize, gl->uniforms, GL_STREAM_DRAW);
+#if NANOVG_GL_USE_RING
+		if (gl->useRing) {
+			gl->fragBase = glnvg__uploadRing(&gl->fragRing, gl->uniforms, gl->nuniforms * gl->fragSize, gl->fragAlign);
+			gl->fragBufInUse = gl->fragRing.buf;
+		} else
+#endif
+		{
+			glBindBuffer(GL_UNIFORM_BUFFER, gl->fragBuf);
+			glBufferData(GL_UNIFORM_BUFFER, gl->nuniforms * gl->fragSize, gl->uniforms, GL_STREAM_DRAW);
+			gl->fragBase = 0;
+			gl->fragBufInUse = gl->fragBuf;
+		}
 #endif
 
 		// Upload vertex data
 #if defined NANOVG_GL3
 		glBindVertexArray(gl->vertArr);
 #endif
-		glBindBuffer(GL_ARRAY_BUFFER, gl->vertBuf);
-		glBufferData(GL_ARRAY_BUFFER, gl->nverts * sizeof(NVGvertex), gl->verts, GL_STREAM_DRAW);
+#if NANOVG_GL_USE_RING
+		if (gl->useRing) {
+			vertBase = glnvg__uploadRing(&gl->vertRing, gl->verts, gl->nverts * sizeof(NVGvertex), sizeof(NVGvertex));
+		} else
+#endif
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, gl->vertBuf);
+			glBufferData(GL_ARRAY_BUFFER, gl->nverts * sizeof(NVGvertex), gl->verts, GL_STREAM_DRAW);
+		}
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(size_t)0);
-		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(0 + 2*sizeof(float)));
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(size_t)vertBase);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(size_t)(vertBase + 2*sizeof(float)));
 
 		// Set view and texture just once per frame.
 		glUniform1i(gl->shader.loc[GLNVG_LOC_TEX], 0);
 		glUniform2fv(gl->shader.loc[GLNVG_LOC_VIEWSIZE], 1, gl->view);
 
 #if NANOVG_GL_USE_UNIFORMBUFFER
-		glBindBuffer(GL_UNIFORM_BUFFER, gl->fragBuf);
+		glBindBuffer(GL_UNIFORM_BUFFER, gl->fragBufInUse);
 #endif
 
 		for (i = 0; i < gl->ncalls; i++) {
 			GLNVGcall* call = &gl->calls[i];
+			if (gl->flags & NVG_BATCHING) {
+				int n = glnvg__countMergeable(gl, i);
+				if (n > 1) {
+					glnvg__mergedDraw(gl, call, n);
+					i += n - 1;
+					continue;
+				}
+			}
+
 			if (call->type == GLNVG_FILL)
 				glnvg__fill(gl, call);
 			else if (call->type == GLNVG_CONVEXFILL)
@@ -1132,6 +1407,15 @@ static void glnvg__renderFlush(void* uptr)
 				glnvg__triangles(gl, call);
 		}
 
+#if NANOVG_GL_USE_RING
+		if (gl->useRing) {
+			glnvg__fenceRing(&gl->vertRing);
+#if NANOVG_GL_USE_UNIFORMBUFFER
+			glnvg__fenceRing(&gl->fragRing);
+#endif
+		}
+#endif
+
 		glDisableVertexAttribArray(0);
 		glDisableVertexAttribArray(1);
 #if defined NANOVG_GL3
@@ -1229,6 +1513,23 @@ static GLNVGfragUniforms* nvg__fragUniformPtr(GLNVGcontext* gl, int i)
 	return (GLNVGfragUniforms*)&gl->uniforms[i];
 }
 
+// Lets a call use the uniforms of the previous call if they are the same, so that both calls
+// can be merged when flushing.
+static void glnvg__shareFragUniforms(GLNVGcontext* gl, GLNVGcall* call)
+{
+	GLNVGcall* prev;
+	if ((gl->flags & NVG_BATCHING) == 0 || gl->ncalls < 2) return;
+
+	prev = &gl->calls[gl->ncalls-2];
+	if (prev->type != call->type || prev->image != call->image) return;
+	if (call->uniformOffset != (gl->nuniforms-1) * gl->fragSize) return;
+	if (memcmp(nvg__fragUniformPtr(gl, prev->uniformOffset), nvg__fragUniformPtr(gl, call->uniformOffset),
+			   sizeof(GLNVGfragUniforms)) != 0) return;
+
+	gl->nuniforms--;
+	call->uniformOffset = prev->uniformOffset;
+}
+
 static void glnvg__vset(NVGvertex* vtx, float x, float y, float u, float v)
 {
 	vtx->x = x;
@@ -1308,6 +1609,7 @@ static void glnvg__renderFill(void* uptr, NVGpaint* paint, NVGscissor* scissor,
 		if (call->uniformOffset == -1) goto error;
 		// Fill shader
 		glnvg__convertPaint(gl, nvg__fragUniformPtr(gl, call->uniformOffset), paint, scissor, fringe, fringe, -1.0f);
+		glnvg__shareFragUniforms(gl, call);
 	}
 
 	return;
@@ -1363,6 +1665,7 @@ static void glnvg__renderStroke(void* uptr, NVGpaint* paint, NVGscissor* scissor
 		call->uniformOffset = glnvg__allocFragUniforms(gl, 1);
 		if (call->uniformOffset == -1) goto error;
 		glnvg__convertPaint(gl, nvg__fragUniformPtr(gl, call->uniformOffset), paint, scissor, strokeWidth, fringe, -1.0f);
+		glnvg__shareFragUniforms(gl, call);
 	}
 
 	return;
@@ -1398,6 +1701,7 @@ static void glnvg__renderTriangles(void* uptr, NVGpaint* paint, NVGscissor* scis
 	frag = nvg__fragUniformPtr(gl, call->uniformOffset);
 	glnvg__convertPaint(gl, frag, paint, scissor, 1.0f, 1.0f, -1.0f);
 	frag->type = NSVG_SHADER_IMG;
+	glnvg__shareFragUniforms(gl, call);
 
 	return;
 
@@ -1425,6 +1729,12 @@ static void glnvg__renderDelete(void* uptr)
 #endif
 	if (gl->vertBuf != 0)
 		glDeleteBuffers(1, &gl->vertBuf);
+#if NANOVG_GL_USE_RING
+	glnvg__deleteRing(&gl->vertRing);
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	glnvg__deleteRing(&gl->fragRing);
+#endif
+#endif
 
 	for (i = 0; i < gl->ntextures; i++) {
 		if (gl->textures[i].tex != 0 && (gl->textures[i].flags & NVG_IMAGE_NODELETE) == 0)
@@ -1436,6 +1746,8 @@ static void glnvg__renderDelete(void* uptr)
 	free(gl->verts);
 	free(gl->uniforms);
 	free(gl->calls);
+	free(gl->mergeFirst);
+	free(gl->mergeCount);
 
 	free(gl);
 }
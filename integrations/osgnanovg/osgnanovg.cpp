@@ -2,7 +2,9 @@
 #include "nanovg/nanovg.h"
 #include "nanovg/nanovg_gl.h"
 
+#include <OpenThreads/Thread>
 #include <osg/Drawable>
+#include <osg/Timer>
 #include <osg/MatrixTransform>
 #include <osgDB/ReadFile>
 #include <osgDB/FileUtils>
@@ -10,12 +12,47 @@
 #include <osgViewer/ViewerEventHandlers>
 #include <osgViewer/Viewer>
 #include <osg/io_utils>
+#include <cstdlib>
+#include <map>
+#include <cstring>
+#include <iostream>
+
+/* Run nanovg tasks (e.g. glyph rasterization) in parallel threads */
+class NanoVGTaskThread : public OpenThreads::Thread
+{
+public:
+    NanoVGTaskThread( NVGtaskFunc t, void* p, int i ) : task(t), taskPtr(p), index(i) {}
+    virtual void run() { task( taskPtr, index ); }
+
+protected:
+    NVGtaskFunc task;
+    void* taskPtr;
+    int index;
+};
+
+static void runTasksInThreads( void*, NVGtaskFunc task, void* taskPtr, int numTasks )
+{
+    std::vector<NanoVGTaskThread*> threads;
+    for ( int i=1; i<numTasks; ++i )
+    {
+        NanoVGTaskThread* thread = new NanoVGTaskThread( task, taskPtr, i );
+        thread->start();
+        threads.push_back( thread );
+    }
+    
+    task( taskPtr, 0 );
+    for ( unsigned int i=0; i<threads.size(); ++i )
+    {
+        threads[i]->join();
+        delete threads[i];
+    }
+}
 
 class NanoVGDrawable : public osg::Drawable
 {
 public:
     NanoVGDrawable()
-    :   _vg(NULL), _activeContextID(0), _width(800), _height(600), _initialized(false)
+    :   _vg(NULL), _activeContextID(0), _width(800), _height(600), _initialized(false), _batching(false)
     {
         setSupportsDisplayList( false );
     }
@@ -23,7 +60,9 @@ public:
     NanoVGDrawable( const NanoVGDrawable& copy, const osg::CopyOp& copyop=osg::CopyOp::SHALLOW_COPY )
     :   osg::Drawable(copy, copyop), _vg(copy._vg),
         _loadedImages(copy._loadedImages), _activeContextID(copy._activeContextID),
-        _width(copy._width), _height(copy._height), _initialized(copy._initialized)
+        _fonts(copy._fonts), _texts(copy._texts),
+        _width(copy._width), _height(copy._height), _initialized(copy._initialized),
+        _batching(copy._batching)
     {
     }
     
@@ -36,12 +75,16 @@ public:
         {
             NanoVGDrawable* constMe = const_cast<NanoVGDrawable*>(this);
             glewInit();
-            constMe->_vg = nvgCreateGL2( NVG_ANTIALIAS|NVG_STENCIL_STROKES|NVG_DEBUG );
+            int flags = NVG_ANTIALIAS|NVG_STENCIL_STROKES|NVG_DEBUG;
+            if ( _batching ) flags |= NVG_BATCHING;
+            
+            constMe->_vg = nvgCreateGL2( flags );
             if ( !constMe->_vg )
             {
                 OSG_NOTICE << "[NanoVGDrawable] Failed to create VG context" << std::endl;
                 return;
             }
+            if ( _batching ) nvgTessellationCache( constMe->_vg, 1024 );
             
             constMe->initializeGL( renderInfo.getState() );
             constMe->_activeContextID = contextID;
@@ -82,6 +125,22 @@ public:
         std::string file = osgDB::findDataFile( "Images/osg256.png" );
         int img = nvgCreateImage( _vg, file.c_str(), 0 );
         if ( img!=0 ) _loadedImages.push_back( img );
+        
+        for ( std::map<std::string, std::string>::iterator itr=_fonts.begin(); itr!=_fonts.end(); ++itr )
+        {
+            if ( nvgCreateFont(_vg, itr->first.c_str(), itr->second.c_str())<0 )
+                OSG_NOTICE << "[NanoVGDrawable] Failed to load font " << itr->second << std::endl;
+        }
+        
+        // Rasterize glyphs of all texts before the first frame, instead of stalling while drawing
+        int numThreads = OpenThreads::GetNumberOfProcessors();
+        for ( unsigned int i=0; i<_texts.size(); ++i )
+        {
+            const TextData& text = _texts[i];
+            nvgFontFace( _vg, text.font.c_str() );
+            nvgFontSize( _vg, text.size );
+            nvgPrewarmText( _vg, text.text.c_str(), NULL, numThreads, runTasksInThreads, NULL );
+        }
     }
     
     virtual void deinitializeGL( osg::State* state )
@@ -115,17 +174,53 @@ public:
             nvgFill( _vg );
             nvgClosePath( _vg );
         }
+        
+        float y = 50.0f;
+        for ( unsigned int i=0; i<_texts.size(); ++i )
+        {
+            const TextData& text = _texts[i];
+            nvgFontFace( _vg, text.font.c_str() );
+            nvgFontSize( _vg, text.size );
+            nvgFillColor( _vg, nvgRGBA(255, 255, 255, 255) );
+            nvgText( _vg, 20.0f, y, text.text.c_str(), NULL );
+            y += text.size * 1.5f;
+        }
+    }
+    
+    /** Load a TrueType font file as the named face. It must be added before the first frame */
+    void addFont( const std::string& name, const std::string& file ) { _fonts[name] = file; }
+    
+    /** Add an UTF-8 text to draw; its glyphs are rasterized in parallel threads when the
+        context is created, so that large character sets don't stall the first frame */
+    void addText( const std::string& font, float size, const std::string& text )
+    {
+        TextData data; data.font = font; data.size = size; data.text = text;
+        _texts.push_back( data );
     }
     
     void setWindowSize( int w, int h )
     { _width = w; _height = h; }
     
+    /** Stream vertices and uniforms through ring buffers, merge calls of the same paint and cache
+        tessellated paths between frames. It must be set before the first frame */
+    void setBatching( bool b ) { _batching = b; }
+    bool getBatching() const { return _batching; }
+    
 protected:
+    struct TextData
+    {
+        std::string font, text;
+        float size;
+    };
+    
     NVGcontext* _vg;
     std::vector<int> _loadedImages;
+    std::map<std::string, std::string> _fonts;
+    std::vector<TextData> _texts;
     unsigned int _activeContextID;
     int _width, _height;
     bool _initialized;
+    bool _batching;
 };
 
 class NanoVGHandler : public osgGA::GUIEventHandler
@@ -155,9 +250,160 @@ protected:
     NanoVGDrawable* _vg;
 };
 
+/* A renderer doing nothing, to measure CPU-side tessellation without a graphics context */
+static int nullCreate( void* ) { return 1; }
+static int nullCreateTexture( void*, int, int, int, int, const unsigned char* ) { return 1; }
+static int nullDeleteTexture( void*, int ) { return 1; }
+static int nullUpdateTexture( void*, int, int, int, int, int, const unsigned char* ) { return 1; }
+static int nullGetTextureSize( void*, int, int* w, int* h ) { *w = *h = 512; return 1; }
+static void nullViewport( void*, int, int ) {}
+static void nullCancel( void* ) {}
+static void nullFlush( void* ) {}
+static void nullFill( void*, NVGpaint*, NVGscissor*, float, const float*, const NVGpath*, int ) {}
+static void nullStroke( void*, NVGpaint*, NVGscissor*, float, float, const NVGpath*, int ) {}
+static void nullTriangles( void*, NVGpaint*, NVGscissor*, const NVGvertex*, int ) {}
+static void nullDelete( void* ) {}
+
+int runBenchmark( int numShapes, int numFrames )
+{
+    NVGparams params;
+    memset( &params, 0, sizeof(params) );
+    params.renderCreate = nullCreate;
+    params.renderCreateTexture = nullCreateTexture;
+    params.renderDeleteTexture = nullDeleteTexture;
+    params.renderUpdateTexture = nullUpdateTexture;
+    params.renderGetTextureSize = nullGetTextureSize;
+    params.renderViewport = nullViewport;
+    params.renderCancel = nullCancel;
+    params.renderFlush = nullFlush;
+    params.renderFill = nullFill;
+    params.renderStroke = nullStroke;
+    params.renderTriangles = nullTriangles;
+    params.renderDelete = nullDelete;
+    params.edgeAntiAlias = 1;
+    
+    const int cacheSizes[3] = { 0, numShapes / 2, numShapes * 2 };
+    for ( int c=0; c<3; ++c )
+    {
+        NVGcontext* vg = nvgCreateInternal( &params );
+        if ( !vg ) return 1;
+        nvgTessellationCache( vg, cacheSizes[c] );
+        
+        // A tenth of the shapes move in each frame, others are the same as in last frame
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        for ( int f=0; f<numFrames; ++f )
+        {
+            srand( 0 );
+            nvgBeginFrame( vg, 1024, 768, 1.0f );
+            for ( int i=0; i<numShapes; ++i )
+            {
+                float x = rand() % 1024 + (i % 10==0 ? f : 0), y = rand() % 768;
+                nvgBeginPath( vg );
+                if ( i % 2 ) nvgRoundedRect( vg, x, y, 40, 20, 5 );
+                else nvgCircle( vg, x, y, 10 + i % 20 );
+                nvgFillColor( vg, nvgRGBA(255, 192, 0, 255) );
+                nvgFill( vg );
+                nvgStrokeWidth( vg, 1 + i % 3 );
+                nvgStroke( vg );
+            }
+            nvgEndFrame( vg );
+        }
+        std::cout << numFrames << " frames of " << numShapes << " shapes, tessellation cache of "
+                  << cacheSizes[c] << ": " << osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick())
+                  << "ms" << std::endl;
+        nvgDeleteInternal( vg );
+    }
+    return 0;
+}
+
+/* Rasterize numGlyphs CJK glyphs while drawing, then ahead of drawing in 1 and N threads */
+int runFontBenchmark( const std::string& fontFile, int numGlyphs )
+{
+    std::string text;
+    for ( int i=0; i<numGlyphs; ++i )
+    {
+        unsigned int c = 0x4e00 + i;  // 3-byte UTF-8 sequences
+        text += (char)(0xe0 | (c >> 12));
+        text += (char)(0x80 | ((c >> 6) & 0x3f));
+        text += (char)(0x80 | (c & 0x3f));
+    }
+    
+    NVGparams params;
+    memset( &params, 0, sizeof(params) );
+    params.renderCreate = nullCreate;
+    params.renderCreateTexture = nullCreateTexture;
+    params.renderDeleteTexture = nullDeleteTexture;
+    params.renderUpdateTexture = nullUpdateTexture;
+    params.renderGetTextureSize = nullGetTextureSize;
+    params.renderViewport = nullViewport;
+    params.renderCancel = nullCancel;
+    params.renderFlush = nullFlush;
+    params.renderFill = nullFill;
+    params.renderStroke = nullStroke;
+    params.renderTriangles = nullTriangles;
+    params.renderDelete = nullDelete;
+    
+    const int numThreads[3] = { 0, 1, OpenThreads::GetNumberOfProcessors() };
+    for ( int t=0; t<3; ++t )
+    {
+        NVGcontext* vg = nvgCreateInternal( &params );
+        if ( !vg ) return 1;
+        if ( nvgCreateFont(vg, "cjk", fontFile.c_str())<0 )
+        {
+            OSG_NOTICE << "Failed to load font " << fontFile << std::endl;
+            nvgDeleteInternal( vg );
+            return 1;
+        }
+        
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        nvgFontFace( vg, "cjk" );
+        nvgFontSize( vg, 24.0f );
+        if ( numThreads[t]>0 )
+            nvgPrewarmText( vg, text.c_str(), NULL, numThreads[t], runTasksInThreads, NULL );
+        
+        nvgBeginFrame( vg, 1024, 768, 1.0f );
+        nvgFontFace( vg, "cjk" );
+        nvgFontSize( vg, 24.0f );
+        nvgText( vg, 0.0f, 100.0f, text.c_str(), NULL );
+        nvgEndFrame( vg );
+        
+        if ( numThreads[t]>0 ) std::cout << "Prewarming in " << numThreads[t] << " threads: ";
+        else std::cout << "Rasterizing while drawing: ";
+        std::cout << numGlyphs << " glyphs, " << osg::Timer::instance()->delta_m(t0, osg::Timer::instance()->tick())
+                  << "ms" << std::endl;
+        nvgDeleteInternal( vg );
+    }
+    return 0;
+}
+
 int main( int argc, char** argv )
 {
+    osg::ArgumentParser arguments( &argc, argv );
+    
+    // Headless tessellation benchmark, e.g. --benchmark 5000 --frames 100
+    int numShapes = 0, numFrames = 100;
+    arguments.read( "--frames", numFrames );
+    if ( arguments.read("--benchmark", numShapes) )
+        return runBenchmark( numShapes, numFrames );
+    
+    // Glyph rasterization benchmark, e.g. --font-benchmark simhei.ttf --glyphs 20000
+    std::string fontFile;
+    int numGlyphs = 20000;
+    arguments.read( "--glyphs", numGlyphs );
+    if ( arguments.read("--font-benchmark", fontFile) )
+        return runFontBenchmark( fontFile, numGlyphs );
+    
     osg::ref_ptr<NanoVGDrawable> vgDrawable = new NanoVGDrawable;
+    vgDrawable->setBatching( arguments.read("--batching") );
+    
+    // Text to draw with a given font, e.g. --font simhei.ttf --text "..."
+    std::string text;
+    if ( arguments.read("--font", fontFile) )
+    {
+        vgDrawable->addFont( "default", fontFile );
+        while ( arguments.read("--text", text) )
+            vgDrawable->addText( "default", 24.0f, text );
+    }
     
     osg::ref_ptr<osg::Geode> geode = new osg::Geode;
     geode->setCullingActive( false );
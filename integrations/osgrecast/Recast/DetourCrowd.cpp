@@ -340,7 +340,12 @@ dtCrowd::dtCrowd() :
 	m_maxPathResult(0),
 	m_maxAgentRadius(0),
 	m_velocitySampleCount(0),
-	m_navquery(0)
+	m_navquery(0),
+	m_taskRunner(0),
+	m_numWorkers(0),
+	m_workerNavQueries(0),
+	m_workerObstacleQueries(0),
+	m_workerSampleCounts(0)
 {
 }
 
@@ -351,6 +356,8 @@ dtCrowd::~dtCrowd()
 
 void dtCrowd::purge()
 {
+	purgeWorkers();
+	
 	for (int i = 0; i < m_maxAgents; ++i)
 		m_agents[i].~dtCrowdAgent();
 	dtFree(m_agents);
@@ -458,6 +465,77 @@ bool dtCrowd::init(const int maxAgents, const float maxAgentRadius, dtNavMesh* n
 	if (dtStatusFailed(m_navquery->init(nav, MAX_COMMON_NODES)))
 		return false;
 	
+	// Re-create the per-worker queries of a previously set runner.
+	if (!setTaskRunner(m_taskRunner))
+		return false;
+	
+	return true;
+}
+
+void dtCrowd::purgeWorkers()
+{
+	// Worker 0 shares the queries owned by the crowd.
+	for (int i = 1; i < m_numWorkers; ++i)
+	{
+		dtFreeNavMeshQuery(m_workerNavQueries[i]);
+		dtFreeObstacleAvoidanceQuery(m_workerObstacleQueries[i]);
+	}
+	dtFree(m_workerNavQueries);
+	m_workerNavQueries = 0;
+	dtFree(m_workerObstacleQueries);
+	m_workerObstacleQueries = 0;
+	dtFree(m_workerSampleCounts);
+	m_workerSampleCounts = 0;
+	m_numWorkers = 0;
+}
+
+/// @par
+///
+/// The navigation mesh query and the obstacle avoidance query are not thread safe, so every
+/// worker of the runner gets its own copy of them. The crowd must be initialized before calling
+/// this method. The runner is not owned by the crowd and must outlive it, or be reset to null
+/// before it is destroyed.
+///
+/// Each agent phase only writes to the agent being processed, so the result of #update() does
+/// not depend on the number of workers or on the way the runner partitions the agents.
+bool dtCrowd::setTaskRunner(dtCrowdTaskRunner* runner)
+{
+	purgeWorkers();
+	m_taskRunner = runner;
+	if (!m_navquery || !m_obstacleQuery)
+		return false;
+	
+	const int nworkers = runner ? dtMax(runner->getWorkerCount(), 1) : 1;
+	m_workerNavQueries = (dtNavMeshQuery**)dtAlloc(sizeof(dtNavMeshQuery*)*nworkers, DT_ALLOC_PERM);
+	if (!m_workerNavQueries)
+		return false;
+	m_workerObstacleQueries = (dtObstacleAvoidanceQuery**)dtAlloc(sizeof(dtObstacleAvoidanceQuery*)*nworkers, DT_ALLOC_PERM);
+	if (!m_workerObstacleQueries)
+		return false;
+	m_workerSampleCounts = (int*)dtAlloc(sizeof(int)*nworkers, DT_ALLOC_PERM);
+	if (!m_workerSampleCounts)
+		return false;
+	memset(m_workerNavQueries, 0, sizeof(dtNavMeshQuery*)*nworkers);
+	memset(m_workerObstacleQueries, 0, sizeof(dtObstacleAvoidanceQuery*)*nworkers);
+	memset(m_workerSampleCounts, 0, sizeof(int)*nworkers);
+	m_numWorkers = nworkers;
+	
+	m_workerNavQueries[0] = m_navquery;
+	m_workerObstacleQueries[0] = m_obstacleQuery;
+	for (int i = 1; i < nworkers; ++i)
+	{
+		m_workerNavQueries[i] = dtAllocNavMeshQuery();
+		if (!m_workerNavQueries[i])
+			return false;
+		if (dtStatusFailed(m_workerNavQueries[i]->init(m_navquery->getAttachedNavMesh(), MAX_COMMON_NODES)))
+			return false;
+		
+		m_workerObstacleQueries[i] = dtAllocObstacleAvoidanceQuery();
+		if (!m_workerObstacleQueries[i])
+			return false;
+		if (!m_workerObstacleQueries[i]->init(6, 8))
+			return false;
+	}
 	return true;
 }
 
@@ -1042,12 +1120,57 @@ void dtCrowd::checkPathValidity(dtCrowdAgent** agents, const int nagents, const
 	}
 }
 	
+
+enum CrowdUpdatePhase
+{
+	CROWD_PHASE_NEIGHBOURS,
+	CROWD_PHASE_CORNERS,
+	CROWD_PHASE_OFFMESH,
+	CROWD_PHASE_STEERING,
+	CROWD_PHASE_VELOCITY_PLANNING,
+	CROWD_PHASE_INTEGRATE,
+	CROWD_PHASE_COLLISION,
+	CROWD_PHASE_DISPLACE,
+	CROWD_PHASE_MOVE,
+};
+
+/// Runs one of the per-agent phases of dtCrowd::update() over a range of active agents.
+class dtCrowdUpdateTask : public dtCrowdTask
+{
+public:
+	dtCrowdUpdateTask(dtCrowd* crowd, dtCrowdAgent** agents, const int nagents,
+					  const float dt, dtCrowdAgentDebugInfo* debug) :
+		m_crowd(crowd), m_agents(agents), m_nagents(nagents), m_dt(dt), m_debug(debug), m_phase(0)
+	{
+	}
+	
+	void dispatch(const int phase)
+	{
+		m_phase = phase;
+		if (m_crowd->m_taskRunner && m_crowd->m_numWorkers > 1)
+			m_crowd->m_taskRunner->run(this, m_nagents);
+		else
+			run(0, 0, m_nagents);
+	}
+	
+	virtual void run(const int worker, const int begin, const int end)
+	{
+		m_crowd->updateAgents(m_phase, worker, begin, end, m_agents, m_nagents, m_dt, m_debug);
+	}
+	
+private:
+	dtCrowd* m_crowd;
+	dtCrowdAgent** m_agents;
+	int m_nagents;
+	float m_dt;
+	dtCrowdAgentDebugInfo* m_debug;
+	int m_phase;
+};
+
 void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 {
 	m_velocitySampleCount = 0;
 	
-	const int debugIdx = debug ? debug->idx : -1;
-	
 	dtCrowdAgent** agents = m_activeAgents;
 	int nagents = getActiveAgents(agents, m_maxAgents);
 
@@ -1070,377 +1193,388 @@ void dtCrowd::update(const float dt, dtCrowdAgentDebugInfo* debug)
 		m_grid->addItem((unsigned short)i, p[0]-r, p[2]-r, p[0]+r, p[2]+r);
 	}
 	
+	// The remaining phases only write to the agent being processed, and only read
+	// from other agents data which was completed by a previous phase.
+	dtCrowdUpdateTask task(this, agents, nagents, dt, debug);
+	
 	// Get nearby navmesh segments and agents to collide with.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
+	task.dispatch(CROWD_PHASE_NEIGHBOURS);
+	
+	// Find next corner to steer to.
+	task.dispatch(CROWD_PHASE_CORNERS);
+	
+	// Trigger off-mesh connections (depends on corners).
+	task.dispatch(CROWD_PHASE_OFFMESH);
+	
+	// Calculate steering.
+	task.dispatch(CROWD_PHASE_STEERING);
+	
+	// Velocity planning.
+	for (int i = 0; i < m_numWorkers; ++i)
+		m_workerSampleCounts[i] = 0;
+	task.dispatch(CROWD_PHASE_VELOCITY_PLANNING);
+	for (int i = 0; i < m_numWorkers; ++i)
+		m_velocitySampleCount += m_workerSampleCounts[i];
 
-		// Update the collision boundary after certain distance has been passed or
-		// if it has become invalid.
-		const float updateThr = ag->params.collisionQueryRange*0.25f;
-		if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
-			!ag->boundary.isValid(m_navquery, &m_filters[ag->params.queryFilterType]))
-		{
-			ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
-								m_navquery, &m_filters[ag->params.queryFilterType]);
-		}
-		// Query neighbour agents
-		ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
-								  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
-								  agents, nagents, m_grid);
-		for (int j = 0; j < ag->nneis; j++)
-			ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
+	// Integrate.
+	task.dispatch(CROWD_PHASE_INTEGRATE);
+	
+	// Handle collisions.
+	for (int iter = 0; iter < 4; ++iter)
+	{
+		task.dispatch(CROWD_PHASE_COLLISION);
+		task.dispatch(CROWD_PHASE_DISPLACE);
 	}
 	
-	// Find next corner to steer to.
-	for (int i = 0; i < nagents; ++i)
+	// Move along navmesh.
+	task.dispatch(CROWD_PHASE_MOVE);
+	
+	// Update agents using off-mesh connection.
+	for (int i = 0; i < m_maxAgents; ++i)
 	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
+		dtCrowdAgentAnimation* anim = &m_agentAnims[i];
+		if (!anim->active)
 			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+		dtCrowdAgent* ag = agents[i];
+
+		anim->t += dt;
+		if (anim->t > anim->tmax)
+		{
+			// Reset animation
+			anim->active = false;
+			// Prepare agent for walking.
+			ag->state = DT_CROWDAGENT_STATE_WALKING;
 			continue;
+		}
 		
-		// Find corners for steering
-		ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
-												DT_CROWDAGENT_MAX_CORNERS, m_navquery, &m_filters[ag->params.queryFilterType]);
-		
-		// Check to see if the corner after the next corner is directly visible,
-		// and short cut to there.
-		if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
+		// Update position
+		const float ta = anim->tmax*0.15f;
+		const float tb = anim->tmax;
+		if (anim->t < ta)
 		{
-			const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
-			ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, m_navquery, &m_filters[ag->params.queryFilterType]);
-			
-			// Copy data for debug purposes.
-			if (debugIdx == i)
-			{
-				dtVcopy(debug->optStart, ag->corridor.getPos());
-				dtVcopy(debug->optEnd, target);
-			}
+			const float u = tween(anim->t, 0.0, ta);
+			dtVlerp(ag->npos, anim->initPos, anim->startPos, u);
 		}
 		else
 		{
-			// Copy data for debug purposes.
-			if (debugIdx == i)
-			{
-				dtVset(debug->optStart, 0,0,0);
-				dtVset(debug->optEnd, 0,0,0);
-			}
+			const float u = tween(anim->t, ta, tb);
+			dtVlerp(ag->npos, anim->startPos, anim->endPos, u);
 		}
+			
+		// Update velocity.
+		dtVset(ag->vel, 0,0,0);
+		dtVset(ag->dvel, 0,0,0);
 	}
 	
-	// Trigger off-mesh connections (depends on corners).
-	for (int i = 0; i < nagents; ++i)
+}
+
+void dtCrowd::updateAgents(const int phase, const int worker, const int begin, const int end,
+						   dtCrowdAgent** agents, const int nagents, const float dt, dtCrowdAgentDebugInfo* debug)
+{
+	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
+	
+	const int debugIdx = debug ? debug->idx : -1;
+	dtNavMeshQuery* navquery = m_workerNavQueries[worker];
+	dtObstacleAvoidanceQuery* obstacleQuery = m_workerObstacleQueries[worker];
+	
+	for (int i = begin; i < end; ++i)
 	{
 		dtCrowdAgent* ag = agents[i];
-		
 		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
 			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-			continue;
 		
-		// Check 
-		const float triggerRadius = ag->params.radius*2.25f;
-		if (overOffmeshConnection(ag, triggerRadius))
+		switch (phase)
 		{
-			// Prepare to off-mesh connection.
-			const int idx = (int)(ag - m_agents);
-			dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
-			
-			// Adjust the path over the off-mesh connection.
-			dtPolyRef refs[2];
-			if (ag->corridor.moveOverOffmeshConnection(ag->cornerPolys[ag->ncorners-1], refs,
-													   anim->startPos, anim->endPos, m_navquery))
+		case CROWD_PHASE_NEIGHBOURS:
 			{
-				dtVcopy(anim->initPos, ag->npos);
-				anim->polyRef = refs[1];
-				anim->active = true;
-				anim->t = 0.0f;
-				anim->tmax = (dtVdist2D(anim->startPos, anim->endPos) / ag->params.maxSpeed) * 0.5f;
-				
-				ag->state = DT_CROWDAGENT_STATE_OFFMESH;
-				ag->ncorners = 0;
-				ag->nneis = 0;
-				continue;
-			}
-			else
-			{
-				// Path validity check will ensure that bad/blocked connections will be replanned.
+				// Update the collision boundary after certain distance has been passed or
+				// if it has become invalid.
+				const float updateThr = ag->params.collisionQueryRange*0.25f;
+				if (dtVdist2DSqr(ag->npos, ag->boundary.getCenter()) > dtSqr(updateThr) ||
+					!ag->boundary.isValid(navquery, &m_filters[ag->params.queryFilterType]))
+				{
+					ag->boundary.update(ag->corridor.getFirstPoly(), ag->npos, ag->params.collisionQueryRange,
+										navquery, &m_filters[ag->params.queryFilterType]);
+				}
+				// Query neighbour agents
+				ag->nneis = getNeighbours(ag->npos, ag->params.height, ag->params.collisionQueryRange,
+										  ag, ag->neis, DT_CROWDAGENT_MAX_NEIGHBOURS,
+										  agents, nagents, m_grid);
+				for (int j = 0; j < ag->nneis; j++)
+					ag->neis[j].idx = getAgentIndex(agents[ag->neis[j].idx]);
 			}
-		}
-	}
-		
-	// Calculate steering.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
-			continue;
-		
-		float dvel[3] = {0,0,0};
-
-		if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-		{
-			dtVcopy(dvel, ag->targetPos);
-			ag->desiredSpeed = dtVlen(ag->targetPos);
-		}
-		else
-		{
-			// Calculate steering direction.
-			if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
-				calcSmoothSteerDirection(ag, dvel);
-			else
-				calcStraightSteerDirection(ag, dvel);
-			
-			// Calculate speed scale, which tells the agent to slowdown at the end of the path.
-			const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
-			const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
-				
-			ag->desiredSpeed = ag->params.maxSpeed;
-			dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
-		}
-
-		// Separation
-		if (ag->params.updateFlags & DT_CROWD_SEPARATION)
-		{
-			const float separationDist = ag->params.collisionQueryRange; 
-			const float invSeparationDist = 1.0f / separationDist; 
-			const float separationWeight = ag->params.separationWeight;
-			
-			float w = 0;
-			float disp[3] = {0,0,0};
+			break;
 			
-			for (int j = 0; j < ag->nneis; ++j)
+		case CROWD_PHASE_CORNERS:
 			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
-				
-				const float distSqr = dtVlenSqr(diff);
-				if (distSqr < 0.00001f)
-					continue;
-				if (distSqr > dtSqr(separationDist))
+				if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
 					continue;
-				const float dist = dtMathSqrtf(distSqr);
-				const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
 				
-				dtVmad(disp, disp, diff, weight/dist);
-				w += 1.0f;
+				// Find corners for steering
+				ag->ncorners = ag->corridor.findCorners(ag->cornerVerts, ag->cornerFlags, ag->cornerPolys,
+														DT_CROWDAGENT_MAX_CORNERS, navquery, &m_filters[ag->params.queryFilterType]);
+				
+				// Check to see if the corner after the next corner is directly visible,
+				// and short cut to there.
+				if ((ag->params.updateFlags & DT_CROWD_OPTIMIZE_VIS) && ag->ncorners > 0)
+				{
+					const float* target = &ag->cornerVerts[dtMin(1,ag->ncorners-1)*3];
+					ag->corridor.optimizePathVisibility(target, ag->params.pathOptimizationRange, navquery, &m_filters[ag->params.queryFilterType]);
+					
+					// Copy data for debug purposes.
+					if (debugIdx == i)
+					{
+						dtVcopy(debug->optStart, ag->corridor.getPos());
+						dtVcopy(debug->optEnd, target);
+					}
+				}
+				else
+				{
+					// Copy data for debug purposes.
+					if (debugIdx == i)
+					{
+						dtVset(debug->optStart, 0,0,0);
+						dtVset(debug->optEnd, 0,0,0);
+					}
+				}
 			}
+			break;
 			
-			if (w > 0.0001f)
+		case CROWD_PHASE_OFFMESH:
 			{
-				// Adjust desired velocity.
-				dtVmad(dvel, dvel, disp, 1.0f/w);
-				// Clamp desired velocity to desired speed.
-				const float speedSqr = dtVlenSqr(dvel);
-				const float desiredSqr = dtSqr(ag->desiredSpeed);
-				if (speedSqr > desiredSqr)
-					dtVscale(dvel, dvel, desiredSqr/speedSqr);
+				if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+					continue;
+				
+				// Check 
+				const float triggerRadius = ag->params.radius*2.25f;
+				if (overOffmeshConnection(ag, triggerRadius))
+				{
+					// Prepare to off-mesh connection.
+					const int idx = (int)(ag - m_agents);
+					dtCrowdAgentAnimation* anim = &m_agentAnims[idx];
+					
+					// Adjust the path over the off-mesh connection.
+					dtPolyRef refs[2];
+					if (ag->corridor.moveOverOffmeshConnection(ag->cornerPolys[ag->ncorners-1], refs,
+															   anim->startPos, anim->endPos, navquery))
+					{
+						dtVcopy(anim->initPos, ag->npos);
+						anim->polyRef = refs[1];
+						anim->active = true;
+						anim->t = 0.0f;
+						anim->tmax = (dtVdist2D(anim->startPos, anim->endPos) / ag->params.maxSpeed) * 0.5f;
+						
+						ag->state = DT_CROWDAGENT_STATE_OFFMESH;
+						ag->ncorners = 0;
+						ag->nneis = 0;
+						continue;
+					}
+					else
+					{
+						// Path validity check will ensure that bad/blocked connections will be replanned.
+					}
+				}
 			}
-		}
-		
-		// Set the desired velocity.
-		dtVcopy(ag->dvel, dvel);
-	}
-	
-	// Velocity planning.	
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		
-		if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
-		{
-			m_obstacleQuery->reset();
+			break;
 			
-			// Add neighbours as obstacles.
-			for (int j = 0; j < ag->nneis; ++j)
+		case CROWD_PHASE_STEERING:
 			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				m_obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
-			}
-
-			// Append neighbour segments as obstacles.
-			for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
-			{
-				const float* s = ag->boundary.getSegment(j);
-				if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
+				if (ag->targetState == DT_CROWDAGENT_TARGET_NONE)
 					continue;
-				m_obstacleQuery->addSegment(s, s+3);
-			}
+				
+				float dvel[3] = {0,0,0};
 
-			dtObstacleAvoidanceDebugData* vod = 0;
-			if (debugIdx == i) 
-				vod = debug->vod;
-			
-			// Sample new safe velocity.
-			bool adaptive = true;
-			int ns = 0;
+				if (ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+				{
+					dtVcopy(dvel, ag->targetPos);
+					ag->desiredSpeed = dtVlen(ag->targetPos);
+				}
+				else
+				{
+					// Calculate steering direction.
+					if (ag->params.updateFlags & DT_CROWD_ANTICIPATE_TURNS)
+						calcSmoothSteerDirection(ag, dvel);
+					else
+						calcStraightSteerDirection(ag, dvel);
+					
+					// Calculate speed scale, which tells the agent to slowdown at the end of the path.
+					const float slowDownRadius = ag->params.radius*2;	// TODO: make less hacky.
+					const float speedScale = getDistanceToGoal(ag, slowDownRadius) / slowDownRadius;
+						
+					ag->desiredSpeed = ag->params.maxSpeed;
+					dtVscale(dvel, dvel, ag->desiredSpeed * speedScale);
+				}
 
-			const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
+				// Separation
+				if (ag->params.updateFlags & DT_CROWD_SEPARATION)
+				{
+					const float separationDist = ag->params.collisionQueryRange; 
+					const float invSeparationDist = 1.0f / separationDist; 
+					const float separationWeight = ag->params.separationWeight;
+					
+					float w = 0;
+					float disp[3] = {0,0,0};
+					
+					for (int j = 0; j < ag->nneis; ++j)
+					{
+						const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+						
+						float diff[3];
+						dtVsub(diff, ag->npos, nei->npos);
+						diff[1] = 0;
+						
+						const float distSqr = dtVlenSqr(diff);
+						if (distSqr < 0.00001f)
+							continue;
+						if (distSqr > dtSqr(separationDist))
+							continue;
+						const float dist = dtMathSqrtf(distSqr);
+						const float weight = separationWeight * (1.0f - dtSqr(dist*invSeparationDist));
+						
+						dtVmad(disp, disp, diff, weight/dist);
+						w += 1.0f;
+					}
+					
+					if (w > 0.0001f)
+					{
+						// Adjust desired velocity.
+						dtVmad(dvel, dvel, disp, 1.0f/w);
+						// Clamp desired velocity to desired speed.
+						const float speedSqr = dtVlenSqr(dvel);
+						const float desiredSqr = dtSqr(ag->desiredSpeed);
+						if (speedSqr > desiredSqr)
+							dtVscale(dvel, dvel, desiredSqr/speedSqr);
+					}
+				}
 				
-			if (adaptive)
-			{
-				ns = m_obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
-															 ag->vel, ag->dvel, ag->nvel, params, vod);
-			}
-			else
-			{
-				ns = m_obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
-														 ag->vel, ag->dvel, ag->nvel, params, vod);
+				// Set the desired velocity.
+				dtVcopy(ag->dvel, dvel);
 			}
-			m_velocitySampleCount += ns;
-		}
-		else
-		{
-			// If not using velocity planning, new velocity is directly the desired velocity.
-			dtVcopy(ag->nvel, ag->dvel);
-		}
-	}
-
-	// Integrate.
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		integrate(ag, dt);
-	}
-	
-	// Handle collisions.
-	static const float COLLISION_RESOLVE_FACTOR = 0.7f;
-	
-	for (int iter = 0; iter < 4; ++iter)
-	{
-		for (int i = 0; i < nagents; ++i)
-		{
-			dtCrowdAgent* ag = agents[i];
-			const int idx0 = getAgentIndex(ag);
+			break;
 			
-			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-				continue;
+		case CROWD_PHASE_VELOCITY_PLANNING:
+			{
+				if (ag->params.updateFlags & DT_CROWD_OBSTACLE_AVOIDANCE)
+				{
+					obstacleQuery->reset();
+					
+					// Add neighbours as obstacles.
+					for (int j = 0; j < ag->nneis; ++j)
+					{
+						const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+						obstacleQuery->addCircle(nei->npos, nei->params.radius, nei->vel, nei->dvel);
+					}
 
-			dtVset(ag->disp, 0,0,0);
-			
-			float w = 0;
+					// Append neighbour segments as obstacles.
+					for (int j = 0; j < ag->boundary.getSegmentCount(); ++j)
+					{
+						const float* s = ag->boundary.getSegment(j);
+						if (dtTriArea2D(ag->npos, s, s+3) < 0.0f)
+							continue;
+						obstacleQuery->addSegment(s, s+3);
+					}
 
-			for (int j = 0; j < ag->nneis; ++j)
-			{
-				const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
-				const int idx1 = getAgentIndex(nei);
+					dtObstacleAvoidanceDebugData* vod = 0;
+					if (debugIdx == i) 
+						vod = debug->vod;
+					
+					// Sample new safe velocity.
+					bool adaptive = true;
+					int ns = 0;
 
-				float diff[3];
-				dtVsub(diff, ag->npos, nei->npos);
-				diff[1] = 0;
-				
-				float dist = dtVlenSqr(diff);
-				if (dist > dtSqr(ag->params.radius + nei->params.radius))
-					continue;
-				dist = dtMathSqrtf(dist);
-				float pen = (ag->params.radius + nei->params.radius) - dist;
-				if (dist < 0.0001f)
-				{
-					// Agents on top of each other, try to choose diverging separation directions.
-					if (idx0 > idx1)
-						dtVset(diff, -ag->dvel[2],0,ag->dvel[0]);
+					const dtObstacleAvoidanceParams* params = &m_obstacleQueryParams[ag->params.obstacleAvoidanceType];
+						
+					if (adaptive)
+					{
+						ns = obstacleQuery->sampleVelocityAdaptive(ag->npos, ag->params.radius, ag->desiredSpeed,
+																   ag->vel, ag->dvel, ag->nvel, params, vod);
+					}
 					else
-						dtVset(diff, ag->dvel[2],0,-ag->dvel[0]);
-					pen = 0.01f;
+					{
+						ns = obstacleQuery->sampleVelocityGrid(ag->npos, ag->params.radius, ag->desiredSpeed,
+															   ag->vel, ag->dvel, ag->nvel, params, vod);
+					}
+					m_workerSampleCounts[worker] += ns;
 				}
 				else
 				{
-					pen = (1.0f/dist) * (pen*0.5f) * COLLISION_RESOLVE_FACTOR;
+					// If not using velocity planning, new velocity is directly the desired velocity.
+					dtVcopy(ag->nvel, ag->dvel);
 				}
-				
-				dtVmad(ag->disp, ag->disp, diff, pen);			
-				
-				w += 1.0f;
 			}
+			break;
+			
+		case CROWD_PHASE_INTEGRATE:
+			integrate(ag, dt);
+			break;
 			
-			if (w > 0.0001f)
+		case CROWD_PHASE_COLLISION:
 			{
-				const float iw = 1.0f / w;
-				dtVscale(ag->disp, ag->disp, iw);
+				const int idx0 = getAgentIndex(ag);
+				dtVset(ag->disp, 0,0,0);
+				
+				float w = 0;
+
+				for (int j = 0; j < ag->nneis; ++j)
+				{
+					const dtCrowdAgent* nei = &m_agents[ag->neis[j].idx];
+					const int idx1 = getAgentIndex(nei);
+
+					float diff[3];
+					dtVsub(diff, ag->npos, nei->npos);
+					diff[1] = 0;
+					
+					float dist = dtVlenSqr(diff);
+					if (dist > dtSqr(ag->params.radius + nei->params.radius))
+						continue;
+					dist = dtMathSqrtf(dist);
+					float pen = (ag->params.radius + nei->params.radius) - dist;
+					if (dist < 0.0001f)
+					{
+						// Agents on top of each other, try to choose diverging separation directions.
+						if (idx0 > idx1)
+							dtVset(diff, -ag->dvel[2],0,ag->dvel[0]);
+						else
+							dtVset(diff, ag->dvel[2],0,-ag->dvel[0]);
+						pen = 0.01f;
+					}
+					else
+					{
+						pen = (1.0f/dist) * (pen*0.5f) * COLLISION_RESOLVE_FACTOR;
+					}
+					
+					dtVmad(ag->disp, ag->disp, diff, pen);			
+					
+					w += 1.0f;
+				}
+				
+				if (w > 0.0001f)
+				{
+					const float iw = 1.0f / w;
+					dtVscale(ag->disp, ag->disp, iw);
+				}
 			}
-		}
-		
-		for (int i = 0; i < nagents; ++i)
-		{
-			dtCrowdAgent* ag = agents[i];
-			if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-				continue;
+			break;
 			
+		case CROWD_PHASE_DISPLACE:
 			dtVadd(ag->npos, ag->npos, ag->disp);
-		}
-	}
-	
-	for (int i = 0; i < nagents; ++i)
-	{
-		dtCrowdAgent* ag = agents[i];
-		if (ag->state != DT_CROWDAGENT_STATE_WALKING)
-			continue;
-		
-		// Move along navmesh.
-		ag->corridor.movePosition(ag->npos, m_navquery, &m_filters[ag->params.queryFilterType]);
-		// Get valid constrained position back.
-		dtVcopy(ag->npos, ag->corridor.getPos());
-
-		// If not using path, truncate the corridor to just one poly.
-		if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
-		{
-			ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
-			ag->partial = false;
-		}
-
-	}
-	
-	// Update agents using off-mesh connection.
-	for (int i = 0; i < m_maxAgents; ++i)
-	{
-		dtCrowdAgentAnimation* anim = &m_agentAnims[i];
-		if (!anim->active)
-			continue;
-		dtCrowdAgent* ag = agents[i];
+			break;
+			
+		case CROWD_PHASE_MOVE:
+			{
+				// Move along navmesh.
+				ag->corridor.movePosition(ag->npos, navquery, &m_filters[ag->params.queryFilterType]);
+				// Get valid constrained position back.
+				dtVcopy(ag->npos, ag->corridor.getPos());
 
-		anim->t += dt;
-		if (anim->t > anim->tmax)
-		{
-			// Reset animation
-			anim->active = false;
-			// Prepare agent for walking.
-			ag->state = DT_CROWDAGENT_STATE_WALKING;
-			continue;
-		}
-		
-		// Update position
-		const float ta = anim->tmax*0.15f;
-		const float tb = anim->tmax;
-		if (anim->t < ta)
-		{
-			const float u = tween(anim->t, 0.0, ta);
-			dtVlerp(ag->npos, anim->initPos, anim->startPos, u);
-		}
-		else
-		{
-			const float u = tween(anim->t, ta, tb);
-			dtVlerp(ag->npos, anim->startPos, anim->endPos, u);
+				// If not using path, truncate the corridor to just one poly.
+				if (ag->targetState == DT_CROWDAGENT_TARGET_NONE || ag->targetState == DT_CROWDAGENT_TARGET_VELOCITY)
+				{
+					ag->corridor.reset(ag->corridor.getFirstPoly(), ag->npos);
+					ag->partial = false;
+				}
+			}
+			break;
 		}
-			
-		// Update velocity.
-		dtVset(ag->vel, 0,0,0);
-		dtVset(ag->dvel, 0,0,0);
 	}
-	
 }
@@ -198,6 +198,38 @@ struct dtCrowdAgentDebugInfo
 	dtObstacleAvoidanceDebugData* vod;
 };
 
+/// A batch of independent per-agent work submitted by the crowd to a #dtCrowdTaskRunner.
+/// @ingroup crowd
+class dtCrowdTask
+{
+public:
+	virtual ~dtCrowdTask() {}
+
+	/// Processes the items in the range [@p begin, @p end).
+	///  @param[in]		worker	The index of the worker running the range. [Limits: 0 <= value < dtCrowdTaskRunner::getWorkerCount()]
+	///  @param[in]		begin	The first item to process.
+	///  @param[in]		end		One past the last item to process.
+	virtual void run(const int worker, const int begin, const int end) = 0;
+};
+
+/// Runs the per-agent phases of #dtCrowd::update() on several threads.
+/// @ingroup crowd
+/// @see dtCrowd::setTaskRunner()
+class dtCrowdTaskRunner
+{
+public:
+	virtual ~dtCrowdTaskRunner() {}
+
+	/// The number of workers used by the runner, including the calling thread.
+	/// @return The number of workers. [Limit: >= 1]
+	virtual int getWorkerCount() const = 0;
+
+	/// Runs the task over the items [0, @p count) and returns when all of them are processed.
+	///  @param[in]		task	The task to run.
+	///  @param[in]		count	The number of items.
+	virtual void run(dtCrowdTask* task, const int count) = 0;
+};
+
 /// Provides local steering behaviors for a group of agents. 
 /// @ingroup crowd
 class dtCrowd
@@ -227,6 +259,17 @@ class dtCrowd
 
 	dtNavMeshQuery* m_navquery;
 
+	dtCrowdTaskRunner* m_taskRunner;
+	int m_numWorkers;
+	dtNavMeshQuery** m_workerNavQueries;
+	dtObstacleAvoidanceQuery** m_workerObstacleQueries;
+	int* m_workerSampleCounts;
+
+	friend class dtCrowdUpdateTask;
+	void updateAgents(const int phase, const int worker, const int begin, const int end,
+					  dtCrowdAgent** agents, const int nagents, const float dt, dtCrowdAgentDebugInfo* debug);
+	void purgeWorkers();
+
 	void updateTopologyOptimization(dtCrowdAgent** agents, const int nagents, const float dt);
 	void updateMoveRequest(const float dt);
 	void checkPathValidity(dtCrowdAgent** agents, const int nagents, const float dt);
@@ -258,7 +301,16 @@ public:
 	///							[Limits:  0 <= value < #DT_CROWD_MAX_OBSTAVOIDANCE_PARAMS]
 	/// @return The requested configuration.
 	const dtObstacleAvoidanceParams* getObstacleAvoidanceParams(const int idx) const;
-	
+
+	/// Sets the runner used to distribute the per-agent update phases over several threads.
+	///  @param[in]		runner	The task runner, or null to update all agents on the calling thread.
+	/// @return True if the per-worker queries could be allocated.
+	bool setTaskRunner(dtCrowdTaskRunner* runner);
+
+	/// Gets the runner used to distribute the per-agent update phases.
+	/// @return The task runner, or null if the crowd is updated serially.
+	dtCrowdTaskRunner* getTaskRunner() const { return m_taskRunner; }
+
 	/// Gets the specified agent from the pool.
 	///	 @param[in]		idx		The agent index. [Limits: 0 <= value < #getAgentCount()]
 	/// @return The requested agent.
@@ -104,7 +104,7 @@ void GeometryDataCollector::apply( osg::Geode& node )
 RecastManager::RecastManager( const osg::Matrix& matrix )
 :   _chunkyMesh(NULL), _mesh(NULL), _detailMesh(NULL),
     _navMesh(NULL), _navQuery(NULL), _crowd(NULL),
-    _agentHeight(2.0f), _agentRadius(0.6f), _agentMaxClimb(0.9f)
+    _agentHeight(2.0f), _agentRadius(0.6f), _agentMaxClimb(0.9f), _numCrowdThreads(1)
 {
     _globalOffset = matrix;
     _globalOffsetInv = osg::Matrix::inverse(matrix);
@@ -325,9 +325,20 @@ bool RecastManager::buildScene( osg::Node* node, int maxAgents, int chunkSize )
         return false;
     }
     
+    // Distribute agent updates to worker threads
+    if ( _crowdWorkers.valid() && !_crowd->setTaskRunner(_crowdWorkers.get()) )
+    {
+        OSG_NOTICE << "[RecastManager] Could not initialize crowd worker threads" << std::endl;
+        return false;
+    }
+    
     // Make polygons with 'disabled' flag invalid
     _crowd->getEditableFilter(0)->setExcludeFlags( POLYFLAGS_DISABLED );
     
+    // Batched path queries share the crowd filter and worker threads
+    _pathService = new RecastPathService( _navMesh, _crowd->getFilter(0), _crowd->getQueryExtents(),
+                                          _crowdWorkers.get(), _globalOffset );
+    
     // Setup local avoidance params to different qualities
     {
         dtObstacleAvoidanceParams params;
@@ -356,6 +367,32 @@ bool RecastManager::buildScene( osg::Node* node, int maxAgents, int chunkSize )
     return true;
 }
 
+void RecastManager::setNumCrowdThreads( int num )
+{
+    _numCrowdThreads = osg::maximum(num, 1);
+    if ( _crowd ) _crowd->setTaskRunner( NULL );
+    _crowdWorkers = _numCrowdThreads>1 ? new RecastWorkerPool(_numCrowdThreads) : NULL;
+    if ( _crowd && _crowdWorkers.valid() && !_crowd->setTaskRunner(_crowdWorkers.get()) )
+    {
+        OSG_NOTICE << "[RecastManager] Could not initialize crowd worker threads, "
+                   << "updating agents on the calling thread" << std::endl;
+        _crowdWorkers = NULL;
+        _crowd->setTaskRunner( NULL );
+    }
+    
+    if ( _pathService.valid() )
+    {
+        // Running queries are bound to the old pool, so report them as failed to be issued again
+        osg::ref_ptr<RecastPathService> oldService = _pathService;
+        _pathService = new RecastPathService( _navMesh, _crowd->getFilter(0), _crowd->getQueryExtents(),
+                                              _crowdWorkers.get(), _globalOffset );
+        _pathService->setTimeBudget( oldService->getTimeBudget() );
+        _pathService->setIterationsPerSlice( oldService->getIterationsPerSlice() );
+        _pathService->setMaxPathLength( oldService->getMaxPathLength() );
+        oldService->cancel();
+    }
+}
+
 void RecastManager::destroy( bool includeGeom )
 {
     if ( includeGeom )
@@ -364,6 +401,7 @@ void RecastManager::destroy( bool includeGeom )
         _chunkyMesh = NULL;
     }
     
+    _pathService = NULL;
     rcFreePolyMesh(_mesh); _mesh = NULL;
     rcFreePolyMeshDetail(_detailMesh); _detailMesh = NULL;
     dtFreeNavMesh(_navMesh); _navMesh = NULL;
@@ -375,6 +413,7 @@ void RecastManager::update( float deltaTime )
 {
     if ( !_navMesh || !_crowd ) return;
     _crowd->update( deltaTime, NULL );
+    if ( _pathService.valid() ) _pathService->update();
     
     for ( AgentDataMap::iterator itr=_agentMap.begin();
           itr!=_agentMap.end(); ++itr )
@@ -450,3 +489,20 @@ void RecastManager::moveTo( const osg::Vec3f& pos, osg::MatrixTransform* node )
             _crowd->requestMoveTarget( itr->second.id, targetRef, targetPos );
     }
 }
+
+static float randomFloat()
+{
+    return (float)rand() / (float)RAND_MAX;
+}
+
+bool RecastManager::getRandomPoint( osg::Vec3f& pos )
+{
+    if ( !_navQuery || !_crowd ) return false;
+    dtPolyRef ref;
+    float pt[3];
+    dtStatus status = _navQuery->findRandomPoint( _crowd->getFilter(0), randomFloat, &ref, pt );
+    if ( dtStatusFailed(status) ) return false;
+    
+    pos = osg::Vec3(pt[0], pt[1], pt[2]) * _globalOffsetInv;
+    return true;
+}
@@ -7,6 +7,8 @@
 #include "Recast/DetourNavMeshBuilder.h"
 #include "Recast/DetourCrowd.h"
 #include "ChunkyTriMesh.h"
+#include "RecastWorkerPool.h"
+#include "RecastPathService.h"
 #include <osg/MatrixTransform>
 
 class RecastManager : public osg::Referenced
@@ -28,6 +30,11 @@ public:
     /** Build new navigation scene from node, all configurations should be done before this method */
     bool buildScene( osg::Node* node, int maxAgents=128, int chunkSize=256 );
     
+    /** Set number of threads updating the crowd agents (1 = no worker threads).
+        Path requests not yet finished are reported to their callbacks as failed */
+    void setNumCrowdThreads( int num );
+    int getNumCrowdThreads() const { return _numCrowdThreads; }
+    
     /** Destroy current scene */
     void destroy( bool includeGeom );
     
@@ -44,6 +51,12 @@ public:
     /** Move specified agent (or NULL for all) to position */
     void moveTo( const osg::Vec3f& pos, osg::MatrixTransform* node=NULL );
     
+    /** Get the service for batched asynchronous path queries, which is updated in update() */
+    RecastPathService* getPathService() { return _pathService.get(); }
+    
+    /** Get a random position on the navigation mesh */
+    bool getRandomPoint( osg::Vec3f& pos );
+    
 protected:
     virtual ~RecastManager();
     
@@ -55,9 +68,12 @@ protected:
     dtNavMesh* _navMesh;
     dtNavMeshQuery* _navQuery;
     dtCrowd* _crowd;
+    osg::ref_ptr<RecastWorkerPool> _crowdWorkers;
+    osg::ref_ptr<RecastPathService> _pathService;
     osg::Matrix _globalOffset, _globalOffsetInv;
     float _meshBoundMin[3], _meshBoundMax[3];
     float _agentHeight, _agentRadius, _agentMaxClimb;
+    int _numCrowdThreads;
     
     struct AgentData
     {
@@ -0,0 +1,302 @@
+#include <float.h>
+#include <algorithm>
+#include "Recast/DetourCommon.h"
+#include "RecastPathService.h"
+
+namespace
+{
+
+struct LessRequestID
+{
+    template<typename T>
+    bool operator()( const T* lhs, const T* rhs ) const
+    { return lhs->result.id < rhs->result.id; }
+};
+
+}
+
+void RecastPathService::SliceTask::run( const int worker, const int begin, const int end )
+{
+    for ( int i=begin; i<end; ++i )
+        _service->processSlot( _service->_slots[i], _deadline );
+}
+
+/* RecastPathService */
+
+RecastPathService::RecastPathService( const dtNavMesh* navMesh, const dtQueryFilter* filter, const float* extents,
+                                      RecastWorkerPool* workers, const osg::Matrix& globalOffset, int maxNodes )
+:   _workers(workers), _filter(filter), _timeBudget(1.0),
+    _iterationsPerSlice(32), _maxPathLength(256), _nextID(0)
+{
+    _globalOffset = globalOffset;
+    _globalOffsetInv = osg::Matrix::inverse(globalOffset);
+    for ( int i=0; i<3; ++i ) _extents[i] = extents[i];
+    
+    // Each slot keeps its own query object, as a sliced query may last for several frames
+    _slots.resize( workers ? workers->getWorkerCount() : 1 );
+    for ( unsigned int i=0; i<_slots.size(); ++i )
+    {
+        _slots[i].query = dtAllocNavMeshQuery();
+        if ( dtStatusFailed(_slots[i].query->init(navMesh, maxNodes)) )
+            OSG_NOTICE << "[RecastPathService] Could not initialize Detour navmesh query" << std::endl;
+    }
+}
+
+RecastPathService::~RecastPathService()
+{
+    clear();
+    for ( unsigned int i=0; i<_slots.size(); ++i )
+        dtFreeNavMeshQuery( _slots[i].query );
+}
+
+unsigned int RecastPathService::addRequest( const Request& request )
+{
+    PendingRequest* pr = new PendingRequest;
+    pr->request = request;
+    pr->result.id = _nextID++;
+    pr->result.type = request.type;
+    pr->result.status = 0;
+    pr->result.hitParameter = FLT_MAX;
+    pr->result.userData = request.userData;
+    pr->startRef = pr->endRef = 0;
+    
+    osg::Vec3f start = request.start * _globalOffset, end = request.end * _globalOffset;
+    for ( int i=0; i<3; ++i )
+    {
+        pr->startPos[i] = start[i];
+        pr->endPos[i] = end[i];
+    }
+    _pending.push_back( pr );
+    return pr->result.id;
+}
+
+unsigned int RecastPathService::addRequests( const std::vector<Request>& requests )
+{
+    unsigned int firstID = _nextID;
+    _pending.reserve( _pending.size() + requests.size() );
+    for ( unsigned int i=0; i<requests.size(); ++i )
+        addRequest( requests[i] );
+    return firstID;
+}
+
+void RecastPathService::clear()
+{
+    for ( unsigned int i=0; i<_pending.size(); ++i )
+        delete _pending[i];
+    _pending.clear();
+    _nextPending.exchange( 0 );
+    
+    for ( unsigned int i=0; i<_slots.size(); ++i )
+    {
+        Slot& slot = _slots[i];
+        for ( unsigned int j=0; j<slot.finished.size(); ++j )
+            delete slot.finished[j];
+        slot.finished.clear();
+        
+        // The query object still keeps the sliced state, but it is reset by next initSlicedFindPath()
+        delete slot.current;
+        slot.current = NULL;
+    }
+}
+
+unsigned int RecastPathService::getNumPendingRequests() const
+{
+    unsigned int num = _pending.size();
+    for ( unsigned int i=0; i<_slots.size(); ++i )
+    {
+        if ( _slots[i].current ) num++;
+    }
+    return num;
+}
+
+void RecastPathService::update()
+{
+    osg::Timer* timer = osg::Timer::instance();
+    osg::Timer_t deadline = timer->tick() + (osg::Timer_t)(_timeBudget * 0.001 / timer->getSecondsPerTick());
+    
+    SliceTask task( this, deadline );
+    if ( _workers.valid() )
+        _workers->run( &task, _slots.size() );
+    else
+        task.run( 0, 0, _slots.size() );
+    
+    // Remove requests taken by the slots
+    unsigned int numTaken = osg::minimum( (unsigned int)_nextPending.exchange(0), (unsigned int)_pending.size() );
+    _pending.erase( _pending.begin(), _pending.begin() + numTaken );
+    
+    std::vector<PendingRequest*> finished;
+    for ( unsigned int i=0; i<_slots.size(); ++i )
+    {
+        Slot& slot = _slots[i];
+        finished.insert( finished.end(), slot.finished.begin(), slot.finished.end() );
+        slot.finished.clear();
+    }
+    deliverResults( finished );
+}
+
+void RecastPathService::cancel()
+{
+    std::vector<PendingRequest*> finished;
+    for ( unsigned int i=0; i<_slots.size(); ++i )
+    {
+        Slot& slot = _slots[i];
+        finished.insert( finished.end(), slot.finished.begin(), slot.finished.end() );
+        slot.finished.clear();
+        if ( slot.current )
+        {
+            slot.current->result.status = DT_FAILURE;
+            finished.push_back( slot.current );
+            slot.current = NULL;
+        }
+    }
+    
+    for ( unsigned int i=0; i<_pending.size(); ++i )
+    {
+        _pending[i]->result.status = DT_FAILURE;
+        finished.push_back( _pending[i] );
+    }
+    _pending.clear();
+    _nextPending.exchange( 0 );
+    deliverResults( finished );
+}
+
+void RecastPathService::deliverResults( std::vector<PendingRequest*>& finished )
+{
+    // Deliver results in the order of submission, regardless of the slot which executed them
+    std::sort( finished.begin(), finished.end(), LessRequestID() );
+    for ( unsigned int i=0; i<finished.size(); ++i )
+    {
+        PendingRequest* pr = finished[i];
+        if ( pr->request.callback.valid() )
+            (*pr->request.callback)( pr->result );
+        delete pr;
+    }
+}
+
+RecastPathService::PendingRequest* RecastPathService::takeNextRequest()
+{
+    unsigned int index = ++_nextPending - 1;
+    return index<_pending.size() ? _pending[index] : NULL;
+}
+
+void RecastPathService::processSlot( Slot& slot, osg::Timer_t deadline )
+{
+    osg::Timer* timer = osg::Timer::instance();
+    while ( timer->tick()<deadline )
+    {
+        if ( !slot.current )
+        {
+            PendingRequest* pr = takeNextRequest();
+            if ( !pr ) break;
+            if ( !beginRequest(slot, pr) ) continue;
+        }
+        
+        // Shorten the slice to the time left, so that a large slice doesn't overshoot the deadline
+        osg::Timer_t start = timer->tick();
+        if ( start>=deadline ) break;
+        
+        int iterations = _iterationsPerSlice;
+        if ( slot.ticksPerIteration>0.0 )
+        {
+            double affordable = (double)(deadline - start) / slot.ticksPerIteration;
+            iterations = (int)osg::clampBetween( affordable, 1.0, (double)_iterationsPerSlice );
+        }
+        
+        int doneIterations = 0;
+        dtStatus status = slot.query->updateSlicedFindPath( iterations, &doneIterations );
+        if ( doneIterations>0 )
+            slot.ticksPerIteration = (double)(timer->tick() - start) / doneIterations;
+        if ( !dtStatusInProgress(status) )
+        {
+            slot.current->result.status = status;
+            finishRequest( slot, slot.current );
+            slot.current = NULL;
+        }
+    }
+}
+
+bool RecastPathService::beginRequest( Slot& slot, PendingRequest* pr )
+{
+    Result& result = pr->result;
+    float nearestPos[3];
+    result.status = slot.query->findNearestPoly( pr->startPos, _extents, _filter, &(pr->startRef), nearestPos );
+    if ( dtStatusFailed(result.status) || !pr->startRef )
+    {
+        result.status = DT_FAILURE | DT_INVALID_PARAM;
+        slot.finished.push_back( pr );
+        return false;
+    }
+    dtVcopy( pr->startPos, nearestPos );
+    
+    if ( pr->request.type==RAYCAST )
+    {
+        // Raycasts are cheap and not sliced, so finish them at once
+        float hitNormal[3];
+        int pathCount = 0;
+        slot.pathBuffer.resize( _maxPathLength );
+        result.status = slot.query->raycast( pr->startRef, pr->startPos, pr->endPos, _filter,
+                                             &result.hitParameter, hitNormal,
+                                             &(slot.pathBuffer[0]), &pathCount, _maxPathLength );
+        result.polys.assign( slot.pathBuffer.begin(), slot.pathBuffer.begin() + pathCount );
+        
+        float t = osg::minimum(result.hitParameter, 1.0f);
+        osg::Vec3f start(pr->startPos[0], pr->startPos[1], pr->startPos[2]);
+        osg::Vec3f end(pr->endPos[0], pr->endPos[1], pr->endPos[2]);
+        result.points.push_back( (start + (end - start) * t) * _globalOffsetInv );
+        slot.finished.push_back( pr );
+        return false;
+    }
+    
+    result.status = slot.query->findNearestPoly( pr->endPos, _extents, _filter, &(pr->endRef), nearestPos );
+    if ( dtStatusFailed(result.status) || !pr->endRef )
+    {
+        result.status = DT_FAILURE | DT_INVALID_PARAM;
+        slot.finished.push_back( pr );
+        return false;
+    }
+    dtVcopy( pr->endPos, nearestPos );
+    
+    result.status = slot.query->initSlicedFindPath( pr->startRef, pr->endRef, pr->startPos, pr->endPos, _filter );
+    if ( dtStatusFailed(result.status) )
+    {
+        slot.finished.push_back( pr );
+        return false;
+    }
+    slot.current = pr;
+    return true;
+}
+
+void RecastPathService::finishRequest( Slot& slot, PendingRequest* pr )
+{
+    Result& result = pr->result;
+    slot.finished.push_back( pr );
+    if ( dtStatusFailed(result.status) ) return;
+    
+    int pathCount = 0;
+    slot.pathBuffer.resize( _maxPathLength );
+    result.status = slot.query->finalizeSlicedFindPath( &(slot.pathBuffer[0]), &pathCount, _maxPathLength );
+    if ( dtStatusFailed(result.status) ) return;
+    result.polys.assign( slot.pathBuffer.begin(), slot.pathBuffer.begin() + pathCount );
+    
+    if ( pr->request.type==STRAIGHT_PATH && pathCount>0 )
+    {
+        // Clamp the end position to the last polygon, in case of a partial path
+        float endPos[3];
+        dtVcopy( endPos, pr->endPos );
+        if ( slot.pathBuffer[pathCount-1]!=pr->endRef )
+            slot.query->closestPointOnPoly( slot.pathBuffer[pathCount-1], pr->endPos, endPos, NULL );
+        
+        int numPoints = 0;
+        slot.pointBuffer.resize( _maxPathLength * 3 );
+        dtStatus status = slot.query->findStraightPath( pr->startPos, endPos, &(slot.pathBuffer[0]), pathCount,
+                                                        &(slot.pointBuffer[0]), NULL, NULL,
+                                                        &numPoints, _maxPathLength );
+        if ( dtStatusFailed(status) ) { result.status = status; return; }
+        
+        for ( int i=0; i<numPoints; ++i )
+        {
+            const float* p = &(slot.pointBuffer[i * 3]);
+            result.points.push_back( osg::Vec3f(p[0], p[1], p[2]) * _globalOffsetInv );
+        }
+    }
+}
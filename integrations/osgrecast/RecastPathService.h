@@ -0,0 +1,140 @@
+#ifndef H_RECASTPATHSERVICE
+#define H_RECASTPATHSERVICE
+
+#include "Recast/DetourNavMesh.h"
+#include "Recast/DetourNavMeshQuery.h"
+#include "RecastWorkerPool.h"
+#include <osg/Matrix>
+#include <osg/Timer>
+#include <vector>
+
+/** Batched path queries, executed as sliced queries on a pool of dtNavMeshQuery objects */
+class RecastPathService : public osg::Referenced
+{
+public:
+    enum RequestType
+    {
+        FIND_PATH,       // Polygon corridor from start to end
+        STRAIGHT_PATH,   // Polygon corridor and its straight path points
+        RAYCAST          // Walkability ray from start towards end
+    };
+
+    struct Result
+    {
+        unsigned int id;
+        RequestType type;
+        dtStatus status;
+        std::vector<dtPolyRef> polys;
+        std::vector<osg::Vec3f> points;  // Straight path points, or the hit point of a raycast
+        float hitParameter;              // Raycast only: FLT_MAX if the end position was reached
+        void* userData;
+
+        bool succeeded() const { return dtStatusSucceed(status); }
+    };
+
+    /** Called from update() for every finished request. Results finished in the same update() are
+        reported in order of submission, but a short request may overtake a longer one issued before it */
+    struct ResultCallback : public osg::Referenced
+    {
+        virtual void operator()( const Result& result ) = 0;
+    };
+
+    struct Request
+    {
+        Request( RequestType t=FIND_PATH ) : type(t), userData(NULL) {}
+        RequestType type;
+        osg::Vec3f start, end;
+        osg::ref_ptr<ResultCallback> callback;
+        void* userData;
+    };
+
+    /** The navigation mesh and the filter must outlive the service. Positions are transformed by
+        globalOffset before querying and by its inverse when reporting results, as in RecastManager */
+    RecastPathService( const dtNavMesh* navMesh, const dtQueryFilter* filter, const float* extents,
+                       RecastWorkerPool* workers=NULL, const osg::Matrix& globalOffset=osg::Matrix(),
+                       int maxNodes=2048 );
+
+    /** Queue a single request and return its ID */
+    unsigned int addRequest( const Request& request );
+
+    /** Queue a batch of requests and return the ID of the first one; IDs of a batch are contiguous */
+    unsigned int addRequests( const std::vector<Request>& requests );
+
+    /** Discard all waiting and running requests without calling their callbacks */
+    void clear();
+
+    /** Report all waiting and running requests to their callbacks as failed, and deliver finished ones */
+    void cancel();
+
+    /** Time budget (in milliseconds) that every worker may spend in one update() call */
+    void setTimeBudget( double ms ) { _timeBudget = ms; }
+    double getTimeBudget() const { return _timeBudget; }
+
+    /** Maximum number of A* iterations between two checks of the time budget; fewer are run
+        when the remaining budget of the update() wouldn't cover a full slice */
+    void setIterationsPerSlice( int num ) { _iterationsPerSlice = num; }
+    int getIterationsPerSlice() const { return _iterationsPerSlice; }
+
+    /** Maximum number of polygons / points in a result */
+    void setMaxPathLength( int num ) { _maxPathLength = num; }
+    int getMaxPathLength() const { return _maxPathLength; }
+
+    unsigned int getNumPendingRequests() const;
+
+    /** Advance the queries with the time budget, and deliver finished results via callbacks */
+    void update();
+
+protected:
+    virtual ~RecastPathService();
+
+    struct PendingRequest
+    {
+        Request request;
+        Result result;
+        dtPolyRef startRef, endRef;
+        float startPos[3], endPos[3];
+    };
+
+    /** One query object and the sliced request running on it */
+    struct Slot
+    {
+        Slot() : query(NULL), current(NULL), ticksPerIteration(0.0) {}
+        dtNavMeshQuery* query;
+        PendingRequest* current;
+        double ticksPerIteration;  // Measured cost of the last slice, to fit slices into the budget
+        std::vector<PendingRequest*> finished;
+        std::vector<dtPolyRef> pathBuffer;
+        std::vector<float> pointBuffer;
+    };
+
+    class SliceTask : public dtCrowdTask
+    {
+    public:
+        SliceTask( RecastPathService* s, osg::Timer_t deadline ) : _service(s), _deadline(deadline) {}
+        virtual void run( const int worker, const int begin, const int end );
+
+    protected:
+        RecastPathService* _service;
+        osg::Timer_t _deadline;
+    };
+    friend class SliceTask;
+
+    PendingRequest* takeNextRequest();
+    void deliverResults( std::vector<PendingRequest*>& finished );
+    void processSlot( Slot& slot, osg::Timer_t deadline );
+    bool beginRequest( Slot& slot, PendingRequest* pr );
+    void finishRequest( Slot& slot, PendingRequest* pr );
+
+    std::vector<Slot> _slots;
+    std::vector<PendingRequest*> _pending;
+    OpenThreads::Atomic _nextPending;
+    osg::ref_ptr<RecastWorkerPool> _workers;
+    const dtQueryFilter* _filter;
+    float _extents[3];
+    osg::Matrix _globalOffset, _globalOffsetInv;
+    double _timeBudget;
+    int _iterationsPerSlice, _maxPathLength;
+    unsigned int _nextID;
+};
+
+#endif
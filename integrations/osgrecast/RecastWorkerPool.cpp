@@ -0,0 +1,79 @@
+#include <osg/Math>
+#include "RecastWorkerPool.h"
+
+void RecastWorkerPool::WorkerThread::run()
+{
+    while ( true )
+    {
+        _pool->_startBarrier.block();
+        if ( _pool->_done ) break;
+
+        _pool->runChunks( _index );
+        _pool->_endBarrier.block();
+    }
+}
+
+/* RecastWorkerPool */
+
+RecastWorkerPool::RecastWorkerPool( int numWorkers )
+:   _startBarrier(numWorkers>1 ? numWorkers : 1), _endBarrier(numWorkers>1 ? numWorkers : 1),
+    _task(NULL), _count(0), _chunkSize(1), _done(false)
+{
+    for ( int i=1; i<numWorkers; ++i )
+    {
+        WorkerThread* thread = new WorkerThread( this, i );
+        thread->start();
+        _threads.push_back( thread );
+    }
+}
+
+RecastWorkerPool::~RecastWorkerPool()
+{
+    if ( !_threads.empty() )
+    {
+        // Release all waiting threads with the quit flag set
+        _done = true;
+        _startBarrier.block();
+    }
+
+    for ( unsigned int i=0; i<_threads.size(); ++i )
+    {
+        _threads[i]->join();
+        delete _threads[i];
+    }
+}
+
+void RecastWorkerPool::run( dtCrowdTask* task, const int count )
+{
+    if ( !task || count<=0 ) return;
+    if ( _threads.empty() )
+    {
+        task->run( 0, 0, count );
+        return;
+    }
+
+    // Use small chunks so that workers with cheap agents can steal the remaining ones;
+    // the result never depends on which worker processes a chunk
+    int numWorkers = getWorkerCount();
+    _task = task;
+    _count = count;
+    _chunkSize = osg::maximum(count / (numWorkers * 8), 1);
+    _nextChunk.exchange( 0 );
+
+    _startBarrier.block();
+    runChunks( 0 );
+    _endBarrier.block();
+    _task = NULL;
+}
+
+void RecastWorkerPool::runChunks( int worker )
+{
+    while ( true )
+    {
+        int begin = (int)(++_nextChunk - 1) * _chunkSize;
+        if ( begin>=_count ) break;
+
+        int end = osg::minimum(begin + _chunkSize, _count);
+        _task->run( worker, begin, end );
+    }
+}
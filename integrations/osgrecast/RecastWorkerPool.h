@@ -0,0 +1,51 @@
+#ifndef H_RECASTWORKERPOOL
+#define H_RECASTWORKERPOOL
+
+#include "Recast/DetourCrowd.h"
+#include <osg/Referenced>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Barrier>
+#include <OpenThreads/Atomic>
+#include <vector>
+
+/** A fixed pool of threads executing Detour crowd tasks. The calling thread works as worker 0 */
+class RecastWorkerPool : public osg::Referenced, public dtCrowdTaskRunner
+{
+public:
+    /** Create the pool with specified number of workers, including the calling thread */
+    RecastWorkerPool( int numWorkers );
+
+    /** Number of workers, including the calling thread */
+    virtual int getWorkerCount() const { return (int)_threads.size() + 1; }
+
+    /** Run the task over [0, count) and block until all items are processed */
+    virtual void run( dtCrowdTask* task, const int count );
+
+protected:
+    virtual ~RecastWorkerPool();
+
+    /** Execute chunks of current task on the specified worker until nothing is left */
+    void runChunks( int worker );
+
+    class WorkerThread : public OpenThreads::Thread
+    {
+    public:
+        WorkerThread( RecastWorkerPool* pool, int index ) : _pool(pool), _index(index) {}
+        virtual void run();
+
+    protected:
+        RecastWorkerPool* _pool;
+        int _index;
+    };
+    friend class WorkerThread;
+
+    std::vector<WorkerThread*> _threads;
+    OpenThreads::Barrier _startBarrier;
+    OpenThreads::Barrier _endBarrier;
+    OpenThreads::Atomic _nextChunk;
+    dtCrowdTask* _task;
+    int _count, _chunkSize;
+    bool _done;
+};
+
+#endif
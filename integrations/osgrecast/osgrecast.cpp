@@ -8,15 +8,18 @@
 #include <osgViewer/ViewerEventHandlers>
 #include <osgViewer/Viewer>
 #include <osg/io_utils>
+#include <osg/Timer>
+#include <iostream>
 #include "RecastManager.h"
 
 class SimulationHandler : public osgGA::GUIEventHandler
 {
 public:
-    SimulationHandler( osg::MatrixTransform* s )
+    SimulationHandler( osg::MatrixTransform* s, int numThreads=1 )
     :   _scene(s), _lastSimulationTime(0.0)
     {
         _recast = new RecastManager( osg::Matrix::rotate(-osg::PI_2, osg::X_AXIS) );
+        _recast->setNumCrowdThreads( numThreads );
         _recast->buildScene( s );
         
         _agentShape = new osg::Geode;
@@ -64,17 +67,106 @@ protected:
     double _lastSimulationTime;
 };
 
+struct CountPathCallback : public RecastPathService::ResultCallback
+{
+    CountPathCallback() : numSucceeded(0), numFailed(0) {}
+    virtual void operator()( const RecastPathService::Result& result )
+    { if ( result.succeeded() ) numSucceeded++; else numFailed++; }
+    
+    int numSucceeded, numFailed;
+};
+
+int runPathBenchmark( osg::MatrixTransform* scene, int numRequests, int numThreads, double budget )
+{
+    osg::ref_ptr<RecastManager> recast = new RecastManager( osg::Matrix::rotate(-osg::PI_2, osg::X_AXIS) );
+    recast->setNumCrowdThreads( numThreads );
+    if ( !recast->buildScene(scene) ) return 1;
+    
+    // Issue all requests in a single frame, as an RTS command to a large selection would do
+    osg::ref_ptr<CountPathCallback> callback = new CountPathCallback;
+    std::vector<RecastPathService::Request> requests;
+    for ( int i=0; i<numRequests; ++i )
+    {
+        RecastPathService::Request request( RecastPathService::STRAIGHT_PATH );
+        if ( !recast->getRandomPoint(request.start) || !recast->getRandomPoint(request.end) ) continue;
+        request.callback = callback;
+        requests.push_back( request );
+    }
+    
+    RecastPathService* service = recast->getPathService();
+    service->setTimeBudget( budget );
+    service->addRequests( requests );
+    
+    int numFrames = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    while ( service->getNumPendingRequests()>0 )
+    {
+        service->update();
+        numFrames++;
+    }
+    double ms = osg::Timer::instance()->delta_m( start, osg::Timer::instance()->tick() );
+    std::cout << "Requests: " << requests.size() << ", Threads: " << numThreads << ", Budget: " << budget
+              << "ms, Frames: " << numFrames << ", Total: " << ms << "ms, Succeeded: " << callback->numSucceeded
+              << ", Failed: " << callback->numFailed << std::endl;
+    return 0;
+}
+
+int runBenchmark( osg::MatrixTransform* scene, int numAgents, int numThreads, int numFrames )
+{
+    osg::ref_ptr<RecastManager> recast = new RecastManager( osg::Matrix::rotate(-osg::PI_2, osg::X_AXIS) );
+    recast->setNumCrowdThreads( numThreads );
+    if ( !recast->buildScene(scene, numAgents) ) return 1;
+    
+    std::vector< osg::ref_ptr<osg::MatrixTransform> > agents;
+    for ( int i=0; i<numAgents; ++i )
+    {
+        osg::Vec3f pos, target;
+        if ( !recast->getRandomPoint(pos) || !recast->getRandomPoint(target) ) continue;
+        
+        osg::ref_ptr<osg::MatrixTransform> agent = new osg::MatrixTransform;
+        if ( recast->addAgent(pos, agent.get())<0 ) continue;
+        recast->moveTo( target, agent.get() );
+        agents.push_back( agent );
+    }
+    
+    // Fixed time steps, so that results of different thread counts can be compared
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for ( int i=0; i<numFrames; ++i )
+        recast->update( 1.0f / 60.0f );
+    double ms = osg::Timer::instance()->delta_m( start, osg::Timer::instance()->tick() );
+    
+    osg::Vec3d checksum;
+    for ( unsigned int i=0; i<agents.size(); ++i )
+        checksum += agents[i]->getMatrix().getTrans();
+    std::cout << "Agents: " << agents.size() << ", Threads: " << numThreads
+              << ", Update: " << ms / numFrames << "ms/frame, Checksum: " << checksum << std::endl;
+    return 0;
+}
+
 int main( int argc, char** argv )
 {
+    osg::ArgumentParser arguments( &argc, argv );
     osg::ref_ptr<osg::MatrixTransform> scene = new osg::MatrixTransform;
     scene->addChild( osgDB::readNodeFile("nav_test.obj") );
+    
+    // Headless crowd benchmark, e.g. --benchmark 5000 --threads 8
+    // or path query benchmark, e.g. --path-benchmark 3000 --threads 4 --budget 2
+    int numAgents = 0, numRequests = 0, numThreads = 1, numFrames = 300;
+    double budget = 2.0;
+    arguments.read( "--threads", numThreads );
+    arguments.read( "--frames", numFrames );
+    arguments.read( "--budget", budget );
+    if ( arguments.read("--path-benchmark", numRequests) )
+        return runPathBenchmark( scene.get(), numRequests, numThreads, budget );
+    if ( arguments.read("--benchmark", numAgents) )
+        return runBenchmark( scene.get(), numAgents, numThreads, numFrames );
     scene->getOrCreateStateSet()->setMode( GL_CULL_FACE, osg::StateAttribute::ON );
     
     osgViewer::Viewer viewer;
     viewer.addEventHandler( new osgGA::StateSetManipulator(viewer.getCamera()->getOrCreateStateSet()) );
     viewer.addEventHandler( new osgViewer::StatsHandler );
     viewer.addEventHandler( new osgViewer::WindowSizeHandler );
-    viewer.addEventHandler( new SimulationHandler(scene.get()) );
+    viewer.addEventHandler( new SimulationHandler(scene.get(), numThreads) );
     viewer.setSceneData( scene.get() );
     return viewer.run();
 }
@@ -57,6 +57,7 @@
 #include <SWIFT_config.h>
 #include <SWIFT_common.h>
 #include <SWIFT_array.h>
+#include <SWIFT_boxtree.h>
 
 //////////////////////////////////////////////////////////////////////////////
 // Types
@@ -68,6 +69,8 @@ typedef SWIFT_Real SWIFT_Matrix[9];
 
 typedef enum { MEDIAN, MIDPOINT, MEAN, GAP } SPLIT_TYPE;
 
+typedef enum { SWEEP_AND_PRUNE, AABB_TREE } BROAD_PHASE_TYPE;
+
 //////////////////////////////////////////////////////////////////////////////
 // Constants
 //////////////////////////////////////////////////////////////////////////////
@@ -86,6 +89,7 @@ static const int SWIFT_FACE = 3;
 // Default scene configuration
 static const bool DEFAULT_BP = true;                        // Broad phase on
 static const bool DEFAULT_GS = true;                        // Global sort on
+static const BROAD_PHASE_TYPE DEFAULT_BP_TYPE = SWEEP_AND_PRUNE;
 
 // Default object configuration
 static const bool DEFAULT_FIXED = false;                    // Moving
@@ -118,6 +122,45 @@ class SWIFT_Object;
 class SWIFT_Box_Node;
 class SWIFT_Pair;
 class SWIFT_File_Reader;
+class SWIFT_Query_Task;
+
+
+//////////////////////////////////////////////////////////////////////////////
+// SWIFT_Task
+//
+// Description:
+//      A range of independent work items submitted by the scene to a task
+//  runner.
+//////////////////////////////////////////////////////////////////////////////
+class SWIFT_Task {
+  public:
+    virtual ~SWIFT_Task( ) { }
+
+    // Process the items in the range [begin, end).  The thread index is
+    // between 0 and the number of threads of the runner minus one.  Ranges
+    // that are run at the same time must be given different thread indices.
+    virtual void Run( int thread, int begin, int end ) = 0;
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+// SWIFT_Task_Runner
+//
+// Description:
+//      Interface to run the pair queries of a scene on several threads.  It
+//  has to be implemented by the application with its own threads.
+//////////////////////////////////////////////////////////////////////////////
+class SWIFT_Task_Runner {
+  public:
+    virtual ~SWIFT_Task_Runner( ) { }
+
+    // The number of threads used by the runner, including the calling thread.
+    virtual int Num_Threads( ) const = 0;
+
+    // Run the task over the items [0, num_items) and return when all of them
+    // have been processed.
+    virtual void Run( SWIFT_Task* task, int num_items ) = 0;
+};
 
 
 //////////////////////////////////////////////////////////////////////////////
@@ -144,8 +187,18 @@ class SWIFT_Scene {
     // Configure the scene.  Turn the broad phase (sweep and prune) algorithm
     // on or off.  Turn on global sorting or local sorting (by setting
     // global_sort to false).
+    //
+    // The broad phase type may be set to AABB_TREE instead of sweep and prune
+    // which suits scenes of many objects, most of them fixed or still, or
+    // which are often added and deleted.  Fixed and moving objects are kept in
+    // two dynamic trees whose leaf boxes are slightly larger than the object
+    // boxes.  Only the objects that leave their leaf boxes are reinserted and
+    // their pairs are updated at the next query, so global_sort has no effect.
+    // The pairs reported by the broad phase are those of overlapping leaf
+    // boxes which may be more than with sweep and prune.
     SWIFT_Scene( bool broad_phase = DEFAULT_BP,
-                 bool global_sort = DEFAULT_GS );
+                 bool global_sort = DEFAULT_GS,
+                 BROAD_PHASE_TYPE broad_phase_type = DEFAULT_BP_TYPE );
 
     ~SWIFT_Scene( );
 
@@ -251,6 +304,20 @@ class SWIFT_Scene {
     // 3x4 transformation matrices in row-major form: [R|T]. 
     void Set_All_Object_Transformations( const SWIFT_Real* RT );
 
+    // Set the transformation for the num_ids objects given by ids.  The
+    // other objects are not touched, so this is the cheaper way to move only
+    // some objects of a large scene.  Fixed objects may be given as well.
+    // R and T are given in the same order as the ids and as for
+    // Set_All_Object_Transformations.
+    void Set_Object_Transformations( const int* ids, int num_ids,
+                                     const SWIFT_Real* R, const SWIFT_Real* T );
+
+    // Set the transformation for the num_ids objects given by ids.
+    // RT is given in the same order as the ids and as for
+    // Set_All_Object_Transformations.
+    void Set_Object_Transformations( const int* ids, int num_ids,
+                                     const SWIFT_Real* RT );
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // Pair Activation methods
@@ -375,6 +442,21 @@ class SWIFT_Scene {
                 int** feature_ids = NO_FEAT_IDS );
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Parallel Query methods
+///////////////////////////////////////////////////////////////////////////////
+
+    // Set the task runner used to query the pairs on several threads.  Pairs
+    // are independent of each other once the broad phase has found them, so
+    // they are split between the threads of the runner and the results are
+    // reported in the same order as a serial query would report them.  The
+    // runner is not owned by the scene and must outlive it or be reset to
+    // NULL before it is destroyed.  Queries are always serial if the compiler
+    // does not support thread local storage (see SWIFT_common.h).
+    void Set_Task_Runner( SWIFT_Task_Runner* runner );
+    SWIFT_Task_Runner* Task_Runner( ) const { return task_runner; }
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Plug-In Registration methods
 ///////////////////////////////////////////////////////////////////////////////
@@ -402,6 +484,17 @@ class SWIFT_Scene {
     inline void Sort_Local( int oid, int axis );
     void Sort_Local( int oid );
 
+    // Bounding box tree update methods
+    SWIFT_Box_Tree& Tree( SWIFT_Object* obj );
+    inline SWIFT_Pair* Find_Pair( int id1, int id2 );
+    inline void Set_Tree_Overlap( SWIFT_Pair* pair, bool overlap );
+    void Move_In_Tree( int oid );
+    void Update_Tree_Pairs( );
+
+    // Parallel query methods
+    bool Parallel_Query_Pairs( );
+    bool Run_Parallel_Query( int& k );
+
 ///////////////////////////////////////////////////////////////////////////////
 // Private data
 ///////////////////////////////////////////////////////////////////////////////
@@ -409,6 +502,8 @@ class SWIFT_Scene {
     //      Sweep and Prune
     bool bp; // Broad phase enabled?
     bool gs; // Global sorting enabled?
+    //      AABB tree
+    bool bt; // Box trees used instead of sweep and prune?
 
     // The objects in the scene
     SWIFT_Array<SWIFT_Object*> objects;
@@ -424,6 +519,14 @@ class SWIFT_Scene {
     // The sweep and prune lists which contain internal piece ids
     SWIFT_Array<SWIFT_Box_Node*> sorted[3];
 
+    // The box trees of the fixed and the moving objects
+    SWIFT_Box_Tree static_tree;
+    SWIFT_Box_Tree dynamic_tree;
+
+    // The pairs whose leaf boxes overlap and the tree query results
+    SWIFT_Array<SWIFT_Pair*> tree_pairs;
+    SWIFT_Array<SWIFT_Object*> tree_hits;
+
     // Pair count
     int total_pairs;
 
@@ -439,6 +542,10 @@ class SWIFT_Scene {
     SWIFT_Array<int> pis;           // piece ids
     SWIFT_Array<int> fts;           // feature types
     SWIFT_Array<int> fis;           // feature ids
+
+    // Parallel querying
+    SWIFT_Task_Runner* task_runner;
+    SWIFT_Query_Task* query_task;
 };
 
 #endif
@@ -0,0 +1,118 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// SWIFT_boxtree.h
+//
+// Description:
+//      Classes to manage a dynamic bounding box tree for the broad phase.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef _SWIFT_BOXTREE_H_
+#define _SWIFT_BOXTREE_H_
+
+#include <SWIFT_config.h>
+#include <SWIFT_common.h>
+#include <SWIFT_array.h>
+
+class SWIFT_Object;
+
+//////////////////////////////////////////////////////////////////////////////
+// SWIFT_Box_Tree_Node
+//
+// Description:
+//      Class to hold a node of the box tree.  Leaves refer to an object and
+//  internal nodes bound their two children.  Free nodes are linked through the
+//  parent index.
+//////////////////////////////////////////////////////////////////////////////
+class SWIFT_Box_Tree_Node {
+  public:
+    bool Is_Leaf( ) const { return child0 == -1; }
+
+    SWIFT_Real min[3];
+    SWIFT_Real max[3];
+    SWIFT_Object* obj;
+    int parent;
+    int child0;
+    int child1;
+    // Leaves have height 0 and free nodes -1
+    int height;
+    bool moved;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+// SWIFT_Box_Tree
+//
+// Description:
+//      Class to manage a dynamic AABB tree of objects.  Each object has a leaf
+//  (proxy) whose box is the object box enlarged by a margin, so that small
+//  motions do not change the tree.  The tree is kept balanced by rotations
+//  which makes insertion and removal O(log n).  Leaves that were inserted or
+//  reinserted since the last call to Clear_Moved are listed as moved.
+//////////////////////////////////////////////////////////////////////////////
+class SWIFT_Box_Tree {
+  public:
+    SWIFT_Box_Tree( );
+    ~SWIFT_Box_Tree( ) { }
+
+    // Get functions
+    SWIFT_Object* Object( int proxy ) { return nodes[proxy].obj; }
+    const SWIFT_Real* Min( int proxy ) { return nodes[proxy].min; }
+    const SWIFT_Real* Max( int proxy ) { return nodes[proxy].max; }
+    bool Moved( int proxy ) { return nodes[proxy].moved; }
+    SWIFT_Array<int>& Moved_Proxies( ) { return moved_proxies; }
+
+    // Returns true if the boxes of the two proxies overlap.  The proxies may
+    // belong to different trees.
+    static bool Overlap( SWIFT_Box_Tree& t0, int p0,
+                         SWIFT_Box_Tree& t1, int p1 )
+    {
+        return Overlap( t0.nodes[p0].min, t0.nodes[p0].max,
+                        t1.nodes[p1].min, t1.nodes[p1].max );
+    }
+
+    // Add a leaf for the object using its current box.  Returns the proxy id.
+    int Insert( SWIFT_Object* obj );
+
+    // Remove the leaf of a proxy.
+    void Remove( int proxy );
+
+    // Update the leaf after its object has moved.  Returns true if the object
+    // box left the leaf box in which case the leaf was reinserted.
+    bool Move( int proxy );
+
+    // Add the objects of the leaves overlapping the given box to hits.
+    void Query( const SWIFT_Real* min, const SWIFT_Real* max,
+                SWIFT_Array<SWIFT_Object*>& hits );
+
+    // Forget the moved leaves.
+    void Clear_Moved( );
+
+  private:
+    static bool Overlap( const SWIFT_Real* min0, const SWIFT_Real* max0,
+                         const SWIFT_Real* min1, const SWIFT_Real* max1 )
+    {
+        return min0[0] <= max1[0] && min1[0] <= max0[0] &&
+               min0[1] <= max1[1] && min1[1] <= max0[1] &&
+               min0[2] <= max1[2] && min1[2] <= max0[2];
+    }
+
+    int Allocate_Node( );
+    void Free_Node( int i );
+    void Set_Leaf_Box( int leaf );
+    void Mark_Moved( int leaf );
+    void Insert_Leaf( int leaf );
+    void Remove_Leaf( int leaf );
+    void Refit( int i );
+    int Balance( int i );
+
+    SWIFT_Array<SWIFT_Box_Tree_Node> nodes;
+    int root;
+    int free_list;
+
+    SWIFT_Array<int> moved_proxies;
+    SWIFT_Array<int> stack;
+};
+
+#endif
+
+
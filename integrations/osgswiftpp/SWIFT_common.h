@@ -125,6 +125,21 @@ static const SWIFT_Real EPSILON1 = 1.0e-1;
 #define max(a,b) ((a)>(b)?(a):(b))
 # endif
 
+///////////////////////////////////////////////////////////////////////////////
+// Threading
+///////////////////////////////////////////////////////////////////////////////
+
+// The pair queries keep their working state in file scope variables.  If the
+// compiler supports thread local storage, every thread gets its own copy of
+// them and the scene may query pairs on several threads (see
+// SWIFT_Scene::Set_Task_Runner).  Otherwise queries are always serial.
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#define SWIFT_THREAD_LOCAL thread_local
+#define SWIFT_PARALLEL_QUERIES
+#else
+#define SWIFT_THREAD_LOCAL
+#endif
+
 // Special min and max function which accumulates min and max
 inline void Min_And_Max( SWIFT_Real &mn, SWIFT_Real &mx, SWIFT_Real v )
 {
@@ -60,7 +60,8 @@
 
 // Set what type of floating point numbers to use in SWIFT.  If SWIFT_USE_FLOAT
 // is defined then float's are used, otherwise doubles are used.  Doubles are
-// recommended due to higher accuracy.
+// recommended due to higher accuracy.  The CMake option SWIFT_USE_FLOAT
+// defines it for the whole build.
 //#define SWIFT_USE_FLOAT
 
 // If SWIFT_ALWAYS_LOOKUP_TABLE is defined, then a lookup table is always used
@@ -130,6 +131,16 @@
 # undef SWIFT_USE_FLOAT
 #endif
 
+// When floats are used and the compiler targets SSE2, the triple operations on
+// the hot paths (addition, scaling, dot and cross products and transformations)
+// are done four floats at a time.  Triples and matrices are padded for this.
+// Define SWIFT_NO_SIMD to always use the scalar code.
+#if defined(SWIFT_USE_FLOAT) && !defined(SWIFT_NO_SIMD) && \
+    ( defined(__SSE2__) || defined(_M_X64) || \
+      (defined(_M_IX86_FP) && _M_IX86_FP >= 2) )
+# define SWIFT_USE_SIMD
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // Disable Warnings
 ///////////////////////////////////////////////////////////////////////////////
@@ -62,9 +62,23 @@
 
 #include <SWIFT_config.h>
 #include <SWIFT_common.h>
+#ifdef SWIFT_USE_SIMD
+#include <emmintrin.h>
+#endif
 
 using namespace  std;
 
+// Number of reals stored for a triple and a matrix.  With SIMD a triple fills a
+// register and the last matrix row can be loaded as one.  The extra reals are
+// never read as coordinates.
+#ifdef SWIFT_USE_SIMD
+#define SWIFT_TRIPLE_SIZE 4
+#define SWIFT_MATRIX33_SIZE 12
+#else
+#define SWIFT_TRIPLE_SIZE 3
+#define SWIFT_MATRIX33_SIZE 9
+#endif
+
 // Forward declarations
 class SWIFT_Matrix33;
 class SWIFT_Transformation;
@@ -194,7 +208,7 @@ class SWIFT_Triple {
     friend ostream& operator<<( ostream&, const SWIFT_Triple& );
 
   private:
-    SWIFT_Real val[3];
+    SWIFT_Real val[SWIFT_TRIPLE_SIZE];
 };
 
 
@@ -318,7 +332,7 @@ class SWIFT_Matrix33 {
     friend ostream& operator<<( ostream& out, const SWIFT_Transformation& m );
 
   private:
-    SWIFT_Real val[9];
+    SWIFT_Real val[SWIFT_MATRIX33_SIZE];
 };
 
 //////////////////////////////////////////////////////////////////////////////
@@ -388,6 +402,39 @@ class SWIFT_Transformation {
     SWIFT_Triple T;
 };
 
+#ifdef SWIFT_USE_SIMD
+//////////////////////////////////////////////////////////////////////////////
+// SIMD helper functions
+//////////////////////////////////////////////////////////////////////////////
+
+// Load three reals with the fourth lane cleared so that whatever follows them
+// in memory does not take part in the arithmetic.
+inline __m128 SWIFT_Load( const SWIFT_Real* v )
+{
+    return _mm_and_ps( _mm_loadu_ps( v ),
+                       _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) ) );
+}
+
+// Sum of the lanes
+inline SWIFT_Real SWIFT_Sum( __m128 v )
+{
+    v = _mm_add_ps( v, _mm_movehl_ps( v, v ) );
+    v = _mm_add_ss( v, _mm_shuffle_ps( v, v, _MM_SHUFFLE( 1, 1, 1, 1 ) ) );
+    return _mm_cvtss_f32( v );
+}
+
+// The three row dot products of a row major matrix with a loaded triple
+inline __m128 SWIFT_Rows_Dot( const SWIFT_Real* m, __m128 t )
+{
+    __m128 r0 = _mm_mul_ps( SWIFT_Load( m ), t );
+    __m128 r1 = _mm_mul_ps( SWIFT_Load( m + 3 ), t );
+    __m128 r2 = _mm_mul_ps( SWIFT_Load( m + 6 ), t );
+    __m128 r3 = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+    return _mm_add_ps( _mm_add_ps( r0, r1 ), r2 );
+}
+#endif
+
 //////////////////////////////////////////////////////////////////////////////
 // Auxiliary operator functions
 //////////////////////////////////////////////////////////////////////////////
@@ -561,12 +608,17 @@ inline void SWIFT_Triple::Set_Smallest_Coord( SWIFT_Real v )
 
 inline SWIFT_Real SWIFT_Triple::Dist_Sq( const SWIFT_Triple& t ) const
 {
+#ifdef SWIFT_USE_SIMD
+    const __m128 d = _mm_sub_ps( SWIFT_Load( t.val ), SWIFT_Load( val ) );
+    return SWIFT_Sum( _mm_mul_ps( d, d ) );
+#else
     SWIFT_Real x, y, z;
     t.Get_Value( x, y, z );
     x -= val[0];
     y -= val[1];
     z -= val[2];
     return x * x + y * y + z * z;
+#endif
 }
 
 inline SWIFT_Real SWIFT_Triple::Dist( const SWIFT_Triple& t ) const
@@ -661,13 +713,25 @@ inline void SWIFT_Triple::Transform( const SWIFT_Triple& x,
 { *this = val[0] * x + val[1] * y + val[2] * z; }
 
 inline void SWIFT_Triple::operator+=( const SWIFT_Triple& t )
+#ifdef SWIFT_USE_SIMD
+{ _mm_storeu_ps( val, _mm_add_ps( SWIFT_Load( val ), SWIFT_Load( t.val ) ) ); }
+#else
 { val[0] += t.X(); val[1] += t.Y(); val[2] += t.Z(); }
+#endif
 
 inline void SWIFT_Triple::operator-=( const SWIFT_Triple& t )
+#ifdef SWIFT_USE_SIMD
+{ _mm_storeu_ps( val, _mm_sub_ps( SWIFT_Load( val ), SWIFT_Load( t.val ) ) ); }
+#else
 { val[0] -= t.X(); val[1] -= t.Y(); val[2] -= t.Z(); }
+#endif
 
 inline void SWIFT_Triple::operator*=( SWIFT_Real s )
+#ifdef SWIFT_USE_SIMD
+{ _mm_storeu_ps( val, _mm_mul_ps( SWIFT_Load( val ), _mm_set1_ps( s ) ) ); }
+#else
 { val[0] *= s; val[1] *= s; val[2] *= s; }
+#endif
 
 inline void SWIFT_Triple::operator/=( SWIFT_Real s )
 { const SWIFT_Real _s = 1.0/s; val[0] *= _s; val[1] *= _s; val[2] *= _s; }
@@ -683,6 +747,9 @@ inline void SWIFT_Triple::operator^=( const SWIFT_Matrix33& m )
 
 inline void SWIFT_Triple::operator^=( const SWIFT_Transformation& m )
 {
+#ifdef SWIFT_USE_SIMD
+    *this = m * *this;
+#else
     SWIFT_Real temp0 = val[0]*m.R.val[0] + val[1]*m.R.val[1] +
                        val[2]*m.R.val[2] + m.T.val[0];
     SWIFT_Real temp1 = val[0]*m.R.val[3] + val[1]*m.R.val[4] +
@@ -691,10 +758,14 @@ inline void SWIFT_Triple::operator^=( const SWIFT_Transformation& m )
                                                      m.T.val[2];
     val[0] = temp0;
     val[1] = temp1;
+#endif
 }
 
 inline void SWIFT_Triple::operator&=( const SWIFT_Transformation& m )
 {
+#ifdef SWIFT_USE_SIMD
+    *this = m & *this;
+#else
     SWIFT_Real temp0 = val[0]*m.R.val[0] + val[1]*m.R.val[1] +
                        val[2]*m.R.val[2];
     SWIFT_Real temp1 = val[0]*m.R.val[3] + val[1]*m.R.val[4] +
@@ -702,6 +773,7 @@ inline void SWIFT_Triple::operator&=( const SWIFT_Transformation& m )
     val[2] = val[0]*m.R.val[6] + val[1]*m.R.val[7] + val[2]*m.R.val[8];
     val[0] = temp0;
     val[1] = temp1;
+#endif
 }
 
 inline bool SWIFT_Triple::operator==( const SWIFT_Triple& t ) const
@@ -990,6 +1062,28 @@ inline void SWIFT_Transformation::Set_Value( const SWIFT_Real r[],
 inline SWIFT_Triple operator-( const SWIFT_Triple& t )
 { return SWIFT_Triple( -t.val[0], -t.val[1], -t.val[2] ); }
 
+#ifdef SWIFT_USE_SIMD
+// Triple addition
+inline SWIFT_Triple operator+( const SWIFT_Triple& t1, const SWIFT_Triple& t2 )
+{ SWIFT_Triple result;
+  _mm_storeu_ps( result.val, _mm_add_ps( SWIFT_Load( t1.val ),
+                                         SWIFT_Load( t2.val ) ) );
+  return result; }
+
+// Triple subtraction
+inline SWIFT_Triple operator-( const SWIFT_Triple& t1, const SWIFT_Triple& t2 )
+{ SWIFT_Triple result;
+  _mm_storeu_ps( result.val, _mm_sub_ps( SWIFT_Load( t1.val ),
+                                         SWIFT_Load( t2.val ) ) );
+  return result; }
+
+// Scalar multiplication
+inline SWIFT_Triple operator*( SWIFT_Real s, const SWIFT_Triple& t )
+{ SWIFT_Triple result;
+  _mm_storeu_ps( result.val, _mm_mul_ps( _mm_set1_ps( s ),
+                                         SWIFT_Load( t.val ) ) );
+  return result; }
+#else
 // Triple addition
 inline SWIFT_Triple operator+( const SWIFT_Triple& t1, const SWIFT_Triple& t2 )
 { return SWIFT_Triple( t1.val[0] + t2.val[0], t1.val[1] + t2.val[1],
@@ -1003,10 +1097,11 @@ inline SWIFT_Triple operator-( const SWIFT_Triple& t1, const SWIFT_Triple& t2 )
 // Scalar multiplication
 inline SWIFT_Triple operator*( SWIFT_Real s, const SWIFT_Triple& t )
 { return SWIFT_Triple( s * t.val[0], s * t.val[1], s * t.val[2] ); }
+#endif
 
 // Scalar multiplication
 inline SWIFT_Triple operator*( const SWIFT_Triple& t, SWIFT_Real s )
-{ return SWIFT_Triple( s * t.val[0], s * t.val[1], s * t.val[2] ); }
+{ return s * t; }
 
 // Scalar division
 inline SWIFT_Triple operator/( const SWIFT_Triple& t, SWIFT_Real s )
@@ -1015,14 +1110,30 @@ inline SWIFT_Triple operator/( const SWIFT_Triple& t, SWIFT_Real s )
 
 // Dot product
 inline SWIFT_Real operator*( const SWIFT_Triple& t1, const SWIFT_Triple& t2 )
+#ifdef SWIFT_USE_SIMD
+{ return SWIFT_Sum( _mm_mul_ps( SWIFT_Load( t1.val ), SWIFT_Load( t2.val ) ) ); }
+#else
 { return t1.val[0]*t2.val[0] + t1.val[1]*t2.val[1] + t1.val[2]*t2.val[2]; }
+#endif
 
 // Cross product
 inline SWIFT_Triple operator%( const SWIFT_Triple& t1, const SWIFT_Triple& t2 )
 {
+#ifdef SWIFT_USE_SIMD
+    const __m128 a = SWIFT_Load( t1.val );
+    const __m128 b = SWIFT_Load( t2.val );
+    const __m128 a_yzx = _mm_shuffle_ps( a, a, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+    const __m128 b_yzx = _mm_shuffle_ps( b, b, _MM_SHUFFLE( 3, 0, 2, 1 ) );
+    // a x b = (a * b.yzx - a.yzx * b).yzx
+    const __m128 c = _mm_sub_ps( _mm_mul_ps( a, b_yzx ), _mm_mul_ps( a_yzx, b ) );
+    SWIFT_Triple result;
+    _mm_storeu_ps( result.val, _mm_shuffle_ps( c, c, _MM_SHUFFLE( 3, 0, 2, 1 ) ) );
+    return result;
+#else
     return SWIFT_Triple( t1.val[1] * t2.val[2] - t1.val[2] * t2.val[1],
                          t1.val[2] * t2.val[0] - t1.val[0] * t2.val[2],
                          t1.val[0] * t2.val[1] - t1.val[1] * t2.val[0] );
+#endif
 }
 
 
@@ -1092,19 +1203,39 @@ inline SWIFT_Matrix33 operator/( const SWIFT_Matrix33& m, SWIFT_Real s )
 // Matrix vector right multiply
 inline SWIFT_Triple operator*( const SWIFT_Matrix33& m, const SWIFT_Triple& t )
 {
+#ifdef SWIFT_USE_SIMD
+    SWIFT_Triple result;
+    _mm_storeu_ps( result.val, SWIFT_Rows_Dot( m.val, SWIFT_Load( t.val ) ) );
+    return result;
+#else
     return SWIFT_Triple(
                    t.val[0]*m.val[0] + t.val[1]*m.val[1] + t.val[2]*m.val[2],
                    t.val[0]*m.val[3] + t.val[1]*m.val[4] + t.val[2]*m.val[5],
                    t.val[0]*m.val[6] + t.val[1]*m.val[7] + t.val[2]*m.val[8] );
+#endif
 }
 
 // Matrix transpose-Vector multiplication
 inline SWIFT_Triple operator%( const SWIFT_Matrix33& m, const SWIFT_Triple& t )
 {
+#ifdef SWIFT_USE_SIMD
+    // Sum of the rows scaled by the coordinates
+    const __m128 v = SWIFT_Load( t.val );
+    SWIFT_Triple result;
+    _mm_storeu_ps( result.val, _mm_add_ps( _mm_add_ps(
+        _mm_mul_ps( SWIFT_Load( m.val ),
+                    _mm_shuffle_ps( v, v, _MM_SHUFFLE( 0, 0, 0, 0 ) ) ),
+        _mm_mul_ps( SWIFT_Load( m.val + 3 ),
+                    _mm_shuffle_ps( v, v, _MM_SHUFFLE( 1, 1, 1, 1 ) ) ) ),
+        _mm_mul_ps( SWIFT_Load( m.val + 6 ),
+                    _mm_shuffle_ps( v, v, _MM_SHUFFLE( 2, 2, 2, 2 ) ) ) ) );
+    return result;
+#else
     return SWIFT_Triple(
                    t.val[0]*m.val[0] + t.val[1]*m.val[3] + t.val[2]*m.val[6],
                    t.val[0]*m.val[1] + t.val[1]*m.val[4] + t.val[2]*m.val[7],
                    t.val[0]*m.val[2] + t.val[1]*m.val[5] + t.val[2]*m.val[8] );
+#endif
 }
 
 // Matrix multiplication = m1 * m2
@@ -1159,6 +1290,13 @@ inline SWIFT_Matrix33 operator%( const SWIFT_Matrix33& m1,
 inline SWIFT_Triple operator*( const SWIFT_Transformation& m,
                                const SWIFT_Triple& t )
 {
+#ifdef SWIFT_USE_SIMD
+    SWIFT_Triple result;
+    _mm_storeu_ps( result.val, _mm_add_ps( SWIFT_Rows_Dot( m.R.val,
+                                                SWIFT_Load( t.val ) ),
+                                           SWIFT_Load( m.T.val ) ) );
+    return result;
+#else
     return SWIFT_Triple(
         t.val[0]*m.R.val[0] + t.val[1]*m.R.val[1] + t.val[2]*m.R.val[2] +
                                                     m.T.val[0],
@@ -1166,16 +1304,21 @@ inline SWIFT_Triple operator*( const SWIFT_Transformation& m,
                                                     m.T.val[1],
         t.val[0]*m.R.val[6] + t.val[1]*m.R.val[7] + t.val[2]*m.R.val[8] +
                                                     m.T.val[2] );
+#endif
 }
 
 // Matrix vector right multiply
 inline SWIFT_Triple operator&( const SWIFT_Transformation& m,
                                const SWIFT_Triple& t )
 {
+#ifdef SWIFT_USE_SIMD
+    return m.R * t;
+#else
     return SWIFT_Triple(
         t.val[0]*m.R.val[0] + t.val[1]*m.R.val[1] + t.val[2]*m.R.val[2],
         t.val[0]*m.R.val[3] + t.val[1]*m.R.val[4] + t.val[2]*m.R.val[5],
         t.val[0]*m.R.val[6] + t.val[1]*m.R.val[7] + t.val[2]*m.R.val[8] );
+#endif
 }
 
 inline ostream& operator<<( ostream& out, const SWIFT_Triple& t )
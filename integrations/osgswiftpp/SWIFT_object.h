@@ -83,6 +83,8 @@ class SWIFT_Object {
     bool Use_Cube( ) { return cube; }
     SWIFT_Box_Node* Min_Box_Node( int axis ) { return min_bns+axis; }
     SWIFT_Box_Node* Max_Box_Node( int axis ) { return max_bns+axis; }
+    // Leaf in the box tree of the scene
+    int Proxy( ) { return proxy; }
     void Get_Box_Nodes( int i,
                         SWIFT_Box_Node** min_0, SWIFT_Box_Node** max_0,
                         SWIFT_Box_Node** min_1, SWIFT_Box_Node** max_1,
@@ -92,6 +94,7 @@ class SWIFT_Object {
 
   // Set functions
     void Set_Id( int i );
+    void Set_Proxy( int p ) { proxy = p; }
 
     // Initialization functions.  Should only be called once after this
     // object has been constructed.
@@ -127,6 +130,9 @@ class SWIFT_Object {
     SWIFT_Box_Node min_bns[3];
     SWIFT_Box_Node max_bns[3];
 
+    // Box tree leaf
+    int proxy;
+
     // AABB parameters
     bool cube;
     SWIFT_Real enlargement;
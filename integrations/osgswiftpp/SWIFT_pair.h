@@ -139,6 +139,9 @@ class SWIFT_Pair {
     void Set_Id0( int id ) { id0 = id; }
     void Set_Id1( int id ) { id1 = id; }
     void Toggle_Overlap( int axis ) { bit_field ^= (1 << axis); }
+    void Set_Overlap( bool overlap )
+                { bit_field = overlap ? (0xfffffff8 & bit_field) :
+                                        (0x7 | bit_field); }
     void Set_State( RESULT_TYPE state )
                     { bit_field = (0xffffffc7 & bit_field) | (state << 3); }
 #ifdef SWIFT_FRONT_TRACKING
@@ -0,0 +1,465 @@
+#include <osg/Geode>
+#include <osg/TriangleFunctor>
+#include <osg/Notify>
+#include <osg/io_utils>
+#include "SwiftCollisionGraph.h"
+#include <SWIFT_mesh.h>
+#include <SWIFT_mesh_utils.h>
+
+namespace
+{
+
+/** Welds vertices rounding to the same cell of a grid of the tolerance size. The cells are
+    kept in an open addressing table as the vertices are only ever added. Welded vertices are
+    snapped to their cells, so faces which are planar up to the tolerance become exactly planar,
+    which the feature walks of SWIFT need */
+class VertexWelder
+{
+public:
+    VertexWelder( double tolerance )
+    :   _tolerance(tolerance>0.0 ? tolerance : 0.0) { _table.resize( 256, -1 ); }
+
+    unsigned int getOrCreate( const osg::Vec3d& v )
+    {
+        // Rounding keeps vertices around round coordinates, which are common, in one cell
+        osg::Vec3d cell = v;
+        if ( _tolerance>0.0 )
+        {
+            cell.set( floor(v[0] / _tolerance + 0.5), floor(v[1] / _tolerance + 0.5),
+                      floor(v[2] / _tolerance + 0.5) );
+        }
+
+        unsigned int mask = _table.size() - 1, slot = hash(cell) & mask;
+        while ( _table[slot]>=0 )
+        {
+            if ( _cells[_table[slot]]==cell ) return _table[slot];
+            slot = (slot + 1) & mask;
+        }
+
+        int index = (int)_cells.size();
+        _table[slot] = index;
+        _cells.push_back( cell );
+
+        osg::Vec3d snapped = _tolerance>0.0 ? cell * _tolerance : v;
+        vertices.push_back( snapped[0] );
+        vertices.push_back( snapped[1] );
+        vertices.push_back( snapped[2] );
+
+        // Keep the table at most half full
+        if ( _cells.size() * 2>_table.size() ) rehash( _table.size() * 2 );
+        return index;
+    }
+
+    void clear()
+    {
+        vertices.clear();
+        faces.clear();
+        _cells.clear();
+        _table.assign( 256, -1 );
+    }
+
+    std::vector<SWIFT_Real> vertices;
+    std::vector<int> faces;
+
+protected:
+    static unsigned int hash( const osg::Vec3d& c )
+    {
+        // Primes from the spatial hashing of Teschner et al.
+        return (unsigned int)(long long)c[0] * 73856093u ^
+               (unsigned int)(long long)c[1] * 19349663u ^
+               (unsigned int)(long long)c[2] * 83492791u;
+    }
+
+    void rehash( unsigned int size )
+    {
+        _table.assign( size, -1 );
+        for ( unsigned int i=0; i<_cells.size(); ++i )
+        {
+            unsigned int slot = hash(_cells[i]) & (size - 1);
+            while ( _table[slot]>=0 ) slot = (slot + 1) & (size - 1);
+            _table[slot] = (int)i;
+        }
+    }
+
+    std::vector<osg::Vec3d> _cells;
+    std::vector<int> _table;
+    double _tolerance;
+};
+
+struct CollectFaceOperator
+{
+    void operator()( const osg::Vec3& v1, const osg::Vec3& v2, const osg::Vec3& v3, bool temp )
+    {
+        unsigned int i1 = welder->getOrCreate( osg::Vec3d(v1) * matrix );
+        unsigned int i2 = welder->getOrCreate( osg::Vec3d(v2) * matrix );
+        unsigned int i3 = welder->getOrCreate( osg::Vec3d(v3) * matrix );
+        if ( i1==i2 || i2==i3 || i3==i1 ) return;
+        welder->faces.push_back( i1 );
+        welder->faces.push_back( i2 );
+        welder->faces.push_back( i3 );
+    }
+
+    VertexWelder* welder;
+    osg::Matrix matrix;
+};
+
+typedef std::pair<osg::Drawable*, osg::Matrix> PiecePart;
+
+/** A convex piece to create: one drawable, or all drawables of a HULL_PER_NODE subgraph */
+struct PieceSource
+{
+    int body;
+    osg::Drawable* drawable;
+    bool convex;
+    std::vector<PiecePart> parts;
+};
+
+/** Pieces with same drawable, matrix and fixed state can share the geometry */
+struct PieceKey
+{
+    PieceKey( osg::Drawable* d, const osg::Matrix& m, bool f ) : drawable(d), matrix(m), fixed(f) {}
+
+    bool operator<( const PieceKey& rhs ) const
+    {
+        if ( drawable!=rhs.drawable ) return drawable<rhs.drawable;
+        if ( fixed!=rhs.fixed ) return fixed<rhs.fixed;
+        return matrix<rhs.matrix;
+    }
+
+    osg::Drawable* drawable;
+    osg::Matrix matrix;
+    bool fixed;
+};
+
+/** Collects the bodies and the pieces of a subgraph. Matrices are relative to the body */
+class GraphDataCollector : public osg::NodeVisitor
+{
+public:
+    typedef std::map<osg::Node*, SwiftCollisionGraph::DecompositionHint> HintMap;
+
+    GraphDataCollector( const HintMap& hints )
+    :   osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN), _hints(hints),
+        _hint(SwiftCollisionGraph::HULL_PER_DRAWABLE), _body(-1), _nodeHull(-1) {}
+
+    virtual void apply( osg::Transform& transform );
+    virtual void apply( osg::Geode& node );
+    virtual void apply( osg::Node& node );
+
+    std::vector<osg::NodePath> bodies;
+    std::vector<PieceSource> pieces;
+
+protected:
+    /** Traverse the node with its own hint if it has one */
+    void traverseWithHint( osg::Node& node );
+
+    const HintMap& _hints;
+    SwiftCollisionGraph::DecompositionHint _hint;
+    osg::Matrix _matrix;
+    int _body, _nodeHull;
+};
+
+void GraphDataCollector::apply( osg::Transform& transform )
+{
+    // The root is the fixed frame, so its own matrix is ignored
+    if ( getNodePath().size()<2 ) { traverseWithHint( transform ); return; }
+
+    osg::MatrixTransform* mt = transform.asMatrixTransform();
+    int lastBody = _body;
+    osg::Matrix lastMatrix = _matrix;
+    if ( mt && mt->getDataVariance()!=osg::Object::STATIC && _nodeHull<0 )
+    {
+        // A new body, whose pieces are in its own coordinates
+        _body = (int)bodies.size();
+        _matrix.makeIdentity();
+        bodies.push_back( osg::NodePath(getNodePath().begin() + 1, getNodePath().end()) );
+    }
+    else
+        transform.computeLocalToWorldMatrix( _matrix, this );
+
+    traverseWithHint( transform );
+    _body = lastBody;
+    _matrix = lastMatrix;
+}
+
+void GraphDataCollector::apply( osg::Geode& node )
+{
+    HintMap::const_iterator itr = _hints.find( &node );
+    SwiftCollisionGraph::DecompositionHint hint = (itr!=_hints.end()) ? itr->second : _hint;
+    if ( hint==SwiftCollisionGraph::IGNORE_NODE ) return;
+    if ( hint==SwiftCollisionGraph::HULL_PER_NODE && _nodeHull<0 )
+    {
+        PieceSource source;
+        source.body = _body;
+        source.drawable = NULL;
+        source.convex = false;
+        pieces.push_back( source );
+    }
+
+    for ( unsigned int i=0; i<node.getNumDrawables(); ++i )
+    {
+        osg::Drawable* drawable = node.getDrawable(i);
+        if ( _nodeHull>=0 || hint==SwiftCollisionGraph::HULL_PER_NODE )
+        {
+            int index = _nodeHull>=0 ? _nodeHull : (int)pieces.size() - 1;
+            pieces[index].parts.push_back( PiecePart(drawable, _matrix) );
+            continue;
+        }
+
+        PieceSource source;
+        source.body = _body;
+        source.drawable = drawable;
+        source.convex = (hint==SwiftCollisionGraph::CONVEX_PER_DRAWABLE);
+        source.parts.push_back( PiecePart(drawable, _matrix) );
+        pieces.push_back( source );
+    }
+}
+
+void GraphDataCollector::apply( osg::Node& node )
+{
+    traverseWithHint( node );
+}
+
+void GraphDataCollector::traverseWithHint( osg::Node& node )
+{
+    HintMap::const_iterator itr = _hints.find( &node );
+    if ( itr==_hints.end() ) { traverse( node ); return; }
+    if ( itr->second==SwiftCollisionGraph::IGNORE_NODE ) return;
+
+    SwiftCollisionGraph::DecompositionHint lastHint = _hint;
+    int lastNodeHull = _nodeHull;
+    _hint = itr->second;
+    if ( _hint==SwiftCollisionGraph::HULL_PER_NODE && _nodeHull<0 )
+    {
+        PieceSource source;
+        source.body = _body;
+        source.drawable = NULL;
+        source.convex = false;
+        _nodeHull = (int)pieces.size();
+        pieces.push_back( source );
+    }
+
+    traverse( node );
+    _hint = lastHint;
+    _nodeHull = lastNodeHull;
+}
+
+/** Replace the welded triangles by their convex hull, keeping only the vertices on it */
+bool computeHull( VertexWelder& welder )
+{
+    int numVertices = (int)welder.vertices.size() / 3;
+    if ( numVertices<4 ) return false;
+
+    // Qhull takes the ownership of the malloc'ed points
+    coordT* points = (coordT*)malloc( sizeof(coordT) * numVertices * 3 );
+    for ( int i=0; i<numVertices * 3; ++i ) points[i] = welder.vertices[i];
+
+    int* faces = NULL, numFaces = 0;
+    Compute_Convex_Hull( points, numVertices, faces, numFaces );
+
+    std::vector<int> newIndices( numVertices, -1 );
+    std::vector<SWIFT_Real> vertices;
+    welder.faces.resize( numFaces * 3 );
+    for ( int i=0; i<numFaces * 3; ++i )
+    {
+        int& index = newIndices[faces[i]];
+        if ( index<0 )
+        {
+            index = (int)vertices.size() / 3;
+            vertices.insert( vertices.end(), welder.vertices.begin() + faces[i] * 3,
+                             welder.vertices.begin() + faces[i] * 3 + 3 );
+        }
+        welder.faces[i] = index;
+    }
+    welder.vertices.swap( vertices );
+    delete[] faces;
+    return numFaces>0;
+}
+
+}
+
+/* SwiftCollisionGraph */
+
+SwiftCollisionGraph::SwiftCollisionGraph( bool useTree, SwiftWorkerPool* pool )
+:   _pool(pool), _scene(NULL), _weldTolerance(1e-5), _contactTolerance(0.0), _useTree(useTree)
+{
+}
+
+SwiftCollisionGraph::~SwiftCollisionGraph()
+{
+    delete _scene;
+}
+
+void SwiftCollisionGraph::setDecompositionHint( osg::Node* node, DecompositionHint hint )
+{
+    _hints[node] = hint;
+}
+
+SwiftCollisionGraph::DecompositionHint SwiftCollisionGraph::getDecompositionHint( osg::Node* node ) const
+{
+    std::map<osg::Node*, DecompositionHint>::const_iterator itr = _hints.find( node );
+    return itr!=_hints.end() ? itr->second : HULL_PER_DRAWABLE;
+}
+
+bool SwiftCollisionGraph::build( osg::Node* root )
+{
+    delete _scene;
+    _scene = new SWIFT_Scene( true, false, _useTree ? AABB_TREE : SWEEP_AND_PRUNE );
+    if ( _pool.valid() ) _scene->Set_Task_Runner( _pool.get() );
+    _root = root;
+    _bodies.clear();
+    _pieces.clear();
+    _movingBodies.clear();
+    _contacts.clear();
+    if ( !root ) return false;
+
+    GraphDataCollector collector( _hints );
+    root->accept( collector );
+    for ( unsigned int i=0; i<collector.bodies.size(); ++i )
+    {
+        BodyData body;
+        body.path = collector.bodies[i];
+        body.scaleWarned = false;
+        _bodies.push_back( body );
+    }
+
+    // Instances of a drawable are copied instead of welded and added again
+    std::map<PieceKey, int> sharedPieces;
+    std::vector< std::vector<int> > bodyPieces( _bodies.size() );
+    VertexWelder welder( _weldTolerance );
+    for ( unsigned int i=0; i<collector.pieces.size(); ++i )
+    {
+        const PieceSource& source = collector.pieces[i];
+        if ( source.parts.empty() ) continue;
+
+        bool fixed = source.body<0, ok = false;
+        int id = 0;
+        PieceKey key( source.drawable, source.parts[0].second, fixed );
+        std::map<PieceKey, int>::iterator itr = sharedPieces.find( key );
+        if ( source.drawable && itr!=sharedPieces.end() )
+            ok = _scene->Copy_Object( itr->second, id );
+        else
+        {
+            welder.clear();
+            for ( unsigned int j=0; j<source.parts.size(); ++j )
+            {
+                osg::TriangleFunctor<CollectFaceOperator> functor;
+                functor.welder = &welder;
+                functor.matrix = source.parts[j].second;
+                source.parts[j].first->accept( functor );
+            }
+
+            if ( welder.faces.empty() || (!source.convex && !computeHull(welder)) )
+            {
+                OSG_NOTICE << "Failed to find enough vertex and index data of drawable "
+                           << source.drawable << std::endl;
+                continue;
+            }
+
+            // Boxes are enlarged so that pairs closer than the tolerance are still tested
+            ok = _scene->Add_Convex_Object(
+                &(welder.vertices[0]), &(welder.faces[0]), (int)welder.vertices.size() / 3,
+                (int)welder.faces.size() / 3, id, fixed, DEFAULT_ORIENTATION, DEFAULT_TRANSLATION,
+                DEFAULT_SCALE, DEFAULT_BOX_SETTING, DEFAULT_BOX_ENLARGE_REL, _contactTolerance * 0.5 );
+            if ( ok && source.drawable ) sharedPieces[key] = id;
+        }
+
+        if ( !ok )
+        {
+            OSG_NOTICE << "Failed to create convex object of drawable " << source.drawable << std::endl;
+            continue;
+        }
+
+        if ( id>=(int)_pieces.size() ) _pieces.resize( id + 1 );
+        _pieces[id].drawable = source.drawable;
+        _pieces[id].body = source.body;
+        if ( !fixed ) bodyPieces[source.body].push_back( id );
+    }
+
+    // Pieces of a body move together and are never tested against each other
+    for ( unsigned int i=0; i<bodyPieces.size(); ++i )
+    {
+        const std::vector<int>& ids = bodyPieces[i];
+        for ( unsigned int j=0; j<ids.size(); ++j )
+        {
+            for ( unsigned int k=j+1; k<ids.size(); ++k )
+                _scene->Deactivate( ids[j], ids[k] );
+        }
+    }
+
+    // Moving objects are ordered by their ids in the batched transformations, as all objects
+    // were added to a new scene
+    for ( unsigned int i=0; i<_pieces.size(); ++i )
+    {
+        if ( _pieces[i].body>=0 ) _movingBodies.push_back( _pieces[i].body );
+    }
+    _transforms.resize( _movingBodies.size() * 12 );
+    applyTransforms();
+    return !_pieces.empty();
+}
+
+void SwiftCollisionGraph::update()
+{
+    if ( !_scene ) return;
+    applyTransforms();
+
+    int numPairs = 0, *pairIDs = NULL;
+    if ( _contactTolerance>0.0 )
+        _scene->Query_Tolerance_Verification( false, _contactTolerance, numPairs, &pairIDs );
+    else
+        _scene->Query_Intersection( false, numPairs, &pairIDs );
+
+    _contacts.resize( numPairs );
+    for ( int i=0; i<numPairs; ++i )
+    {
+        ContactPair& pair = _contacts[i];
+        for ( int j=0; j<2; ++j )
+        {
+            const PieceData& piece = _pieces[pairIDs[i * 2 + j]];
+            pair.nodes[j] = piece.body<0 ? _root.get() : _bodies[piece.body].path.back();
+            pair.drawables[j] = piece.drawable;
+        }
+    }
+
+    if ( _contactCallback.valid() )
+        _contactCallback->contacts( this, _contacts );
+}
+
+void SwiftCollisionGraph::applyTransforms()
+{
+    if ( _movingBodies.empty() ) return;
+
+    // SWIFT takes column vector [R|T] matrices, the transposes of OSG ones
+    std::vector<osg::Matrix> matrices( _bodies.size() );
+    for ( unsigned int i=0; i<_bodies.size(); ++i )
+    {
+        BodyData& body = _bodies[i];
+        osg::Matrix& matrix = matrices[i];
+        matrix = osg::computeLocalToWorld( body.path );
+
+        // Only rotations and translations are allowed
+        osg::Vec3d scale = matrix.getScale();
+        if ( !osg::equivalent(scale[0], 1.0, 1e-4) || !osg::equivalent(scale[1], 1.0, 1e-4) ||
+             !osg::equivalent(scale[2], 1.0, 1e-4) )
+        {
+            if ( !body.scaleWarned )
+            {
+                OSG_NOTICE << "Scale " << scale << " of body " << body.path.back()->getName()
+                           << " is ignored by collision queries" << std::endl;
+                body.scaleWarned = true;
+            }
+            matrix = osg::Matrix::rotate(matrix.getRotate()) * osg::Matrix::translate(matrix.getTrans());
+        }
+    }
+
+    SWIFT_Real* rt = &(_transforms[0]);
+    for ( unsigned int i=0; i<_movingBodies.size(); ++i, rt+=12 )
+    {
+        const osg::Matrix& matrix = matrices[_movingBodies[i]];
+        for ( int r=0; r<3; ++r )
+        {
+            for ( int c=0; c<3; ++c ) rt[r * 4 + c] = matrix(c, r);
+            rt[r * 4 + 3] = matrix(3, r);
+        }
+    }
+    _scene->Set_All_Object_Transformations( &(_transforms[0]) );
+}
@@ -0,0 +1,134 @@
+#ifndef H_SWIFTCOLLISIONGRAPH
+#define H_SWIFTCOLLISIONGRAPH
+
+#include <osg/MatrixTransform>
+#include <osg/Drawable>
+#include <osg/NodeCallback>
+#include <osg/observer_ptr>
+#include <map>
+#include <vector>
+#include <SWIFT.h>
+#include "SwiftWorkerPool.h"
+
+/** Converts a whole subgraph into SWIFT objects and reports all contacting pairs of it.
+    Every MatrixTransform below the root is a rigid body moving with its matrix, unless its data
+    variance is STATIC. Static transforms and geometry outside of bodies are fixed. Each drawable
+    becomes a convex piece of its body by default, and pieces of one body never collide */
+class SwiftCollisionGraph : public osg::Referenced
+{
+public:
+    enum DecompositionHint
+    {
+        HULL_PER_DRAWABLE,    // Each drawable becomes the convex hull of its triangles
+        HULL_PER_NODE,        // The subgraph becomes one convex hull, nested bodies included
+        CONVEX_PER_DRAWABLE,  // Each drawable is convex and closed already, so is used as is
+        IGNORE_NODE           // The subgraph is left out
+    };
+
+    struct ContactPair
+    {
+        /** The bodies, or the root for fixed geometry */
+        osg::Node* nodes[2];
+
+        /** The drawables, or NULL for pieces made from HULL_PER_NODE subgraphs */
+        osg::Drawable* drawables[2];
+    };
+
+    /** Receives the contacting pairs each time the graph is updated */
+    class ContactCallback : public osg::Referenced
+    {
+    public:
+        virtual void contacts( SwiftCollisionGraph* graph, const std::vector<ContactPair>& pairs ) = 0;
+
+    protected:
+        virtual ~ContactCallback() {}
+    };
+
+    /** Node callback updating the graph every frame, e.g. on the root of the subgraph. It only
+        observes the graph, which keeps the root, so keep a reference to the graph elsewhere */
+    class UpdateCallback : public osg::NodeCallback
+    {
+    public:
+        UpdateCallback( SwiftCollisionGraph* graph ) : _graph(graph) {}
+
+        virtual void operator()( osg::Node* node, osg::NodeVisitor* nv )
+        {
+            osg::ref_ptr<SwiftCollisionGraph> graph;
+            if ( _graph.lock(graph) ) graph->update();
+            traverse( node, nv );
+        }
+
+    protected:
+        osg::observer_ptr<SwiftCollisionGraph> _graph;
+    };
+
+    /** Create the graph with the AABB tree broad phase, which suits mostly fixed assemblies,
+        or with sweep and prune. The optional pool runs the narrow phase queries */
+    SwiftCollisionGraph( bool useTree=true, SwiftWorkerPool* pool=NULL );
+
+    /** Set how the subgraph of a node is decomposed into convex pieces. The hint applies to
+        the subgraph until another node below has its own one */
+    void setDecompositionHint( osg::Node* node, DecompositionHint hint );
+    DecompositionHint getDecompositionHint( osg::Node* node ) const;
+
+    /** Set the distance below which vertices are welded, in units of the geometry */
+    void setWeldTolerance( double tol ) { _weldTolerance = tol; }
+    double getWeldTolerance() const { return _weldTolerance; }
+
+    /** Set the distance below which pieces are in contact (0 = only intersecting pieces).
+        The bounding boxes are enlarged by it, so set it before build() */
+    void setContactTolerance( double tol ) { _contactTolerance = tol; }
+    double getContactTolerance() const { return _contactTolerance; }
+
+    void setContactCallback( ContactCallback* cb ) { _contactCallback = cb; }
+    ContactCallback* getContactCallback() { return _contactCallback.get(); }
+
+    /** Convert the subgraph, replacing the previous one. Transforms above the root are ignored */
+    bool build( osg::Node* root );
+
+    /** Move all bodies to the current matrices in one batch, find the contacting pairs and
+        report them to the callback */
+    void update();
+
+    /** Contacting pairs found by last update() */
+    const std::vector<ContactPair>& getContacts() const { return _contacts; }
+
+    /** Number of SWIFT objects, i.e. convex pieces, created by last build() */
+    unsigned int getNumObjects() const { return _pieces.size(); }
+
+    unsigned int getNumBodies() const { return _bodies.size(); }
+    SWIFT_Scene* getScene() { return _scene; }
+
+protected:
+    virtual ~SwiftCollisionGraph();
+
+    /** Set the transformations of all moving objects from the matrices of their bodies */
+    void applyTransforms();
+
+    struct BodyData
+    {
+        osg::NodePath path;  // From the child of root to the body
+        bool scaleWarned;
+    };
+    std::vector<BodyData> _bodies;
+
+    struct PieceData
+    {
+        osg::Drawable* drawable;
+        int body;
+    };
+    std::vector<PieceData> _pieces;
+
+    std::map<osg::Node*, DecompositionHint> _hints;
+    std::vector<SWIFT_Real> _transforms;
+    std::vector<int> _movingBodies;
+    std::vector<ContactPair> _contacts;
+    osg::ref_ptr<osg::Node> _root;
+    osg::ref_ptr<ContactCallback> _contactCallback;
+    osg::ref_ptr<SwiftWorkerPool> _pool;
+    SWIFT_Scene* _scene;
+    double _weldTolerance, _contactTolerance;
+    bool _useTree;
+};
+
+#endif
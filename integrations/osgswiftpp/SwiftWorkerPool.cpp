@@ -0,0 +1,79 @@
+#include <osg/Math>
+#include "SwiftWorkerPool.h"
+
+void SwiftWorkerPool::WorkerThread::run()
+{
+    while ( true )
+    {
+        _pool->_startBarrier.block();
+        if ( _pool->_done ) break;
+
+        _pool->runChunks( _index );
+        _pool->_endBarrier.block();
+    }
+}
+
+/* SwiftWorkerPool */
+
+SwiftWorkerPool::SwiftWorkerPool( int numThreads )
+:   _startBarrier(numThreads>1 ? numThreads : 1), _endBarrier(numThreads>1 ? numThreads : 1),
+    _task(NULL), _count(0), _chunkSize(1), _done(false)
+{
+    for ( int i=1; i<numThreads; ++i )
+    {
+        WorkerThread* thread = new WorkerThread( this, i );
+        thread->start();
+        _threads.push_back( thread );
+    }
+}
+
+SwiftWorkerPool::~SwiftWorkerPool()
+{
+    if ( !_threads.empty() )
+    {
+        // Release all waiting threads with the quit flag set
+        _done = true;
+        _startBarrier.block();
+    }
+
+    for ( unsigned int i=0; i<_threads.size(); ++i )
+    {
+        _threads[i]->join();
+        delete _threads[i];
+    }
+}
+
+void SwiftWorkerPool::Run( SWIFT_Task* task, int numItems )
+{
+    if ( !task || numItems<=0 ) return;
+    if ( _threads.empty() )
+    {
+        task->Run( 0, 0, numItems );
+        return;
+    }
+
+    // Pairs differ a lot in cost (touching pairs walk more features), so use small chunks
+    // that idle threads can pick up; results never depend on which thread runs a chunk
+    int numThreads = Num_Threads();
+    _task = task;
+    _count = numItems;
+    _chunkSize = osg::maximum(numItems / (numThreads * 8), 1);
+    _nextChunk.exchange( 0 );
+
+    _startBarrier.block();
+    runChunks( 0 );
+    _endBarrier.block();
+    _task = NULL;
+}
+
+void SwiftWorkerPool::runChunks( int thread )
+{
+    while ( true )
+    {
+        int begin = (int)(++_nextChunk - 1) * _chunkSize;
+        if ( begin>=_count ) break;
+
+        int end = osg::minimum(begin + _chunkSize, _count);
+        _task->Run( thread, begin, end );
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef H_SWIFTWORKERPOOL
+#define H_SWIFTWORKERPOOL
+
+#include <osg/Referenced>
+#include <OpenThreads/Thread>
+#include <OpenThreads/Barrier>
+#include <OpenThreads/Atomic>
+#include <vector>
+#include <SWIFT.h>
+
+/** A fixed pool of threads executing SWIFT pair queries. The calling thread works as thread 0 */
+class SwiftWorkerPool : public osg::Referenced, public SWIFT_Task_Runner
+{
+public:
+    /** Create the pool with specified number of threads, including the calling thread */
+    SwiftWorkerPool( int numThreads );
+
+    /** Number of threads, including the calling thread */
+    virtual int Num_Threads() const { return (int)_threads.size() + 1; }
+
+    /** Run the task over [0, numItems) and block until all items are processed */
+    virtual void Run( SWIFT_Task* task, int numItems );
+
+protected:
+    virtual ~SwiftWorkerPool();
+
+    /** Execute chunks of current task on the specified thread until nothing is left */
+    void runChunks( int thread );
+
+    class WorkerThread : public OpenThreads::Thread
+    {
+    public:
+        WorkerThread( SwiftWorkerPool* pool, int index ) : _pool(pool), _index(index) {}
+        virtual void run();
+
+    protected:
+        SwiftWorkerPool* _pool;
+        int _index;
+    };
+    friend class WorkerThread;
+
+    std::vector<WorkerThread*> _threads;
+    OpenThreads::Barrier _startBarrier;
+    OpenThreads::Barrier _endBarrier;
+    OpenThreads::Atomic _nextChunk;
+    SWIFT_Task* _task;
+    int _count, _chunkSize;
+    bool _done;
+};
+
+#endif
@@ -0,0 +1,403 @@
+//////////////////////////////////////////////////////////////////////////////
+//
+// boxtree.cpp
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include <SWIFT_config.h>
+#include <SWIFT_common.h>
+#include <SWIFT_linalg.h>
+#include <SWIFT_array.h>
+#include <SWIFT_object.h>
+#include <SWIFT_boxtree.h>
+
+///////////////////////////////////////////////////////////////////////////////
+// Constants
+///////////////////////////////////////////////////////////////////////////////
+
+// Margin added around the object boxes relative to their largest extent
+static const SWIFT_Real BOX_TREE_MARGIN = 0.05;
+
+// Minimum amount to grow the arrays by.  They are doubled when larger.
+static const int BOX_TREE_GROW_SIZE = 64;
+
+///////////////////////////////////////////////////////////////////////////////
+// Local functions
+///////////////////////////////////////////////////////////////////////////////
+
+// Half the surface area of a box
+inline SWIFT_Real Area( const SWIFT_Real* min, const SWIFT_Real* max )
+{
+    const SWIFT_Real dx = max[0]-min[0];
+    const SWIFT_Real dy = max[1]-min[1];
+    const SWIFT_Real dz = max[2]-min[2];
+    return dx*dy + dy*dz + dz*dx;
+}
+
+// Half the surface area of the union of two boxes
+inline SWIFT_Real Union_Area( const SWIFT_Real* min0, const SWIFT_Real* max0,
+                              const SWIFT_Real* min1, const SWIFT_Real* max1 )
+{
+    SWIFT_Real min[3], max[3];
+    int i;
+    for( i = 0; i < 3; i++ ) {
+        min[i] = min0[i] < min1[i] ? min0[i] : min1[i];
+        max[i] = max0[i] > max1[i] ? max0[i] : max1[i];
+    }
+    return Area( min, max );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SWIFT_Box_Tree public functions
+///////////////////////////////////////////////////////////////////////////////
+
+SWIFT_Box_Tree::SWIFT_Box_Tree( )
+{
+    nodes.Set_Length( 0 );
+    moved_proxies.Set_Length( 0 );
+    stack.Set_Length( 0 );
+    root = -1;
+    free_list = -1;
+}
+
+int SWIFT_Box_Tree::Insert( SWIFT_Object* obj )
+{
+    const int leaf = Allocate_Node();
+
+    nodes[leaf].obj = obj;
+    Set_Leaf_Box( leaf );
+    Insert_Leaf( leaf );
+    Mark_Moved( leaf );
+
+    return leaf;
+}
+
+void SWIFT_Box_Tree::Remove( int proxy )
+{
+    int i;
+
+    if( nodes[proxy].moved ) {
+        for( i = 0; moved_proxies[i] != proxy; i++ );
+        moved_proxies[i] = moved_proxies.Last();
+        moved_proxies.Decrement_Length();
+    }
+
+    Remove_Leaf( proxy );
+    Free_Node( proxy );
+}
+
+bool SWIFT_Box_Tree::Move( int proxy )
+{
+    SWIFT_Box_Tree_Node& leaf = nodes[proxy];
+    int i;
+
+    // Nothing to do while the object stays in the enlarged box
+    for( i = 0; i < 3; i++ ) {
+        if( leaf.obj->Min_Box_Node( i )->Value() < leaf.min[i] ||
+            leaf.obj->Max_Box_Node( i )->Value() > leaf.max[i]
+        ) {
+            break;
+        }
+    }
+    if( i == 3 ) {
+        return false;
+    }
+
+    Remove_Leaf( proxy );
+    Set_Leaf_Box( proxy );
+    Insert_Leaf( proxy );
+    Mark_Moved( proxy );
+
+    return true;
+}
+
+void SWIFT_Box_Tree::Query( const SWIFT_Real* min, const SWIFT_Real* max,
+                            SWIFT_Array<SWIFT_Object*>& hits )
+{
+    int i;
+
+    if( root == -1 ) {
+        return;
+    }
+
+    stack.Set_Length( 0 );
+    stack.Add_Grow( root, BOX_TREE_GROW_SIZE );
+    while( !stack.Empty() ) {
+        i = stack.Last();
+        stack.Decrement_Length();
+        if( !Overlap( min, max, nodes[i].min, nodes[i].max ) ) {
+            continue;
+        }
+        if( nodes[i].Is_Leaf() ) {
+            hits.Add_Grow( nodes[i].obj,
+                           max( hits.Length(), BOX_TREE_GROW_SIZE ) );
+        } else {
+            stack.Add_Grow( nodes[i].child0, BOX_TREE_GROW_SIZE );
+            stack.Add_Grow( nodes[i].child1, BOX_TREE_GROW_SIZE );
+        }
+    }
+}
+
+void SWIFT_Box_Tree::Clear_Moved( )
+{
+    int i;
+
+    for( i = 0; i < moved_proxies.Length(); i++ ) {
+        nodes[moved_proxies[i]].moved = false;
+    }
+    moved_proxies.Set_Length( 0 );
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// SWIFT_Box_Tree private functions
+///////////////////////////////////////////////////////////////////////////////
+
+int SWIFT_Box_Tree::Allocate_Node( )
+{
+    int i;
+
+    if( free_list == -1 ) {
+        if( nodes.Length() == nodes.Max_Length() ) {
+            nodes.Grow( max( nodes.Length(), BOX_TREE_GROW_SIZE ) );
+        }
+        i = nodes.Length();
+        nodes.Increment_Length();
+    } else {
+        i = free_list;
+        free_list = nodes[i].parent;
+    }
+
+    nodes[i].obj = NULL;
+    nodes[i].parent = -1;
+    nodes[i].child0 = -1;
+    nodes[i].child1 = -1;
+    nodes[i].height = 0;
+    nodes[i].moved = false;
+
+    return i;
+}
+
+void SWIFT_Box_Tree::Free_Node( int i )
+{
+    nodes[i].obj = NULL;
+    nodes[i].height = -1;
+    nodes[i].parent = free_list;
+    free_list = i;
+}
+
+// Set the box of a leaf to the enlarged box of its object
+void SWIFT_Box_Tree::Set_Leaf_Box( int leaf )
+{
+    SWIFT_Box_Tree_Node& node = nodes[leaf];
+    SWIFT_Real margin = 0.0;
+    int i;
+
+    for( i = 0; i < 3; i++ ) {
+        node.min[i] = node.obj->Min_Box_Node( i )->Value();
+        node.max[i] = node.obj->Max_Box_Node( i )->Value();
+        margin = max( margin, node.max[i]-node.min[i] );
+    }
+
+    margin *= BOX_TREE_MARGIN;
+    for( i = 0; i < 3; i++ ) {
+        node.min[i] -= margin;
+        node.max[i] += margin;
+    }
+}
+
+void SWIFT_Box_Tree::Mark_Moved( int leaf )
+{
+    if( !nodes[leaf].moved ) {
+        nodes[leaf].moved = true;
+        moved_proxies.Add_Grow( leaf, max( moved_proxies.Length(),
+                                          BOX_TREE_GROW_SIZE ) );
+    }
+}
+
+void SWIFT_Box_Tree::Insert_Leaf( int leaf )
+{
+    SWIFT_Real min[3], max[3];
+    SWIFT_Real area, combined, cost, cost0, cost1, inheritance;
+    int i, c0, c1, sibling, old_parent, new_parent;
+
+    if( root == -1 ) {
+        root = leaf;
+        nodes[leaf].parent = -1;
+        return;
+    }
+
+    // Copy the box since allocating a node may move the nodes
+    for( i = 0; i < 3; i++ ) {
+        min[i] = nodes[leaf].min[i];
+        max[i] = nodes[leaf].max[i];
+    }
+
+    // Find the best sibling by the surface area heuristic
+    i = root;
+    while( !nodes[i].Is_Leaf() ) {
+        c0 = nodes[i].child0;
+        c1 = nodes[i].child1;
+
+        area = Area( nodes[i].min, nodes[i].max );
+        combined = Union_Area( nodes[i].min, nodes[i].max, min, max );
+
+        // Cost of making a new parent for this node and the leaf
+        cost = 2.0 * combined;
+
+        // Cost of pushing the leaf further down the tree
+        inheritance = 2.0 * (combined-area);
+        cost0 = Union_Area( nodes[c0].min, nodes[c0].max, min, max ) +
+                inheritance;
+        if( !nodes[c0].Is_Leaf() ) {
+            cost0 -= Area( nodes[c0].min, nodes[c0].max );
+        }
+        cost1 = Union_Area( nodes[c1].min, nodes[c1].max, min, max ) +
+                inheritance;
+        if( !nodes[c1].Is_Leaf() ) {
+            cost1 -= Area( nodes[c1].min, nodes[c1].max );
+        }
+
+        if( cost < cost0 && cost < cost1 ) {
+            break;
+        }
+
+        i = cost0 < cost1 ? c0 : c1;
+    }
+    sibling = i;
+
+    // Create a new parent for the sibling and the leaf
+    old_parent = nodes[sibling].parent;
+    new_parent = Allocate_Node();
+    nodes[new_parent].parent = old_parent;
+    nodes[new_parent].child0 = sibling;
+    nodes[new_parent].child1 = leaf;
+    nodes[sibling].parent = new_parent;
+    nodes[leaf].parent = new_parent;
+
+    if( old_parent == -1 ) {
+        root = new_parent;
+    } else if( nodes[old_parent].child0 == sibling ) {
+        nodes[old_parent].child0 = new_parent;
+    } else {
+        nodes[old_parent].child1 = new_parent;
+    }
+
+    // Fix the heights and boxes on the way up
+    for( i = new_parent; i != -1; i = nodes[i].parent ) {
+        i = Balance( i );
+        Refit( i );
+    }
+}
+
+void SWIFT_Box_Tree::Remove_Leaf( int leaf )
+{
+    int i, parent, grand_parent, sibling;
+
+    if( leaf == root ) {
+        root = -1;
+        return;
+    }
+
+    parent = nodes[leaf].parent;
+    grand_parent = nodes[parent].parent;
+    sibling = nodes[parent].child0 == leaf ? nodes[parent].child1 :
+                                             nodes[parent].child0;
+
+    // Replace the parent by the sibling
+    nodes[sibling].parent = grand_parent;
+    Free_Node( parent );
+
+    if( grand_parent == -1 ) {
+        root = sibling;
+        return;
+    }
+
+    if( nodes[grand_parent].child0 == parent ) {
+        nodes[grand_parent].child0 = sibling;
+    } else {
+        nodes[grand_parent].child1 = sibling;
+    }
+
+    // Fix the heights and boxes on the way up
+    for( i = grand_parent; i != -1; i = nodes[i].parent ) {
+        i = Balance( i );
+        Refit( i );
+    }
+}
+
+// Set the height and the box of an internal node from its children
+void SWIFT_Box_Tree::Refit( int i )
+{
+    SWIFT_Box_Tree_Node& node = nodes[i];
+    const SWIFT_Box_Tree_Node& node0 = nodes[node.child0];
+    const SWIFT_Box_Tree_Node& node1 = nodes[node.child1];
+    int j;
+
+    node.height = 1 + max( node0.height, node1.height );
+    for( j = 0; j < 3; j++ ) {
+        node.min[j] = node0.min[j] < node1.min[j] ? node0.min[j] : node1.min[j];
+        node.max[j] = node0.max[j] > node1.max[j] ? node0.max[j] : node1.max[j];
+    }
+}
+
+// Rotate the higher child of a node up if the heights of the children differ
+// by more than one.  Returns the node which took the place of the given one.
+int SWIFT_Box_Tree::Balance( int ia )
+{
+    SWIFT_Box_Tree_Node& a = nodes[ia];
+    int ib, ic, iup, ikeep, imove;
+
+    if( a.Is_Leaf() || a.height < 2 ) {
+        return ia;
+    }
+
+    ib = a.child0;
+    ic = a.child1;
+    if( nodes[ic].height - nodes[ib].height > 1 ) {
+        iup = ic;
+    } else if( nodes[ib].height - nodes[ic].height > 1 ) {
+        iup = ib;
+    } else {
+        return ia;
+    }
+
+    SWIFT_Box_Tree_Node& up = nodes[iup];
+
+    // The higher child of the rising node stays with it and the lower one
+    // takes the place of the rising node under a
+    if( nodes[up.child0].height > nodes[up.child1].height ) {
+        ikeep = up.child0;
+        imove = up.child1;
+    } else {
+        ikeep = up.child1;
+        imove = up.child0;
+    }
+
+    // Put the rising node in the place of a
+    up.parent = a.parent;
+    if( up.parent == -1 ) {
+        root = iup;
+    } else if( nodes[up.parent].child0 == ia ) {
+        nodes[up.parent].child0 = iup;
+    } else {
+        nodes[up.parent].child1 = iup;
+    }
+
+    // a becomes a child of the rising node
+    up.child0 = ia;
+    up.child1 = ikeep;
+    a.parent = iup;
+    if( iup == ib ) {
+        a.child0 = imove;
+    } else {
+        a.child1 = imove;
+    }
+    nodes[imove].parent = ia;
+
+    Refit( ia );
+    Refit( iup );
+
+    return iup;
+}
+
+
@@ -2740,7 +2740,7 @@ void SWIFT_Tri_Mesh::Compute_Radius( )
     SWIFT_Real d;
     radius = 0.0;
     for( i = 0; i < Num_Vertices(); i++ ) {
-        d = Center().Dist_Sq( verts[i].Coords() );
+        d = Center_Of_Mass().Dist_Sq( verts[i].Coords() );
         if( d > radius ) {
             radius = d;
         }
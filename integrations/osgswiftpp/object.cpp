@@ -63,6 +63,7 @@
 SWIFT_Object::SWIFT_Object( )
 {
     mesh = NULL;
+    proxy = -1;
     min_bns[0].Set_Is_Max( false ), max_bns[0].Set_Is_Max( true ),
     min_bns[1].Set_Is_Max( false ), max_bns[1].Set_Is_Max( true ),
     min_bns[2].Set_Is_Max( false ), max_bns[2].Set_Is_Max( true );
@@ -1,174 +1,290 @@
 #include <osg/ShapeDrawable>
 #include <osg/MatrixTransform>
-#include <osg/TriangleFunctor>
 #include <osgDB/ReadFile>
 #include <osgUtil/SmoothingVisitor>
 #include <osgGA/StateSetManipulator>
 #include <osgViewer/ViewerEventHandlers>
 #include <osgViewer/Viewer>
+#include <osg/Timer>
+#include <iostream>
 
 #include <SWIFT.h>
+#include <SWIFT_mesh.h>
+#include <SWIFT_fileio.h>
+#include "SwiftWorkerPool.h"
+#include "SwiftCollisionGraph.h"
 
-struct CollectFaceOperator
+class MoveVehicleHandler : public osgGA::GUIEventHandler
 {
-    void operator()( const osg::Vec3& v1, const osg::Vec3& v2, const osg::Vec3& v3, bool temp )
-    {
-        if ( v1==v2 || v2==v3 || v3==v1 ) return;
-        indices.push_back( findIndex(v1) );
-        indices.push_back( findIndex(v2) );
-        indices.push_back( findIndex(v3) );
-    }
+public:
+    MoveVehicleHandler( SwiftCollisionGraph* graph, osg::MatrixTransform* actor )
+    :   _graph(graph), _actor(actor) {}
     
-    unsigned int findIndex( const osg::Vec3& v )
+    virtual bool handle( const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa )
     {
-        unsigned int index = 0;
-        if ( vertexMap.find(v)==vertexMap.end() )
+        if ( !_actor ) return false;
+        if ( ea.getEventType()==osgGA::GUIEventAdapter::KEYDOWN )
         {
-            index = vertexMap.size();
-            vertexMap[v] = index;
+            // Handle user inputs
+            osg::Matrix matrix = _actor->getMatrix();
+            switch ( ea.getKey() )
+            {
+            case osgGA::GUIEventAdapter::KEY_Left:
+                matrix = matrix * osg::Matrix::translate(-0.2f, 0.0f, 0.0f);
+                break;
+            case osgGA::GUIEventAdapter::KEY_Right:
+                matrix = matrix * osg::Matrix::translate(0.2f, 0.0f, 0.0f);
+                break;
+            case osgGA::GUIEventAdapter::KEY_Down:
+                matrix = matrix * osg::Matrix::translate(0.0f, -0.2f, 0.0f);
+                break;
+            case osgGA::GUIEventAdapter::KEY_Up:
+                matrix = matrix * osg::Matrix::translate(0.0f, 0.2f, 0.0f);
+                break;
+            default: return false;
+            }
             
-            vertices.push_back( v[0] );
-            vertices.push_back( v[1] );
-            vertices.push_back( v[2] );
+            // The actor is the only body of the graph, so every contact blocks the move
+            osg::Matrix lastMatrix = _actor->getMatrix();
+            _actor->setMatrix( matrix );
+            _graph->update();
+            if ( !_graph->getContacts().empty() )
+                _actor->setMatrix( lastMatrix );
         }
-        else index = vertexMap[v];
-        return index;
+        return false;
     }
     
-    std::map<osg::Vec3, int> vertexMap;
-    std::vector<SWIFT_Real> vertices;
-    std::vector<int> indices;
+protected:
+    osg::ref_ptr<SwiftCollisionGraph> _graph;
+    osg::observer_ptr<osg::MatrixTransform> _actor;
 };
 
-class MoveVehicleHandler : public osgGA::GUIEventHandler
+class PrintContactsCallback : public SwiftCollisionGraph::ContactCallback
 {
 public:
-    MoveVehicleHandler() : _actorID(-1)
+    PrintContactsCallback() : _numContacts(0) {}
+    
+    virtual void contacts( SwiftCollisionGraph* graph, const std::vector<SwiftCollisionGraph::ContactPair>& pairs )
     {
-        _swiftScene = new SWIFT_Scene( true, false );
+        // Only report changes, as an assembly keeps the same contacts every frame
+        if ( pairs.size()==_numContacts ) return;
+        _numContacts = pairs.size();
+        std::cout << "Contacts: " << _numContacts << std::endl;
+        for ( unsigned int i=0; i<pairs.size(); ++i )
+        {
+            const SwiftCollisionGraph::ContactPair& pair = pairs[i];
+            std::cout << "    " << pair.nodes[0]->getName() << " (" << pair.drawables[0] << ") - "
+                      << pair.nodes[1]->getName() << " (" << pair.drawables[1] << ")" << std::endl;
+        }
     }
     
-    virtual ~MoveVehicleHandler()
+protected:
+    unsigned int _numContacts;
+};
+
+int runInterferenceCheck( osg::Node* model, int numThreads, int numFrames, bool useTree )
+{
+    osg::ref_ptr<SwiftCollisionGraph> graph = new SwiftCollisionGraph(
+        useTree, numThreads>1 ? new SwiftWorkerPool(numThreads) : NULL );
+    graph->setContactCallback( new PrintContactsCallback );
+    
+    osg::Timer_t t0 = osg::Timer::instance()->tick();
+    if ( !graph->build(model) )
     {
-        delete _swiftScene;
+        OSG_NOTICE << "No convex pieces found in the model" << std::endl;
+        return 1;
     }
     
-    void setActor( int id, osg::MatrixTransform* actor )
-    { _actorID = id; _actor = actor; }
+    osg::Timer_t t1 = osg::Timer::instance()->tick();
+    for ( int f=0; f<numFrames; ++f ) graph->update();
+    
+    osg::Timer_t t2 = osg::Timer::instance()->tick();
+    std::cout << "Pieces: " << graph->getNumObjects() << ", Bodies: " << graph->getNumBodies()
+              << ", Build: " << osg::Timer::instance()->delta_m(t0, t1) << "ms"
+              << ", Update: " << osg::Timer::instance()->delta_m(t1, t2) / numFrames << "ms/frame" << std::endl;
+    return 0;
+}
+
+/* Read a convex mesh with the SWIFT file readers (TRI, POLY or OBJ files starting with "#OBJ"),
+   centered and scaled to the size of the default icosahedrons so the scene stays as crowded */
+bool readBenchmarkMesh( const std::string& file, std::vector<SWIFT_Real>& vertices,
+                        std::vector<int>& faces, std::vector<int>& valences )
+{
+    SWIFT_File_Read_Dispatcher dispatcher;
+    SWIFT_Basic_File_Reader basicReader; basicReader.Register_Yourself( dispatcher );
+    SWIFT_Obj_File_Reader objReader; objReader.Register_Yourself( dispatcher );
+    SWIFT_File_IO_Initialize();
     
-    int addSwiftObject( const osg::Matrix& matrix, osg::Drawable* drawable )
+    SWIFT_Real* vs = NULL; int *fs = NULL, *fv = NULL, numVertices = 0, numFaces = 0;
+    bool ok = dispatcher.Read( file.c_str(), vs, fs, numVertices, numFaces, fv ) && numVertices>0 && numFaces>0;
+    if ( ok )
     {
-        osg::TriangleFunctor<CollectFaceOperator> cf;
-        drawable->accept( cf );
+        osg::BoundingBoxd bb;
+        for ( int i=0; i<numVertices; ++i ) bb.expandBy( vs[i * 3], vs[i * 3 + 1], vs[i * 3 + 2] );
         
-        int id = 0, vertexSize = (int)cf.vertices.size()/3, indexSize = (int)cf.indices.size()/3;
-        if ( vertexSize>0 && indexSize>0 )
-        {
-            bool ok = _swiftScene->Add_Convex_Object(
-                &(cf.vertices[0]), &(cf.indices[0]), vertexSize, indexSize, id, false );
-            if ( !ok )
-            {
-                OSG_NOTICE << "Failed to create convex object" << std::endl;
-                return -1;
-            }
-        }
-        else
-        {
-            OSG_NOTICE << "Failed to find vertex and index data" << std::endl;
-            return -1;
-        }
+        osg::Vec3d halfSize = (bb._max - bb._min) * 0.5;
+        double scale = (1.0 + sqrt(5.0)) * 0.5 / osg::maximum(halfSize.x(), osg::maximum(halfSize.y(), halfSize.z()));
+        vertices.resize( numVertices * 3 );
+        for ( int i=0; i<numVertices * 3; ++i ) vertices[i] = (vs[i] - bb.center()[i % 3]) * scale;
         
-        setSwiftTransformation( id, matrix );
-        return id;
+        int numIndices = 0;
+        for ( int i=0; i<numFaces; ++i ) numIndices += fv ? fv[i] : 3;
+        faces.assign( fs, fs + numIndices );
+        if ( fv ) valences.assign( fv, fv + numFaces );
     }
+    delete[] vs; delete[] fs; delete[] fv;
+    return ok;
+}
+
+int runBenchmark( int numObjects, int numThreads, int numFrames, bool useTree, const std::string& meshFile )
+{
+    // Icosahedrons by default, which are convex without coplanar faces
+    const SWIFT_Real p = (1.0 + sqrt(5.0)) * 0.5;
+    const SWIFT_Real icosahedronVertices[36] =
+    {
+        -1, p, 0,  1, p, 0,  -1, -p, 0,  1, -p, 0,  0, -1, p,  0, 1, p,
+        0, -1, -p,  0, 1, -p,  p, 0, -1,  p, 0, 1,  -p, 0, -1,  -p, 0, 1
+    };
+    const int icosahedronFaces[60] =
+    {
+        0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,  1, 5, 9,  5, 11, 4,
+        11, 10, 2,  10, 7, 6,  7, 1, 8,  3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,
+        3, 8, 9,  4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1
+    };
     
-    void finish()
+    std::vector<SWIFT_Real> vertices( icosahedronVertices, icosahedronVertices + 36 );
+    std::vector<int> faces( icosahedronFaces, icosahedronFaces + 60 ), valences;
+    if ( !meshFile.empty() && !readBenchmarkMesh(meshFile, vertices, faces, valences) )
     {
-        // Query only the actor because it is the only dynamic object in the scene
-        _swiftScene->Deactivate();
-        _swiftScene->Activate( _actorID );
+        OSG_NOTICE << "Failed to read mesh " << meshFile << std::endl;
+        return 1;
     }
     
-    void setSwiftTransformation( int id, const osg::Matrix& matrix )
+    int numVertices = vertices.size() / 3;
+    int numFaces = valences.empty() ? faces.size() / 3 : valences.size();
+    const int* faceValences = valences.empty() ? DEFAULT_FACE_VALENCES : &valences[0];
+    
+    osg::ref_ptr<SwiftWorkerPool> pool = new SwiftWorkerPool( numThreads );
+    SWIFT_Scene* swiftScene = new SWIFT_Scene( true, true, useTree ? AABB_TREE : SWEEP_AND_PRUNE );
+    swiftScene->Set_Task_Runner( pool.get() );
+    
+    // Boxes are enlarged by half the distance tolerance, so that both broad phases find
+    // every pair within the tolerance
+    int id = 0;
+    for ( int i=0; i<numObjects; ++i )
     {
-        SWIFT_Real R[9];
-        for ( int x=0; x<3; ++x )
+        if ( !swiftScene->Add_Convex_Object(&vertices[0], &faces[0], numVertices, numFaces, id, DEFAULT_FIXED,
+                                            DEFAULT_ORIENTATION, DEFAULT_TRANSLATION, DEFAULT_SCALE,
+                                            DEFAULT_BOX_SETTING, 0.0, 0.25, faceValences) )
         {
-            for ( int y=0; y<3; ++y )
-                R[x*3+y] = matrix(x, y);
+            OSG_NOTICE << "Failed to create convex object" << std::endl;
+            delete swiftScene;
+            return 1;
         }
-        
-        SWIFT_Real T[3];
-        for ( int i=0; i<3; ++i ) T[i] = matrix(3, i);
-        _swiftScene->Set_Object_Transformation( id, R, T );
     }
     
-    virtual bool handle( const osgGA::GUIEventAdapter& ea, osgGA::GUIActionAdapter& aa )
+    // Objects drift slowly in a box crowded enough for many overlapping pairs. The broad
+    // phase is sorted once before timing, as it relies on coherence between frames
+    srand( 0 );
+    double size = pow((double)numObjects / 0.35, 1.0 / 3.0) * 2.5;
+    std::vector<osg::Vec3d> positions( numObjects );
+    for ( int i=0; i<numObjects; ++i )
     {
-        if ( !_actor ) return false;
-        if ( ea.getEventType()==osgGA::GUIEventAdapter::KEYDOWN )
+        positions[i].set( size * (rand() % 10000) / 10000.0, size * (rand() % 10000) / 10000.0,
+                          size * (rand() % 10000) / 10000.0 );
+    }
+    
+    double times[4] = { 0.0, 0.0, 0.0, 0.0 }, checksum = 0.0;
+    int numPairs = 0, numContacts = 0, *pairIDs = NULL, *contacts = NULL;
+    SWIFT_Real *dists = NULL, *points = NULL;
+    for ( int f=-1; f<numFrames; ++f )
+    {
+        // Despawn and respawn 1% of objects, which get the same ids back
+        osg::Timer_t t = osg::Timer::instance()->tick();
+        for ( int i=0; f>=0 && i<numObjects; i+=100 )
         {
-            // Handle user inputs
-            osg::Matrix matrix = _actor->getMatrix();
-            switch ( ea.getKey() )
-            {
-            case osgGA::GUIEventAdapter::KEY_Left:
-                matrix = matrix * osg::Matrix::translate(-0.2f, 0.0f, 0.0f);
-                break;
-            case osgGA::GUIEventAdapter::KEY_Right:
-                matrix = matrix * osg::Matrix::translate(0.2f, 0.0f, 0.0f);
-                break;
-            case osgGA::GUIEventAdapter::KEY_Down:
-                matrix = matrix * osg::Matrix::translate(0.0f, -0.2f, 0.0f);
-                break;
-            case osgGA::GUIEventAdapter::KEY_Up:
-                matrix = matrix * osg::Matrix::translate(0.0f, 0.2f, 0.0f);
-                break;
-            default: return false;
-            }
-            
-            // Apply transformation for intersection query
-            setSwiftTransformation( _actorID, matrix );
+            int index = (i + f * 37) % numObjects;
+            swiftScene->Delete_Object( index );
+            swiftScene->Add_Convex_Object( &vertices[0], &faces[0], numVertices, numFaces, id, DEFAULT_FIXED,
+                                           DEFAULT_ORIENTATION, DEFAULT_TRANSLATION, DEFAULT_SCALE,
+                                           DEFAULT_BOX_SETTING, 0.0, 0.25, faceValences );
+        }
+        if ( f>=0 ) times[3] += osg::Timer::instance()->delta_m(t, osg::Timer::instance()->tick());
+        
+        for ( int i=0; i<numObjects; ++i )
+        {
+            osg::Matrix matrix = osg::Matrix::rotate(0.01 * f + i, osg::Z_AXIS) * osg::Matrix::translate(positions[i]);
+            if ( f>=0 ) positions[i] += osg::Vec3d(rand() % 1000 - 500, rand() % 1000 - 500, rand() % 1000 - 500) * 0.0004;
             
-            // Check if there are intersections
-            bool canMove = true;
-            int numPairs = 0;
-            int* pairIDs = NULL;
-#if 0  // Compute exact intersection pairs and distances
-            SWIFT_Real* dists = NULL;
-            if ( _swiftScene->Query_Exact_Distance(false, SWIFT_INFINITY, numPairs, &pairIDs, &dists) )
+            SWIFT_Real R[9], T[3];
+            for ( int x=0; x<3; ++x )
             {
-                for ( int i=0; i<numPairs; ++i )
-                {
-                    if ( dists[i]>0.1f ) continue;
-                    std::cout << pairIDs[i<<1] << " and " << pairIDs[(i<<1) + 1]
-                              << ": " << dists[i] << std::endl;
-                    canMove = false;
-                }
+                for ( int y=0; y<3; ++y ) R[x*3+y] = matrix(x, y);
+                T[x] = matrix(3, x);
             }
-#else  // Only do intersection test
-            if ( _swiftScene->Query_Intersection(true, numPairs, &pairIDs) )
-            {
-                canMove = false;
-            }
-#endif
-            
-            // Apply the result to the scene graph
-            if ( canMove )
-                _actor->setMatrix( matrix );
+            swiftScene->Set_Object_Transformation( i, R, T );
         }
-        return false;
+        
+        osg::Timer_t t0 = osg::Timer::instance()->tick();
+        swiftScene->Query_Intersection( false, numPairs, &pairIDs );
+        if ( f<0 ) continue;
+        for ( int i=0; i<numPairs*2; ++i ) checksum += pairIDs[i];
+        
+        osg::Timer_t t1 = osg::Timer::instance()->tick();
+        swiftScene->Query_Exact_Distance( false, 0.5, numPairs, &pairIDs, &dists );
+        for ( int i=0; i<numPairs; ++i ) checksum += dists[i];
+        
+        osg::Timer_t t2 = osg::Timer::instance()->tick();
+        swiftScene->Query_Contact_Determination( false, 0.5, numPairs, &pairIDs, &contacts, &dists, &points );
+        for ( int i=0, c=0; i<numPairs; ++i )
+        {
+            if ( contacts[i]<0 ) { c++; continue; }
+            for ( int j=0; j<contacts[i]; ++j, ++c )
+                checksum += dists[c] + points[c * 6] + points[c * 6 + 3];
+            numContacts += contacts[i];
+        }
+        
+        osg::Timer_t t3 = osg::Timer::instance()->tick();
+        times[0] += osg::Timer::instance()->delta_m(t0, t1);
+        times[1] += osg::Timer::instance()->delta_m(t1, t2);
+        times[2] += osg::Timer::instance()->delta_m(t2, t3);
     }
+    delete swiftScene;
     
-protected:
-    osg::observer_ptr<osg::MatrixTransform> _actor;
-    SWIFT_Scene* _swiftScene;
-    int _actorID;
-};
+    std::cout << "Objects: " << numObjects << " (" << numFaces << " faces), Threads: " << numThreads
+              << ", Broad phase: " << (useTree ? "AABB tree" : "sweep and prune")
+              << ", Respawn: " << times[3] / numFrames << "ms/frame"
+              << ", Intersection: " << times[0] / numFrames << "ms/frame"
+              << ", Distance: " << times[1] / numFrames << "ms/frame"
+              << ", Contacts: " << times[2] / numFrames << "ms/frame (" << numContacts << ")"
+              << ", Checksum: " << checksum << std::endl;
+    return 0;
+}
 
 // Some code copied from osgmicropather
 int main( int argc, char** argv )
 {
+    // Headless query benchmark, e.g. --benchmark 2000 --threads 8 --tree --mesh convex.obj
+    osg::ArgumentParser arguments( &argc, argv );
+    int numObjects = 0, numThreads = 1, numFrames = 20;
+    bool useTree = arguments.read( "--tree" );
+    arguments.read( "--threads", numThreads );
+    arguments.read( "--frames", numFrames );
+    
+    std::string meshFile;
+    arguments.read( "--mesh", meshFile );
+    if ( arguments.read("--benchmark", numObjects) )
+        return runBenchmark( numObjects, numThreads, numFrames, useTree, meshFile );
+    
+    // Headless interference check of all parts of a model, e.g. --graph assembly.osgb
+    std::string modelFile;
+    if ( arguments.read("--graph", modelFile) )
+    {
+        osg::ref_ptr<osg::Node> model = osgDB::readNodeFile( modelFile );
+        if ( !model ) return 1;
+        return runInterferenceCheck( model.get(), numThreads, numFrames, useTree );
+    }
+    
     // Create path properties
     const int mapData[10 * 10] =
     { 
@@ -184,9 +300,6 @@ int main( int argc, char** argv )
         1, 1, 0, 1, 1, 1, 1, 1, 1, 1
     };
     
-    // Create the interactive handler
-    osg::ref_ptr<MoveVehicleHandler> handler = new MoveVehicleHandler;
-    
     // Create the actor
     osg::ref_ptr<osg::ShapeDrawable> actorShape =
         new osg::ShapeDrawable( new osg::Box(osg::Vec3(), 3.0f) );
@@ -202,9 +315,6 @@ int main( int argc, char** argv )
     osg::ref_ptr<osg::MatrixTransform> scene = new osg::MatrixTransform;
     scene->addChild( actor.get() );
     
-    int id = handler->addSwiftObject( actor->getMatrix(), actorShape.get() );
-    if ( id>=0 ) handler->setActor( id, actor.get() );
-    
     // Create the map geometries
     osg::ref_ptr<osg::ShapeDrawable> groundShape = new osg::ShapeDrawable(
         new osg::Box(osg::Vec3(45.0f, 45.0f, 0.0f), 100.0f, 100.0f, 0.5f) );
@@ -214,6 +324,7 @@ int main( int argc, char** argv )
     ground->addDrawable( groundShape.get() );
     scene->addChild( ground.get() );
     
+    // Static walls are fixed in the collision graph and share one piece
     osg::ref_ptr<osg::Geode> geode = new osg::Geode;
     geode->addDrawable( new osg::ShapeDrawable(new osg::Box(osg::Vec3(0.0f, 0.0f, 5.0f), 10.0f)) );
     for ( int x=0; x<10; ++x )
@@ -222,21 +333,24 @@ int main( int argc, char** argv )
         {
             if ( mapData[y*10 + x]==0 ) continue;
             osg::ref_ptr<osg::MatrixTransform> boxNode = new osg::MatrixTransform;
+            boxNode->setDataVariance( osg::Object::STATIC );
             boxNode->setMatrix( osg::Matrix::translate(10.0f*(float)x, 10.0f*(float)y, 0.0f) );
             boxNode->addChild( geode.get() );
             scene->addChild( boxNode.get() );
-            handler->addSwiftObject( boxNode->getMatrix(), geode->getDrawable(0) );
         }
     }
     
+    // Create the collision graph, which has the actor as the only moving body
+    osg::ref_ptr<SwiftCollisionGraph> graph = new SwiftCollisionGraph;
+    graph->setDecompositionHint( scene.get(), SwiftCollisionGraph::CONVEX_PER_DRAWABLE );
+    graph->build( scene.get() );
+    
     // Create the viewer
     osgViewer::Viewer viewer;
-    viewer.addEventHandler( handler.get() );
+    viewer.addEventHandler( new MoveVehicleHandler(graph.get(), actor.get()) );
     viewer.addEventHandler( new osgGA::StateSetManipulator(viewer.getCamera()->getOrCreateStateSet()) );
     viewer.addEventHandler( new osgViewer::StatsHandler );
     viewer.addEventHandler( new osgViewer::WindowSizeHandler );
     viewer.setSceneData( scene.get() );
-    
-    handler->finish();
     return viewer.run();
 }
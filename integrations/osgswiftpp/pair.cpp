@@ -110,92 +110,93 @@ static const int FACE = 3;
 ///////////////////////////////////////////////////////////////////////////////
 
 // These are setup before a query
-static SWIFT_Object* obj0;
-static SWIFT_Object* obj1;
+static SWIFT_THREAD_LOCAL SWIFT_Object* obj0;
+static SWIFT_THREAD_LOCAL SWIFT_Object* obj1;
 
 // Helper variables
-static SWIFT_Real dist;
-static SWIFT_Triple fdir;
+static SWIFT_THREAD_LOCAL SWIFT_Real dist;
+static SWIFT_THREAD_LOCAL SWIFT_Triple fdir;
 
 // Forwarding variables
-static SWIFT_Triple* t1xp = new SWIFT_Triple;
-static SWIFT_Triple* h1xp = new SWIFT_Triple;
-static SWIFT_Triple* u1xp = new SWIFT_Triple;
-static SWIFT_Triple* t2xp = new SWIFT_Triple;
-static SWIFT_Triple* h2xp = new SWIFT_Triple;
-static SWIFT_Triple* u2xp = new SWIFT_Triple;
-static SWIFT_Triple* fnxp = new SWIFT_Triple;
-static SWIFT_Real dt12, dh12, dt21, dh21;
-static SWIFT_Real dl12, dr12, dl21, dr21;
-static SWIFT_Real lam_min1, lam_max1, lam_min2, lam_max2;
+static SWIFT_THREAD_LOCAL SWIFT_Triple forwarding_triples[7];
+static SWIFT_THREAD_LOCAL SWIFT_Triple* t1xp = forwarding_triples;
+static SWIFT_THREAD_LOCAL SWIFT_Triple* h1xp = forwarding_triples+1;
+static SWIFT_THREAD_LOCAL SWIFT_Triple* u1xp = forwarding_triples+2;
+static SWIFT_THREAD_LOCAL SWIFT_Triple* t2xp = forwarding_triples+3;
+static SWIFT_THREAD_LOCAL SWIFT_Triple* h2xp = forwarding_triples+4;
+static SWIFT_THREAD_LOCAL SWIFT_Triple* u2xp = forwarding_triples+5;
+static SWIFT_THREAD_LOCAL SWIFT_Triple* fnxp = forwarding_triples+6;
+static SWIFT_THREAD_LOCAL SWIFT_Real dt12, dh12, dt21, dh21;
+static SWIFT_THREAD_LOCAL SWIFT_Real dl12, dr12, dl21, dr21;
+static SWIFT_THREAD_LOCAL SWIFT_Real lam_min1, lam_max1, lam_min2, lam_max2;
 
 // Transformation variables
-static SWIFT_Transformation trans01;
-static SWIFT_Transformation trans10;
-static SWIFT_Transformation* T01 = &trans01;
-static SWIFT_Transformation* T10 = &trans10;
+static SWIFT_THREAD_LOCAL SWIFT_Transformation trans01;
+static SWIFT_THREAD_LOCAL SWIFT_Transformation trans10;
+static SWIFT_THREAD_LOCAL SWIFT_Transformation* T01 = &trans01;
+static SWIFT_THREAD_LOCAL SWIFT_Transformation* T10 = &trans10;
 
 // State transition variables
-static SWIFT_Tri_Vertex* v1;
-static SWIFT_Tri_Vertex* v2;
-static SWIFT_Tri_Edge* ve1;
-static SWIFT_Tri_Edge* ve2;
-static SWIFT_Tri_Edge* e1;
-static SWIFT_Tri_Edge* e2;
-static SWIFT_Tri_Face* f1;
-static SWIFT_Tri_Face* f2;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Vertex* v1;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Vertex* v2;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Edge* ve1;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Edge* ve2;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Edge* e1;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Edge* e2;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Face* f1;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Face* f2;
 
 // State saving variables
 #ifndef SWIFT_FRONT_TRACKING
-static RESULT_TYPE save_state;
-static SWIFT_Tri_Vertex* save_v1;
-static SWIFT_Tri_Vertex* save_v2;
-static SWIFT_Tri_Edge* save_ve1;
-static SWIFT_Tri_Edge* save_ve2;
-static SWIFT_Tri_Edge* save_e1;
-static SWIFT_Tri_Edge* save_e2;
-static SWIFT_Tri_Face* save_f1;
-static SWIFT_Tri_Face* save_f2;
+static SWIFT_THREAD_LOCAL RESULT_TYPE save_state;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Vertex* save_v1;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Vertex* save_v2;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Edge* save_ve1;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Edge* save_ve2;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Edge* save_e1;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Edge* save_e2;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Face* save_f1;
+static SWIFT_THREAD_LOCAL SWIFT_Tri_Face* save_f2;
 #endif
 
 // State flag for keeping track of the state across global function calls
-static RESULT_TYPE state;
-static RESULT_TYPE prev_state;
+static SWIFT_THREAD_LOCAL RESULT_TYPE state;
+static SWIFT_THREAD_LOCAL RESULT_TYPE prev_state;
 
 
 // feat0, feat1, distance, error, pair type lists for holding the
 // contacts during traversal
-static SWIFT_Array<void*> contact_list0;
-static SWIFT_Array<void*> contact_list1;
-static SWIFT_Array<SWIFT_Real> contact_listd;
-static SWIFT_Array<RESULT_TYPE> contact_listt;
-static SWIFT_Array<SWIFT_BV*> contact_listbv0;
-static SWIFT_Array<SWIFT_BV*> contact_listbv1;
+static SWIFT_THREAD_LOCAL SWIFT_Array<void*> contact_list0;
+static SWIFT_THREAD_LOCAL SWIFT_Array<void*> contact_list1;
+static SWIFT_THREAD_LOCAL SWIFT_Array<SWIFT_Real> contact_listd;
+static SWIFT_THREAD_LOCAL SWIFT_Array<RESULT_TYPE> contact_listt;
+static SWIFT_THREAD_LOCAL SWIFT_Array<SWIFT_BV*> contact_listbv0;
+static SWIFT_THREAD_LOCAL SWIFT_Array<SWIFT_BV*> contact_listbv1;
 
 
 // Non-convex variables
-static int level0;
-static int level1;
-static SWIFT_BV* bv0;
-static SWIFT_BV* bv1;
+static SWIFT_THREAD_LOCAL int level0;
+static SWIFT_THREAD_LOCAL int level1;
+static SWIFT_THREAD_LOCAL SWIFT_BV* bv0;
+static SWIFT_THREAD_LOCAL SWIFT_BV* bv1;
 #ifdef SWIFT_PIECE_CACHING
-static SWIFT_Pair* pair;
+static SWIFT_THREAD_LOCAL SWIFT_Pair* pair;
 #endif
 #ifdef SWIFT_PRIORITY_DIRECTION
-static SWIFT_Priority_Queue pqueue;
+static SWIFT_THREAD_LOCAL SWIFT_Priority_Queue pqueue;
 #endif
 #ifdef SWIFT_FRONT_TRACKING
-static SWIFT_Front* pairfront;
+static SWIFT_THREAD_LOCAL SWIFT_Front* pairfront;
 #else
-static bool saved;
+static SWIFT_THREAD_LOCAL bool saved;
 #endif
-static int c1, c2;
+static SWIFT_THREAD_LOCAL int c1, c2;
 
 #ifdef CYCLE_DETECTION
 // Cycle detection variables
-SWIFT_Array<void*> cycle_detector_feats( CYCLE_LENGTH<<1 );
+SWIFT_THREAD_LOCAL SWIFT_Array<void*> cycle_detector_feats( CYCLE_LENGTH<<1 );
 #ifdef SWIFT_DEBUG
-int cycle_counter = 0;
+SWIFT_THREAD_LOCAL int cycle_counter = 0;
 #endif
 #endif
 
@@ -833,6 +834,13 @@ inline RESULT_TYPE Vertex_Face( )
             return PENETRATION;
         }
 
+        // A head exactly on the face plane stays on the side of the tail
+        // when that is below the face.  Otherwise the walk would end disjoint
+        // with the normal oriented for a vertex below the face.
+        if( dist == 0.0 && minfd < 0.0 ) {
+            dist = minfd;
+        }
+
         v1 = e1->Next()->Origin();
         ve1 = e1->Twin( level0 );
 
@@ -2035,7 +2043,7 @@ bool Walk_Convex_LC( RESULT_TYPE start_state )
                     jittered_transformation = false;
                 } else {
                     // Jitter the transformation and try to proceed.
-                    Jitter_Transformation( k );
+                    Jitter_Transformation( l );
 
                     jittered_transformation = true;
                     // Do not reset k since we are close to the answer.
@@ -47,6 +47,9 @@
 //////////////////////////////////////////////////////////////////////////////
 
 #include <iostream>
+#ifdef SWIFT_PARALLEL_QUERIES
+#include <atomic>
+#endif
 
 
 #include <SWIFT.h>
@@ -57,6 +60,7 @@
 #include <SWIFT_mesh.h>
 #include <SWIFT_mesh_utils.h>
 #include <SWIFT_boxnode.h>
+#include <SWIFT_boxtree.h>
 #include <SWIFT_object.h>
 #include <SWIFT_pair.h>
 #include <SWIFT_fileio.h>
@@ -83,6 +87,9 @@ static const int OBJECT_SEGMENT_SIZE = 4;
 static const int REPORTING_LIST_CREATION_SIZE = 100;
 static const int REPORTING_LIST_GROW_SIZE = 100;
 
+// Queries with fewer pairs than this are not worth splitting between threads
+static const int PARALLEL_QUERY_MIN_PAIRS = 64;
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // Static functions
@@ -125,11 +132,206 @@ static bool Is_Identity( const SWIFT_Orientation& orient,
     }
 }
 
+template< class Type >
+static void Append( SWIFT_Array<Type>& to, SWIFT_Array<Type>& from,
+                    int start, int n, int grow )
+{
+    to.Fit_Grow( n, grow );
+    memcpy( (void*)(to.Data()+to.Length()), (void*)(from.Data()+start),
+            n*sizeof(Type) );
+    to.Set_Length( to.Length()+n );
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SWIFT_Query_Task
+//
+// Description:
+//      Task to query a list of pairs on several threads.  The result of every
+//  pair is kept separately and contacts are written to the reporting lists of
+//  the thread that queried the pair, so that the scene can report them in the
+//  order of the pairs afterwards.
+///////////////////////////////////////////////////////////////////////////////
+class SWIFT_Query_Task : public SWIFT_Task {
+  public:
+    typedef enum { TOLERANCE, DISTANCE, CONTACTS } QUERY_TYPE;
+
+    // The result of a pair.  Contacts begin at the given positions in the
+    // reporting lists of the thread.
+    struct Pair_Result {
+        bool reported;
+        bool intersection;
+        SWIFT_Real distance;
+        int num_contacts;
+        int thread;
+        int ds_start, nps_start, cns_start, fts_start, fis_start;
+    };
+
+    // The reporting lists of a thread
+    struct Thread_Lists {
+        SWIFT_Array<SWIFT_Real> ds;     // distances
+        SWIFT_Array<SWIFT_Real> nps;    // nearest points
+        SWIFT_Array<SWIFT_Real> cns;    // contact normals
+        SWIFT_Array<int> fts;           // feature types
+        SWIFT_Array<int> fis;           // feature ids
+    };
+
+    SWIFT_Query_Task( SWIFT_Array<SWIFT_Object*>& objs )
+        : objects( objs ), lists( NULL ), num_lists( 0 ),
+          stopped( false ) { }
+    ~SWIFT_Query_Task( ) { delete [] lists; }
+
+  // Get functions
+    SWIFT_Array<SWIFT_Pair*>& Pairs( ) { return pairs; }
+    const Pair_Result& Result( int i ) { return results[i]; }
+    Thread_Lists& Lists( int thread ) { return lists[thread]; }
+    QUERY_TYPE Type( ) const { return type; }
+    bool Report_Distances( ) const { return report_ds; }
+    bool Report_Nearest_Points( ) const { return report_nps; }
+    bool Report_Normals( ) const { return report_cns; }
+    bool Report_Features( ) const { return report_fs; }
+    bool Stopped( ) const { return stopped; }
+
+  // Set functions
+    void Set_Query( QUERY_TYPE t, bool early, SWIFT_Real tol,
+                    SWIFT_Real abs_err = 0.0, SWIFT_Real rel_err = 0.0 )
+    {
+        type = t; early_exit = early; tolerance = tol;
+        abs_error = abs_err; rel_error = rel_err;
+        report_ds = report_nps = report_cns = report_fs = false;
+    }
+    void Set_Contact_Reporting( bool d, bool np, bool cn, bool f )
+    {
+        report_ds = d; report_nps = np; report_cns = cn; report_fs = f;
+    }
+
+    // Prepare the results and reporting lists for the given number of threads
+    void Prepare( int num_threads );
+
+    virtual void Run( int thread, int begin, int end );
+
+  private:
+    SWIFT_Array<SWIFT_Object*>& objects;
+    SWIFT_Array<SWIFT_Pair*> pairs;
+    SWIFT_Array<Pair_Result> results;
+    Thread_Lists* lists;
+    int num_lists;
+
+    // Set when an intersection is found and early exit was requested.  All
+    // threads check it before every pair and stop querying.
+#ifdef SWIFT_PARALLEL_QUERIES
+    std::atomic<bool> stopped;
+#else
+    bool stopped;
+#endif
+
+    QUERY_TYPE type;
+    bool early_exit;
+    SWIFT_Real tolerance;
+    SWIFT_Real abs_error;
+    SWIFT_Real rel_error;
+    bool report_ds, report_nps, report_cns, report_fs;
+};
+
+void SWIFT_Query_Task::Prepare( int num_threads )
+{
+    int i;
+
+    results.Ensure_Length( pairs.Length() );
+
+    if( num_lists < num_threads ) {
+        delete [] lists;
+        lists = new Thread_Lists[num_threads];
+        num_lists = num_threads;
+        for( i = 0; i < num_lists; i++ ) {
+            lists[i].ds.Create( REPORTING_LIST_CREATION_SIZE );
+            lists[i].nps.Create( REPORTING_LIST_CREATION_SIZE*6 );
+            lists[i].cns.Create( REPORTING_LIST_CREATION_SIZE*3 );
+            lists[i].fts.Create( REPORTING_LIST_CREATION_SIZE<<1 );
+            lists[i].fis.Create( REPORTING_LIST_CREATION_SIZE<<2 );
+        }
+    }
+
+    for( i = 0; i < num_lists; i++ ) {
+        lists[i].ds.Set_Length( 0 );
+        lists[i].nps.Set_Length( 0 );
+        lists[i].cns.Set_Length( 0 );
+        lists[i].fts.Set_Length( 0 );
+        lists[i].fis.Set_Length( 0 );
+    }
+
+    stopped = false;
+}
+
+void SWIFT_Query_Task::Run( int thread, int begin, int end )
+{
+    Thread_Lists& tl = lists[thread];
+    int i;
+
+    for( i = begin; i < end && !stopped; i++ ) {
+        SWIFT_Pair* pair = pairs[i];
+        SWIFT_Object* o0 = objects[pair->Id0()];
+        SWIFT_Object* o1 = objects[pair->Id1()];
+        Pair_Result& r = results[i];
+
+        switch( type ) {
+        case TOLERANCE:
+            r.intersection = pair->Tolerance( o0, o1, tolerance );
+            r.reported = r.intersection;
+            break;
+        case DISTANCE:
+            r.intersection = pair->Distance( o0, o1, tolerance,
+                                             abs_error, rel_error, r.distance );
+            r.reported = r.distance <= tolerance;
+            break;
+        case CONTACTS:
+            r.intersection = pair->Contacts( o0, o1, tolerance,
+                                             r.distance, r.num_contacts );
+            r.reported = r.distance <= tolerance;
+            if( r.reported && !r.intersection ) {
+                // The contacts are kept by the thread that computed them so
+                // they have to be copied out right away
+                const int num_cs = r.num_contacts;
+                r.thread = thread;
+                r.ds_start = tl.ds.Length();
+                r.nps_start = tl.nps.Length();
+                r.cns_start = tl.cns.Length();
+                r.fts_start = tl.fts.Length();
+                r.fis_start = tl.fis.Length();
+                if( report_ds ) {
+                    tl.ds.Fit_Grow( num_cs, REPORTING_LIST_GROW_SIZE );
+                    pair->Distances( tl.ds );
+                }
+                if( report_nps ) {
+                    tl.nps.Fit_Grow( num_cs*6, REPORTING_LIST_GROW_SIZE*6 );
+                    pair->Contact_Points( tl.nps );
+                }
+                if( report_cns ) {
+                    tl.cns.Fit_Grow( num_cs*3, REPORTING_LIST_GROW_SIZE*3 );
+                    pair->Contact_Normals( tl.cns );
+                }
+                if( report_fs ) {
+                    tl.fts.Fit_Grow( num_cs<<1, REPORTING_LIST_GROW_SIZE<<1 );
+                    tl.fis.Fit_Grow( num_cs<<2, REPORTING_LIST_GROW_SIZE<<2 );
+                    pair->Contact_Features( tl.fts, tl.fis );
+                }
+            }
+            break;
+        }
+
+        if( r.intersection && early_exit ) {
+            stopped = true;
+        }
+    }
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Scene Creation methods
 ///////////////////////////////////////////////////////////////////////////////
 
-SWIFT_Scene::SWIFT_Scene( bool broad_phase, bool global_sort )
+SWIFT_Scene::SWIFT_Scene( bool broad_phase, bool global_sort,
+                          BROAD_PHASE_TYPE broad_phase_type )
 {
     // Create the lists
     objects.Create( OBJECT_SEGMENT_SIZE );
@@ -142,14 +344,23 @@ SWIFT_Scene::SWIFT_Scene( bool broad_phase, bool global_sort )
     total_pairs = 0;
     overlapping_pairs = NULL;
 
+    task_runner = NULL;
+    query_task = NULL;
+
     // Register the file readers
     basic_file_reader.Register_Yourself( file_dispatcher );
     obj_file_reader.Register_Yourself( file_dispatcher );
 
     bp = broad_phase;
     gs = global_sort;
-
-    if( bp ) {
+    bt = broad_phase && broad_phase_type == AABB_TREE;
+
+    if( bt ) {
+        tree_pairs.Create( OBJECT_SEGMENT_SIZE );
+        tree_pairs.Set_Length( 0 );
+        tree_hits.Create( OBJECT_SEGMENT_SIZE );
+        tree_hits.Set_Length( 0 );
+    } else if( bp ) {
         sorted[0].Create( OBJECT_SEGMENT_SIZE<<1 );
         sorted[1].Create( OBJECT_SEGMENT_SIZE<<1 );
         sorted[2].Create( OBJECT_SEGMENT_SIZE<<1 );
@@ -189,6 +400,8 @@ SWIFT_Scene::~SWIFT_Scene( )
         // in the objects.
         delete objects[i];
     }
+
+    delete query_task;
 }
 
 
@@ -374,7 +587,18 @@ void SWIFT_Scene::Delete_Object( int id )
     int i, j;
     SWIFT_Object* free_obj = objects[object_ids[id]];
 
-    if( bp ) {
+    if( bt ) {
+        // Forget the overlapping pairs of the object and remove its leaf
+        for( i = 0, j = 0; i < tree_pairs.Length(); i++ ) {
+            if( tree_pairs[i]->Id0() != object_ids[id] &&
+                tree_pairs[i]->Id1() != object_ids[id]
+            ) {
+                tree_pairs[j++] = tree_pairs[i];
+            }
+        }
+        tree_pairs.Set_Length( j );
+        Tree( free_obj ).Remove( free_obj->Proxy() );
+    } else if( bp ) {
         // Remove the boxes from the sorted lists and compress the lists
         for( j = 0; j < 3; j++ ) {
             // Fix the boxes before the first deleted index
@@ -421,6 +645,10 @@ void SWIFT_Scene::Delete_Object( int id )
         // Find the pair to delete.
         for( j = 0; j < objects[i]->Num_Pairs(); j++ ) {
             if( !objects[i]->Pairs()[j].Deleted() ) {
+                if( objects[i]->Pairs()[j].Id0() > object_ids[id] ) {
+                    // Did not find it.  Must have been a pair of fixed objects.
+                    break;
+                }
                 // Renumber the pair
                 objects[i]->Pairs()[j].Set_Id1(
                                             objects[i]->Pairs()[j].Id1()-1 );
@@ -428,20 +656,21 @@ void SWIFT_Scene::Delete_Object( int id )
                     objects[i]->Pairs()[j].Delete();
                     j++;
                     break;
-                } else if( objects[i]->Pairs()[j].Id0() > object_ids[id] ) {
-                    // Did not find it.  Must have been a pair of fixed objects.
-                    break;
                 }
             }
         }
 
-        // Renumber the remaining pairs
+        // Renumber the remaining pairs.  Deleted pairs are renumbered as well
+        // to keep the pairs sorted on Id0 for the pair searches.
         for( ; j < objects[i]->Num_Pairs(); j++ ) {
             if( !objects[i]->Pairs()[j].Deleted() ) {
                 objects[i]->Pairs()[j].Set_Id0(
                                             objects[i]->Pairs()[j].Id0()-1 );
                 objects[i]->Pairs()[j].Set_Id1(
                                             objects[i]->Pairs()[j].Id1()-1 );
+            } else if( objects[i]->Pairs()[j].Id0() > object_ids[id] ) {
+                objects[i]->Pairs()[j].Set_Id0(
+                                            objects[i]->Pairs()[j].Id0()-1 );
             }
         }
 
@@ -480,7 +709,9 @@ void SWIFT_Scene::Set_Object_Transformation( int id, const SWIFT_Real* R,
 #endif
     if( bp ) {
         objects[object_ids[id]]->Set_Transformation( R, T );
-        if( !gs ) {
+        if( bt ) {
+            Move_In_Tree( object_ids[id] );
+        } else if( !gs ) {
             Sort_Local( object_ids[id] );
         }
     } else {
@@ -502,7 +733,9 @@ void SWIFT_Scene::Set_Object_Transformation( int id, const SWIFT_Real* R )
 #endif
     if( bp ) {
         objects[object_ids[id]]->Set_Transformation( R );
-        if( !gs ) {
+        if( bt ) {
+            Move_In_Tree( object_ids[id] );
+        } else if( !gs ) {
             Sort_Local( object_ids[id] );
         }
     } else {
@@ -521,10 +754,15 @@ void SWIFT_Scene::Set_All_Object_Transformations( const SWIFT_Real* R,
         for( i = 0; i < objects.Length(); i++ ) {
             if( !objects[i]->Fixed() ) {
                 objects[i]->Set_Transformation( Rp, Tp );
+                if( bt ) {
+                    Move_In_Tree( i );
+                }
                 Rp += 9; Tp += 3;
             }
         }
-        Sort_Global();
+        if( !bt ) {
+            Sort_Global();
+        }
     } else {
         for( i = 0; i < objects.Length(); i++ ) {
             if( !objects[i]->Fixed() ) {
@@ -544,10 +782,15 @@ void SWIFT_Scene::Set_All_Object_Transformations( const SWIFT_Real* R )
         for( i = 0; i < objects.Length(); i++ ) {
             if( !objects[i]->Fixed() ) {
                 objects[i]->Set_Transformation( Rp );
+                if( bt ) {
+                    Move_In_Tree( i );
+                }
                 Rp += 12;
             }
         }
-        Sort_Global();
+        if( !bt ) {
+            Sort_Global();
+        }
     } else {
         for( i = 0; i < objects.Length(); i++ ) {
             if( !objects[i]->Fixed() ) {
@@ -558,6 +801,69 @@ void SWIFT_Scene::Set_All_Object_Transformations( const SWIFT_Real* R )
     }
 }
 
+void SWIFT_Scene::Set_Object_Transformations( const int* ids, int num_ids,
+                                              const SWIFT_Real* R,
+                                              const SWIFT_Real* T )
+{
+    int i;
+    SWIFT_Object* obj;
+
+    for( i = 0; i < num_ids; i++ ) {
+#ifdef SWIFT_DEBUG
+        // Check the validity of the id
+        if( ids[i] < 0 || ids[i] >= object_ids.Length() ||
+            object_ids[ids[i]] == -1
+        ) {
+            cerr << "Error: Invalid object id given to "
+                 << "Set_Object_Transformations(" << ids[i] << ")" << endl;
+            continue;
+        }
+#endif
+        obj = objects[object_ids[ids[i]]];
+        if( bp ) {
+            obj->Set_Transformation( R+i*9, T+i*3 );
+            if( bt ) {
+                Move_In_Tree( object_ids[ids[i]] );
+            } else if( !gs ) {
+                Sort_Local( object_ids[ids[i]] );
+            }
+        } else {
+            obj->Set_Transformation_No_Boxes( R+i*9, T+i*3 );
+        }
+    }
+}
+
+void SWIFT_Scene::Set_Object_Transformations( const int* ids, int num_ids,
+                                              const SWIFT_Real* RT )
+{
+    int i;
+    SWIFT_Object* obj;
+
+    for( i = 0; i < num_ids; i++ ) {
+#ifdef SWIFT_DEBUG
+        // Check the validity of the id
+        if( ids[i] < 0 || ids[i] >= object_ids.Length() ||
+            object_ids[ids[i]] == -1
+        ) {
+            cerr << "Error: Invalid object id given to "
+                 << "Set_Object_Transformations(" << ids[i] << ")" << endl;
+            continue;
+        }
+#endif
+        obj = objects[object_ids[ids[i]]];
+        if( bp ) {
+            obj->Set_Transformation( RT+i*12 );
+            if( bt ) {
+                Move_In_Tree( object_ids[ids[i]] );
+            } else if( !gs ) {
+                Sort_Local( object_ids[ids[i]] );
+            }
+        } else {
+            obj->Set_Transformation_No_Boxes( RT+i*12 );
+        }
+    }
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // Pair Activation methods
@@ -919,8 +1225,20 @@ bool SWIFT_Scene::Query_Intersection(
     num_pairs = 0;
 
 
+#ifdef SWIFT_PARALLEL_QUERIES
+    if( Parallel_Query_Pairs() ) {
+        query_task->Set_Query( SWIFT_Query_Task::TOLERANCE, early_exit, 0.0 );
+        if( Run_Parallel_Query( k ) && early_exit ) {
+            num_pairs = 0;
+            return true;
+        }
+    } else
+#endif
     if( bp ) {
-        if( gs ) {
+        if( bt ) {
+            // Update the pairs of the objects that left their leaf boxes
+            Update_Tree_Pairs();
+        } else if( gs ) {
             // Do global bounding box sort
             Sort_Global();
         }
@@ -988,8 +1306,21 @@ bool SWIFT_Scene::Query_Tolerance_Verification( bool early_exit,
 
     num_pairs = 0;
 
+#ifdef SWIFT_PARALLEL_QUERIES
+    if( Parallel_Query_Pairs() ) {
+        query_task->Set_Query( SWIFT_Query_Task::TOLERANCE, early_exit,
+                               tolerance );
+        if( Run_Parallel_Query( k ) && early_exit ) {
+            num_pairs = 0;
+            return true;
+        }
+    } else
+#endif
     if( bp ) {
-        if( gs ) {
+        if( bt ) {
+            // Update the pairs of the objects that left their leaf boxes
+            Update_Tree_Pairs();
+        } else if( gs ) {
             // Do global bounding box sort
             Sort_Global();
         }
@@ -1062,8 +1393,18 @@ bool SWIFT_Scene::Query_Approximate_Distance(
     abs_error = abs_error < 0.0 ? 0.0 : abs_error;
     rel_error = rel_error < 0.0 ? 0.0 : rel_error;
 
+#ifdef SWIFT_PARALLEL_QUERIES
+    if( Parallel_Query_Pairs() ) {
+        query_task->Set_Query( SWIFT_Query_Task::DISTANCE, early_exit,
+                               distance_tolerance, abs_error, rel_error );
+        intersection = Run_Parallel_Query( k );
+    } else
+#endif
     if( bp ) {
-        if( gs ) {
+        if( bt ) {
+            // Update the pairs of the objects that left their leaf boxes
+            Update_Tree_Pairs();
+        } else if( gs ) {
             // Do global bounding box sort
             Sort_Global();
         }
@@ -1160,8 +1501,18 @@ bool SWIFT_Scene::Query_Exact_Distance(
 
     tolerance = tolerance < 0.0 ? 0.0 : tolerance;
 
+#ifdef SWIFT_PARALLEL_QUERIES
+    if( Parallel_Query_Pairs() ) {
+        query_task->Set_Query( SWIFT_Query_Task::DISTANCE, early_exit,
+                               tolerance );
+        intersection = Run_Parallel_Query( k );
+    } else
+#endif
     if( bp ) {
-        if( gs ) {
+        if( bt ) {
+            // Update the pairs of the objects that left their leaf boxes
+            Update_Tree_Pairs();
+        } else if( gs ) {
             // Do global bounding box sort
             Sort_Global();
         }
@@ -1268,8 +1619,23 @@ bool SWIFT_Scene::Query_Contact_Determination(
 
     tolerance = tolerance < 0.0 ? 0.0 : tolerance;
 
+#ifdef SWIFT_PARALLEL_QUERIES
+    if( Parallel_Query_Pairs() ) {
+        query_task->Set_Query( SWIFT_Query_Task::CONTACTS, early_exit,
+                               tolerance );
+        query_task->Set_Contact_Reporting( distances != NULL,
+                                           nearest_pts != NULL,
+                                           normals != NULL,
+                                           feature_types != NULL &&
+                                           feature_ids != NULL );
+        intersection = Run_Parallel_Query( k );
+    } else
+#endif
     if( bp ) {
-        if( gs ) {
+        if( bt ) {
+            // Update the pairs of the objects that left their leaf boxes
+            Update_Tree_Pairs();
+        } else if( gs ) {
             // Do global bounding box sort
             Sort_Global();
         }
@@ -1454,6 +1820,16 @@ bool SWIFT_Scene::Query_Contact_Determination(
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Parallel Query methods
+///////////////////////////////////////////////////////////////////////////////
+
+void SWIFT_Scene::Set_Task_Runner( SWIFT_Task_Runner* runner )
+{
+    task_runner = runner;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Plug-In Registration methods
 ///////////////////////////////////////////////////////////////////////////////
@@ -1483,7 +1859,7 @@ void SWIFT_Scene::Initialize_Object_In_Scene( SWIFT_Object* cobj, int& id )
             object_ids.Grow( OBJECT_SEGMENT_SIZE );
             user_object_ids.Grow( OBJECT_SEGMENT_SIZE );
             // Only one box per object
-            if( bp && sorted[0].Length() == sorted[0].Max_Length() ) {
+            if( bp && !bt && sorted[0].Length() == sorted[0].Max_Length() ) {
                 sorted[0].Grow( OBJECT_SEGMENT_SIZE<<1 );
                 sorted[1].Grow( OBJECT_SEGMENT_SIZE<<1 );
                 sorted[2].Grow( OBJECT_SEGMENT_SIZE<<1 );
@@ -1522,7 +1898,10 @@ void SWIFT_Scene::Initialize_Object_In_Scene( SWIFT_Object* cobj, int& id )
         }
     }
 
-    if( bp ) {
+    if( bt ) {
+        // Add a leaf whose pairs are found at the next query
+        cobj->Set_Proxy( Tree( cobj ).Insert( cobj ) );
+    } else if( bp ) {
         // Set the box nodes and initialize them in the sorted list
         j = sorted[0].Length();
         k = j+1;
@@ -1546,9 +1925,146 @@ void SWIFT_Scene::Initialize_Object_In_Scene( SWIFT_Object* cobj, int& id )
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Parallel query functions
+
+// Collect the pairs to query into the query task.  Returns true if the query
+// should be run on the threads of the task runner.
+bool SWIFT_Scene::Parallel_Query_Pairs( )
+{
+    int i, j;
+
+    if( task_runner == NULL || task_runner->Num_Threads() < 2 ) {
+        return false;
+    }
+
+    if( query_task == NULL ) {
+        query_task = new SWIFT_Query_Task( objects );
+    }
+
+    SWIFT_Array<SWIFT_Pair*>& pairs = query_task->Pairs();
+    pairs.Ensure_Length( total_pairs );
+    pairs.Set_Length( 0 );
+
+    if( bp ) {
+        if( bt ) {
+            // Update the pairs of the objects that left their leaf boxes
+            Update_Tree_Pairs();
+        } else if( gs ) {
+            // Do global bounding box sort
+            Sort_Global();
+        }
+
+        SWIFT_Pair* pair = overlapping_pairs;
+
+        while( pair != NULL ) {
+            pairs.Add( pair );
+            pair = pair->Next();
+        }
+    } else {
+        // Take all the pairs
+        for( i = 1; i < objects.Length(); i++ ) {
+            // Objects are compressed on deletion so this object valid
+            for( j = 0; j < objects[i]->Num_Pairs(); j++ ) {
+                if( objects[i]->Pairs()[j].Inactive() ||
+                    objects[i]->Pairs()[j].Deleted()
+                ) {
+                    continue;
+                }
+                pairs.Add( objects[i]->Pairs()(j) );
+            }
+        }
+    }
+
+    return pairs.Length() >= PARALLEL_QUERY_MIN_PAIRS;
+}
+
+// Run the query which was set in the query task and report the results in the
+// order of the pairs.  k is set to the number of reported object ids.  Returns
+// true if there was an intersection (or a tolerance violation for tolerance
+// queries).  If early exit was requested nothing is reported in that case.
+bool SWIFT_Scene::Run_Parallel_Query( int& k )
+{
+    SWIFT_Query_Task& task = *query_task;
+    SWIFT_Array<SWIFT_Pair*>& pairs = task.Pairs();
+    bool intersection = false;
+    int i;
+
+    task.Prepare( task_runner->Num_Threads() );
+    task_runner->Run( query_task, pairs.Length() );
+
+    k = 0;
+    if( task.Stopped() ) {
+        return true;
+    }
+
+    for( i = 0; i < pairs.Length(); i++ ) {
+        const SWIFT_Query_Task::Pair_Result& r = task.Result( i );
+        if( r.intersection ) {
+            intersection = true;
+        }
+        if( !r.reported ) {
+            continue;
+        }
+
+        ois[k] = user_object_ids[pairs[i]->Id0()];
+        ois[k+1] = user_object_ids[pairs[i]->Id1()];
+
+        if( task.Type() == SWIFT_Query_Task::DISTANCE ) {
+            ds.Add_Grow( r.distance, REPORTING_LIST_GROW_SIZE );
+        } else if( task.Type() == SWIFT_Query_Task::CONTACTS ) {
+            if( r.intersection ) {
+                ncs[k>>1] = -1;
+                if( task.Report_Distances() ) {
+                    ds.Fit_Grow( 1, REPORTING_LIST_GROW_SIZE );
+                    ds.Add( r.distance );
+                }
+                if( task.Report_Nearest_Points() ) {
+                    nps.Fit_Grow( 6, REPORTING_LIST_GROW_SIZE*6 );
+                    nps.Set_Length( nps.Length()+6 );
+                }
+                if( task.Report_Normals() ) {
+                    cns.Fit_Grow( 3, REPORTING_LIST_GROW_SIZE*3 );
+                    cns.Set_Length( cns.Length()+3 );
+                }
+                if( task.Report_Features() ) {
+                    fts.Fit_Grow( 2, REPORTING_LIST_GROW_SIZE<<1 );
+                    fts.Set_Length( fts.Length()+2 );
+                    fis.Fit_Grow( 4, REPORTING_LIST_GROW_SIZE<<2 );
+                    fis.Set_Length( fis.Length()+4 );
+                }
+            } else {
+                const int num_cs = r.num_contacts;
+                SWIFT_Query_Task::Thread_Lists& tl = task.Lists( r.thread );
+                ncs[k>>1] = num_cs;
+                if( task.Report_Distances() ) {
+                    Append( ds, tl.ds, r.ds_start, num_cs,
+                            REPORTING_LIST_GROW_SIZE );
+                }
+                if( task.Report_Nearest_Points() ) {
+                    Append( nps, tl.nps, r.nps_start, num_cs*6,
+                            REPORTING_LIST_GROW_SIZE*6 );
+                }
+                if( task.Report_Normals() ) {
+                    Append( cns, tl.cns, r.cns_start, num_cs*3,
+                            REPORTING_LIST_GROW_SIZE*3 );
+                }
+                if( task.Report_Features() ) {
+                    Append( fts, tl.fts, r.fts_start, num_cs<<1,
+                            REPORTING_LIST_GROW_SIZE<<1 );
+                    Append( fis, tl.fis, r.fis_start, num_cs<<2,
+                            REPORTING_LIST_GROW_SIZE<<2 );
+                }
+            }
+        }
+        k += 2;
+    }
+
+    return intersection;
+}
+
 inline void SWIFT_Scene::Update_Overlap( int axis, int id1, int id2 )
 {
-    int j;
     SWIFT_Pair* pair;
     bool poverlapping;
     const int oid1 = id1;
@@ -1559,16 +2075,7 @@ inline void SWIFT_Scene::Update_Overlap( int axis, int id1, int id2 )
         return;
     }
 
-    // Find the pair
-    if( oid1 > oid2 ) {
-        for( j = 0; objects[oid1]->Pairs()[j].Id0() != id2; j++ );
-
-        pair = objects[oid1]->Pairs()( j );
-    } else {
-        for( j = 0; objects[oid2]->Pairs()[j].Id0() != id1; j++ );
-
-        pair = objects[oid2]->Pairs()( j );
-    }
+    pair = Find_Pair( oid1, oid2 );
 
     poverlapping = pair->Active() && pair->Overlapping();
 
@@ -1699,5 +2206,131 @@ void SWIFT_Scene::Sort_Local( int oid )
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Box tree functions
+
+SWIFT_Box_Tree& SWIFT_Scene::Tree( SWIFT_Object* obj )
+{
+    return obj->Fixed() ? static_tree : dynamic_tree;
+}
+
+// Find the pair of two objects given by internal ids.  The pair is kept by the
+// object with the larger id and the pairs are sorted on the other id.
+inline SWIFT_Pair* SWIFT_Scene::Find_Pair( int id1, int id2 )
+{
+    int j;
+
+    if( id1 < id2 ) {
+        j = id1; id1 = id2; id2 = j;
+    }
+
+    for( j = 0; objects[id1]->Pairs()[j].Deleted() ||
+                objects[id1]->Pairs()[j].Id0() != id2; j++ );
+
+    return objects[id1]->Pairs()( j );
+}
+
+// Set the overlap status of a pair and keep the overlapping list consistent
+// as Update_Overlap does.
+inline void SWIFT_Scene::Set_Tree_Overlap( SWIFT_Pair* pair, bool overlap )
+{
+    if( overlap ) {
+        pair->Set_Overlap( true );
+        if( pair->Active() ) {
+            // Add it to the overlapping list.
+            pair->Set_Next( overlapping_pairs );
+            pair->Set_Prev( NULL );
+            if( overlapping_pairs != NULL ) {
+                overlapping_pairs->Set_Prev( pair );
+            }
+            overlapping_pairs = pair;
+        }
+    } else {
+        if( pair->Active() ) {
+            // Remove it from the overlapping pairs list.
+            if( pair->Next() != NULL ) {
+                pair->Next()->Set_Prev( pair->Prev() );
+            }
+            if( pair->Prev() != NULL ) {
+                pair->Prev()->Set_Next( pair->Next() );
+            } else {
+                overlapping_pairs = pair->Next();
+            }
+            // Set it uninitialized
+            pair->Set_Uninitialized();
+        }
+        pair->Set_Overlap( false );
+    }
+}
+
+void SWIFT_Scene::Move_In_Tree( int oid )
+{
+    Tree( objects[oid] ).Move( objects[oid]->Proxy() );
+}
+
+// Update the overlap status of the pairs of the leaves inserted since the last
+// update.  The other pairs cannot have changed since their leaf boxes did not.
+void SWIFT_Scene::Update_Tree_Pairs( )
+{
+    int i, j, k;
+    SWIFT_Pair* pair;
+    SWIFT_Object* o1;
+    SWIFT_Object* o2;
+    SWIFT_Box_Tree* trees[2] = { &dynamic_tree, &static_tree };
 
+    if( dynamic_tree.Moved_Proxies().Empty() &&
+        static_tree.Moved_Proxies().Empty()
+    ) {
+        return;
+    }
 
+    // Drop the pairs whose leaf boxes do not overlap anymore
+    for( i = 0, j = 0; i < tree_pairs.Length(); i++ ) {
+        pair = tree_pairs[i];
+        o1 = objects[pair->Id0()];
+        o2 = objects[pair->Id1()];
+        if( (Tree( o1 ).Moved( o1->Proxy() ) ||
+             Tree( o2 ).Moved( o2->Proxy() )) &&
+            !SWIFT_Box_Tree::Overlap( Tree( o1 ), o1->Proxy(),
+                                      Tree( o2 ), o2->Proxy() )
+        ) {
+            Set_Tree_Overlap( pair, false );
+        } else {
+            tree_pairs[j++] = pair;
+        }
+    }
+    tree_pairs.Set_Length( j );
+
+    // Find the new pairs of the moved leaves.  Pairs of two moved leaves are
+    // found twice but added once.
+    for( k = 0; k < 2; k++ ) {
+        SWIFT_Array<int>& moved = trees[k]->Moved_Proxies();
+        for( i = 0; i < moved.Length(); i++ ) {
+            o1 = trees[k]->Object( moved[i] );
+            tree_hits.Set_Length( 0 );
+            dynamic_tree.Query( trees[k]->Min( moved[i] ),
+                                trees[k]->Max( moved[i] ), tree_hits );
+            if( !o1->Fixed() ) {
+                static_tree.Query( trees[k]->Min( moved[i] ),
+                                   trees[k]->Max( moved[i] ), tree_hits );
+            }
+
+            for( j = 0; j < tree_hits.Length(); j++ ) {
+                o2 = tree_hits[j];
+                if( o2 == o1 ) {
+                    continue;
+                }
+                pair = Find_Pair( o1->Min_Box_Node( 0 )->Id(),
+                                  o2->Min_Box_Node( 0 )->Id() );
+                if( !pair->Overlapping() ) {
+                    Set_Tree_Overlap( pair, true );
+                    tree_pairs.Add_Grow( pair, max( tree_pairs.Length(),
+                                                    OBJECT_SEGMENT_SIZE ) );
+                }
+            }
+        }
+    }
+
+    dynamic_tree.Clear_Moved();
+    static_tree.Clear_Moved();
+}
@@ -44,6 +44,21 @@ void OscReceiver::ProcessBundle( const ReceivedBundle& b, const IpEndpointName&
 }
 
 void OscReceiver::ProcessPacket( const char *data, int size, const IpEndpointName& remoteEndpoint ) {
+	if (bulk_parsing) {
+		try {
+			bulkReader.Read( data, size, bulkMessages );
+		} catch (Exception& e) {
+			std::cerr << "malformed OSC packet: " << e.what() << std::endl;
+			return;
+		}
+		
+		for (std::vector<BulkMessage>::iterator msg=bulkMessages.begin(); msg!= bulkMessages.end(); msg++) {
+			for (std::list<TuioClient*>::iterator client=clientList.begin(); client!= clientList.end(); client++)
+				(*client)->processOSC(*msg);
+		}
+		return;
+	}
+	
 	try {
 		ReceivedPacket p( data, size );
 		if(p.IsBundle()) ProcessBundle( ReceivedBundle(p), remoteEndpoint);
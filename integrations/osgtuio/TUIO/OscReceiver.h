@@ -26,6 +26,7 @@
 #include "TuioClient.h"
 
 #include "osc/OscReceivedElements.h"
+#include "osc/OscBulkReader.h"
 #include "osc/OscHostEndianness.h"
 #include "ip/PacketListener.h"
 #include "ip/IpEndpointName.h"
@@ -47,7 +48,7 @@ namespace TUIO {
 		/**
 		 * The constructor is doing nothing in particular. 
 		 */
-		OscReceiver() : connected(false) {};
+		OscReceiver() : connected(false), bulk_parsing(true) {};
 
 		/**
 		 * The destructor is doing nothing in particular. 
@@ -79,6 +80,15 @@ namespace TUIO {
 		 */
 		void addTuioClient(TuioClient *client);
 		
+		/**
+		 * Selects how incoming packets are decoded. With bulk parsing (default) each packet is validated once
+		 * and its messages are then read straight from the packet buffer without any allocations.
+		 * Otherwise the messages are decoded by the osc::ReceivedPacket argument streams.
+		 *
+		 * @param  bulk	true to enable bulk parsing
+		 */
+		void setBulkParsing(bool bulk) { bulk_parsing = bulk; };
+		
 		/**
 		 * The OSC callback method where the incoming OSC data is received
 		 *
@@ -95,6 +105,10 @@ namespace TUIO {
 		
 		std::list<TuioClient*> clientList;
 		bool connected;
+		
+		bool bulk_parsing;
+		osc::BulkPacketReader bulkReader;
+		std::vector<osc::BulkMessage> bulkMessages;
 	};
 };
 #endif /* INCLUDED_OSCRECEIVER_H */
@@ -65,6 +65,12 @@ namespace TUIO {
 		 * @return true if the connection is alive
 		 */
 		virtual bool isConnected () = 0;
+		
+		/**
+		 * This method delivers all OSC data which has been queued by sendOscPacket.
+		 * The TuioServer calls it after each frame. Senders delivering each packet immediately do nothing.
+		 */
+		virtual void flush () {};
 
 		/**
 		 * This method returns if this OscSender delivers locally
@@ -30,6 +30,8 @@ TuioBlob::TuioBlob (TuioTime ttime, long si, int bi, float xp, float yp, float a
 	area = f;
 	rotation_speed = 0.0f;
 	rotation_accel = 0.0f;
+	last_angle = angle;
+	last_rotation_speed = 0.0f;
 }
 
 TuioBlob::TuioBlob (long si, int bi, float xp, float yp, float a, float  w, float h, float f):TuioContainer(si, xp, yp) {
@@ -40,6 +42,8 @@ TuioBlob::TuioBlob (long si, int bi, float xp, float yp, float a, float  w, floa
 	area = f;
 	rotation_speed = 0.0f;
 	rotation_accel = 0.0f;
+	last_angle = angle;
+	last_rotation_speed = 0.0f;
 }
 
 TuioBlob::TuioBlob (TuioBlob *tblb):TuioContainer(tblb) {
@@ -50,6 +54,21 @@ TuioBlob::TuioBlob (TuioBlob *tblb):TuioContainer(tblb) {
 	area = tblb->getArea();
 	rotation_speed = 0.0f;
 	rotation_accel = 0.0f;
+	last_angle = angle;
+	last_rotation_speed = 0.0f;
+}
+
+void TuioBlob::init(TuioTime ttime, long si, int bi, float xp, float yp, float a, float w, float h, float f) {
+	TuioContainer::init(ttime,si,xp,yp);
+	blob_id = bi;
+	angle = a;
+	width = w;
+	height = h;
+	area = f;
+	rotation_speed = 0.0f;
+	rotation_accel = 0.0f;
+	last_angle = angle;
+	last_rotation_speed = 0.0f;
 }
 
 int TuioBlob::getBlobID() const{
@@ -79,13 +98,25 @@ void TuioBlob::update (float xp, float yp, float a, float w, float h, float f, f
 }
 
 void TuioBlob::update (TuioTime ttime, float xp, float yp, float a, float w, float h, float f) {
-	TuioPoint lastPoint = path.back();
+	bool repeated = isRepeatedUpdate(ttime);
+	if (repeated && path_length<2) {
+		TuioContainer::update(ttime,xp,yp);
+		angle = a;
+		width = w;
+		height = h;
+		area = f;
+		return;
+	}
+	
+	TuioPoint lastPoint = getPreviousPathPoint(ttime);
+	if (!repeated) {
+		last_angle = angle;
+		last_rotation_speed = rotation_speed;
+	}
 	TuioContainer::update(ttime,xp,yp);
 	
 	TuioTime diffTime = currentTime - lastPoint.getTuioTime();
 	float dt = diffTime.getTotalMilliseconds()/1000.0f;
-	float last_angle = angle;
-	float last_rotation_speed = rotation_speed;
 	angle = a;
 	
 	double da = (angle-last_angle)/(2*M_PI);
@@ -63,6 +63,10 @@ namespace TUIO {
 		 * The rotation acceleration value.
 		 */ 
 		float rotation_accel;
+		/**
+		 * The rotation angle and speed values before the last update at a new time.
+		 */ 
+		float last_angle, last_rotation_speed;
 		
 	public:
 		using TuioContainer::update;
@@ -108,6 +112,22 @@ namespace TUIO {
 		 * The destructor is doing nothing in particular. 
 		 */
 		~TuioBlob() {};
+		
+		/**
+		 * Reinitializes a released TuioBlob with the provided TuioTime, Session ID, Blob ID,
+		 * X and Y coordinate, angle, width, height and area as if it had been newly created.
+		 *
+		 * @param	ttime	the TuioTime to assign
+		 * @param	si	the Session ID to assign
+		 * @param	bi	the Blob ID to assign
+		 * @param	xp	the X coordinate to assign
+		 * @param	yp	the Y coordinate to assign
+		 * @param	a	the angle to assign
+		 * @param	w	the width to assign
+		 * @param	h	the height to assign
+		 * @param	f	the area to assign
+		 */
+		void init(TuioTime ttime, long si, int bi, float xp, float yp, float a, float w, float h, float f);
 
 		/**
 		 * Returns the Blob ID of this TuioBlob.
@@ -243,6 +263,14 @@ namespace TUIO {
 		 * @return	true of this TuioBlob is moving
 		 */
 		bool isMoving() const;
+		
+	private:
+		friend class TuioManager;
+		
+		/**
+		 * The position of the TuioBlob in the active list of a TuioManager, valid while it is listed.
+		 */ 
+		std::list<TuioBlob*>::iterator list_entry;
 	};
 }
 #endif
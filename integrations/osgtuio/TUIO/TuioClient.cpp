@@ -25,6 +25,9 @@
 using namespace TUIO;
 using namespace osc;
 
+enum { TUIO_OBJECT_PROFILE, TUIO_CURSOR_PROFILE, TUIO_BLOB_PROFILE };
+enum { TUIO_SOURCE, TUIO_SET, TUIO_ALIVE, TUIO_FSEQ };
+
 
 TuioClient::TuioClient()
 : currentFrame	(-1)
@@ -63,641 +66,667 @@ void TuioClient::initialize()	{
 	receiver->addTuioClient(this);
 	maxCursorID[source_id] = -1;
 	maxBlobID[source_id]   = -1;
+	
+	profileTable.Add("/tuio/2Dobj",TUIO_OBJECT_PROFILE);
+	profileTable.Add("/tuio/2Dcur",TUIO_CURSOR_PROFILE);
+	profileTable.Add("/tuio/2Dblb",TUIO_BLOB_PROFILE);
+	
+	commandTable.Add("source",TUIO_SOURCE);
+	commandTable.Add("set",TUIO_SET);
+	commandTable.Add("alive",TUIO_ALIVE);
+	commandTable.Add("fseq",TUIO_FSEQ);
 }
 
 TuioClient::~TuioClient() {
 	if (local_receiver) delete receiver;
 }
 
+TuioObject* TuioClient::createTuioObject(TuioTime ttime, long s_id, int sym, float xp, float yp, float a) {
+	TuioObject *tobj = objectPool.acquire();
+	if (tobj) tobj->init(ttime,s_id,sym,xp,yp,a);
+	else tobj = new TuioObject(ttime,s_id,sym,xp,yp,a);
+	return tobj;
+}
+
+TuioCursor* TuioClient::createTuioCursor(TuioTime ttime, long s_id, int c_id, float xp, float yp) {
+	TuioCursor *tcur = cursorPool.acquire();
+	if (tcur) tcur->init(ttime,s_id,c_id,xp,yp);
+	else tcur = new TuioCursor(ttime,s_id,c_id,xp,yp);
+	return tcur;
+}
+
+TuioBlob* TuioClient::createTuioBlob(TuioTime ttime, long s_id, int b_id, float xp, float yp, float a, float w, float h, float f) {
+	TuioBlob *tblb = blobPool.acquire();
+	if (tblb) tblb->init(ttime,s_id,b_id,xp,yp,a,w,h,f);
+	else tblb = new TuioBlob(ttime,s_id,b_id,xp,yp,a,w,h,f);
+	return tblb;
+}
+
 void TuioClient::processOSC( const ReceivedMessage& msg ) {
 	try {
+		int profile = profileTable.Find(msg.AddressPattern());
+		if (profile<0) return;
+		
 		ReceivedMessageArgumentStream args = msg.ArgumentStream();
-		ReceivedMessage::const_iterator arg = msg.ArgumentsBegin();
+		const char* cmd;
+		args >> cmd;
 		
-		if( strcmp( msg.AddressPattern(), "/tuio/2Dobj" ) == 0 ){
-			
-			const char* cmd;
-			args >> cmd;
-			
-			if (strcmp(cmd,"source")==0) {
+		switch (commandTable.Find(cmd)) {
+			case TUIO_SOURCE: {
 				const char* src;
 				args >> src;
-				
-				source_name = strtok((char*)src, "@");
-				char *addr = strtok(NULL, "@");
-				
-				if (addr!=NULL) source_addr = addr;
-				else source_addr = (char*)"localhost";
-				
-				// check if we know that source
-				std::string source_str(src);
-				std::map<std::string,int>::iterator iter = sourceList.find(source_str);
-
-				// add a new source
-				if (iter==sourceList.end()) {
-					source_id = sourceList.size();
-					sourceList[source_str] = source_id;
+				setTuioSource(src);
+				break;
+			}
+			case TUIO_SET:
+				if (profile==TUIO_OBJECT_PROFILE) {
+					int32 s_id, c_id;
+					float xpos, ypos, angle, xspeed, yspeed, rspeed, maccel, raccel;
+					args >> s_id >> c_id >> xpos >> ypos >> angle >> xspeed >> yspeed >> rspeed >> maccel >> raccel;
+					setTuioObject(s_id,c_id,xpos,ypos,angle,xspeed,yspeed,rspeed,maccel,raccel);
+				} else if (profile==TUIO_CURSOR_PROFILE) {
+					int32 s_id;
+					float xpos, ypos, xspeed, yspeed, maccel;
+					args >> s_id >> xpos >> ypos >> xspeed >> yspeed >> maccel;
+					setTuioCursor(s_id,xpos,ypos,xspeed,yspeed,maccel);
 				} else {
-				// use the found source_id
-					source_id = sourceList[source_str];
+					int32 s_id;
+					float xpos, ypos, angle, width, height, area, xspeed, yspeed, rspeed, maccel, raccel;
+					args >> s_id >> xpos >> ypos >> angle >> width >> height >> area >> xspeed >> yspeed >> rspeed >> maccel >> raccel;
+					setTuioBlob(s_id,xpos,ypos,angle,width,height,area,xspeed,yspeed,rspeed,maccel,raccel);
 				}
-				
-			} else if (strcmp(cmd,"set")==0) {	
-				int32 s_id, c_id;
-				float xpos, ypos, angle, xspeed, yspeed, rspeed, maccel, raccel;
-				args >> s_id >> c_id >> xpos >> ypos >> angle >> xspeed >> yspeed >> rspeed >> maccel >> raccel;
+				break;
+			case TUIO_ALIVE: {
+				std::vector<long> &aliveList = getAliveList(profile);
+				int32 s_id;
+				aliveList.clear();
+				while(!args.Eos()) {
+					args >> s_id;
+					aliveList.push_back((long)s_id);
+				}
+				break;
+			}
+			case TUIO_FSEQ: {
+				int32 fseq;
+				args >> fseq;
+				commitFrame(profile,fseq);
+				break;
+			}
+		}
+	} catch( Exception& e ){
+		std::cerr << "error parsing TUIO message: "<< msg.AddressPattern() <<  " - " << e.what() << std::endl;
+	}
+}
+
+void TuioClient::processOSC( const BulkMessage& msg ) {
+	int profile = profileTable.Find(msg.addressPattern,msg.addressHash);
+	if (profile<0) return;
+	
+	// the packet has been validated, so only the argument types are left to check
+	const char *types = msg.typeTags;
+	if (types[0]!='s') {
+		std::cerr << "error parsing TUIO message: "<< msg.addressPattern <<  " - wrong argument type" << std::endl;
+		return;
+	}
+	const char *cmd = msg.arguments;
+	const char *args = SkipStringArgument(cmd);
+	types++;
+	
+	int32 ids[2];
+	float values[11];
+	switch (commandTable.Find(cmd)) {
+		case TUIO_SOURCE:
+			if (types[0]!='s') break;
+			setTuioSource(args);
+			return;
+		case TUIO_SET:
+			if (profile==TUIO_OBJECT_PROFILE) {
+				if (strncmp(types,"iiffffffff",10)!=0) break;
+				ReadInt32Block(args,ids,2);
+				ReadFloatBlock(args+8,values,8);
+				setTuioObject(ids[0],ids[1],values[0],values[1],values[2],values[3],values[4],values[5],values[6],values[7]);
+			} else if (profile==TUIO_CURSOR_PROFILE) {
+				if (strncmp(types,"ifffff",6)!=0) break;
+				ReadInt32Block(args,ids,1);
+				ReadFloatBlock(args+4,values,5);
+				setTuioCursor(ids[0],values[0],values[1],values[2],values[3],values[4]);
+			} else {
+				if (strncmp(types,"ifffffffffff",12)!=0) break;
+				ReadInt32Block(args,ids,1);
+				ReadFloatBlock(args+4,values,11);
+				setTuioBlob(ids[0],values[0],values[1],values[2],values[3],values[4],values[5],values[6],values[7],values[8],values[9],values[10]);
+			}
+			return;
+		case TUIO_ALIVE: {
+			int count = 0;
+			while (types[count]=='i') count++;
+			if (types[count]!='\0') break;
+			
+			aliveBuffer.resize(count);
+			if (count>0) ReadInt32Block(args,&aliveBuffer[0],count);
+			std::vector<long> &aliveList = getAliveList(profile);
+			aliveList.assign(aliveBuffer.begin(),aliveBuffer.end());
+			return;
+		}
+		case TUIO_FSEQ:
+			if (types[0]!='i') break;
+			ReadInt32Block(args,ids,1);
+			commitFrame(profile,ids[0]);
+			return;
+		default:
+			return;
+	}
+	std::cerr << "error parsing TUIO message: "<< msg.addressPattern <<  " - wrong argument type" << std::endl;
+}
 
-				lockObjectList();
-				std::list<TuioObject*>::iterator tobj;
-				for (tobj=objectList.begin(); tobj!= objectList.end(); tobj++)
-					if((*tobj)->getSessionID()==(long)s_id) break;
+void TuioClient::setTuioSource(const char *src) {
+	source_name = strtok((char*)src, "@");
+	char *addr = strtok(NULL, "@");
+	
+	if (addr!=NULL) source_addr = addr;
+	else source_addr = (char*)"localhost";
+	
+	// check if we know that source
+	std::string source_str(src);
+	std::map<std::string,int>::iterator iter = sourceList.find(source_str);
+	
+	// add a new source
+	if (iter==sourceList.end()) {
+		source_id = sourceList.size();
+		sourceList[source_str] = source_id;
+		maxCursorID[source_id] = -1;
+		maxBlobID[source_id]   = -1;
+	} else {
+		// use the found source_id
+		source_id = iter->second;
+	}
+}
 
-				if (tobj == objectList.end()) {
-					
-					TuioObject *addObject = new TuioObject((long)s_id,(int)c_id,xpos,ypos,angle);
-					frameObjects.push_back(addObject);
+std::vector<long>& TuioClient::getAliveList(int profile) {
+	if (profile==TUIO_OBJECT_PROFILE) return aliveObjectList;
+	else if (profile==TUIO_CURSOR_PROFILE) return aliveCursorList;
+	else return aliveBlobList;
+}
 
-				} else if ( ((*tobj)->getX()!=xpos) || ((*tobj)->getY()!=ypos) || ((*tobj)->getAngle()!=angle) || ((*tobj)->getXSpeed()!=xspeed) || ((*tobj)->getYSpeed()!=yspeed) || ((*tobj)->getRotationSpeed()!=rspeed) || ((*tobj)->getMotionAccel()!=maccel) || ((*tobj)->getRotationAccel()!=raccel) ) {
+void TuioClient::setTuioObject(long s_id, int c_id, float xpos, float ypos, float angle, float xspeed, float yspeed, float rspeed, float maccel, float raccel) {
+	lockObjectList();
+	std::list<TuioObject*>::iterator tobj;
+	for (tobj=objectList.begin(); tobj!= objectList.end(); tobj++)
+		if((*tobj)->getSessionID()==(long)s_id) break;
 
-					TuioObject *updateObject = new TuioObject((long)s_id,(*tobj)->getSymbolID(),xpos,ypos,angle);
-					updateObject->update(xpos,ypos,angle,xspeed,yspeed,rspeed,maccel,raccel);
-					frameObjects.push_back(updateObject);
+	if (tobj == objectList.end()) {
+		
+		TuioObject *addObject = createTuioObject(TuioTime::getSessionTime(),(long)s_id,(int)c_id,xpos,ypos,angle);
+		frameObjects.push_back(addObject);
 
-				}
-				unlockObjectList();
+	} else if ( ((*tobj)->getX()!=xpos) || ((*tobj)->getY()!=ypos) || ((*tobj)->getAngle()!=angle) || ((*tobj)->getXSpeed()!=xspeed) || ((*tobj)->getYSpeed()!=yspeed) || ((*tobj)->getRotationSpeed()!=rspeed) || ((*tobj)->getMotionAccel()!=maccel) || ((*tobj)->getRotationAccel()!=raccel) ) {
 
-			} else if (strcmp(cmd,"alive")==0) {
+		TuioObject *updateObject = createTuioObject(TuioTime::getSessionTime(),(long)s_id,(*tobj)->getSymbolID(),xpos,ypos,angle);
+		updateObject->update(xpos,ypos,angle,xspeed,yspeed,rspeed,maccel,raccel);
+		frameObjects.push_back(updateObject);
 
-				int32 s_id;
-				aliveObjectList.clear();
-				while(!args.Eos()) {
-					args >> s_id;
-					aliveObjectList.push_back((long)s_id);
-				}
+	}
+	unlockObjectList();
+}
 
-			} else if (strcmp(cmd,"fseq")==0) {
+void TuioClient::setTuioCursor(long s_id, float xpos, float ypos, float xspeed, float yspeed, float maccel) {
+	lockCursorList();
+	std::list<TuioCursor*>::iterator tcur;
+	for (tcur=cursorList.begin(); tcur!= cursorList.end(); tcur++)
+		if (((*tcur)->getSessionID()==(long)s_id) && ((*tcur)->getTuioSourceID()==source_id)) break;
+	
+	if (tcur==cursorList.end()) {
+						
+		TuioCursor *addCursor = createTuioCursor(TuioTime::getSessionTime(),(long)s_id,-1,xpos,ypos);
+		frameCursors.push_back(addCursor);
 
-				int32 fseq;
-				args >> fseq;
-				bool lateFrame = false;
-				if (fseq>0) {
-					if (fseq>currentFrame) currentTime = TuioTime::getSessionTime();
-					if ((fseq>=currentFrame) || ((currentFrame-fseq)>100)) currentFrame = fseq;
-					else lateFrame = true;
-				} else if ((TuioTime::getSessionTime().getTotalMilliseconds()-currentTime.getTotalMilliseconds())>100) {
-					currentTime = TuioTime::getSessionTime();
+	} else if ( ((*tcur)->getX()!=xpos) || ((*tcur)->getY()!=ypos) || ((*tcur)->getXSpeed()!=xspeed) || ((*tcur)->getYSpeed()!=yspeed) || ((*tcur)->getMotionAccel()!=maccel) ) {
+
+		TuioCursor *updateCursor = createTuioCursor(TuioTime::getSessionTime(),(long)s_id,(*tcur)->getCursorID(),xpos,ypos);
+		updateCursor->update(xpos,ypos,xspeed,yspeed,maccel);
+		frameCursors.push_back(updateCursor);
+
+	}
+	unlockCursorList();
+}
+
+void TuioClient::setTuioBlob(long s_id, float xpos, float ypos, float angle, float width, float height, float area, float xspeed, float yspeed, float rspeed, float maccel, float raccel) {
+	lockBlobList();
+	std::list<TuioBlob*>::iterator tblb;
+	for (tblb=blobList.begin(); tblb!= blobList.end(); tblb++)
+		if((*tblb)->getSessionID()==(long)s_id) break;
+	
+	if (tblb==blobList.end()) {
+		
+		TuioBlob *addBlob = createTuioBlob(TuioTime::getSessionTime(),(long)s_id,-1,xpos,ypos,angle,width,height,area);
+		frameBlobs.push_back(addBlob);
+		
+	} else if ( ((*tblb)->getX()!=xpos) || ((*tblb)->getY()!=ypos) || ((*tblb)->getAngle()!=angle) || ((*tblb)->getWidth()!=width) || ((*tblb)->getHeight()!=height) || ((*tblb)->getArea()!=area) || ((*tblb)->getXSpeed()!=xspeed) || ((*tblb)->getYSpeed()!=yspeed) || ((*tblb)->getMotionAccel()!=maccel) ) {
+		
+		TuioBlob *updateBlob = createTuioBlob(TuioTime::getSessionTime(),(long)s_id,(*tblb)->getBlobID(),xpos,ypos,angle,width,height,area);
+		updateBlob->update(xpos,ypos,angle,width,height,area,xspeed,yspeed,rspeed,maccel,raccel);
+		frameBlobs.push_back(updateBlob);
+	}
+	unlockBlobList();
+}
+
+void TuioClient::commitFrame(int profile, int32 fseq) {
+	bool lateFrame = false;
+	if (fseq>0) {
+		if (fseq>currentFrame) currentTime = TuioTime::getSessionTime();
+		if ((fseq>=currentFrame) || ((currentFrame-fseq)>100)) currentFrame = fseq;
+		else lateFrame = true;
+	} else if ((TuioTime::getSessionTime().getTotalMilliseconds()-currentTime.getTotalMilliseconds())>100) {
+		currentTime = TuioTime::getSessionTime();
+	}
+	
+	if (profile==TUIO_OBJECT_PROFILE) commitTuioObjects(lateFrame);
+	else if (profile==TUIO_CURSOR_PROFILE) commitTuioCursors(lateFrame);
+	else commitTuioBlobs(lateFrame);
+}
+
+void TuioClient::commitTuioObjects(bool lateFrame) {
+	if (!lateFrame) {
+		
+		lockObjectList();
+		//find the removed objects first
+		for (std::list<TuioObject*>::iterator tobj=objectList.begin(); tobj != objectList.end(); tobj++) {
+			if ((*tobj)->getTuioSourceID()==source_id) {
+				std::vector<long>::iterator iter = find(aliveObjectList.begin(), aliveObjectList.end(), (*tobj)->getSessionID());
+				if (iter == aliveObjectList.end()) {
+					(*tobj)->remove(currentTime);
+					frameObjects.push_back(*tobj);							
 				}
-			
-				if (!lateFrame) {
-					
+			}
+		}
+		unlockObjectList();
+		
+		for (std::list<TuioObject*>::iterator iter=frameObjects.begin(); iter != frameObjects.end(); iter++) {
+			TuioObject *tobj = (*iter);
+
+			TuioObject *frameObject = NULL;
+			switch (tobj->getTuioState()) {
+				case TUIO_REMOVED:
+
+					frameObject = tobj;
+					frameObject->remove(currentTime);
+
+					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+						(*listener)->removeTuioObject(frameObject);
+
 					lockObjectList();
-					//find the removed objects first
-					for (std::list<TuioObject*>::iterator tobj=objectList.begin(); tobj != objectList.end(); tobj++) {
-						if ((*tobj)->getTuioSourceID()==source_id) {
-							std::list<long>::iterator iter = find(aliveObjectList.begin(), aliveObjectList.end(), (*tobj)->getSessionID());
-							if (iter == aliveObjectList.end()) {
-								(*tobj)->remove(currentTime);
-								frameObjects.push_back(*tobj);							
-							}
+					for (std::list<TuioObject*>::iterator delobj=objectList.begin(); delobj!=objectList.end(); delobj++) {
+						if((*delobj)->getSessionID()==frameObject->getSessionID()) {
+							objectList.erase(delobj);
+							break;
 						}
 					}
 					unlockObjectList();
-					
-					for (std::list<TuioObject*>::iterator iter=frameObjects.begin(); iter != frameObjects.end(); iter++) {
-						TuioObject *tobj = (*iter);
-
-						TuioObject *frameObject = NULL;
-						switch (tobj->getTuioState()) {
-							case TUIO_REMOVED:
+					break;
+				case TUIO_ADDED:
 
-								frameObject = tobj;
-								frameObject->remove(currentTime);
+					lockObjectList();
+					frameObject = createTuioObject(currentTime,tobj->getSessionID(),tobj->getSymbolID(),tobj->getX(),tobj->getY(),tobj->getAngle());
+					if (source_name) frameObject->setTuioSource(source_id,source_name,source_addr);
+					objectList.push_back(frameObject);
+					unlockObjectList();
+					
+					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+						(*listener)->addTuioObject(frameObject);
 
-								for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-									(*listener)->removeTuioObject(frameObject);
+					break;
+				default:
 
-								lockObjectList();
-								for (std::list<TuioObject*>::iterator delobj=objectList.begin(); delobj!=objectList.end(); delobj++) {
-									if((*delobj)->getSessionID()==frameObject->getSessionID()) {
-										objectList.erase(delobj);
-										break;
-									}
-								}
-								unlockObjectList();
-								break;
-							case TUIO_ADDED:
-
-								lockObjectList();
-								frameObject = new TuioObject(currentTime,tobj->getSessionID(),tobj->getSymbolID(),tobj->getX(),tobj->getY(),tobj->getAngle());
-								if (source_name) frameObject->setTuioSource(source_id,source_name,source_addr);
-								objectList.push_back(frameObject);
-								unlockObjectList();
-								
-								for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-									(*listener)->addTuioObject(frameObject);
-
-								break;
-							default:
-
-								lockObjectList();
-								std::list<TuioObject*>::iterator iter;
-								for (iter=objectList.begin(); iter != objectList.end(); iter++) {
-									if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getSessionID()==tobj->getSessionID())) {
-										frameObject = (*iter);
-										break;
-									}
-								}	
-								
-								if (iter==objectList.end()) {
-									unlockObjectList();
-									break;
-								}
-								
-								if ( (tobj->getX()!=frameObject->getX() && tobj->getXSpeed()==0) || (tobj->getY()!=frameObject->getY() && tobj->getYSpeed()==0) )
-									frameObject->update(currentTime,tobj->getX(),tobj->getY(),tobj->getAngle());
-								else
-									frameObject->update(currentTime,tobj->getX(),tobj->getY(),tobj->getAngle(),tobj->getXSpeed(),tobj->getYSpeed(),tobj->getRotationSpeed(),tobj->getMotionAccel(),tobj->getRotationAccel());
-								
-								unlockObjectList();
-								
-								for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-									(*listener)->updateTuioObject(frameObject);
+					lockObjectList();
+					std::list<TuioObject*>::iterator iter;
+					for (iter=objectList.begin(); iter != objectList.end(); iter++) {
+						if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getSessionID()==tobj->getSessionID())) {
+							frameObject = (*iter);
+							break;
 						}
-						delete tobj;
+					}	
+					
+					if (iter==objectList.end()) {
+						unlockObjectList();
+						break;
 					}
 					
-					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-						(*listener)->refresh(currentTime);
+					if ( (tobj->getX()!=frameObject->getX() && tobj->getXSpeed()==0) || (tobj->getY()!=frameObject->getY() && tobj->getYSpeed()==0) )
+						frameObject->update(currentTime,tobj->getX(),tobj->getY(),tobj->getAngle());
+					else
+						frameObject->update(currentTime,tobj->getX(),tobj->getY(),tobj->getAngle(),tobj->getXSpeed(),tobj->getYSpeed(),tobj->getRotationSpeed(),tobj->getMotionAccel(),tobj->getRotationAccel());
 					
-				} else {
-					for (std::list<TuioObject*>::iterator iter=frameObjects.begin(); iter != frameObjects.end(); iter++) {
-						TuioObject *tobj = (*iter);
-						delete tobj;
-					}
-				}
-				
-				frameObjects.clear();
+					unlockObjectList();
+					
+					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+						(*listener)->updateTuioObject(frameObject);
 			}
-		} else if( strcmp( msg.AddressPattern(), "/tuio/2Dcur" ) == 0 ) {
-			const char* cmd;
-			args >> cmd;
-			
-			if (strcmp(cmd,"source")==0) {
-				const char* src;
-				args >> src;
-				
-				source_name = strtok((char*)src, "@");
-				char *addr = strtok(NULL, "@");
-				
-				if (addr!=NULL) source_addr = addr;
-				else source_addr = (char*)"localhost";
-				
-				// check if we know that source
-				std::string source_str(src);
-				std::map<std::string,int>::iterator iter = sourceList.find(source_str);
-				
-				// add a new source
-				if (iter==sourceList.end()) {
-					source_id = sourceList.size();
-					sourceList[source_str] = source_id;
-					maxCursorID[source_id] = -1;
-				} else {
-					// use the found source_id
-					source_id = sourceList[source_str];
-				}
-				
-			} else if (strcmp(cmd,"set")==0) {	
+			objectPool.release(tobj);
+		}
+		
+		for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+			(*listener)->refresh(currentTime);
+		
+	} else {
+		for (std::list<TuioObject*>::iterator iter=frameObjects.begin(); iter != frameObjects.end(); iter++) {
+			TuioObject *tobj = (*iter);
+			objectPool.release(tobj);
+		}
+	}
+	
+	frameObjects.clear();
+}
 
-				int32 s_id;
-				float xpos, ypos, xspeed, yspeed, maccel;				
-				args >> s_id >> xpos >> ypos >> xspeed >> yspeed >> maccel;
-				
-				lockCursorList();
-				std::list<TuioCursor*>::iterator tcur;
-				for (tcur=cursorList.begin(); tcur!= cursorList.end(); tcur++)
-					if (((*tcur)->getSessionID()==(long)s_id) && ((*tcur)->getTuioSourceID()==source_id)) break;
+void TuioClient::commitTuioCursors(bool lateFrame) {
+	if (!lateFrame) {
+		
+		lockCursorList();
+		// find the removed cursors first
+		for (std::list<TuioCursor*>::iterator tcur=cursorList.begin(); tcur != cursorList.end(); tcur++) {
+			if ((*tcur)->getTuioSourceID()==source_id) {
+				std::vector<long>::iterator iter = find(aliveCursorList.begin(), aliveCursorList.end(), (*tcur)->getSessionID());
 				
-				if (tcur==cursorList.end()) {
-									
-					TuioCursor *addCursor = new TuioCursor((long)s_id,-1,xpos,ypos);
-					frameCursors.push_back(addCursor);
+				if (iter == aliveCursorList.end()) {
+						(*tcur)->remove(currentTime);
+						frameCursors.push_back(*tcur);
+				}
+			}
+		}
+		unlockCursorList();
+		
+		for (std::list<TuioCursor*>::iterator iter=frameCursors.begin(); iter != frameCursors.end(); iter++) {
+			TuioCursor *tcur = (*iter);
+			
+			int c_id = 0;
+			int free_size = 0;
+			TuioCursor *frameCursor = NULL;
+			switch (tcur->getTuioState()) {
+				case TUIO_REMOVED:
 
-				} else if ( ((*tcur)->getX()!=xpos) || ((*tcur)->getY()!=ypos) || ((*tcur)->getXSpeed()!=xspeed) || ((*tcur)->getYSpeed()!=yspeed) || ((*tcur)->getMotionAccel()!=maccel) ) {
+					frameCursor = tcur;
+					frameCursor->remove(currentTime);
 
-					TuioCursor *updateCursor = new TuioCursor((long)s_id,(*tcur)->getCursorID(),xpos,ypos);
-					updateCursor->update(xpos,ypos,xspeed,yspeed,maccel);
-					frameCursors.push_back(updateCursor);
+					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+						(*listener)->removeTuioCursor(frameCursor);
 
-				}
-				unlockCursorList();
-				
-			} else if (strcmp(cmd,"alive")==0) {
-				
-				int32 s_id;
-				aliveCursorList.clear();
-				while(!args.Eos()) {
-					args >> s_id;
-					aliveCursorList.push_back((long)s_id);
-				}
-				
-			} else if( strcmp( cmd, "fseq" ) == 0 ) {
-				int32 fseq;
-				args >> fseq;
-				bool lateFrame = false;
-				if (fseq>0) {
-					if (fseq>currentFrame) currentTime = TuioTime::getSessionTime();
-					if ((fseq>=currentFrame) || ((currentFrame-fseq)>100)) currentFrame = fseq;
-					else lateFrame = true;
-				}  else if ((TuioTime::getSessionTime().getTotalMilliseconds()-currentTime.getTotalMilliseconds())>100) {
-					currentTime = TuioTime::getSessionTime();
-				}
-			
-				if (!lateFrame) {
-					
 					lockCursorList();
-					// find the removed cursors first
-					for (std::list<TuioCursor*>::iterator tcur=cursorList.begin(); tcur != cursorList.end(); tcur++) {
-						if ((*tcur)->getTuioSourceID()==source_id) {
-							std::list<long>::iterator iter = find(aliveCursorList.begin(), aliveCursorList.end(), (*tcur)->getSessionID());
-							
-							if (iter == aliveCursorList.end()) {
-									(*tcur)->remove(currentTime);
-									frameCursors.push_back(*tcur);
-							}
+					for (std::list<TuioCursor*>::iterator delcur=cursorList.begin(); delcur!=cursorList.end(); delcur++) {
+						if(((*delcur)->getTuioSourceID()==source_id) && ((*delcur)->getSessionID()==frameCursor->getSessionID())) {
+							cursorList.erase(delcur);
+							break;
 						}
 					}
-					unlockCursorList();
-					
-					for (std::list<TuioCursor*>::iterator iter=frameCursors.begin(); iter != frameCursors.end(); iter++) {
-						TuioCursor *tcur = (*iter);
-						
-						int c_id = 0;
-						int free_size = 0;
-						TuioCursor *frameCursor = NULL;
-						switch (tcur->getTuioState()) {
-							case TUIO_REMOVED:
-		
-								frameCursor = tcur;
-								frameCursor->remove(currentTime);
-	
-								for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-									(*listener)->removeTuioCursor(frameCursor);
-
-								lockCursorList();
-								for (std::list<TuioCursor*>::iterator delcur=cursorList.begin(); delcur!=cursorList.end(); delcur++) {
-									if(((*delcur)->getTuioSourceID()==source_id) && ((*delcur)->getSessionID()==frameCursor->getSessionID())) {
-										cursorList.erase(delcur);
-										break;
-									}
-								}
 
-								if (frameCursor->getCursorID()==maxCursorID[source_id]) {
-									maxCursorID[source_id] = -1;
-									delete frameCursor;
-									
-									if (cursorList.size()>0) {
-										std::list<TuioCursor*>::iterator clist;
-										for (clist=cursorList.begin(); clist != cursorList.end(); clist++) {
-											if ((*clist)->getTuioSourceID()==source_id) {
-												c_id = (*clist)->getCursorID();
-												if (c_id>maxCursorID[source_id]) maxCursorID[source_id]=c_id;
-											}
-										}
-			
-										freeCursorBuffer.clear();
-										for (std::list<TuioCursor*>::iterator flist=freeCursorList.begin(); flist != freeCursorList.end(); flist++) {
-											TuioCursor *freeCursor = (*flist);
-											if (freeCursor->getTuioSourceID()==source_id) {
-												if (freeCursor->getCursorID()>maxCursorID[source_id]) delete freeCursor;
-												else freeCursorBuffer.push_back(freeCursor);
-											} else freeCursorBuffer.push_back(freeCursor);
-										}	
-										freeCursorList = freeCursorBuffer;
-
-									} else {
-										freeCursorBuffer.clear();
-										for (std::list<TuioCursor*>::iterator flist=freeCursorList.begin(); flist != freeCursorList.end(); flist++) {
-											TuioCursor *freeCursor = (*flist);
-											if (freeCursor->getTuioSourceID()==source_id) delete freeCursor;
-											else freeCursorBuffer.push_back(freeCursor);
-										}	
-										freeCursorList = freeCursorBuffer;
-										
-									}
-								} else if (frameCursor->getCursorID()<maxCursorID[source_id]) {
-									freeCursorList.push_back(frameCursor);
-								} 
-								
-								unlockCursorList();
-								break;
-							case TUIO_ADDED:
-								
-								lockCursorList();
-								for(std::list<TuioCursor*>::iterator iter = cursorList.begin();iter!= cursorList.end(); iter++)
-									if ((*iter)->getTuioSourceID()==source_id) c_id++;
-								
-								for(std::list<TuioCursor*>::iterator iter = freeCursorList.begin();iter!= freeCursorList.end(); iter++)
-									if ((*iter)->getTuioSourceID()==source_id) free_size++;
-								
-								if ((free_size<=maxCursorID[source_id]) && (free_size>0)) {
-									std::list<TuioCursor*>::iterator closestCursor = freeCursorList.begin();
-									
-									for(std::list<TuioCursor*>::iterator iter = freeCursorList.begin();iter!= freeCursorList.end(); iter++) {
-										if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getDistance(tcur)<(*closestCursor)->getDistance(tcur))) closestCursor = iter;
-									}
-									
-									if (closestCursor!=freeCursorList.end()) {
-										TuioCursor *freeCursor = (*closestCursor);
-										c_id = freeCursor->getCursorID();
-										freeCursorList.erase(closestCursor);
-										delete freeCursor;
-									}
-								} else maxCursorID[source_id] = c_id;									
-								
-								frameCursor = new TuioCursor(currentTime,tcur->getSessionID(),c_id,tcur->getX(),tcur->getY());
-								if (source_name) frameCursor->setTuioSource(source_id,source_name,source_addr);
-								cursorList.push_back(frameCursor);
-								
-								delete tcur;
-								unlockCursorList();
-								
-								for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-									(*listener)->addTuioCursor(frameCursor);
-								
-								break;
-							default:
-								
-								lockCursorList();
-								std::list<TuioCursor*>::iterator iter;
-								for (iter=cursorList.begin(); iter != cursorList.end(); iter++) {
-									if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getSessionID()==tcur->getSessionID())) {
-										frameCursor = (*iter);
-										break;
-									}
-								}	
-								
-								if (iter==cursorList.end()) {
-									unlockCursorList();
-									break;
+					if (frameCursor->getCursorID()==maxCursorID[source_id]) {
+						maxCursorID[source_id] = -1;
+						cursorPool.release(frameCursor);
+						
+						if (cursorList.size()>0) {
+							std::list<TuioCursor*>::iterator clist;
+							for (clist=cursorList.begin(); clist != cursorList.end(); clist++) {
+								if ((*clist)->getTuioSourceID()==source_id) {
+									c_id = (*clist)->getCursorID();
+									if (c_id>maxCursorID[source_id]) maxCursorID[source_id]=c_id;
 								}
-								
-								if ( (tcur->getX()!=frameCursor->getX() && tcur->getXSpeed()==0) || (tcur->getY()!=frameCursor->getY() && tcur->getYSpeed()==0) )
-									frameCursor->update(currentTime,tcur->getX(),tcur->getY());
-								else
-									frameCursor->update(currentTime,tcur->getX(),tcur->getY(),tcur->getXSpeed(),tcur->getYSpeed(),tcur->getMotionAccel());
-			
-								delete tcur;
-								unlockCursorList();
-
-								for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-									(*listener)->updateTuioCursor(frameCursor);
+							}
 
-						}	
-					}
+							freeCursorBuffer.clear();
+							for (std::list<TuioCursor*>::iterator flist=freeCursorList.begin(); flist != freeCursorList.end(); flist++) {
+								TuioCursor *freeCursor = (*flist);
+								if (freeCursor->getTuioSourceID()==source_id) {
+									if (freeCursor->getCursorID()>maxCursorID[source_id]) cursorPool.release(freeCursor);
+									else freeCursorBuffer.push_back(freeCursor);
+								} else freeCursorBuffer.push_back(freeCursor);
+							}	
+							freeCursorList = freeCursorBuffer;
+
+						} else {
+							freeCursorBuffer.clear();
+							for (std::list<TuioCursor*>::iterator flist=freeCursorList.begin(); flist != freeCursorList.end(); flist++) {
+								TuioCursor *freeCursor = (*flist);
+								if (freeCursor->getTuioSourceID()==source_id) cursorPool.release(freeCursor);
+								else freeCursorBuffer.push_back(freeCursor);
+							}	
+							freeCursorList = freeCursorBuffer;
+							
+						}
+					} else if (frameCursor->getCursorID()<maxCursorID[source_id]) {
+						freeCursorList.push_back(frameCursor);
+					} 
+					
+					unlockCursorList();
+					break;
+				case TUIO_ADDED:
+					
+					lockCursorList();
+					for(std::list<TuioCursor*>::iterator iter = cursorList.begin();iter!= cursorList.end(); iter++)
+						if ((*iter)->getTuioSourceID()==source_id) c_id++;
+					
+					for(std::list<TuioCursor*>::iterator iter = freeCursorList.begin();iter!= freeCursorList.end(); iter++)
+						if ((*iter)->getTuioSourceID()==source_id) free_size++;
+					
+					if ((free_size<=maxCursorID[source_id]) && (free_size>0)) {
+						std::list<TuioCursor*>::iterator closestCursor = freeCursorList.begin();
+						
+						for(std::list<TuioCursor*>::iterator iter = freeCursorList.begin();iter!= freeCursorList.end(); iter++) {
+							if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getDistance(tcur)<(*closestCursor)->getDistance(tcur))) closestCursor = iter;
+						}
+						
+						if (closestCursor!=freeCursorList.end()) {
+							TuioCursor *freeCursor = (*closestCursor);
+							c_id = freeCursor->getCursorID();
+							freeCursorList.erase(closestCursor);
+							cursorPool.release(freeCursor);
+						}
+					} else maxCursorID[source_id] = c_id;									
+					
+					frameCursor = createTuioCursor(currentTime,tcur->getSessionID(),c_id,tcur->getX(),tcur->getY());
+					if (source_name) frameCursor->setTuioSource(source_id,source_name,source_addr);
+					cursorList.push_back(frameCursor);
+					
+					cursorPool.release(tcur);
+					unlockCursorList();
 					
 					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-						(*listener)->refresh(currentTime);
+						(*listener)->addTuioCursor(frameCursor);
 					
-				} else {
-					for (std::list<TuioCursor*>::iterator iter=frameCursors.begin(); iter != frameCursors.end(); iter++) {
-						TuioCursor *tcur = (*iter);
-						delete tcur;
-					}
-				}
-				
-				frameCursors.clear();
-			}
-		} else if( strcmp( msg.AddressPattern(), "/tuio/2Dblb" ) == 0 ){
-			const char* cmd;
-			args >> cmd;
-			
-			if (strcmp(cmd,"source")==0) {	
-				const char* src;
-				args >> src;
-				
-				source_name = strtok((char*)src, "@");
-				char *addr = strtok(NULL, "@");
-				
-				if (addr!=NULL) source_addr = addr;
-				else source_addr = (char*)"localhost";
-				
-				// check if we know that source
-				std::string source_str(src);
-				std::map<std::string,int>::iterator iter = sourceList.find(source_str);
-				
-				// add a new source
-				if (iter==sourceList.end()) {
-					source_id = sourceList.size();
-					sourceList[source_str] = source_id;
-					maxBlobID[source_id]   = -1;
-				} else {
-					// use the found source_id
-					source_id = sourceList[source_str];
-				}
-				
-			} else if (strcmp(cmd,"set")==0) {	
-				
-				int32 s_id;
-				float xpos, ypos, angle, width, height, area, xspeed, yspeed, rspeed, maccel, raccel;				
-				args >> s_id >> xpos >> ypos >> angle >> width >> height >> area >> xspeed >> yspeed >> rspeed >> maccel >> raccel;
-				
-				lockBlobList();
-				std::list<TuioBlob*>::iterator tblb;
-				for (tblb=blobList.begin(); tblb!= blobList.end(); tblb++)
-					if((*tblb)->getSessionID()==(long)s_id) break;
-				
-				if (tblb==blobList.end()) {
+					break;
+				default:
 					
-					TuioBlob *addBlob = new TuioBlob((long)s_id,-1,xpos,ypos,angle,width,height,area);
-					frameBlobs.push_back(addBlob);
+					lockCursorList();
+					std::list<TuioCursor*>::iterator iter;
+					for (iter=cursorList.begin(); iter != cursorList.end(); iter++) {
+						if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getSessionID()==tcur->getSessionID())) {
+							frameCursor = (*iter);
+							break;
+						}
+					}	
 					
-				} else if ( ((*tblb)->getX()!=xpos) || ((*tblb)->getY()!=ypos) || ((*tblb)->getAngle()!=angle) || ((*tblb)->getWidth()!=width) || ((*tblb)->getHeight()!=height) || ((*tblb)->getArea()!=area) || ((*tblb)->getXSpeed()!=xspeed) || ((*tblb)->getYSpeed()!=yspeed) || ((*tblb)->getMotionAccel()!=maccel) ) {
+					if (iter==cursorList.end()) {
+						unlockCursorList();
+						break;
+					}
 					
-					TuioBlob *updateBlob = new TuioBlob((long)s_id,(*tblb)->getBlobID(),xpos,ypos,angle,width,height,area);
-					updateBlob->update(xpos,ypos,angle,width,height,area,xspeed,yspeed,rspeed,maccel,raccel);
-					frameBlobs.push_back(updateBlob);
-				}
-				unlockBlobList();
-				
-			} else if (strcmp(cmd,"alive")==0) {
-				
-				int32 s_id;
-				aliveBlobList.clear();
-				while(!args.Eos()) {
-					args >> s_id;
-					aliveBlobList.push_back((long)s_id);
-				}
-				
-			} else if( strcmp( cmd, "fseq" ) == 0 ) {
+					if ( (tcur->getX()!=frameCursor->getX() && tcur->getXSpeed()==0) || (tcur->getY()!=frameCursor->getY() && tcur->getYSpeed()==0) )
+						frameCursor->update(currentTime,tcur->getX(),tcur->getY());
+					else
+						frameCursor->update(currentTime,tcur->getX(),tcur->getY(),tcur->getXSpeed(),tcur->getYSpeed(),tcur->getMotionAccel());
+
+					cursorPool.release(tcur);
+					unlockCursorList();
+
+					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+						(*listener)->updateTuioCursor(frameCursor);
+
+			}	
+		}
+		
+		for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+			(*listener)->refresh(currentTime);
+		
+	} else {
+		for (std::list<TuioCursor*>::iterator iter=frameCursors.begin(); iter != frameCursors.end(); iter++) {
+			TuioCursor *tcur = (*iter);
+			cursorPool.release(tcur);
+		}
+	}
+	
+	frameCursors.clear();
+}
+
+void TuioClient::commitTuioBlobs(bool lateFrame) {
+	if (!lateFrame) {
+		
+		lockBlobList();
+		// find the removed blobs first
+		for (std::list<TuioBlob*>::iterator tblb=blobList.begin(); tblb != blobList.end(); tblb++) {
+			if ((*tblb)->getTuioSourceID()==source_id) {
+				std::vector<long>::iterator iter = find(aliveBlobList.begin(), aliveBlobList.end(), (*tblb)->getSessionID());
 				
-				int32 fseq;
-				args >> fseq;
-				bool lateFrame = false;
-				if (fseq>0) {
-					if (fseq>currentFrame) currentTime = TuioTime::getSessionTime();
-					if ((fseq>=currentFrame) || ((currentFrame-fseq)>100)) currentFrame = fseq;
-					else lateFrame = true;
-				}  else if ((TuioTime::getSessionTime().getTotalMilliseconds()-currentTime.getTotalMilliseconds())>100) {
-					currentTime = TuioTime::getSessionTime();
+				if (iter == aliveBlobList.end()) {
+					(*tblb)->remove(currentTime);
+					frameBlobs.push_back(*tblb);
 				}
-				
-				if (!lateFrame) {
+			}
+		}
+		unlockBlobList();
+		
+		for (std::list<TuioBlob*>::iterator iter=frameBlobs.begin(); iter != frameBlobs.end(); iter++) {
+			TuioBlob *tblb = (*iter);
+			
+			int b_id = 0;
+			int free_size = 0;
+			TuioBlob *frameBlob = NULL;
+			switch (tblb->getTuioState()) {
+				case TUIO_REMOVED:
+					frameBlob = tblb;
+					frameBlob->remove(currentTime);
+					
+					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+						(*listener)->removeTuioBlob(frameBlob);
 					
 					lockBlobList();
-					// find the removed blobs first
-					for (std::list<TuioBlob*>::iterator tblb=blobList.begin(); tblb != blobList.end(); tblb++) {
-						if ((*tblb)->getTuioSourceID()==source_id) {
-							std::list<long>::iterator iter = find(aliveBlobList.begin(), aliveBlobList.end(), (*tblb)->getSessionID());
-							
-							if (iter == aliveBlobList.end()) {
-								(*tblb)->remove(currentTime);
-								frameBlobs.push_back(*tblb);
-							}
+					for (std::list<TuioBlob*>::iterator delblb=blobList.begin(); delblb!=blobList.end(); delblb++) {
+						if(((*delblb)->getTuioSourceID()==source_id) && ((*delblb)->getSessionID()==frameBlob->getSessionID())) {
+							blobList.erase(delblb);
+							break;
 						}
 					}
-					unlockBlobList();
 					
-					for (std::list<TuioBlob*>::iterator iter=frameBlobs.begin(); iter != frameBlobs.end(); iter++) {
-						TuioBlob *tblb = (*iter);
+					if (frameBlob->getBlobID()==maxBlobID[source_id]) {
+						maxBlobID[source_id] = -1;
+						blobPool.release(frameBlob);
 						
-						int b_id = 0;
-						int free_size = 0;
-						TuioBlob *frameBlob = NULL;
-						switch (tblb->getTuioState()) {
-							case TUIO_REMOVED:
-								frameBlob = tblb;
-								frameBlob->remove(currentTime);
-								
-								for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-									(*listener)->removeTuioBlob(frameBlob);
-								
-								lockBlobList();
-								for (std::list<TuioBlob*>::iterator delblb=blobList.begin(); delblb!=blobList.end(); delblb++) {
-									if(((*delblb)->getTuioSourceID()==source_id) && ((*delblb)->getSessionID()==frameBlob->getSessionID())) {
-										blobList.erase(delblb);
-										break;
-									}
+						if (blobList.size()>0) {
+							std::list<TuioBlob*>::iterator clist;
+							for (clist=blobList.begin(); clist != blobList.end(); clist++) {
+								if ((*clist)->getTuioSourceID()==source_id) {
+									b_id = (*clist)->getBlobID();
+									if (b_id>maxBlobID[source_id]) maxBlobID[source_id]=b_id;
 								}
-								
-								if (frameBlob->getBlobID()==maxBlobID[source_id]) {
-									maxBlobID[source_id] = -1;
-									delete frameBlob;
-									
-									if (blobList.size()>0) {
-										std::list<TuioBlob*>::iterator clist;
-										for (clist=blobList.begin(); clist != blobList.end(); clist++) {
-											if ((*clist)->getTuioSourceID()==source_id) {
-												b_id = (*clist)->getBlobID();
-												if (b_id>maxBlobID[source_id]) maxBlobID[source_id]=b_id;
-											}
-										}
-										
-										freeBlobBuffer.clear();
-										for (std::list<TuioBlob*>::iterator flist=freeBlobList.begin(); flist != freeBlobList.end(); flist++) {
-											TuioBlob *freeBlob = (*flist);
-											if (freeBlob->getTuioSourceID()==source_id) {
-												if (freeBlob->getBlobID()>maxBlobID[source_id]) delete freeBlob;
-												else freeBlobBuffer.push_back(freeBlob);
-											} else freeBlobBuffer.push_back(freeBlob);
-										}	
-										freeBlobList = freeBlobBuffer;
-										
-									} else {
-										freeBlobBuffer.clear();
-										for (std::list<TuioBlob*>::iterator flist=freeBlobList.begin(); flist != freeBlobList.end(); flist++) {
-											TuioBlob *freeBlob = (*flist);
-											if (freeBlob->getTuioSourceID()==source_id) delete freeBlob;
-											else freeBlobBuffer.push_back(freeBlob);
-										}	
-										freeBlobList = freeBlobBuffer;
-										
-									}
-								} else if (frameBlob->getBlobID()<maxBlobID[source_id]) {
-									freeBlobList.push_back(frameBlob);
-								} 
-								
-								unlockBlobList();
-								break;
-							case TUIO_ADDED:
-								
-								lockBlobList();
-								for(std::list<TuioBlob*>::iterator iter = blobList.begin();iter!= blobList.end(); iter++)
-									if ((*iter)->getTuioSourceID()==source_id) b_id++;
-								
-								for(std::list<TuioBlob*>::iterator iter = freeBlobList.begin();iter!= freeBlobList.end(); iter++)
-									if ((*iter)->getTuioSourceID()==source_id) free_size++;
-								
-								if ((free_size<=maxBlobID[source_id]) && (free_size>0)) {
-									std::list<TuioBlob*>::iterator closestBlob = freeBlobList.begin();
-									
-									for(std::list<TuioBlob*>::iterator iter = freeBlobList.begin();iter!= freeBlobList.end(); iter++) {
-										if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getDistance(tblb)<(*closestBlob)->getDistance(tblb))) closestBlob = iter;
-									}
-									
-									if (closestBlob!=freeBlobList.end()) {
-										TuioBlob *freeBlob = (*closestBlob);
-										b_id = freeBlob->getBlobID();
-										freeBlobList.erase(closestBlob);
-										delete freeBlob;
-									}
-								} else maxBlobID[source_id] = b_id;									
-								
-								frameBlob = new TuioBlob(currentTime,tblb->getSessionID(),b_id,tblb->getX(),tblb->getY(),tblb->getAngle(),tblb->getWidth(),tblb->getHeight(),tblb->getArea());
-								if (source_name) frameBlob->setTuioSource(source_id,source_name,source_addr);
-								blobList.push_back(frameBlob);
-								
-								delete tblb;
-								unlockBlobList();
-								
-								for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-									(*listener)->addTuioBlob(frameBlob);
+							}
 							
-								break;
-							default:
-								
-								lockBlobList();
-								std::list<TuioBlob*>::iterator iter;
-								for (iter=blobList.begin(); iter != blobList.end(); iter++) {
-									if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getSessionID()==tblb->getSessionID())) {
-										frameBlob = (*iter);
-										break;
-									}
-								}	
-								
-								if (iter==blobList.end()) {
-									unlockBlobList();
-									break;
-								}
-								
-								if ( (tblb->getX()!=frameBlob->getX() && tblb->getXSpeed()==0) || (tblb->getY()!=frameBlob->getY() && tblb->getYSpeed()==0) || (tblb->getAngle()!=frameBlob->getAngle() && tblb->getRotationSpeed()==0) )
-									frameBlob->update(currentTime,tblb->getX(),tblb->getY(),tblb->getAngle(),tblb->getWidth(),tblb->getHeight(),tblb->getArea());
-								else
-									frameBlob->update(currentTime,tblb->getX(),tblb->getY(),tblb->getAngle(),tblb->getWidth(),tblb->getHeight(),tblb->getArea(),tblb->getXSpeed(),tblb->getYSpeed(),tblb->getRotationSpeed(),tblb->getMotionAccel(),tblb->getRotationAccel());
-								
-								delete tblb;
-								unlockBlobList();
-								
-								for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-									(*listener)->updateTuioBlob(frameBlob);
-						}	
-					}
+							freeBlobBuffer.clear();
+							for (std::list<TuioBlob*>::iterator flist=freeBlobList.begin(); flist != freeBlobList.end(); flist++) {
+								TuioBlob *freeBlob = (*flist);
+								if (freeBlob->getTuioSourceID()==source_id) {
+									if (freeBlob->getBlobID()>maxBlobID[source_id]) blobPool.release(freeBlob);
+									else freeBlobBuffer.push_back(freeBlob);
+								} else freeBlobBuffer.push_back(freeBlob);
+							}	
+							freeBlobList = freeBlobBuffer;
+							
+						} else {
+							freeBlobBuffer.clear();
+							for (std::list<TuioBlob*>::iterator flist=freeBlobList.begin(); flist != freeBlobList.end(); flist++) {
+								TuioBlob *freeBlob = (*flist);
+								if (freeBlob->getTuioSourceID()==source_id) blobPool.release(freeBlob);
+								else freeBlobBuffer.push_back(freeBlob);
+							}	
+							freeBlobList = freeBlobBuffer;
+							
+						}
+					} else if (frameBlob->getBlobID()<maxBlobID[source_id]) {
+						freeBlobList.push_back(frameBlob);
+					} 
+					
+					unlockBlobList();
+					break;
+				case TUIO_ADDED:
+					
+					lockBlobList();
+					for(std::list<TuioBlob*>::iterator iter = blobList.begin();iter!= blobList.end(); iter++)
+						if ((*iter)->getTuioSourceID()==source_id) b_id++;
+					
+					for(std::list<TuioBlob*>::iterator iter = freeBlobList.begin();iter!= freeBlobList.end(); iter++)
+						if ((*iter)->getTuioSourceID()==source_id) free_size++;
+					
+					if ((free_size<=maxBlobID[source_id]) && (free_size>0)) {
+						std::list<TuioBlob*>::iterator closestBlob = freeBlobList.begin();
+						
+						for(std::list<TuioBlob*>::iterator iter = freeBlobList.begin();iter!= freeBlobList.end(); iter++) {
+							if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getDistance(tblb)<(*closestBlob)->getDistance(tblb))) closestBlob = iter;
+						}
+						
+						if (closestBlob!=freeBlobList.end()) {
+							TuioBlob *freeBlob = (*closestBlob);
+							b_id = freeBlob->getBlobID();
+							freeBlobList.erase(closestBlob);
+							blobPool.release(freeBlob);
+						}
+					} else maxBlobID[source_id] = b_id;									
+					
+					frameBlob = createTuioBlob(currentTime,tblb->getSessionID(),b_id,tblb->getX(),tblb->getY(),tblb->getAngle(),tblb->getWidth(),tblb->getHeight(),tblb->getArea());
+					if (source_name) frameBlob->setTuioSource(source_id,source_name,source_addr);
+					blobList.push_back(frameBlob);
+					
+					blobPool.release(tblb);
+					unlockBlobList();
 					
 					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
-						(*listener)->refresh(currentTime);
+						(*listener)->addTuioBlob(frameBlob);
+				
+					break;
+				default:
 					
-				} else {
-					for (std::list<TuioBlob*>::iterator iter=frameBlobs.begin(); iter != frameBlobs.end(); iter++) {
-						TuioBlob *tblb = (*iter);
-						delete tblb;
+					lockBlobList();
+					std::list<TuioBlob*>::iterator iter;
+					for (iter=blobList.begin(); iter != blobList.end(); iter++) {
+						if (((*iter)->getTuioSourceID()==source_id) && ((*iter)->getSessionID()==tblb->getSessionID())) {
+							frameBlob = (*iter);
+							break;
+						}
+					}	
+					
+					if (iter==blobList.end()) {
+						unlockBlobList();
+						break;
 					}
-				}
-				
-				frameBlobs.clear();
-			}
+					
+					if ( (tblb->getX()!=frameBlob->getX() && tblb->getXSpeed()==0) || (tblb->getY()!=frameBlob->getY() && tblb->getYSpeed()==0) || (tblb->getAngle()!=frameBlob->getAngle() && tblb->getRotationSpeed()==0) )
+						frameBlob->update(currentTime,tblb->getX(),tblb->getY(),tblb->getAngle(),tblb->getWidth(),tblb->getHeight(),tblb->getArea());
+					else
+						frameBlob->update(currentTime,tblb->getX(),tblb->getY(),tblb->getAngle(),tblb->getWidth(),tblb->getHeight(),tblb->getArea(),tblb->getXSpeed(),tblb->getYSpeed(),tblb->getRotationSpeed(),tblb->getMotionAccel(),tblb->getRotationAccel());
+					
+					blobPool.release(tblb);
+					unlockBlobList();
+					
+					for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+						(*listener)->updateTuioBlob(frameBlob);
+			}	
+		}
+		
+		for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
+			(*listener)->refresh(currentTime);
+		
+	} else {
+		for (std::list<TuioBlob*>::iterator iter=frameBlobs.begin(); iter != frameBlobs.end(); iter++) {
+			TuioBlob *tblb = (*iter);
+			blobPool.release(tblb);
 		}
-	} catch( Exception& e ){
-		std::cerr << "error parsing TUIO message: "<< msg.AddressPattern() <<  " - " << e.what() << std::endl;
 	}
+	
+	frameBlobs.clear();
 }
 
 bool TuioClient::isConnected() {	
@@ -725,23 +754,23 @@ void TuioClient::disconnect() {
 	aliveBlobList.clear();
 
 	for (std::list<TuioObject*>::iterator iter=objectList.begin(); iter != objectList.end(); iter++)
-		delete (*iter);
+		objectPool.release(*iter);
 	objectList.clear();
 
 	for (std::list<TuioCursor*>::iterator iter=cursorList.begin(); iter != cursorList.end(); iter++)
-		delete (*iter);
+		cursorPool.release(*iter);
 	cursorList.clear();
 
 	for (std::list<TuioBlob*>::iterator iter=blobList.begin(); iter != blobList.end(); iter++)
-		delete (*iter);
+		blobPool.release(*iter);
 	blobList.clear();
 	
 	for (std::list<TuioCursor*>::iterator iter=freeCursorList.begin(); iter != freeCursorList.end(); iter++)
-		delete(*iter);
+		cursorPool.release(*iter);
 	freeCursorList.clear();
 
 	for (std::list<TuioBlob*>::iterator iter=freeBlobList.begin(); iter != freeBlobList.end(); iter++)
-		delete(*iter);
+		blobPool.release(*iter);
 	freeBlobList.clear();
 }
 
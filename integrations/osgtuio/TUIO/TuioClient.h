@@ -23,11 +23,14 @@
 #define INCLUDED_TUIOCLIENT_H
 
 #include "TuioDispatcher.h"
+#include "TuioPool.h"
 #include "OscReceiver.h"
 #include "osc/OscReceivedElements.h"
+#include "osc/OscBulkReader.h"
 
 #include <iostream>
 #include <list>
+#include <vector>
 #include <map>
 #include <algorithm>
 #include <string>
@@ -133,6 +136,16 @@ namespace TUIO {
 			return TuioDispatcher::copyTuioObjects();
 		}
 		
+		/**
+		 * Copies the attributes of all currently active TuioObjects into the provided buffer
+		 * without allocating, once the buffer has grown to the number of active TuioObjects
+		 *
+		 * @param  buffer  receives a TuioEntity for each active TuioObject
+		 */
+		void getTuioObjects(std::vector<TuioEntity> &buffer) {
+			TuioDispatcher::getTuioObjects(buffer);
+		}
+		
 		/**
 		 * Returns the TuioObject corresponding to the provided Session ID
 		 * or NULL if the Session ID does not refer to an active TuioObject
@@ -182,6 +195,16 @@ namespace TUIO {
 			return TuioDispatcher::copyTuioCursors();
 		}
 		
+		/**
+		 * Copies the attributes of all currently active TuioCursors into the provided buffer
+		 * without allocating, once the buffer has grown to the number of active TuioCursors
+		 *
+		 * @param  buffer  receives a TuioEntity for each active TuioCursor
+		 */
+		void getTuioCursors(std::vector<TuioEntity> &buffer) {
+			TuioDispatcher::getTuioCursors(buffer);
+		}
+		
 		/**
 		 * Returns a List with a copy of all currently active TuioCursors
 		 * which are associated to the given Source ID
@@ -240,6 +263,16 @@ namespace TUIO {
 			return TuioDispatcher::copyTuioBlobs();
 		}
 		
+		/**
+		 * Copies the attributes of all currently active TuioBlobs into the provided buffer
+		 * without allocating, once the buffer has grown to the number of active TuioBlobs
+		 *
+		 * @param  buffer  receives a TuioEntity for each active TuioBlob
+		 */
+		void getTuioBlobs(std::vector<TuioEntity> &buffer) {
+			TuioDispatcher::getTuioBlobs(buffer);
+		}
+		
 		/**
 		 * Returns a List with a copy of all currently active TuioBlobs
 		 * which are associated to the given Source ID
@@ -273,15 +306,46 @@ namespace TUIO {
 		
 		void processOSC( const osc::ReceivedMessage& message);
 		
+		/**
+		 * Decodes a message of an already validated OSC packet, reading its arguments straight from the packet buffer
+		 *
+		 * @param  message  a message of a packet validated by the osc::BulkPacketReader
+		 */
+		void processOSC( const osc::BulkMessage& message);
+		
 	private:
 		void initialize();
 		
+		void setTuioSource(const char *src);
+		void setTuioObject(long s_id, int c_id, float xpos, float ypos, float angle, float xspeed, float yspeed, float rspeed, float maccel, float raccel);
+		void setTuioCursor(long s_id, float xpos, float ypos, float xspeed, float yspeed, float maccel);
+		void setTuioBlob(long s_id, float xpos, float ypos, float angle, float width, float height, float area, float xspeed, float yspeed, float rspeed, float maccel, float raccel);
+		std::vector<long>& getAliveList(int profile);
+		void commitFrame(int profile, osc::int32 fseq);
+		void commitTuioObjects(bool lateFrame);
+		void commitTuioCursors(bool lateFrame);
+		void commitTuioBlobs(bool lateFrame);
+		
+		TuioObject* createTuioObject(TuioTime ttime, long s_id, int sym, float xp, float yp, float a);
+		TuioCursor* createTuioCursor(TuioTime ttime, long s_id, int c_id, float xp, float yp);
+		TuioBlob* createTuioBlob(TuioTime ttime, long s_id, int b_id, float xp, float yp, float a, float w, float h, float f);
+		
+		// released components are kept for reuse instead of being deleted
+		TuioPool<TuioObject> objectPool;
+		TuioPool<TuioCursor> cursorPool;
+		TuioPool<TuioBlob> blobPool;
+		
 		std::list<TuioObject*> frameObjects;
-		std::list<long> aliveObjectList;
+		std::vector<long> aliveObjectList;
 		std::list<TuioCursor*> frameCursors;
-		std::list<long> aliveCursorList;
+		std::vector<long> aliveCursorList;
 		std::list<TuioBlob*> frameBlobs;
-		std::list<long> aliveBlobList;
+		std::vector<long> aliveBlobList;
+		std::vector<osc::int32> aliveBuffer;
+		
+		// the TUIO profiles and commands, looked up by their precomputed hashes
+		osc::AddressTable profileTable;
+		osc::AddressTable commandTable;
 		
 		osc::int32 currentFrame;
 		TuioTime currentTime;
@@ -32,10 +32,14 @@ TuioContainer::TuioContainer (TuioTime ttime, long si, float xp, float yp):TuioP
 	x_speed = 0.0f;
 	y_speed = 0.0f;
 	motion_speed = 0.0f;
-	motion_accel = 0.0f;			
+	motion_accel = 0.0f;
+	last_motion_speed = 0.0f;			
 	TuioPoint p(currentTime,xpos,ypos);
 	path.push_back(p);
-	
+	path_length = 1;
+	listed = false;
+	in_frame = false;
+	frame_index = -1;
 }
 
 TuioContainer::TuioContainer (long si, float xp, float yp):TuioPoint(xp,yp)
@@ -48,9 +52,14 @@ TuioContainer::TuioContainer (long si, float xp, float yp):TuioPoint(xp,yp)
 	x_speed = 0.0f;
 	y_speed = 0.0f;
 	motion_speed = 0.0f;
-	motion_accel = 0.0f;			
+	motion_accel = 0.0f;
+	last_motion_speed = 0.0f;			
 	TuioPoint p(currentTime,xpos,ypos);
 	path.push_back(p);
+	path_length = 1;
+	listed = false;
+	in_frame = false;
+	frame_index = -1;
 }
 
 TuioContainer::TuioContainer (TuioContainer *tcon):TuioPoint(tcon)
@@ -64,8 +73,53 @@ TuioContainer::TuioContainer (TuioContainer *tcon):TuioPoint(tcon)
 	y_speed = 0.0f;
 	motion_speed = 0.0f;
 	motion_accel = 0.0f;
+	last_motion_speed = 0.0f;
 	TuioPoint p(currentTime,xpos,ypos);
 	path.push_back(p);
+	path_length = 1;
+	listed = false;
+	in_frame = false;
+	frame_index = -1;
+}
+
+void TuioContainer::init(TuioTime ttime, long si, float xp, float yp) {
+	TuioPoint::update(ttime,xp,yp);
+	startTime = ttime;
+	session_id = si;
+	x_speed = 0.0f;
+	y_speed = 0.0f;
+	motion_speed = 0.0f;
+	motion_accel = 0.0f;
+	last_motion_speed = 0.0f;
+	state = TUIO_ADDED;
+	source_id = 0;
+	source_name = "undefined";
+	source_addr = "localhost";
+	
+	if (path_length>1) {
+		path.erase(++path.begin(),path.end());
+		path_length = 1;
+	}
+	path.front() = TuioPoint(currentTime,xpos,ypos);
+}
+
+void TuioContainer::addPathPoint(const TuioPoint &p) {
+	if (path_length<TUIO_MAX_PATH_LENGTH) {
+		path.push_back(p);
+		path_length++;
+	} else {
+		path.splice(path.end(),path,path.begin());
+		path.back() = p;
+	}
+}
+
+bool TuioContainer::isRepeatedUpdate(const TuioTime &ttime) const {
+	return path.back().getTuioTime()==ttime;
+}
+
+const TuioPoint& TuioContainer::getPreviousPathPoint(const TuioTime &ttime) const {
+	if (isRepeatedUpdate(ttime) && path_length>1) return *(++path.rbegin());
+	return path.back();
 }
 
 void TuioContainer::setTuioSource(int src_id, const char *src_name, const char *src_addr) {
@@ -87,7 +141,16 @@ int TuioContainer::getTuioSourceID() const{
 }
 
 void TuioContainer::update (TuioTime ttime, float xp, float yp) {
-	TuioPoint lastPoint = path.back();
+	bool repeated = isRepeatedUpdate(ttime);
+	if (repeated && path_length<2) {
+		// there is no previous position to derive a speed from yet
+		TuioPoint::update(ttime,xp, yp);
+		path.back() = TuioPoint(currentTime,xpos,ypos);
+		return;
+	}
+	
+	TuioPoint lastPoint = getPreviousPathPoint(ttime);
+	if (!repeated) last_motion_speed = motion_speed;
 	TuioPoint::update(ttime,xp, yp);
 	
 	TuioTime diffTime = currentTime - lastPoint.getTuioTime();
@@ -95,7 +158,6 @@ void TuioContainer::update (TuioTime ttime, float xp, float yp) {
 	float dx = xpos - lastPoint.getX();
 	float dy = ypos - lastPoint.getY();
 	float dist = sqrt(dx*dx+dy*dy);
-	float last_motion_speed = motion_speed;
 	
 	x_speed = dx/dt;
 	y_speed = dy/dt;
@@ -103,7 +165,8 @@ void TuioContainer::update (TuioTime ttime, float xp, float yp) {
 	motion_accel = (motion_speed - last_motion_speed)/dt;
 	
 	TuioPoint p(currentTime,xpos,ypos);
-	path.push_back(p);
+	if (repeated) path.back() = p;
+	else addPathPoint(p);
 	
 	if (motion_accel>0) state = TUIO_ACCELERATING;
 	else if (motion_accel<0) state = TUIO_DECELERATING;
@@ -122,7 +185,7 @@ void TuioContainer::update (TuioTime ttime, float xp, float yp, float xs, float
 	motion_accel = ma;
 	
 	TuioPoint p(currentTime,xpos,ypos);
-	path.push_back(p);
+	addPathPoint(p);
 	
 	if (motion_accel>0) state = TUIO_ACCELERATING;
 	else if (motion_accel<0) state = TUIO_DECELERATING;
@@ -136,9 +199,7 @@ void TuioContainer::update (float xp, float yp, float xs, float ys, float ma) {
 	motion_speed = (float)sqrt(x_speed*x_speed+y_speed*y_speed);
 	motion_accel = ma;
 	
-	path.pop_back();
-	TuioPoint p(currentTime,xpos,ypos);
-	path.push_back(p);
+	path.back() = TuioPoint(currentTime,xpos,ypos);
 	
 	if (motion_accel>0) state = TUIO_ACCELERATING;
 	else if (motion_accel<0) state = TUIO_DECELERATING;
@@ -153,7 +214,7 @@ void TuioContainer::update (TuioContainer *tcon) {
 	motion_accel = tcon->getMotionAccel();
 	
 	TuioPoint p(tcon->getTuioTime(),xpos,ypos);
-	path.push_back(p);
+	addPathPoint(p);
 	
 	if (motion_accel>0) state = TUIO_ACCELERATING;
 	else if (motion_accel<0) state = TUIO_DECELERATING;
@@ -34,6 +34,12 @@
 #define TUIO_STOPPED 5
 #define TUIO_REMOVED 6
 
+/**
+ * The maximum number of positions kept in the path of a TUIO component.
+ * The oldest position is recycled for the newest one beyond that.
+ */
+#define TUIO_MAX_PATH_LENGTH 128
+
 namespace TUIO {
 	
 	/**
@@ -66,9 +72,18 @@ namespace TUIO {
 		 */ 
 		float motion_accel;
 		/**
-		 * A List of TuioPoints containing all the previous positions of the TUIO component.
+		 * The motion speed value before the last update at a new time.
+		 */ 
+		float last_motion_speed;
+		/**
+		 * A List of TuioPoints containing the previous positions of the TUIO component,
+		 * limited to the last TUIO_MAX_PATH_LENGTH positions.
 		 */ 
 		std::list<TuioPoint> path;
+		/**
+		 * The number of positions in the path, which std::list does not count for us.
+		 */ 
+		int path_length;
 		/**
 		 * Reflects the current state of the TuioComponent
 		 */ 
@@ -123,6 +138,17 @@ namespace TUIO {
 		 */
 		virtual ~TuioContainer(){};
 
+		/**
+		 * Reinitializes a released TuioContainer with the provided TuioTime, Session ID, X and Y coordinate
+		 * as if it had been newly created, so that a pool of released containers can be reused.
+		 *
+		 * @param	ttime	the TuioTime to assign
+		 * @param	si	the Session ID to assign
+		 * @param	xp	the X coordinate to assign
+		 * @param	yp	the Y coordinate to assign
+		 */
+		virtual void init(TuioTime ttime, long si, float xp, float yp);
+
 		/**
 		 * Sets the ID, name and address of the TUIO source 
 		 *
@@ -151,6 +177,7 @@ namespace TUIO {
 		 * Takes a TuioTime argument and assigns it along with the provided 
 		 * X and Y coordinate to the private TuioContainer attributes.
 		 * The speed and accleration values are calculated accordingly.
+		 * A repeated update at the same TuioTime replaces the previous one.
 		 *
 		 * @param	ttime	the TuioTime to assign
 		 * @param	xp	the X coordinate to assign
@@ -266,6 +293,46 @@ namespace TUIO {
 		 * @return	true of this TuioContainer is moving
 		 */
 		virtual bool isMoving() const;
+		
+	protected:
+		/**
+		 * Appends the provided position to the path, reusing the oldest one when the path is full.
+		 *
+		 * @param	p	the position to append
+		 */
+		void addPathPoint(const TuioPoint &p);
+		
+		/**
+		 * Returns true if an update at the provided TuioTime replaces the last path position
+		 * instead of appending a new one, because it happens at the same time.
+		 *
+		 * @param	ttime	the TuioTime of the update
+		 */
+		bool isRepeatedUpdate(const TuioTime &ttime) const;
+		
+		/**
+		 * Returns the path position the speed of an update at the provided TuioTime is calculated from,
+		 * which is the one before the last position for a repeated update.
+		 *
+		 * @param	ttime	the TuioTime of the update
+		 */
+		const TuioPoint& getPreviousPathPoint(const TuioTime &ttime) const;
+		
+	private:
+		friend class TuioManager;
+		
+		/**
+		 * True while the TuioContainer is in the active list of a TuioManager.
+		 */ 
+		bool listed;
+		/**
+		 * True while the TuioContainer is in the component list of the current TuioManager frame.
+		 */ 
+		bool in_frame;
+		/**
+		 * The position of the TuioContainer in the component list of the current TuioManager frame.
+		 */ 
+		int frame_index;
 	};
 }
 #endif
@@ -36,6 +36,11 @@ TuioCursor::TuioCursor (TuioCursor *tcur):TuioContainer(tcur) {
 	cursor_id = tcur->getCursorID();
 }
 
+void TuioCursor::init(TuioTime ttime, long si, int ci, float xp, float yp) {
+	TuioContainer::init(ttime,si,xp,yp);
+	cursor_id = ci;
+}
+
 
 int TuioCursor::getCursorID() const{
 	return cursor_id;
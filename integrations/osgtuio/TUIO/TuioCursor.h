@@ -79,11 +79,31 @@ namespace TUIO {
 		 */
 		~TuioCursor(){};
 		
+		/**
+		 * Reinitializes a released TuioCursor with the provided TuioTime, Session ID, Cursor ID,
+		 * X and Y coordinate as if it had been newly created.
+		 *
+		 * @param	ttime	the TuioTime to assign
+		 * @param	si	the Session ID to assign
+		 * @param	ci	the Cursor ID to assign
+		 * @param	xp	the X coordinate to assign
+		 * @param	yp	the Y coordinate to assign
+		 */
+		void init(TuioTime ttime, long si, int ci, float xp, float yp);
+		
 		/**
 		 * Returns the Cursor ID of this TuioCursor.
 		 * @return	the Cursor ID of this TuioCursor
 		 */
 		int getCursorID() const;
+		
+	private:
+		friend class TuioManager;
+		
+		/**
+		 * The position of the TuioCursor in the active list of a TuioManager, valid while it is listed.
+		 */ 
+		std::list<TuioCursor*>::iterator list_entry;
 	};
 }
 #endif
@@ -204,5 +204,32 @@ std::list<TuioBlob> TuioDispatcher::copyTuioBlobs() {
 	return listBuffer;
 }
 
+void TuioDispatcher::getTuioObjects(std::vector<TuioEntity> &buffer) {
+	buffer.clear();
+	lockObjectList();
+	for (std::list<TuioObject*>::iterator iter=objectList.begin(); iter != objectList.end(); iter++) {
+		buffer.push_back(TuioEntity());
+		buffer.back().set(*iter);
+	}
+	unlockObjectList();
+}
 
+void TuioDispatcher::getTuioCursors(std::vector<TuioEntity> &buffer) {
+	buffer.clear();
+	lockCursorList();
+	for (std::list<TuioCursor*>::iterator iter=cursorList.begin(); iter != cursorList.end(); iter++) {
+		buffer.push_back(TuioEntity());
+		buffer.back().set(*iter);
+	}
+	unlockCursorList();
+}
 
+void TuioDispatcher::getTuioBlobs(std::vector<TuioEntity> &buffer) {
+	buffer.clear();
+	lockBlobList();
+	for (std::list<TuioBlob*>::iterator iter=blobList.begin(); iter != blobList.end(); iter++) {
+		buffer.push_back(TuioEntity());
+		buffer.back().set(*iter);
+	}
+	unlockBlobList();
+}
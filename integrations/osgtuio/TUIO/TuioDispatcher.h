@@ -23,6 +23,8 @@
 #define INCLUDED_TUIODISPATCHER_H
 
 #include "TuioListener.h"
+#include "TuioEventQueue.h"
+#include <vector>
 
 #ifndef WIN32
 #include <pthread.h>
@@ -85,6 +87,14 @@ namespace TUIO {
 		 * @return  a List with a copy of all currently active TuioObjects
 		 */
 		std::list<TuioObject> copyTuioObjects();
+
+		/**
+		 * Copies the attributes of all currently active TuioObjects into the provided buffer.
+		 * The buffer is cleared first and keeps its capacity, so that repeated calls do not allocate.
+		 *
+		 * @param  buffer  receives a TuioEntity for each active TuioObject
+		 */
+		void getTuioObjects(std::vector<TuioEntity> &buffer);
 		
 		/**
 		 * Returns a List of all currently active TuioCursors
@@ -99,6 +109,14 @@ namespace TUIO {
 		 * @return  a List with a copy of all currently active TuioCursors
 		 */
 		std::list<TuioCursor> copyTuioCursors();
+
+		/**
+		 * Copies the attributes of all currently active TuioCursors into the provided buffer.
+		 * The buffer is cleared first and keeps its capacity, so that repeated calls do not allocate.
+		 *
+		 * @param  buffer  receives a TuioEntity for each active TuioCursor
+		 */
+		void getTuioCursors(std::vector<TuioEntity> &buffer);
 		
 		/**
 		 * Returns a List of all currently active TuioBlobs
@@ -113,6 +131,14 @@ namespace TUIO {
 		 * @return  a List with a copy of all currently active TuioBlobs
 		 */
 		std::list<TuioBlob> copyTuioBlobs();
+
+		/**
+		 * Copies the attributes of all currently active TuioBlobs into the provided buffer.
+		 * The buffer is cleared first and keeps its capacity, so that repeated calls do not allocate.
+		 *
+		 * @param  buffer  receives a TuioEntity for each active TuioBlob
+		 */
+		void getTuioBlobs(std::vector<TuioEntity> &buffer);
 		
 		/**
 		 * Returns the TuioObject corresponding to the provided Session ID
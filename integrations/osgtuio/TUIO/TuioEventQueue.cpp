@@ -0,0 +1,174 @@
+/*
+ TUIO C++ Library - part of the reacTIVision project
+ http://reactivision.sourceforge.net/
+ */
+
+#include "TuioEventQueue.h"
+
+#ifndef WIN32
+#define TUIO_MEMORY_BARRIER() __sync_synchronize()
+#else
+#define TUIO_MEMORY_BARRIER() MemoryBarrier()
+#endif
+
+using namespace TUIO;
+
+void TuioEntity::set(TuioObject *tobj) {
+	session_id = tobj->getSessionID();
+	id = tobj->getSymbolID();
+	source_id = tobj->getTuioSourceID();
+	state = tobj->getTuioState();
+	x = tobj->getX();
+	y = tobj->getY();
+	angle = tobj->getAngle();
+	width = height = area = 0.0f;
+	x_speed = tobj->getXSpeed();
+	y_speed = tobj->getYSpeed();
+	rotation_speed = tobj->getRotationSpeed();
+	motion_accel = tobj->getMotionAccel();
+	rotation_accel = tobj->getRotationAccel();
+	time = tobj->getTuioTime();
+}
+
+void TuioEntity::set(TuioCursor *tcur) {
+	session_id = tcur->getSessionID();
+	id = tcur->getCursorID();
+	source_id = tcur->getTuioSourceID();
+	state = tcur->getTuioState();
+	x = tcur->getX();
+	y = tcur->getY();
+	angle = width = height = area = 0.0f;
+	x_speed = tcur->getXSpeed();
+	y_speed = tcur->getYSpeed();
+	rotation_speed = 0.0f;
+	motion_accel = tcur->getMotionAccel();
+	rotation_accel = 0.0f;
+	time = tcur->getTuioTime();
+}
+
+void TuioEntity::set(TuioBlob *tblb) {
+	session_id = tblb->getSessionID();
+	id = tblb->getBlobID();
+	source_id = tblb->getTuioSourceID();
+	state = tblb->getTuioState();
+	x = tblb->getX();
+	y = tblb->getY();
+	angle = tblb->getAngle();
+	width = tblb->getWidth();
+	height = tblb->getHeight();
+	area = tblb->getArea();
+	x_speed = tblb->getXSpeed();
+	y_speed = tblb->getYSpeed();
+	rotation_speed = tblb->getRotationSpeed();
+	motion_accel = tblb->getMotionAccel();
+	rotation_accel = tblb->getRotationAccel();
+	time = tblb->getTuioTime();
+}
+
+TuioEventQueue::TuioEventQueue(unsigned int capacity)
+: head		(0)
+, dropped	(0)
+, tail		(0)
+{
+	unsigned int size = 1;
+	while (size<capacity) size <<= 1;
+	events = new TuioEvent[size];
+	mask = size-1;
+}
+
+TuioEventQueue::~TuioEventQueue() {
+	delete[] events;
+}
+
+TuioEvent* TuioEventQueue::push(TuioEvent::Type type) {
+	unsigned int h = head;
+	unsigned int t = tail;
+	// the slot must not be overwritten before the consumer has read it
+	TUIO_MEMORY_BARRIER();
+
+	if (h-t>mask) {
+		dropped = dropped+1;
+		return NULL;
+	}
+
+	TuioEvent *event = &events[h & mask];
+	event->type = type;
+	return event;
+}
+
+void TuioEventQueue::commit() {
+	// publish the event only after it has been completely written
+	TUIO_MEMORY_BARRIER();
+	head = head+1;
+}
+
+bool TuioEventQueue::pop(TuioEvent &event) {
+	unsigned int t = tail;
+	if (t==head) return false;
+	TUIO_MEMORY_BARRIER();
+
+	event = events[t & mask];
+
+	// release the slot only after it has been completely read
+	TUIO_MEMORY_BARRIER();
+	tail = t+1;
+	return true;
+}
+
+unsigned int TuioEventQueue::getDroppedEvents() const {
+	return dropped;
+}
+
+void TuioEventQueue::addTuioObject(TuioObject *tobj) {
+	TuioEvent *event = push(TuioEvent::ADD_OBJECT);
+	if (event) { event->entity.set(tobj); commit(); }
+}
+
+void TuioEventQueue::updateTuioObject(TuioObject *tobj) {
+	TuioEvent *event = push(TuioEvent::UPDATE_OBJECT);
+	if (event) { event->entity.set(tobj); commit(); }
+}
+
+void TuioEventQueue::removeTuioObject(TuioObject *tobj) {
+	TuioEvent *event = push(TuioEvent::REMOVE_OBJECT);
+	if (event) { event->entity.set(tobj); commit(); }
+}
+
+void TuioEventQueue::addTuioCursor(TuioCursor *tcur) {
+	TuioEvent *event = push(TuioEvent::ADD_CURSOR);
+	if (event) { event->entity.set(tcur); commit(); }
+}
+
+void TuioEventQueue::updateTuioCursor(TuioCursor *tcur) {
+	TuioEvent *event = push(TuioEvent::UPDATE_CURSOR);
+	if (event) { event->entity.set(tcur); commit(); }
+}
+
+void TuioEventQueue::removeTuioCursor(TuioCursor *tcur) {
+	TuioEvent *event = push(TuioEvent::REMOVE_CURSOR);
+	if (event) { event->entity.set(tcur); commit(); }
+}
+
+void TuioEventQueue::addTuioBlob(TuioBlob *tblb) {
+	TuioEvent *event = push(TuioEvent::ADD_BLOB);
+	if (event) { event->entity.set(tblb); commit(); }
+}
+
+void TuioEventQueue::updateTuioBlob(TuioBlob *tblb) {
+	TuioEvent *event = push(TuioEvent::UPDATE_BLOB);
+	if (event) { event->entity.set(tblb); commit(); }
+}
+
+void TuioEventQueue::removeTuioBlob(TuioBlob *tblb) {
+	TuioEvent *event = push(TuioEvent::REMOVE_BLOB);
+	if (event) { event->entity.set(tblb); commit(); }
+}
+
+void TuioEventQueue::refresh(TuioTime ftime) {
+	TuioEvent *event = push(TuioEvent::REFRESH);
+	if (event) {
+		event->entity.session_id = -1;
+		event->entity.time = ftime;
+		commit();
+	}
+}
@@ -0,0 +1,134 @@
+/*
+ TUIO C++ Library - part of the reacTIVision project
+ http://reactivision.sourceforge.net/
+ */
+
+#ifndef INCLUDED_TUIOEVENTQUEUE_H
+#define INCLUDED_TUIOEVENTQUEUE_H
+
+#include "TuioListener.h"
+
+namespace TUIO {
+
+	/**
+	 * <p>The TuioEntity is a plain copy of the current attributes of a TuioObject, TuioCursor or TuioBlob.
+	 * Unlike the TUIO components themselves it owns no memory, so it can be copied into preallocated
+	 * buffers and read by another thread while the TuioClient keeps on updating its components.</p>
+	 * <p>The id is the Symbol ID of objects, the Cursor ID of cursors and the Blob ID of blobs.
+	 * Attributes a component does not have are zero.</p>
+	 */
+	struct LIBDECL TuioEntity {
+		long session_id;
+		int id;
+		int source_id;
+		int state;
+		float x, y, angle;
+		float width, height, area;
+		float x_speed, y_speed, rotation_speed;
+		float motion_accel, rotation_accel;
+		TuioTime time;
+
+		void set(TuioObject *tobj);
+		void set(TuioCursor *tcur);
+		void set(TuioBlob *tblb);
+	};
+
+	/**
+	 * <p>The TuioEvent is one TUIO listener callback recorded by the TuioEventQueue.</p>
+	 */
+	struct LIBDECL TuioEvent {
+		enum Type {
+			ADD_OBJECT, UPDATE_OBJECT, REMOVE_OBJECT,
+			ADD_CURSOR, UPDATE_CURSOR, REMOVE_CURSOR,
+			ADD_BLOB, UPDATE_BLOB, REMOVE_BLOB,
+			REFRESH
+		};
+
+		Type type;
+		TuioEntity entity;
+	};
+
+	/**
+	 * <p>The TuioEventQueue is a {@link TuioListener} which records all TUIO events into a fixed size ring buffer,
+	 * so that another thread, such as the render thread of an application, can poll them without any locks.
+	 * The ring is lock-free for exactly one producer, the thread receiving the TUIO messages, and one consumer.</p>
+	 * <p><code>
+	 * TuioEventQueue *queue = new TuioEventQueue();<br/>
+	 * client->addTuioListener(queue);<br/>
+	 * client->connect();<br/>
+	 * ...<br/>
+	 * TuioEvent event;<br/>
+	 * while (queue->pop(event)) { ... }<br/>
+	 * </code></p>
+	 * <p>Events are never allocated. If the consumer falls behind and the ring is full, new events are dropped
+	 * and counted instead. A consumer noticing a changed drop count should resynchronize from
+	 * a snapshot of the TuioClient, e.g. {@link TuioDispatcher#getTuioCursors(std::vector<TuioEntity>&)}.</p>
+	 */
+	class LIBDECL TuioEventQueue : public TuioListener {
+
+	public:
+		/**
+		 * This constructor creates a TuioEventQueue holding at least the provided number of events
+		 *
+		 * @param  capacity  the minimum number of events, rounded up to a power of two
+		 */
+		TuioEventQueue(unsigned int capacity=4096);
+
+		/**
+		 * The destructor frees the ring buffer
+		 */
+		~TuioEventQueue();
+
+		void addTuioObject(TuioObject *tobj);
+		void updateTuioObject(TuioObject *tobj);
+		void removeTuioObject(TuioObject *tobj);
+
+		void addTuioCursor(TuioCursor *tcur);
+		void updateTuioCursor(TuioCursor *tcur);
+		void removeTuioCursor(TuioCursor *tcur);
+
+		void addTuioBlob(TuioBlob *tblb);
+		void updateTuioBlob(TuioBlob *tblb);
+		void removeTuioBlob(TuioBlob *tblb);
+
+		void refresh(TuioTime ftime);
+
+		/**
+		 * Removes the oldest event from the queue. Must only be called by the consumer thread.
+		 *
+		 * @param  event  receives the oldest event
+		 * @return  false if the queue is empty
+		 */
+		bool pop(TuioEvent &event);
+
+		/**
+		 * Returns the number of events dropped so far because the queue was full
+		 *
+		 * @return  the number of dropped events
+		 */
+		unsigned int getDroppedEvents() const;
+
+		/**
+		 * Returns the number of events the queue can hold
+		 *
+		 * @return  the capacity of the queue
+		 */
+		unsigned int getCapacity() const { return mask+1; };
+
+	private:
+		TuioEvent* push(TuioEvent::Type type);
+		void commit();
+
+		TuioEvent *events;
+		unsigned int mask;
+
+		// Written by the producer only, padded to keep it apart from the consumer index
+		volatile unsigned int head;
+		volatile unsigned int dropped;
+		char padding[64];
+
+		// Written by the consumer only
+		volatile unsigned int tail;
+	};
+}
+#endif /* INCLUDED_TUIOEVENTQUEUE_H */
@@ -33,6 +33,9 @@ TuioManager::TuioManager()
 	, updateCursor(false)
 	, updateBlob(false)
 	, verbose(false)
+	, aliveObjectsChanged(false)
+	, aliveCursorsChanged(false)
+	, aliveBlobsChanged(false)
 	, invert_x(false)
 	, invert_y(false)
 	, invert_a(false)
@@ -47,7 +50,7 @@ TuioManager::~TuioManager() {
 TuioObject* TuioManager::addTuioObject(int f_id, float x, float y, float a) {
 	sessionID++;
 	TuioObject *tobj = new TuioObject(currentFrameTime, sessionID, f_id, x, y, a);
-	objectList.push_back(tobj);
+	insertTuioObject(tobj);
 	updateObject = true;
 
 	for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
@@ -61,7 +64,7 @@ TuioObject* TuioManager::addTuioObject(int f_id, float x, float y, float a) {
 
 void TuioManager::addExternalTuioObject(TuioObject *tobj) {
 	if (tobj==NULL) return;
-	objectList.push_back(tobj);
+	insertTuioObject(tobj);
 	updateObject = true;
 
 	for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
@@ -73,7 +76,7 @@ void TuioManager::addExternalTuioObject(TuioObject *tobj) {
 
 void TuioManager::updateTuioObject(TuioObject *tobj, float x, float y, float a) {
 	if (tobj==NULL) return;
-	if (tobj->getTuioTime()==currentFrameTime) return;
+	listInFrame(tobj,frameObjects);
 	tobj->update(currentFrameTime,x,y,a);
 	updateObject = true;
 
@@ -89,6 +92,7 @@ void TuioManager::updateTuioObject(TuioObject *tobj, float x, float y, float a)
 
 void TuioManager::updateExternalTuioObject(TuioObject *tobj) {
 	if (tobj==NULL) return;
+	if (tobj->getTuioTime()==currentFrameTime) listInFrame(tobj,frameObjects);
 	updateObject = true;
 
 	if (tobj->isMoving()) {
@@ -103,7 +107,7 @@ void TuioManager::updateExternalTuioObject(TuioObject *tobj) {
 
 void TuioManager::removeTuioObject(TuioObject *tobj) {
 	if (tobj==NULL) return;
-	objectList.remove(tobj);
+	eraseTuioObject(tobj);
 	delete tobj;
 	updateObject = true;
 
@@ -116,7 +120,7 @@ void TuioManager::removeTuioObject(TuioObject *tobj) {
 
 void TuioManager::removeExternalTuioObject(TuioObject *tobj) {
 	if (tobj==NULL) return;
-	objectList.remove(tobj);
+	eraseTuioObject(tobj);
 	updateObject = true;
 
 	for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
@@ -144,7 +148,7 @@ TuioCursor* TuioManager::addTuioCursor(float x, float y) {
 	} else maxCursorID = cursorID;	
 	
 	TuioCursor *tcur = new TuioCursor(currentFrameTime, sessionID, cursorID, x, y);
-	cursorList.push_back(tcur);
+	insertTuioCursor(tcur);
 	updateCursor = true;
 
 	for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
@@ -158,7 +162,7 @@ TuioCursor* TuioManager::addTuioCursor(float x, float y) {
 
 void TuioManager::addExternalTuioCursor(TuioCursor *tcur) {
 	if (tcur==NULL) return;
-	cursorList.push_back(tcur);
+	insertTuioCursor(tcur);
 	updateCursor = true;
 
 	for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
@@ -170,7 +174,7 @@ void TuioManager::addExternalTuioCursor(TuioCursor *tcur) {
 
 void TuioManager::updateTuioCursor(TuioCursor *tcur,float x, float y) {
 	if (tcur==NULL) return;
-	if (tcur->getTuioTime()==currentFrameTime) return;
+	listInFrame(tcur,frameCursors);
 	tcur->update(currentFrameTime,x,y);
 	updateCursor = true;
 
@@ -186,6 +190,7 @@ void TuioManager::updateTuioCursor(TuioCursor *tcur,float x, float y) {
 
 void TuioManager::updateExternalTuioCursor(TuioCursor *tcur) {
 	if (tcur==NULL) return;
+	if (tcur->getTuioTime()==currentFrameTime) listInFrame(tcur,frameCursors);
 	updateCursor = true;
 	
 	if (tcur->isMoving()) {	
@@ -201,7 +206,7 @@ void TuioManager::updateExternalTuioCursor(TuioCursor *tcur) {
 void TuioManager::removeTuioCursor(TuioCursor *tcur) {
 	if (tcur==NULL) return;
 
-	cursorList.remove(tcur);
+	eraseTuioCursor(tcur);
 	tcur->remove(currentFrameTime);
 	updateCursor = true;
 
@@ -245,7 +250,7 @@ void TuioManager::removeTuioCursor(TuioCursor *tcur) {
 
 void TuioManager::removeExternalTuioCursor(TuioCursor *tcur) {
 	if (tcur==NULL) return;
-	cursorList.remove(tcur);
+	eraseTuioCursor(tcur);
 	updateCursor = true;
 
 	for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
@@ -273,7 +278,7 @@ TuioBlob* TuioManager::addTuioBlob(float x, float y, float a, float w, float h,
 	} else maxBlobID = blobID;	
 	
 	TuioBlob *tblb = new TuioBlob(currentFrameTime, sessionID, blobID, x, y, a, w, h, f);
-	blobList.push_back(tblb);
+	insertTuioBlob(tblb);
 	updateBlob = true;
 	
 	for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
@@ -287,7 +292,7 @@ TuioBlob* TuioManager::addTuioBlob(float x, float y, float a, float w, float h,
 
 void TuioManager::addExternalTuioBlob(TuioBlob *tblb) {
 	if (tblb==NULL) return;
-	blobList.push_back(tblb);
+	insertTuioBlob(tblb);
 	updateBlob = true;
 	
 	for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
@@ -299,7 +304,7 @@ void TuioManager::addExternalTuioBlob(TuioBlob *tblb) {
 
 void TuioManager::updateTuioBlob(TuioBlob *tblb,float x, float y, float a, float w, float h, float f) {
 	if (tblb==NULL) return;
-	if (tblb->getTuioTime()==currentFrameTime) return;
+	listInFrame(tblb,frameBlobs);
 	tblb->update(currentFrameTime,x,y,a,w,h,f);
 	updateBlob = true;
 	
@@ -315,6 +320,7 @@ void TuioManager::updateTuioBlob(TuioBlob *tblb,float x, float y, float a, float
 
 void TuioManager::updateExternalTuioBlob(TuioBlob *tblb) {
 	if (tblb==NULL) return;
+	if (tblb->getTuioTime()==currentFrameTime) listInFrame(tblb,frameBlobs);
 	updateBlob = true;
 	
 	if (tblb->isMoving()) {	
@@ -330,7 +336,7 @@ void TuioManager::updateExternalTuioBlob(TuioBlob *tblb) {
 void TuioManager::removeTuioBlob(TuioBlob *tblb) {
 	if (tblb==NULL) return;
 	
-	blobList.remove(tblb);
+	eraseTuioBlob(tblb);
 	tblb->remove(currentFrameTime);
 	updateBlob = true;
 
@@ -375,7 +381,7 @@ void TuioManager::removeTuioBlob(TuioBlob *tblb) {
 
 void TuioManager::removeExternalTuioBlob(TuioBlob *tblb) {
 	if (tblb==NULL) return;
-	blobList.remove(tblb);
+	eraseTuioBlob(tblb);
 	updateBlob = true;
 	
 	for (std::list<TuioListener*>::iterator listener=listenerList.begin(); listener != listenerList.end(); listener++)
@@ -385,6 +391,80 @@ void TuioManager::removeExternalTuioBlob(TuioBlob *tblb) {
 		std::cout << "del blb " << tblb->getBlobID() << " (" <<  tblb->getSessionID() << ")" << std::endl;
 }
 
+template<class T> void TuioManager::listInFrame(T *tcon, std::vector<T*> &frameList) {
+	if (tcon->in_frame) return;
+	tcon->in_frame = true;
+	tcon->frame_index = (int)frameList.size();
+	frameList.push_back(tcon);
+}
+
+template<class T> void TuioManager::unlistFromFrame(T *tcon, std::vector<T*> &frameList) {
+	if (!tcon->in_frame) return;
+	// the order within a frame does not matter, so the last component takes the free position
+	T *last = frameList.back();
+	frameList[tcon->frame_index] = last;
+	last->frame_index = tcon->frame_index;
+	frameList.pop_back();
+	tcon->in_frame = false;
+	tcon->frame_index = -1;
+}
+
+template<class T> void TuioManager::clearFrame(std::vector<T*> &frameList) {
+	for (typename std::vector<T*>::iterator iter = frameList.begin(); iter!=frameList.end(); iter++) {
+		(*iter)->in_frame = false;
+		(*iter)->frame_index = -1;
+	}
+	frameList.clear();
+}
+
+void TuioManager::insertTuioObject(TuioObject *tobj) {
+	tobj->list_entry = objectList.insert(objectList.end(),tobj);
+	tobj->listed = true;
+	listInFrame(tobj,frameObjects);
+	aliveObjectsChanged = true;
+}
+
+void TuioManager::eraseTuioObject(TuioObject *tobj) {
+	if (tobj->listed) {
+		objectList.erase(tobj->list_entry);
+		tobj->listed = false;
+	} else objectList.remove(tobj);
+	unlistFromFrame(tobj,frameObjects);
+	aliveObjectsChanged = true;
+}
+
+void TuioManager::insertTuioCursor(TuioCursor *tcur) {
+	tcur->list_entry = cursorList.insert(cursorList.end(),tcur);
+	tcur->listed = true;
+	listInFrame(tcur,frameCursors);
+	aliveCursorsChanged = true;
+}
+
+void TuioManager::eraseTuioCursor(TuioCursor *tcur) {
+	if (tcur->listed) {
+		cursorList.erase(tcur->list_entry);
+		tcur->listed = false;
+	} else cursorList.remove(tcur);
+	unlistFromFrame(tcur,frameCursors);
+	aliveCursorsChanged = true;
+}
+
+void TuioManager::insertTuioBlob(TuioBlob *tblb) {
+	tblb->list_entry = blobList.insert(blobList.end(),tblb);
+	tblb->listed = true;
+	listInFrame(tblb,frameBlobs);
+	aliveBlobsChanged = true;
+}
+
+void TuioManager::eraseTuioBlob(TuioBlob *tblb) {
+	if (tblb->listed) {
+		blobList.erase(tblb->list_entry);
+		tblb->listed = false;
+	} else blobList.remove(tblb);
+	unlistFromFrame(tblb,frameBlobs);
+	aliveBlobsChanged = true;
+}
+
 long TuioManager::getSessionID() {
 	sessionID++;
 	return sessionID;
@@ -401,6 +481,9 @@ TuioTime TuioManager::getFrameTime() {
 void TuioManager::initFrame(TuioTime ttime) {
 	currentFrameTime = TuioTime(ttime);
 	currentFrame++;
+	clearFrame(frameObjects);
+	clearFrame(frameCursors);
+	clearFrame(frameBlobs);
 }
 
 void TuioManager::commitFrame() {
@@ -468,11 +551,11 @@ std::list<TuioObject*> TuioManager::getUntouchedObjects() {
 
 void TuioManager::stopUntouchedMovingObjects() {
 	
-	std::list<TuioObject*> untouched;
 	for (std::list<TuioObject*>::iterator tuioObject = objectList.begin(); tuioObject!=objectList.end(); tuioObject++) {
 		
 		TuioObject *tobj = (*tuioObject);
 		if ((tobj->getTuioTime()!=currentFrameTime) && (tobj->isMoving())) {
+			listInFrame(tobj,frameObjects);
 			tobj->stop(currentFrameTime);
 			updateObject = true;
 			if (verbose)		
@@ -486,11 +569,8 @@ void TuioManager::removeUntouchedStoppedObjects() {
 	
 	std::list<TuioObject*>::iterator tuioObject = objectList.begin();
 	while (tuioObject!=objectList.end()) {
-		TuioObject *tobj = (*tuioObject);
-		if ((tobj->getTuioTime()!=currentFrameTime) && (!tobj->isMoving())) {
-			removeTuioObject(tobj);
-			tuioObject = objectList.begin();
-		} else tuioObject++;
+		TuioObject *tobj = (*tuioObject++);
+		if ((tobj->getTuioTime()!=currentFrameTime) && (!tobj->isMoving())) removeTuioObject(tobj);
 	}
 }
 
@@ -515,10 +595,10 @@ std::list<TuioCursor*> TuioManager::getUntouchedCursors() {
 
 void TuioManager::stopUntouchedMovingCursors() {
 	
-	std::list<TuioCursor*> untouched;
 	for (std::list<TuioCursor*>::iterator tuioCursor = cursorList.begin(); tuioCursor!=cursorList.end(); tuioCursor++) {
 		TuioCursor *tcur = (*tuioCursor);
 		if ((tcur->getTuioTime()!=currentFrameTime) && (tcur->isMoving())) {
+			listInFrame(tcur,frameCursors);
 			tcur->stop(currentFrameTime);
 			updateCursor = true;
 			if (verbose) 	
@@ -533,11 +613,8 @@ void TuioManager::removeUntouchedStoppedCursors() {
 	if (cursorList.size()==0) return;
 	std::list<TuioCursor*>::iterator tuioCursor = cursorList.begin();
 	while (tuioCursor!=cursorList.end()) {
-		TuioCursor *tcur = (*tuioCursor);
-		if ((tcur->getTuioTime()!=currentFrameTime) && (!tcur->isMoving())) {
-			removeTuioCursor(tcur);
-			tuioCursor = cursorList.begin();
-		} else tuioCursor++;
+		TuioCursor *tcur = (*tuioCursor++);
+		if ((tcur->getTuioTime()!=currentFrameTime) && (!tcur->isMoving())) removeTuioCursor(tcur);
 	}	
 }
 
@@ -562,10 +639,10 @@ std::list<TuioBlob*> TuioManager::getUntouchedBlobs() {
 
 void TuioManager::stopUntouchedMovingBlobs() {
 	
-	std::list<TuioBlob*> untouched;
 	for (std::list<TuioBlob*>::iterator tuioBlob = blobList.begin(); tuioBlob!=blobList.end(); tuioBlob++) {
 		TuioBlob *tblb = (*tuioBlob);
 		if ((tblb->getTuioTime()!=currentFrameTime) && (tblb->isMoving())) {
+			listInFrame(tblb,frameBlobs);
 			tblb->stop(currentFrameTime);
 			updateBlob = true;
 			if (verbose) 	
@@ -579,11 +656,8 @@ void TuioManager::removeUntouchedStoppedBlobs() {
 	
 	std::list<TuioBlob*>::iterator tuioBlob = blobList.begin();
 	while (tuioBlob!=blobList.end()) {
-		TuioBlob *tblb = (*tuioBlob);
-		if ((tblb->getTuioTime()!=currentFrameTime) && (!tblb->isMoving())) {
-			removeTuioBlob(tblb);
-			tuioBlob = blobList.begin();
-		} else tuioBlob++;
+		TuioBlob *tblb = (*tuioBlob++);
+		if ((tblb->getTuioTime()!=currentFrameTime) && (!tblb->isMoving())) removeTuioBlob(tblb);
 	}	
 }
 
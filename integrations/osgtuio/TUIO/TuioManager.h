@@ -26,6 +26,7 @@
 
 #include <iostream>
 #include <list>
+#include <vector>
 #include <algorithm>
 
 #define OBJ_MESSAGE_SIZE 108	// setMessage + fseqMessage size
@@ -91,6 +92,7 @@ namespace TUIO {
 
 		/**
 		 * Updates the referenced TuioObject based on the given arguments.
+		 * Repeated updates within the same frame replace each other, only the last one is sent.
 		 *
 		 * @param	tobj	the TuioObject to update
 		 * @param	xp	the X coordinate to assign
@@ -142,6 +144,7 @@ namespace TUIO {
 
 		/**
 		 * Updates the referenced TuioCursor based on the given arguments.
+		 * Repeated updates within the same frame replace each other, only the last one is sent.
 		 *
 		 * @param	tcur	the TuioObject to update
 		 * @param	xp	the X coordinate to assign
@@ -196,6 +199,7 @@ namespace TUIO {
 		
 		/**
 		 * Updates the referenced TuioBlob based on the given arguments.
+		 * Repeated updates within the same frame replace each other, only the last one is sent.
 		 *
 		 * @param	tblb	the TuioObject to update
 		 * @param	xp	the X coordinate to assign
@@ -383,9 +387,37 @@ namespace TUIO {
 		bool updateBlob;
 		bool verbose;
 
+		/**
+		 * The components added, updated or stopped within the current frame, each listed once.
+		 * Repeated updates of a component within a frame only keep its last state.
+		 */
+		std::vector<TuioObject*> frameObjects;
+		std::vector<TuioCursor*> frameCursors;
+		std::vector<TuioBlob*> frameBlobs;
+
+		/**
+		 * True if components have been added or removed since the last alive message was sent.
+		 */
+		bool aliveObjectsChanged;
+		bool aliveCursorsChanged;
+		bool aliveBlobsChanged;
+
 		bool invert_x;
 		bool invert_y;
 		bool invert_a;
+
+	private:
+		// the components keep their list and frame positions, to list and remove them without searching
+		template<class T> void listInFrame(T *tcon, std::vector<T*> &frameList);
+		template<class T> void unlistFromFrame(T *tcon, std::vector<T*> &frameList);
+		template<class T> void clearFrame(std::vector<T*> &frameList);
+
+		void insertTuioObject(TuioObject *tobj);
+		void eraseTuioObject(TuioObject *tobj);
+		void insertTuioCursor(TuioCursor *tcur);
+		void eraseTuioCursor(TuioCursor *tcur);
+		void insertTuioBlob(TuioBlob *tblb);
+		void eraseTuioBlob(TuioBlob *tblb);
 	};
 }
 #endif /* INCLUDED_TUIOMANAGER_H */
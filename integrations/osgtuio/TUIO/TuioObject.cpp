@@ -28,6 +28,8 @@ TuioObject::TuioObject (TuioTime ttime, long si, int sym, float xp, float yp, fl
 	angle = a;
 	rotation_speed = 0.0f;
 	rotation_accel = 0.0f;
+	last_angle = angle;
+	last_rotation_speed = 0.0f;
 }
 
 TuioObject::TuioObject (long si, int sym, float xp, float yp, float a):TuioContainer(si, xp, yp) {
@@ -35,6 +37,8 @@ TuioObject::TuioObject (long si, int sym, float xp, float yp, float a):TuioConta
 	angle = a;
 	rotation_speed = 0.0f;
 	rotation_accel = 0.0f;
+	last_angle = angle;
+	last_rotation_speed = 0.0f;
 }
 
 TuioObject::TuioObject (TuioObject *tobj):TuioContainer(tobj) {
@@ -42,6 +46,18 @@ TuioObject::TuioObject (TuioObject *tobj):TuioContainer(tobj) {
 	angle = tobj->getAngle();
 	rotation_speed = 0.0f;
 	rotation_accel = 0.0f;
+	last_angle = angle;
+	last_rotation_speed = 0.0f;
+}
+
+void TuioObject::init(TuioTime ttime, long si, int sym, float xp, float yp, float a) {
+	TuioContainer::init(ttime,si,xp,yp);
+	symbol_id = sym;
+	angle = a;
+	rotation_speed = 0.0f;
+	rotation_accel = 0.0f;
+	last_angle = angle;
+	last_rotation_speed = 0.0f;
 }
 
 void TuioObject::update (TuioTime ttime, float xp, float yp, float a, float xs, float ys, float rs, float ma, float ra) {
@@ -62,13 +78,22 @@ void TuioObject::update (float xp, float yp, float a, float xs, float ys, float
 }
 
 void TuioObject::update (TuioTime ttime, float xp, float yp, float a) {
-	TuioPoint lastPoint = path.back();
+	bool repeated = isRepeatedUpdate(ttime);
+	if (repeated && path_length<2) {
+		TuioContainer::update(ttime,xp,yp);
+		angle = a;
+		return;
+	}
+	
+	TuioPoint lastPoint = getPreviousPathPoint(ttime);
+	if (!repeated) {
+		last_angle = angle;
+		last_rotation_speed = rotation_speed;
+	}
 	TuioContainer::update(ttime,xp,yp);
 	
 	TuioTime diffTime = currentTime - lastPoint.getTuioTime();
 	float dt = diffTime.getTotalMilliseconds()/1000.0f;
-	float last_angle = angle;
-	float last_rotation_speed = rotation_speed;
 	angle = a;
 	
 	double da = (angle-last_angle)/(2*M_PI);
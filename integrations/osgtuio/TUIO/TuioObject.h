@@ -51,6 +51,10 @@ namespace TUIO {
 		 * The rotation acceleration value.
 		 */ 
 		float rotation_accel;
+		/**
+		 * The rotation angle and speed values before the last update at a new time.
+		 */ 
+		float last_angle, last_rotation_speed;
 		
 	public:
 		using TuioContainer::update;
@@ -93,6 +97,19 @@ namespace TUIO {
 		 */
 		~TuioObject() {};
 		
+		/**
+		 * Reinitializes a released TuioObject with the provided TuioTime, Session ID, Symbol ID,
+		 * X and Y coordinate and angle as if it had been newly created.
+		 *
+		 * @param	ttime	the TuioTime to assign
+		 * @param	si	the Session ID to assign
+		 * @param	sym	the Symbol ID to assign
+		 * @param	xp	the X coordinate to assign
+		 * @param	yp	the Y coordinate to assign
+		 * @param	a	the angle to assign
+		 */
+		void init(TuioTime ttime, long si, int sym, float xp, float yp, float a);
+		
 		/**
 		 * Takes a TuioTime argument and assigns it along with the provided 
 		 * X and Y coordinate, angle, X and Y velocity, motion acceleration,
@@ -188,6 +205,14 @@ namespace TUIO {
 		 * @return	true of this TuioObject is moving
 		 */
 		bool isMoving() const;
+		
+	private:
+		friend class TuioManager;
+		
+		/**
+		 * The position of the TuioObject in the active list of a TuioManager, valid while it is listed.
+		 */ 
+		std::list<TuioObject*>::iterator list_entry;
 	};
 }
 #endif
@@ -0,0 +1,66 @@
+/*
+ TUIO C++ Library - part of the reacTIVision project
+ http://reactivision.sourceforge.net/
+ */
+
+#ifndef INCLUDED_TUIOPOOL_H
+#define INCLUDED_TUIOPOOL_H
+
+#include <vector>
+
+namespace TUIO {
+
+	/**
+	 * <p>The TuioPool keeps released TUIO components for reuse, so that the TuioClient
+	 * does not allocate a new TuioObject, TuioCursor or TuioBlob for every incoming message.
+	 * Acquired components have to be reinitialized by their init() method.</p>
+	 * <p>The pool is not thread safe. It is only used by the thread receiving the TUIO messages.</p>
+	 */
+	template<class T> class TuioPool {
+
+	public:
+		/**
+		 * This constructor creates an empty TuioPool
+		 */
+		TuioPool() {};
+
+		/**
+		 * The destructor deletes all released components
+		 */
+		~TuioPool() { clear(); };
+
+		/**
+		 * Returns a released component for reuse or NULL if the pool is empty
+		 *
+		 * @return  a released component or NULL
+		 */
+		T* acquire() {
+			if (freeList.empty()) return NULL;
+			T *item = freeList.back();
+			freeList.pop_back();
+			return item;
+		};
+
+		/**
+		 * Keeps the provided component for reuse instead of deleting it
+		 *
+		 * @param  item  the component to release
+		 */
+		void release(T *item) {
+			freeList.push_back(item);
+		};
+
+		/**
+		 * Deletes all released components
+		 */
+		void clear() {
+			for (typename std::vector<T*>::iterator iter=freeList.begin(); iter != freeList.end(); iter++)
+				delete (*iter);
+			freeList.clear();
+		};
+
+	private:
+		std::vector<T*> freeList;
+	};
+}
+#endif /* INCLUDED_TUIOPOOL_H */
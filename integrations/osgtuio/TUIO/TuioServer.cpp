@@ -22,6 +22,10 @@
 #include "TuioServer.h"
 #include "UdpSender.h"
 
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
 using namespace TUIO;
 using namespace osc;
 
@@ -76,6 +80,9 @@ void TuioServer::initialize() {
 	objectUpdateTime = TuioTime(currentFrameTime);
 	cursorUpdateTime = TuioTime(currentFrameTime);
 	blobUpdateTime = TuioTime(currentFrameTime);
+	objectAliveTime = TuioTime(currentFrameTime);
+	cursorAliveTime = TuioTime(currentFrameTime);
+	blobAliveTime = TuioTime(currentFrameTime);
 	
 	if (cursorProfileEnabled) sendEmptyCursorBundle();
 	if (objectProfileEnabled) sendEmptyObjectBundle();
@@ -101,6 +108,7 @@ TuioServer::~TuioServer() {
 	if (cursorProfileEnabled) sendEmptyCursorBundle();
 	if (objectProfileEnabled) sendEmptyObjectBundle();
 	if (blobProfileEnabled) sendEmptyBlobBundle();
+	flushOscPackets();
 	
 	delete []oscBuffer;
 	delete oscPacket;
@@ -140,6 +148,12 @@ void TuioServer::deliverOscPacket(osc::OutboundPacketStream  *packet) {
 		senderList[i]->sendOscPacket(packet);
 }
 
+void TuioServer::flushOscPackets() {
+
+	for (unsigned int i=0;i<senderList.size();i++)
+		senderList[i]->flush();
+}
+
 void TuioServer::setSourceName(const char *src) {
 	
 	if (!source_name) source_name = new char[256];
@@ -183,31 +197,50 @@ void TuioServer::commitFrame() {
 	TuioManager::commitFrame();
 		
 	if(updateObject) {
-		startObjectBundle();
-		for (std::list<TuioObject*>::iterator  tuioObject = objectList.begin(); tuioObject!=objectList.end(); tuioObject++) {
-			
-			// start a new packet if we exceed the packet capacity
-			if ((oscPacket->Capacity()-oscPacket->Size())<OBJ_MESSAGE_SIZE) {
-				sendObjectBundle(currentFrame);
-				startObjectBundle();
+		// the alive message is only sent when the session IDs have changed, repeated as a keepalive
+		bool alive = (full_update) || (aliveObjectsChanged) || ((currentFrameTime - objectAliveTime).getSeconds()>=ALIVE_INTERVAL);
+		startObjectBundle(alive);
+		if (full_update) {
+			for (std::list<TuioObject*>::iterator tuioObject = objectList.begin(); tuioObject!=objectList.end(); tuioObject++) {
+				
+				// start a new packet if we exceed the packet capacity
+				if ((oscPacket->Capacity()-oscPacket->Size())<OBJ_MESSAGE_SIZE) {
+					sendObjectBundle(currentFrame);
+					startObjectBundle(false);
+				}
+				addObjectMessage(*tuioObject);
+			}
+		} else {
+			// only the components touched within this frame, with their last state
+			for (std::vector<TuioObject*>::iterator tuioObject = frameObjects.begin(); tuioObject!=frameObjects.end(); tuioObject++) {
+				
+				// start a new packet if we exceed the packet capacity
+				if ((oscPacket->Capacity()-oscPacket->Size())<OBJ_MESSAGE_SIZE) {
+					sendObjectBundle(currentFrame);
+					startObjectBundle(false);
+				}
+				addObjectMessage(*tuioObject);
 			}
-			TuioObject *tobj = (*tuioObject);
-			if  ((full_update) || (tobj->getTuioTime()==currentFrameTime)) addObjectMessage(tobj);
 		}
 		objectUpdateTime = TuioTime(currentFrameTime);
+		if (alive) {
+			objectAliveTime = TuioTime(currentFrameTime);
+			aliveObjectsChanged = false;
+		}
 		sendObjectBundle(currentFrame);
 	} else if (objectProfileEnabled && periodic_update) {
-		
 		TuioTime timeCheck = currentFrameTime - objectUpdateTime;
 		if(timeCheck.getSeconds()>=update_interval) {
 			objectUpdateTime = TuioTime(currentFrameTime);
-			startObjectBundle();
-			if  (full_update) {
-				for (std::list<TuioObject*>::iterator  tuioObject = objectList.begin(); tuioObject!=objectList.end(); tuioObject++) {
+			objectAliveTime = TuioTime(currentFrameTime);
+			aliveObjectsChanged = false;
+			startObjectBundle(true);
+			if (full_update) {
+				for (std::list<TuioObject*>::iterator tuioObject = objectList.begin(); tuioObject!=objectList.end(); tuioObject++) {
 					// start a new packet if we exceed the packet capacity
 					if ((oscPacket->Capacity()-oscPacket->Size())<OBJ_MESSAGE_SIZE) {
 						sendObjectBundle(currentFrame);
-						startObjectBundle();
+						startObjectBundle(false);
 					}
 					addObjectMessage(*tuioObject);
 				}
@@ -218,30 +251,50 @@ void TuioServer::commitFrame() {
 	updateObject = false;
 
 	if(updateCursor) {
-		startCursorBundle();
-		for (std::list<TuioCursor*>::iterator tuioCursor = cursorList.begin(); tuioCursor!=cursorList.end(); tuioCursor++) {
-			
-			// start a new packet if we exceed the packet capacity
-			if ((oscPacket->Capacity()-oscPacket->Size())<CUR_MESSAGE_SIZE) {
-				sendCursorBundle(currentFrame);
-				startCursorBundle();
+		// the alive message is only sent when the session IDs have changed, repeated as a keepalive
+		bool alive = (full_update) || (aliveCursorsChanged) || ((currentFrameTime - cursorAliveTime).getSeconds()>=ALIVE_INTERVAL);
+		startCursorBundle(alive);
+		if (full_update) {
+			for (std::list<TuioCursor*>::iterator tuioCursor = cursorList.begin(); tuioCursor!=cursorList.end(); tuioCursor++) {
+				
+				// start a new packet if we exceed the packet capacity
+				if ((oscPacket->Capacity()-oscPacket->Size())<CUR_MESSAGE_SIZE) {
+					sendCursorBundle(currentFrame);
+					startCursorBundle(false);
+				}
+				addCursorMessage(*tuioCursor);
+			}
+		} else {
+			// only the components touched within this frame, with their last state
+			for (std::vector<TuioCursor*>::iterator tuioCursor = frameCursors.begin(); tuioCursor!=frameCursors.end(); tuioCursor++) {
+				
+				// start a new packet if we exceed the packet capacity
+				if ((oscPacket->Capacity()-oscPacket->Size())<CUR_MESSAGE_SIZE) {
+					sendCursorBundle(currentFrame);
+					startCursorBundle(false);
+				}
+				addCursorMessage(*tuioCursor);
 			}
-			TuioCursor *tcur = (*tuioCursor);
-			if ((full_update) || (tcur->getTuioTime()==currentFrameTime)) addCursorMessage(tcur);				
 		}
 		cursorUpdateTime = TuioTime(currentFrameTime);
+		if (alive) {
+			cursorAliveTime = TuioTime(currentFrameTime);
+			aliveCursorsChanged = false;
+		}
 		sendCursorBundle(currentFrame);
 	} else if (cursorProfileEnabled && periodic_update) {
 		TuioTime timeCheck = currentFrameTime - cursorUpdateTime;
 		if(timeCheck.getSeconds()>=update_interval) {
 			cursorUpdateTime = TuioTime(currentFrameTime);
-			startCursorBundle();
+			cursorAliveTime = TuioTime(currentFrameTime);
+			aliveCursorsChanged = false;
+			startCursorBundle(true);
 			if (full_update) {
 				for (std::list<TuioCursor*>::iterator tuioCursor = cursorList.begin(); tuioCursor!=cursorList.end(); tuioCursor++) {
 					// start a new packet if we exceed the packet capacity
 					if ((oscPacket->Capacity()-oscPacket->Size())<CUR_MESSAGE_SIZE) {
 						sendCursorBundle(currentFrame);
-						startCursorBundle();
+						startCursorBundle(false);
 					}
 					addCursorMessage(*tuioCursor);
 				}
@@ -250,32 +303,52 @@ void TuioServer::commitFrame() {
 		}
 	}
 	updateCursor = false;
-	
+
 	if(updateBlob) {
-		startBlobBundle();
-		for (std::list<TuioBlob*>::iterator tuioBlob =blobList.begin(); tuioBlob!=blobList.end(); tuioBlob++) {
-			// start a new packet if we exceed the packet capacity
-			if ((oscPacket->Capacity()-oscPacket->Size())<BLB_MESSAGE_SIZE) {
-				sendBlobBundle(currentFrame);
-				startBlobBundle();
+		// the alive message is only sent when the session IDs have changed, repeated as a keepalive
+		bool alive = (full_update) || (aliveBlobsChanged) || ((currentFrameTime - blobAliveTime).getSeconds()>=ALIVE_INTERVAL);
+		startBlobBundle(alive);
+		if (full_update) {
+			for (std::list<TuioBlob*>::iterator tuioBlob = blobList.begin(); tuioBlob!=blobList.end(); tuioBlob++) {
+				
+				// start a new packet if we exceed the packet capacity
+				if ((oscPacket->Capacity()-oscPacket->Size())<BLB_MESSAGE_SIZE) {
+					sendBlobBundle(currentFrame);
+					startBlobBundle(false);
+				}
+				addBlobMessage(*tuioBlob);
+			}
+		} else {
+			// only the components touched within this frame, with their last state
+			for (std::vector<TuioBlob*>::iterator tuioBlob = frameBlobs.begin(); tuioBlob!=frameBlobs.end(); tuioBlob++) {
+				
+				// start a new packet if we exceed the packet capacity
+				if ((oscPacket->Capacity()-oscPacket->Size())<BLB_MESSAGE_SIZE) {
+					sendBlobBundle(currentFrame);
+					startBlobBundle(false);
+				}
+				addBlobMessage(*tuioBlob);
 			}
-			TuioBlob *tblb = (*tuioBlob);
-			if ((full_update) || (tblb->getTuioTime()==currentFrameTime)) addBlobMessage(tblb);		
 		}
 		blobUpdateTime = TuioTime(currentFrameTime);
+		if (alive) {
+			blobAliveTime = TuioTime(currentFrameTime);
+			aliveBlobsChanged = false;
+		}
 		sendBlobBundle(currentFrame);
 	} else if (blobProfileEnabled && periodic_update) {
 		TuioTime timeCheck = currentFrameTime - blobUpdateTime;
 		if(timeCheck.getSeconds()>=update_interval) {
 			blobUpdateTime = TuioTime(currentFrameTime);
-			startBlobBundle();
+			blobAliveTime = TuioTime(currentFrameTime);
+			aliveBlobsChanged = false;
+			startBlobBundle(true);
 			if (full_update) {
-				for (std::list<TuioBlob*>::iterator tuioBlob =blobList.begin(); tuioBlob!=blobList.end(); tuioBlob++) {
-				
+				for (std::list<TuioBlob*>::iterator tuioBlob = blobList.begin(); tuioBlob!=blobList.end(); tuioBlob++) {
 					// start a new packet if we exceed the packet capacity
 					if ((oscPacket->Capacity()-oscPacket->Size())<BLB_MESSAGE_SIZE) {
 						sendBlobBundle(currentFrame);
-						startBlobBundle();
+						startBlobBundle(false);
 					}
 					addBlobMessage(*tuioBlob);
 				}
@@ -284,6 +357,9 @@ void TuioServer::commitFrame() {
 		}
 	}
 	updateBlob = false;
+	
+	// send all bundles of the frame at once
+	flushOscPackets();
 }
 
 void TuioServer::sendEmptyCursorBundle() {
@@ -296,15 +372,17 @@ void TuioServer::sendEmptyCursorBundle() {
 	deliverOscPacket( oscPacket );
 }
 
-void TuioServer::startCursorBundle() {	
+void TuioServer::startCursorBundle(bool alive) {	
 	oscPacket->Clear();	
 	(*oscPacket) << osc::BeginBundleImmediate;
 	if (source_name) (*oscPacket) << osc::BeginMessage( "/tuio/2Dcur") << "source" << source_name << osc::EndMessage;
-	(*oscPacket) << osc::BeginMessage( "/tuio/2Dcur") << "alive";
-	for (std::list<TuioCursor*>::iterator tuioCursor = cursorList.begin(); tuioCursor!=cursorList.end(); tuioCursor++) {
-		(*oscPacket) << (int32)((*tuioCursor)->getSessionID());	
+	if (alive) {
+		(*oscPacket) << osc::BeginMessage( "/tuio/2Dcur") << "alive";
+		for (std::list<TuioCursor*>::iterator tuioCursor = cursorList.begin(); tuioCursor!=cursorList.end(); tuioCursor++) {
+			(*oscPacket) << (int32)((*tuioCursor)->getSessionID());	
+		}
+		(*oscPacket) << osc::EndMessage;
 	}
-	(*oscPacket) << osc::EndMessage;	
 }
 
 void TuioServer::addCursorMessage(TuioCursor *tcur) {
@@ -344,15 +422,17 @@ void TuioServer::sendEmptyObjectBundle() {
 	deliverOscPacket( oscPacket );
 }
 
-void TuioServer::startObjectBundle() {
+void TuioServer::startObjectBundle(bool alive) {
 	oscPacket->Clear();	
 	(*oscPacket) << osc::BeginBundleImmediate;
 	if (source_name) (*oscPacket) << osc::BeginMessage( "/tuio/2Dobj") << "source" << source_name << osc::EndMessage;
-	(*oscPacket) << osc::BeginMessage( "/tuio/2Dobj") << "alive";
-	for (std::list<TuioObject*>::iterator tuioObject = objectList.begin(); tuioObject!=objectList.end(); tuioObject++) {
-		(*oscPacket) << (int32)((*tuioObject)->getSessionID());	
+	if (alive) {
+		(*oscPacket) << osc::BeginMessage( "/tuio/2Dobj") << "alive";
+		for (std::list<TuioObject*>::iterator tuioObject = objectList.begin(); tuioObject!=objectList.end(); tuioObject++) {
+			(*oscPacket) << (int32)((*tuioObject)->getSessionID());	
+		}
+		(*oscPacket) << osc::EndMessage;
 	}
-	(*oscPacket) << osc::EndMessage;
 }
 
 void TuioServer::addObjectMessage(TuioObject *tobj) {
@@ -399,15 +479,17 @@ void TuioServer::sendEmptyBlobBundle() {
 	deliverOscPacket( oscPacket );
 }
 
-void TuioServer::startBlobBundle() {	
+void TuioServer::startBlobBundle(bool alive) {	
 	oscPacket->Clear();	
 	(*oscPacket) << osc::BeginBundleImmediate;
 	if (source_name) (*oscPacket) << osc::BeginMessage( "/tuio/2Dblb") << "source" << source_name << osc::EndMessage;
-	(*oscPacket) << osc::BeginMessage( "/tuio/2Dblb") << "alive";
-	for (std::list<TuioBlob*>::iterator tuioBlob = blobList.begin(); tuioBlob!=blobList.end(); tuioBlob++) {
-		(*oscPacket) << (int32)((*tuioBlob)->getSessionID());	
+	if (alive) {
+		(*oscPacket) << osc::BeginMessage( "/tuio/2Dblb") << "alive";
+		for (std::list<TuioBlob*>::iterator tuioBlob = blobList.begin(); tuioBlob!=blobList.end(); tuioBlob++) {
+			(*oscPacket) << (int32)((*tuioBlob)->getSessionID());	
+		}
+		(*oscPacket) << osc::EndMessage;
 	}
-	(*oscPacket) << osc::EndMessage;	
 }
 
 void TuioServer::addBlobMessage(TuioBlob *tblb) {
@@ -624,6 +706,7 @@ void TuioServer::sendFullMessages() {
 	(*fullPacket) << osc::BeginMessage( "/tuio/2Dblb") << "fseq" << -1 << osc::EndMessage;
 	(*fullPacket) << osc::EndBundle;
 	deliverOscPacket( fullPacket );
+	flushOscPackets();
 }
 
 
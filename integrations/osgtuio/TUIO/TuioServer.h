@@ -32,6 +32,8 @@
 #include <arpa/inet.h>
 #endif
 
+#define ALIVE_INTERVAL 1	// seconds after which an unchanged alive message is repeated
+
 namespace TUIO {
 	/**
 	 * <p>The TuioServer class is the central TUIO protocol encoder component.
@@ -40,6 +42,8 @@ namespace TUIO {
 	 * <p>During runtime the each frame is marked with the initFrame and commitFrame methods, 
 	 * while the currently present TuioObjects are managed by the server with ADD, UPDATE and REMOVE methods in analogy to the TuioClient's TuioListener interface.</p>
 	 *<p>See the SimpleSimulator example project for further hints on how to use the TuioServer class and its various methods.
+	 * <p>Each frame only carries the last state of the components touched within the frame, and the alive message is only
+	 * included when components have been added or removed, when full updates are enabled, or every ALIVE_INTERVAL seconds.</p>
 	 * <p><code>
 	 * OscSender *sender = new UDPSender();</br>
 	 * TuioServer *server = new TuioServer(sender);<br/>
@@ -189,23 +193,24 @@ namespace TUIO {
 
 		std::vector<OscSender*> senderList;
 		void deliverOscPacket(osc::OutboundPacketStream  *packet);
+		void flushOscPackets();
 		
 		osc::OutboundPacketStream  *oscPacket;
 		char *oscBuffer; 
 		osc::OutboundPacketStream  *fullPacket;
 		char *fullBuffer; 
 		
-		void startObjectBundle();
+		void startObjectBundle(bool alive);
 		void addObjectMessage(TuioObject *tobj);
 		void sendObjectBundle(long fseq);
 		void sendEmptyObjectBundle();
 
-		void startCursorBundle();
+		void startCursorBundle(bool alive);
 		void addCursorMessage(TuioCursor *tcur);
 		void sendCursorBundle(long fseq);
 		void sendEmptyCursorBundle();
 
-		void startBlobBundle();
+		void startBlobBundle(bool alive);
 		void addBlobMessage(TuioBlob *tblb);
 		void sendBlobBundle(long fseq);
 		void sendEmptyBlobBundle();
@@ -213,6 +218,7 @@ namespace TUIO {
 		int update_interval;
 		bool full_update, periodic_update;
 		TuioTime objectUpdateTime, cursorUpdateTime, blobUpdateTime ;
+		TuioTime objectAliveTime, cursorAliveTime, blobAliveTime;
 		bool objectProfileEnabled, cursorProfileEnabled, blobProfileEnabled;		
 		char *source_name;
 	};
@@ -84,16 +84,30 @@ void UdpReceiver::disconnect() {
 		locked = false;
 		return;
 	}
-	socket->Break();
 	
 	if (!locked) {
-#ifdef WIN32
-		if( thread ) CloseHandle( thread );
+		// wake up the receiver thread and wait until it has delivered its last message
+		socket->AsynchronousBreak();
+#ifndef WIN32
+		pthread_join(thread, NULL);
+#else
+		if( thread ) {
+			WaitForSingleObject( thread, INFINITE );
+			CloseHandle( thread );
+		}
 #endif
 		thread = 0;
-	} else locked = false;
+	} else {
+		socket->Break();
+		locked = false;
+	}
 
 	connected = false;
 }
 
+bool UdpReceiver::setSocketBufferSize(int size) {
+	if (socket==NULL) return false;
+	return socket->SetReceiveBufferSize(size);
+}
+
 
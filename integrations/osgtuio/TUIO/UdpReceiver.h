@@ -66,6 +66,15 @@ namespace TUIO {
 		 */
 		void disconnect();
 		
+		/**
+		 * Sets the size of the kernel receive buffer of the socket. A larger buffer keeps bursts of TUIO
+		 * packets from being dropped while the receiving thread is busy.
+		 *
+		 * @param  size  the receive buffer size in bytes
+		 * @return true if the size was accepted
+		 */
+		bool setSocketBufferSize(int size);
+		
 	private:
 
 #ifndef WIN32
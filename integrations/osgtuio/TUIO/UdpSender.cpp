@@ -30,6 +30,7 @@ UdpSender::UdpSender() {
 		long unsigned int ip = GetHostByName("localhost");
 		socket = new UdpTransmitSocket(IpEndpointName(ip, 3333));
 		buffer_size = MAX_UDP_SIZE;
+		initBatch();
 		std::cout << "TUIO/UDP messages to " << "127.0.0.1@3333" << std::endl;
 	} catch (std::exception &e) { 
 		std::cout << "could not create UDP socket" << std::endl;
@@ -48,6 +49,7 @@ UdpSender::UdpSender(const char *host, int port) {
 		}
 		long unsigned int ip = GetHostByName(host);
 		socket = new UdpTransmitSocket(IpEndpointName(ip, port));
+		initBatch();
 		std::cout << "TUIO/UDP messages to " << host << "@" << port << std::endl;
 	} catch (std::exception &e) { 
 		std::cout << "could not create UDP socket" << std::endl;
@@ -62,8 +64,10 @@ UdpSender::UdpSender(const char *host, int port, int size) {
 		} else local = false;
 		long unsigned int ip = GetHostByName(host);
 		socket = new UdpTransmitSocket(IpEndpointName(ip, port));
+		buffer_size = size;
 		if (buffer_size>MAX_UDP_SIZE) buffer_size = MAX_UDP_SIZE;
 		else if (buffer_size<MIN_UDP_SIZE) buffer_size = MIN_UDP_SIZE;
+		initBatch();
 		std::cout << "TUIO/UDP messages to " << host << "@" << port << std::endl;
 	} catch (std::exception &e) { 
 		std::cout << "could not create UDP socket" << std::endl;
@@ -72,9 +76,17 @@ UdpSender::UdpSender(const char *host, int port, int size) {
 }
 
 UdpSender::~UdpSender() {
+	flush();
 	delete socket;		
 }
 
+void UdpSender::initBatch() {
+	batch_size = UDP_BATCH_SIZE;
+	batchBuffer.reserve(batch_size*buffer_size);
+	batchSizes.reserve(batch_size);
+	batchPackets.reserve(batch_size);
+}
+
 bool UdpSender::isConnected() { 
 	if (socket==NULL) return false; 
 	return true;
@@ -85,6 +97,40 @@ bool UdpSender::sendOscPacket (osc::OutboundPacketStream *bundle) {
 	if ( bundle->Size() > buffer_size ) return false;
 	if ( bundle->Size() == 0 ) return false;
 
-	socket->Send( bundle->Data(), bundle->Size() );
+	if (batch_size<=1) {
+		socket->Send( bundle->Data(), bundle->Size() );
+		return true;
+	}
+	
+	// the bundle buffer is reused by the caller, so the packet has to be copied
+	batchBuffer.insert( batchBuffer.end(), bundle->Data(), bundle->Data()+bundle->Size() );
+	batchSizes.push_back( bundle->Size() );
+	if (batchSizes.size()>=batch_size) flush();
 	return true;
 }
+
+void UdpSender::flush() {
+	if (socket==NULL || batchSizes.empty()) return;
+	
+	batchPackets.clear();
+	const char *data = &batchBuffer[0];
+	for (unsigned int i=0;i<batchSizes.size();i++) {
+		batchPackets.push_back(data);
+		data += batchSizes[i];
+	}
+	
+	socket->SendMany( &batchPackets[0], &batchSizes[0], batchSizes.size() );
+	batchBuffer.clear();
+	batchSizes.clear();
+}
+
+void UdpSender::setBatchSize(int size) {
+	flush();
+	if (size<1) size = 1;
+	batch_size = size;
+}
+
+bool UdpSender::setSocketBufferSize(int size) {
+	if (socket==NULL) return false;
+	return socket->SetSendBufferSize(size);
+}
@@ -25,14 +25,20 @@
 #include "OscSender.h"
 #include "ip/UdpSocket.h"
 
+#include <vector>
+
 #define IP_MTU_SIZE 1500
 #define MAX_UDP_SIZE 4096
 #define MIN_UDP_SIZE 576
+#define UDP_BATCH_SIZE 32
 
 namespace TUIO {
 	
 	/**
 	 * The UdpSender implements the UDP transport method for OSC
+	 * <p>The packets of a frame are queued and sent together by {@link #flush()}, which the TuioServer calls
+	 * at the end of each frame, or as soon as the batch is full. Applications sending their own packets
+	 * either call flush() as well or disable batching by setting a batch size of 1.</p>
 	 *
 	 * @author Martin Kaltenbrunner
 	 * @version 1.5
@@ -87,8 +93,35 @@ namespace TUIO {
 		 */
 		 bool isConnected ();
 		
+		/**
+		 * This method sends all queued packets, with a single system call where the platform supports it
+		 */
+		void flush ();
+		
+		/**
+		 * This method sets the number of packets which are queued before they are sent
+		 *
+		 * @param  size  the number of packets per batch, 1 sends each packet immediately
+		 */
+		void setBatchSize (int size);
+		
+		/**
+		 * This method sets the size of the kernel send buffer of the socket
+		 *
+		 * @param  size  the send buffer size in bytes
+		 * @return true if the size was accepted
+		 */
+		bool setSocketBufferSize (int size);
+		
 	private:
+		void initBatch ();
+		
 		UdpTransmitSocket *socket;
+		
+		unsigned int batch_size;
+		std::vector<char> batchBuffer;
+		std::vector<int> batchSizes;
+		std::vector<const char*> batchPackets;
 	};
 }
 #endif /* INCLUDED_UDPSENDER_H */
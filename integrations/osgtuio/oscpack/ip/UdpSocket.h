@@ -204,6 +204,26 @@ public:
 
 
 
+	// Send count packets to the connected endpoint, with as few
+
+	// system calls as the platform allows (sendmmsg on Linux)
+
+	void SendMany( const char * const *data, const int *sizes, int count );
+
+
+
+	// Set the size of the kernel socket buffers in bytes. A larger
+
+	// receive buffer keeps bursts of packets from being dropped while
+
+	// the receiving thread is busy. Returns false if the size was refused.
+
+	bool SetReceiveBufferSize( int size );
+
+	bool SetSendBufferSize( int size );
+
+
+
 
 
 	// Bind a local endpoint to receive incoming data. Endpoint
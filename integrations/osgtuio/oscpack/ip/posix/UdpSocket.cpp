@@ -47,6 +47,12 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <netinet/in.h> // for sockaddr_in
+#include <sys/uio.h>
+
+#if defined(__linux__) && defined(MSG_WAITFORONE)
+// recvmmsg and sendmmsg transfer several datagrams per system call
+#define OSC_HAVE_MMSG
+#endif
 
 #include "ip/PacketListener.h"
 #include "ip/TimerListener.h"
@@ -181,6 +187,53 @@ public:
         send( socket_, data, size, 0 );
 	}
 
+	void SendMany( const char * const *data, const int *sizes, int count )
+	{
+		assert( isConnected_ );
+
+#ifdef OSC_HAVE_MMSG
+		const int MAX_BATCH = 64;
+		struct mmsghdr msgs[ MAX_BATCH ];
+		struct iovec iovecs[ MAX_BATCH ];
+
+		while( count > 0 ){
+			int n = (count < MAX_BATCH) ? count : MAX_BATCH;
+			memset( msgs, 0, sizeof(struct mmsghdr) * n );
+			for( int i = 0; i < n; ++i ){
+				iovecs[i].iov_base = (void*)data[i];
+				iovecs[i].iov_len = sizes[i];
+				msgs[i].msg_hdr.msg_iov = &iovecs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			// sendmmsg may send fewer packets than requested, continue after the last one sent
+			int sent = sendmmsg( socket_, msgs, n, 0 );
+			if( sent <= 0 ){
+				if( sent < 0 && errno == EINTR )
+					continue;
+				// drop the packet that failed, like Send() does
+				sent = 1;
+			}
+			data += sent;
+			sizes += sent;
+			count -= sent;
+		}
+#else
+		for( int i = 0; i < count; ++i )
+			send( socket_, data[i], sizes[i], 0 );
+#endif
+	}
+
+	bool SetReceiveBufferSize( int size )
+	{
+		return setsockopt( socket_, SOL_SOCKET, SO_RCVBUF, (char*)&size, sizeof(size) ) == 0;
+	}
+
+	bool SetSendBufferSize( int size )
+	{
+		return setsockopt( socket_, SOL_SOCKET, SO_SNDBUF, (char*)&size, sizeof(size) ) == 0;
+	}
+
     void SendTo( const IpEndpointName& remoteEndpoint, const char *data, int size )
 	{
 		sendToAddr_.sin_addr.s_addr = htonl( remoteEndpoint.address );
@@ -221,6 +274,60 @@ public:
 		return result;
 	}
 
+	// Receive up to count pending packets without blocking. Packet i is
+	// stored at data + i * size. Returns the number of packets received.
+	int ReceiveMany( IpEndpointName *remoteEndpoints, char *data, int size, int *sizes, int count )
+	{
+		assert( isBound_ );
+
+#ifdef OSC_HAVE_MMSG
+		const int MAX_BATCH = 64;
+		struct mmsghdr msgs[ MAX_BATCH ];
+		struct iovec iovecs[ MAX_BATCH ];
+		struct sockaddr_in fromAddrs[ MAX_BATCH ];
+
+		if( count > MAX_BATCH )
+			count = MAX_BATCH;
+		memset( msgs, 0, sizeof(struct mmsghdr) * count );
+		for( int i = 0; i < count; ++i ){
+			iovecs[i].iov_base = data + i * size;
+			iovecs[i].iov_len = size;
+			msgs[i].msg_hdr.msg_iov = &iovecs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = &fromAddrs[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(fromAddrs[i]);
+		}
+
+		int result = recvmmsg( socket_, msgs, count, MSG_DONTWAIT, 0 );
+		if( result < 0 )
+			return 0;
+
+		for( int i = 0; i < result; ++i ){
+			sizes[i] = msgs[i].msg_len;
+			remoteEndpoints[i].address = ntohl(fromAddrs[i].sin_addr.s_addr);
+			remoteEndpoints[i].port = ntohs(fromAddrs[i].sin_port);
+		}
+		return result;
+#else
+		int received = 0;
+		while( received < count ){
+			struct sockaddr_in fromAddr;
+			socklen_t fromAddrLen = sizeof(fromAddr);
+
+			int result = recvfrom(socket_, data + received * size, size, MSG_DONTWAIT,
+						(struct sockaddr *) &fromAddr, (socklen_t*)&fromAddrLen);
+			if( result < 0 )
+				break;
+
+			sizes[received] = result;
+			remoteEndpoints[received].address = ntohl(fromAddr.sin_addr.s_addr);
+			remoteEndpoints[received].port = ntohs(fromAddr.sin_port);
+			++received;
+		}
+		return received;
+#endif
+	}
+
 	int Socket() { return socket_; }
 };
 
@@ -254,6 +361,21 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 	impl_->SendTo( remoteEndpoint, data, size );
 }
 
+void UdpSocket::SendMany( const char * const *data, const int *sizes, int count )
+{
+	impl_->SendMany( data, sizes, count );
+}
+
+bool UdpSocket::SetReceiveBufferSize( int size )
+{
+	return impl_->SetReceiveBufferSize( size );
+}
+
+bool UdpSocket::SetSendBufferSize( int size )
+{
+	return impl_->SetSendBufferSize( size );
+}
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 {
 	impl_->Bind( localEndpoint );
@@ -402,9 +524,13 @@ public:
 			timerQueue_.push_back( std::make_pair( currentTimeMs + i->initialDelayMs, *i ) );
 		std::sort( timerQueue_.begin(), timerQueue_.end(), CompareScheduledTimerCalls );
 
-		const int MAX_BUFFER_SIZE = 4098;
-		char *data = new char[ MAX_BUFFER_SIZE ];
-		IpEndpointName remoteEndpoint;
+		// pending packets are received in batches of up to MAX_BATCH_SIZE, into
+		// slots whose size is a multiple of 4 so that each packet stays aligned
+		const int MAX_BUFFER_SIZE = 4100;
+		const int MAX_BATCH_SIZE = 32;
+		char *data = new char[ MAX_BUFFER_SIZE * MAX_BATCH_SIZE ];
+		int sizes[ MAX_BATCH_SIZE ];
+		IpEndpointName remoteEndpoints[ MAX_BATCH_SIZE ];
 
 		struct timeval timeout;
 
@@ -443,12 +569,19 @@ public:
 
 				if( FD_ISSET( i->second->impl_->Socket(), &tempfds ) ){
 
-					int size = i->second->ReceiveFrom( remoteEndpoint, data, MAX_BUFFER_SIZE );
-					if( size > 0 ){
-						i->first->ProcessPacket( data, size, remoteEndpoint );
-						if( break_ )
-							break;
-					}
+					// drain the socket without blocking before going back to select(),
+					// but bounded so that the timers and other sockets are not starved
+					int count, batches = 0;
+					do{
+						count = i->second->impl_->ReceiveMany( remoteEndpoints, data, MAX_BUFFER_SIZE, sizes, MAX_BATCH_SIZE );
+						for( int j = 0; j < count && !break_; ++j ){
+							if( sizes[j] > 0 )
+								i->first->ProcessPacket( data + j * MAX_BUFFER_SIZE, sizes[j], remoteEndpoints[j] );
+						}
+					}while( count == MAX_BATCH_SIZE && ++batches < 8 && !break_ );
+
+					if( break_ )
+						break;
 				}
 			}
 
@@ -360,6 +360,44 @@ public:
 
 
 
+	void SendMany( const char * const *data, const int *sizes, int count )
+
+	{
+
+		assert( isConnected_ );
+
+
+
+		// winsock has no call sending several datagrams at once
+
+		for( int i = 0; i < count; ++i )
+
+			send( socket_, data[i], sizes[i], 0 );
+
+	}
+
+
+
+	bool SetReceiveBufferSize( int size )
+
+	{
+
+		return setsockopt( socket_, SOL_SOCKET, SO_RCVBUF, (char*)&size, sizeof(size) ) == 0;
+
+	}
+
+
+
+	bool SetSendBufferSize( int size )
+
+	{
+
+		return setsockopt( socket_, SOL_SOCKET, SO_SNDBUF, (char*)&size, sizeof(size) ) == 0;
+
+	}
+
+
+
 	void Bind( const IpEndpointName& localEndpoint )
 
 	{
@@ -490,6 +528,36 @@ void UdpSocket::SendTo( const IpEndpointName& remoteEndpoint, const char *data,
 
 
 
+void UdpSocket::SendMany( const char * const *data, const int *sizes, int count )
+
+{
+
+	impl_->SendMany( data, sizes, count );
+
+}
+
+
+
+bool UdpSocket::SetReceiveBufferSize( int size )
+
+{
+
+	return impl_->SetReceiveBufferSize( size );
+
+}
+
+
+
+bool UdpSocket::SetSendBufferSize( int size )
+
+{
+
+	return impl_->SetSendBufferSize( size );
+
+}
+
+
+
 void UdpSocket::Bind( const IpEndpointName& localEndpoint )
 
 {
@@ -0,0 +1,335 @@
+/*
+	oscpack -- Open Sound Control packet manipulation library
+	http://www.audiomulch.com/~rossb/oscpack
+
+	Bulk decoding of received packets, see OscBulkReader.h
+*/
+#include "OscBulkReader.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "OscHostEndianness.h"
+
+#if defined(OSC_HOST_LITTLE_ENDIAN) && \
+    ( defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) )
+#define OSC_BULK_SSE2
+#include <emmintrin.h>
+#endif
+
+
+namespace osc{
+
+
+// bundles nested deeper than this are rejected, which bounds the recursion
+static const int MAX_BUNDLE_DEPTH = 8;
+
+static const char EMPTY_TYPE_TAGS[] = "";
+
+
+static inline unsigned long RoundUp4( unsigned long x )
+{
+    return (x + 3) & ~0x3UL;
+}
+
+
+static inline uint32 ToUInt32( const char *p )
+{
+    uint32 x;
+    std::memcpy( &x, p, 4 );
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    x = (x >> 24) | ((x >> 8) & 0xFF00) | ((x << 8) & 0xFF0000) | (x << 24);
+#endif
+    return x;
+}
+
+
+// copy count big endian 32 bit words to host order
+static void ReadBlock32( const char *src, void *dst, int count )
+{
+#ifdef OSC_HOST_LITTLE_ENDIAN
+    char *out = (char*)dst;
+    int i = 0;
+
+#ifdef OSC_BULK_SSE2
+    for( ; i + 4 <= count; i += 4 ){
+        __m128i v = _mm_loadu_si128( (const __m128i*)(src + i * 4) );
+
+        // swap the bytes of each 16 bit half, then the halves of each word
+        v = _mm_or_si128( _mm_slli_epi16( v, 8 ), _mm_srli_epi16( v, 8 ) );
+        v = _mm_shufflehi_epi16( _mm_shufflelo_epi16( v, 0xB1 ), 0xB1 );
+        _mm_storeu_si128( (__m128i*)(out + i * 4), v );
+    }
+#endif
+
+    for( ; i < count; ++i ){
+        uint32 x = ToUInt32( src + i * 4 );
+        std::memcpy( out + i * 4, &x, 4 );
+    }
+#else
+    std::memcpy( dst, src, count * 4 );
+#endif
+}
+
+
+uint32 HashAddress( const char *address )
+{
+    // FNV-1a
+    uint32 hash = 2166136261UL;
+    while( *address ){
+        hash ^= (unsigned char)*address++;
+        hash *= 16777619UL;
+    }
+    return hash & 0xFFFFFFFFUL;
+}
+
+
+//------------------------------------------------------------------------------
+
+
+AddressTable::AddressTable()
+{
+    for( int i = 0; i < TABLE_SIZE; ++i ){
+        entries_[i].address = 0;
+        entries_[i].hash = 0;
+        entries_[i].id = -1;
+    }
+}
+
+
+void AddressTable::Add( const char *address, int id )
+{
+    uint32 hash = HashAddress( address );
+    int i = (int)(hash & (TABLE_SIZE - 1));
+    for( int n = 0; n < TABLE_SIZE; ++n ){
+        Entry& e = entries_[i];
+        if( e.address == 0 || (e.hash == hash && std::strcmp( e.address, address ) == 0) ){
+            e.address = address;
+            e.hash = hash;
+            e.id = id;
+            return;
+        }
+        i = (i + 1) & (TABLE_SIZE - 1);
+    }
+    assert( false && "address table full" );
+}
+
+
+int AddressTable::Find( const char *address, uint32 hash ) const
+{
+    int i = (int)(hash & (TABLE_SIZE - 1));
+    for( int n = 0; n < TABLE_SIZE; ++n ){
+        const Entry& e = entries_[i];
+        if( e.address == 0 )
+            return -1;
+        if( e.hash == hash && std::strcmp( e.address, address ) == 0 )
+            return e.id;
+        i = (i + 1) & (TABLE_SIZE - 1);
+    }
+    return -1;
+}
+
+
+//------------------------------------------------------------------------------
+
+
+void BulkPacketReader::Read( const char *data, int32 size, std::vector<BulkMessage>& messages )
+{
+    messages.clear();
+    if( size <= 0 )
+        throw MalformedMessageException( "zero length messages not permitted" );
+
+    try{
+        ReadElement( data, data + size, 0, messages );
+    }catch( Exception& ){
+        messages.clear();
+        throw;
+    }
+}
+
+
+void BulkPacketReader::ReadElement( const char *data, const char *end, int depth,
+        std::vector<BulkMessage>& messages )
+{
+    if( *data != '#' ){
+        ReadMessage( data, end, messages );
+        return;
+    }
+
+    unsigned long size = end - data;
+    if( size < 16 )
+        throw MalformedBundleException( "packet too short for bundle" );
+
+    if( (size & 0x03L) != 0 )
+        throw MalformedBundleException( "bundle size must be multiple of four" );
+
+    if( std::memcmp( data, "#bundle", 8 ) != 0 )
+        throw MalformedBundleException( "bad bundle address pattern" );
+
+    if( depth >= MAX_BUNDLE_DEPTH )
+        throw MalformedBundleException( "bundles nested too deeply" );
+
+    const char *p = data + 16;
+    while( p < end ){
+        if( p + 4 > end )
+            throw MalformedBundleException( "packet too short for elementSize" );
+
+        uint32 elementSize = ToUInt32( p );
+        if( (elementSize & 0x03L) != 0 )
+            throw MalformedBundleException( "bundle element size must be multiple of four" );
+
+        if( elementSize > (unsigned long)(end - p - 4) )
+            throw MalformedBundleException( "packet too short for bundle element" );
+
+        if( elementSize == 0 )
+            throw MalformedMessageException( "zero length messages not permitted" );
+
+        ReadElement( p + 4, p + 4 + elementSize, depth + 1, messages );
+        p += 4 + elementSize;
+    }
+}
+
+
+void BulkPacketReader::ReadMessage( const char *data, const char *end,
+        std::vector<BulkMessage>& messages )
+{
+    unsigned long size = end - data;
+    if( (size & 0x03L) != 0 )
+        throw MalformedMessageException( "message size must be multiple of four" );
+
+    BulkMessage m;
+    m.addressPattern = data;
+    m.end = end;
+
+    // hash the address pattern while looking for its end
+    const char *p = data;
+    uint32 hash = 2166136261UL;
+    if( *p == '\0' ){
+        // special case for SuperCollider integer address pattern
+        p = data + 4;
+    }else{
+        while( p < end && *p ){
+            hash ^= (unsigned char)*p++;
+            hash *= 16777619UL;
+        }
+        if( p == end )
+            throw MalformedMessageException( "unterminated address pattern" );
+        p = data + RoundUp4( p - data + 1 );
+    }
+    m.addressHash = hash & 0xFFFFFFFFUL;
+
+    if( p == end || (p[0] == ',' && p[1] == '\0') ){
+        // no arguments or type tags
+        m.typeTags = EMPTY_TYPE_TAGS;
+        m.arguments = end;
+        messages.push_back( m );
+        return;
+    }
+
+    if( *p != ',' )
+        throw MalformedMessageException( "type tags not present" );
+
+    const char *typeTags = p + 1;
+    p = typeTags;
+    while( p < end && *p )
+        ++p;
+    if( p == end )
+        throw MalformedMessageException( "type tags were not terminated before end of message" );
+
+    const char *argument = data + RoundUp4( p - data + 1 );
+    m.typeTags = typeTags;
+    m.arguments = argument;
+
+    // check that all arguments are present and well formed
+    for( const char *typeTag = typeTags; *typeTag != '\0'; ++typeTag ){
+        unsigned long remaining = end - argument;
+
+        switch( *typeTag ){
+            case TRUE_TYPE_TAG:
+            case FALSE_TYPE_TAG:
+            case NIL_TYPE_TAG:
+            case INFINITUM_TYPE_TAG:
+                // zero length
+                break;
+
+            case INT32_TYPE_TAG:
+            case FLOAT_TYPE_TAG:
+            case CHAR_TYPE_TAG:
+            case RGBA_COLOR_TYPE_TAG:
+            case MIDI_MESSAGE_TYPE_TAG:
+                if( remaining < 4 )
+                    throw MalformedMessageException( "arguments exceed message size" );
+                argument += 4;
+                break;
+
+            case INT64_TYPE_TAG:
+            case TIME_TAG_TYPE_TAG:
+            case DOUBLE_TYPE_TAG:
+                if( remaining < 8 )
+                    throw MalformedMessageException( "arguments exceed message size" );
+                argument += 8;
+                break;
+
+            case STRING_TYPE_TAG:
+            case SYMBOL_TYPE_TAG:
+                {
+                    const char *q = argument;
+                    while( q < end && *q )
+                        ++q;
+                    if( q == end )
+                        throw MalformedMessageException( "unterminated string argument" );
+                    argument = data + RoundUp4( q - data + 1 );
+
+                    // SkipStringArgument() finds the end by the last byte of each
+                    // word, like the received message iterator does
+                    while( ++q < argument )
+                        if( *q )
+                            throw MalformedMessageException( "string argument padding is not zero" );
+                }
+                break;
+
+            case BLOB_TYPE_TAG:
+                {
+                    if( remaining < 4 )
+                        throw MalformedMessageException( "arguments exceed message size" );
+                    uint32 blobSize = ToUInt32( argument );
+                    if( blobSize > remaining - 4 || RoundUp4( blobSize ) > remaining - 4 )
+                        throw MalformedMessageException( "arguments exceed message size" );
+                    argument += 4 + RoundUp4( blobSize );
+                }
+                break;
+
+            default:
+                throw MalformedMessageException( "unknown type tag" );
+        }
+    }
+
+    messages.push_back( m );
+}
+
+
+//------------------------------------------------------------------------------
+
+
+const char* SkipStringArgument( const char *p )
+{
+    p += 3;
+    while( *p )
+        p += 4;
+    return p + 1;
+}
+
+
+void ReadInt32Block( const char *arguments, int32 *values, int count )
+{
+    ReadBlock32( arguments, values, count );
+}
+
+
+void ReadFloatBlock( const char *arguments, float *values, int count )
+{
+    ReadBlock32( arguments, values, count );
+}
+
+
+} // namespace osc
@@ -0,0 +1,90 @@
+/*
+	oscpack -- Open Sound Control packet manipulation library
+	http://www.audiomulch.com/~rossb/oscpack
+
+	Bulk decoding of received packets. The packet is validated once as a
+	whole, after which its messages are read straight from the packet
+	buffer without any further checks or allocations.
+*/
+#ifndef INCLUDED_OSCBULKREADER_H
+#define INCLUDED_OSCBULKREADER_H
+
+#include <vector>
+
+#include "OscTypes.h"
+#include "OscReceivedElements.h"
+
+
+namespace osc{
+
+
+// A message of a validated packet. All pointers refer to the packet buffer,
+// which must stay alive while the message is used.
+struct BulkMessage{
+    const char *addressPattern;
+    uint32 addressHash;     // see HashAddress()
+    const char *typeTags;   // without the initial ',', never 0
+    const char *arguments;
+    const char *end;
+};
+
+
+uint32 HashAddress( const char *address );
+
+
+// Open addressing hash table mapping a fixed set of address patterns, or any
+// other strings, to ids. Lookups compare the precomputed hash first and the
+// string only on a hash match.
+class AddressTable{
+public:
+    AddressTable();
+
+    // the string is not copied and must outlive the table
+    void Add( const char *address, int id );
+
+    // returns -1 for unknown addresses
+    int Find( const char *address ) const { return Find( address, HashAddress( address ) ); }
+    int Find( const char *address, uint32 hash ) const;
+
+private:
+    enum { TABLE_SIZE = 64 };
+
+    struct Entry{
+        const char *address;
+        uint32 hash;
+        int id;
+    };
+
+    Entry entries_[TABLE_SIZE];
+};
+
+
+class BulkPacketReader{
+public:
+    // Validates the whole packet, including nested bundles and all message
+    // arguments, and appends its messages in order to messages, which is
+    // cleared first. Throws MalformedMessageException or
+    // MalformedBundleException without appending anything if the packet is
+    // malformed.
+    void Read( const char *data, int32 size, std::vector<BulkMessage>& messages );
+
+private:
+    void ReadElement( const char *data, const char *end, int depth, std::vector<BulkMessage>& messages );
+    void ReadMessage( const char *data, const char *end, std::vector<BulkMessage>& messages );
+};
+
+
+// Returns the argument following the string or symbol argument at p of a
+// validated message. Validation rejects strings which are not zero padded, so
+// this only has to look at the last byte of each word.
+const char* SkipStringArgument( const char *p );
+
+// Copy count consecutive int32 or float arguments of a validated message,
+// swapping them to host byte order several at a time where SSE2 is available.
+void ReadInt32Block( const char *arguments, int32 *values, int count );
+void ReadFloatBlock( const char *arguments, float *values, int count );
+
+
+} // namespace osc
+
+#endif /* INCLUDED_OSCBULKREADER_H */
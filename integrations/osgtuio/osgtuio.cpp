@@ -1,41 +1,31 @@
 #include <osg/Texture2D>
 #include <osg/Geometry>
 #include <osg/MatrixTransform>
+#include <osg/Timer>
+#include <OpenThreads/Thread>
 #include <osgDB/ReadFile>
 #include <osgGA/StateSetManipulator>
 #include <osgGA/MultiTouchTrackballManipulator>
 #include <osgViewer/ViewerEventHandlers>
 #include <osgViewer/Viewer>
+#include <fstream>
 
 #include "TUIO/TuioClient.h"
-#include "TUIO/TuioListener.h"
-
-class ClientListener : public TUIO::TuioListener
-{
-public:
-    ClientListener() : active(false) {}
-    bool active;
-    
-    virtual void addTuioObject( TUIO::TuioObject* tobj ) { active = true; }
-    virtual void updateTuioObject( TUIO::TuioObject* tobj ) { active = true; }
-    virtual void removeTuioObject( TUIO::TuioObject* tobj ) { active = true; }
-    virtual void addTuioCursor( TUIO::TuioCursor* tcur ) { active = true; }
-    virtual void updateTuioCursor( TUIO::TuioCursor* tcur ) { active = true; }
-    virtual void removeTuioCursor( TUIO::TuioCursor* tcur ) { active = true; }
-    virtual void addTuioBlob( TUIO::TuioBlob* tblb ) { active = true; }
-    virtual void updateTuioBlob( TUIO::TuioBlob* tblb ) { active = true; }
-    virtual void removeTuioBlob( TUIO::TuioBlob* tblb ) { active = true; }
-    virtual void refresh( TUIO::TuioTime ftime ) {}
-};
+#include "TUIO/TuioServer.h"
+#include "TUIO/TuioEventQueue.h"
+#include "TUIO/UdpReceiver.h"
+#include "TUIO/UdpSender.h"
 
 class TUIOClientHandler : public osgGA::GUIEventHandler
 {
 public:
     TUIOClientHandler( int port=3333 )
+    :   _droppedEvents(0)
     {
-        _listener = new ClientListener;
+        // The receiver thread only records events, which are applied in the FRAME event
+        _queue = new TUIO::TuioEventQueue;
         _client = new TUIO::TuioClient( port );
-        _client->addTuioListener( _listener );
+        _client->addTuioListener( _queue );
         _client->connect();
     }
     
@@ -44,50 +34,14 @@ public:
         osgViewer::View* view = dynamic_cast<osgViewer::View*>( &aa );
         if ( !view ) return false;
         
-        osgGA::EventQueue* queue = view->getEventQueue();
         switch ( ea.getEventType() )
         {
         case osgGA::GUIEventAdapter::FRAME:
-            if ( _listener->active )
-            {
-                _listener->active = false;  // FIXME: is that safe enough for multithreading?
-                std::map<unsigned int, osg::Vec2d> lastIDs = _clientIDs;
-                std::list<TUIO::TuioCursor*> cursors = _client->getTuioCursors();
-                
-                osg::ref_ptr<osgGA::GUIEventAdapter> touched;
-                for ( std::list<TUIO::TuioCursor*>::iterator itr=cursors.begin();
-                      itr!=cursors.end(); ++itr )
-                {
-                    TUIO::TuioCursor* c = *itr;
-                    if ( !c ) continue;
-                    
-                    unsigned int id = c->getCursorID();
-                    double x = 0.1 * c->getX() * ea.getWindowWidth() + ea.getWindowX();
-                    double y = 0.1 * c->getY() * ea.getWindowHeight() + ea.getWindowY();
-                    if ( _clientIDs.find(id)!=_clientIDs.end() )
-                    {
-                        if ( !touched ) touched = queue->touchMoved(id, osgGA::GUIEventAdapter::TOUCH_MOVED, x, y);
-                        else touched->addTouchPoint(id, osgGA::GUIEventAdapter::TOUCH_MOVED, x, y);
-                        lastIDs.erase( id );
-                    }
-                    else
-                    {
-                        if ( !touched ) touched = queue->touchBegan(id, osgGA::GUIEventAdapter::TOUCH_BEGAN, x, y);
-                        else touched->addTouchPoint(id, osgGA::GUIEventAdapter::TOUCH_BEGAN, x, y);
-                    }
-                    _clientIDs[id] = osg::Vec2d(x, y);
-                }
-                
-                for ( std::map<unsigned int, osg::Vec2d>::iterator itr=lastIDs.begin();
-                      itr!=lastIDs.end(); ++itr )
-                {
-                    // Unset IDs are going to be removed this time
-                    double x = itr->second.x(), y = itr->second.y();
-                    if ( !touched ) touched = queue->touchEnded(itr->first, osgGA::GUIEventAdapter::TOUCH_ENDED, x, y, 1);
-                    else touched->addTouchPoint(itr->first, osgGA::GUIEventAdapter::TOUCH_ENDED, x, y, 1);
-                    _clientIDs.erase( itr->first );
-                }
-            }
+            if ( _queue->getDroppedEvents()!=_droppedEvents )
+                resynchronize( ea );
+            else
+                applyEvents( ea );
+            addTouchEvent( view->getEventQueue() );
             break;
         default: break;
         }
@@ -99,20 +53,773 @@ protected:
     {
         if ( _client )
         {
-            _client->removeTuioListener( _listener );
+            _client->removeTuioListener( _queue );
             _client->disconnect();
             delete _client;
         }
-        if ( _listener ) delete _listener;
+        if ( _queue ) delete _queue;
+    }
+    
+    struct Touch
+    {
+        osg::Vec2d position;
+        osgGA::GUIEventAdapter::TouchPhase phase;
+        long sessionId;
+        bool changed;
+        bool endPending;  // began and ended in this frame, so it ends in the next event
+    };
+    
+    osg::Vec2d toWindow( const TUIO::TuioEntity& e, const osgGA::GUIEventAdapter& ea ) const
+    {
+        return osg::Vec2d( 0.1 * e.x * ea.getWindowWidth() + ea.getWindowX(),
+                           0.1 * e.y * ea.getWindowHeight() + ea.getWindowY() );
+    }
+    
+    void beginTouch( Touch& touch, long sessionId, const osg::Vec2d& pos )
+    {
+        touch.phase = osgGA::GUIEventAdapter::TOUCH_BEGAN;
+        touch.position = pos;
+        touch.sessionId = sessionId;
+        touch.changed = true;
+        touch.endPending = false;
+    }
+    
+    void setTouch( unsigned int id, long sessionId, const osg::Vec2d& pos )
+    {
+        std::map<unsigned int, Touch>::iterator itr = _restartedTouches.find( id );
+        if ( itr!=_restartedTouches.end() )
+        {
+            itr->second.position = pos;
+            return;
+        }
+        
+        itr = _touches.find( id );
+        if ( itr!=_touches.end() && itr->second.changed &&
+             (itr->second.phase==osgGA::GUIEventAdapter::TOUCH_ENDED || itr->second.endPending) )
+        {
+            // The cursor was removed and added again in this frame, so end it first
+            beginTouch( _restartedTouches[id], sessionId, pos );
+        }
+        else if ( itr==_touches.end() )
+            beginTouch( _touches[id], sessionId, pos );
+        else
+        {
+            // A touch which began in this frame is reported as began anyway
+            Touch& touch = itr->second;
+            if ( touch.phase!=osgGA::GUIEventAdapter::TOUCH_BEGAN )
+                touch.phase = osgGA::GUIEventAdapter::TOUCH_MOVED;
+            touch.position = pos;
+            touch.changed = true;
+        }
+    }
+    
+    void endTouch( unsigned int id )
+    {
+        std::map<unsigned int, Touch>::iterator itr = _restartedTouches.find( id );
+        if ( itr==_restartedTouches.end() )
+        {
+            itr = _touches.find( id );
+            if ( itr==_touches.end() ) return;
+        }
+        
+        // A touch which began in this frame still begins, and ends in the next event
+        Touch& touch = itr->second;
+        if ( touch.changed && touch.phase==osgGA::GUIEventAdapter::TOUCH_BEGAN )
+            touch.endPending = true;
+        else
+        {
+            touch.phase = osgGA::GUIEventAdapter::TOUCH_ENDED;
+            touch.changed = true;
+        }
+    }
+    
+    void applyEvents( const osgGA::GUIEventAdapter& ea )
+    {
+        TUIO::TuioEvent event;
+        while ( _queue->pop(event) )
+        {
+            switch ( event.type )
+            {
+            case TUIO::TuioEvent::ADD_CURSOR:
+            case TUIO::TuioEvent::UPDATE_CURSOR:
+                setTouch( event.entity.id, event.entity.session_id, toWindow(event.entity, ea) );
+                break;
+            case TUIO::TuioEvent::REMOVE_CURSOR:
+                endTouch( event.entity.id );
+                break;
+            default: break;
+            }
+        }
+    }
+    
+    void resynchronize( const osgGA::GUIEventAdapter& ea )
+    {
+        // Some events were lost, so discard the rest and take the cursors from the client.
+        // Events recorded after the snapshot are applied again next frame, which is harmless
+        TUIO::TuioEvent event;
+        _droppedEvents = _queue->getDroppedEvents();
+        while ( _queue->pop(event) ) {}
+        
+        _client->getTuioCursors( _snapshot );
+        _restartedTouches.clear();
+        for ( std::map<unsigned int, Touch>::iterator itr=_touches.begin(); itr!=_touches.end(); ++itr )
+        {
+            itr->second.phase = osgGA::GUIEventAdapter::TOUCH_ENDED;
+            itr->second.endPending = false;
+        }
+        for ( unsigned int i=0; i<_snapshot.size(); ++i )
+        {
+            // A cursor ID may have been given to a new cursor meanwhile, which ends the old
+            // touch and begins a new one
+            std::map<unsigned int, Touch>::iterator itr = _touches.find( _snapshot[i].id );
+            if ( itr!=_touches.end() )
+            {
+                if ( itr->second.sessionId==_snapshot[i].session_id )
+                    itr->second.phase = osgGA::GUIEventAdapter::TOUCH_MOVED;
+                else
+                    itr->second.changed = true;
+            }
+            setTouch( _snapshot[i].id, _snapshot[i].session_id, toWindow(_snapshot[i], ea) );
+        }
+        for ( std::map<unsigned int, Touch>::iterator itr=_touches.begin(); itr!=_touches.end(); ++itr )
+        {
+            if ( itr->second.phase==osgGA::GUIEventAdapter::TOUCH_ENDED )
+                itr->second.changed = true;
+        }
+    }
+    
+    void addTouchEvent( osgGA::EventQueue* queue )
+    {
+        bool changed = false;
+        for ( std::map<unsigned int, Touch>::iterator itr=_touches.begin(); itr!=_touches.end(); ++itr )
+        {
+            if ( itr->second.changed ) { changed = true; break; }
+        }
+        if ( !changed ) return;
+        
+        // All touches go into one event so that manipulators see them together
+        osg::ref_ptr<osgGA::GUIEventAdapter> touched;
+        bool pending = false;
+        for ( std::map<unsigned int, Touch>::iterator itr=_touches.begin(); itr!=_touches.end(); )
+        {
+            Touch& touch = itr->second;
+            osgGA::GUIEventAdapter::TouchPhase phase =
+                touch.changed ? touch.phase : osgGA::GUIEventAdapter::TOUCH_STATIONARY;
+            double x = touch.position.x(), y = touch.position.y();
+            if ( touched.valid() )
+                touched->addTouchPoint( itr->first, phase, x, y, phase==osgGA::GUIEventAdapter::TOUCH_ENDED ? 1 : 0 );
+            else if ( phase==osgGA::GUIEventAdapter::TOUCH_BEGAN )
+                touched = queue->touchBegan( itr->first, phase, x, y );
+            else if ( phase==osgGA::GUIEventAdapter::TOUCH_ENDED )
+                touched = queue->touchEnded( itr->first, phase, x, y, 1 );
+            else
+                touched = queue->touchMoved( itr->first, phase, x, y );
+            
+            if ( phase==osgGA::GUIEventAdapter::TOUCH_ENDED )
+                _touches.erase( itr++ );
+            else if ( touch.endPending )
+            {
+                touch.phase = osgGA::GUIEventAdapter::TOUCH_ENDED;
+                touch.endPending = false;
+                pending = true; ++itr;
+            }
+            else
+            {
+                touch.phase = osgGA::GUIEventAdapter::TOUCH_STATIONARY;
+                touch.changed = false; ++itr;
+            }
+        }
+        
+        // Restarted cursors begin in a later event, after the old touch with their ID ended
+        for ( std::map<unsigned int, Touch>::iterator itr=_restartedTouches.begin(); itr!=_restartedTouches.end(); )
+        {
+            if ( _touches.insert(*itr).second )
+            {
+                _restartedTouches.erase( itr++ );
+                pending = true;
+            }
+            else ++itr;
+        }
+        if ( pending ) addTouchEvent( queue );
     }
     
-    std::map<unsigned int, osg::Vec2d> _clientIDs;
+    std::map<unsigned int, Touch> _touches;
+    std::map<unsigned int, Touch> _restartedTouches;
+    std::vector<TUIO::TuioEntity> _snapshot;
     TUIO::TuioClient* _client;
-    ClientListener* _listener;
+    TUIO::TuioEventQueue* _queue;
+    unsigned int _droppedEvents;
 };
 
+int runStressTest( int port, int numCursors, double rate, double seconds )
+{
+    TUIO::TuioEventQueue* queue = new TUIO::TuioEventQueue;
+    TUIO::TuioClient* client = new TUIO::TuioClient( port );
+    client->addTuioListener( queue );
+    client->connect();
+    
+    // Replay cursors circling on the surface over UDP loopback, and consume the events
+    // every third frame like a render thread running slower than the sensor
+    TUIO::TuioServer* server = new TUIO::TuioServer( "127.0.0.1", port );
+    std::vector<TUIO::TuioCursor*> cursors( numCursors );
+    std::vector<TUIO::TuioEntity> snapshot;
+    unsigned int numEvents[TUIO::TuioEvent::REFRESH + 1] = { 0 };
+    unsigned int maxCursors = 0;
+    
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    int numFrames = (int)(rate * seconds);
+    for ( int f=0; f<=numFrames+2; ++f )
+    {
+        server->initFrame( TUIO::TuioTime::getSessionTime() );
+        for ( int i=0; i<numCursors; ++i )
+        {
+            float angle = osg::PI * 2.0 * (i + f * 0.01) / numCursors;
+            float x = 0.5f + 0.4f * cosf(angle), y = 0.5f + 0.4f * sinf(angle);
+            if ( f==0 ) cursors[i] = server->addTuioCursor( x, y );
+            else if ( f<=numFrames ) server->updateTuioCursor( cursors[i], x, y );
+            else if ( f==numFrames+1 ) server->removeTuioCursor( cursors[i] );
+        }
+        server->commitFrame();
+        
+        if ( f%3==0 || f>numFrames )
+        {
+            TUIO::TuioEvent event;
+            while ( queue->pop(event) ) numEvents[event.type]++;
+            client->getTuioCursors( snapshot );
+            if ( snapshot.size()>maxCursors ) maxCursors = snapshot.size();
+        }
+        
+        // Keep the frame rate by the time since start instead of sleeping a fixed time
+        double next = (f + 1) / rate, now = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+        if ( next>now ) OpenThreads::Thread::microSleep( (unsigned int)((next - now) * 1e6) );
+    }
+    
+    OpenThreads::Thread::microSleep( 100000 );
+    TUIO::TuioEvent event;
+    while ( queue->pop(event) ) numEvents[event.type]++;
+    client->getTuioCursors( snapshot );
+    
+    double elapsed = osg::Timer::instance()->delta_s( start, osg::Timer::instance()->tick() );
+    std::cout << "Frames: " << numFrames << " in " << elapsed << "s"
+              << ", Added: " << numEvents[TUIO::TuioEvent::ADD_CURSOR]
+              << ", Updated: " << numEvents[TUIO::TuioEvent::UPDATE_CURSOR]
+              << " of " << numFrames * numCursors
+              << ", Removed: " << numEvents[TUIO::TuioEvent::REMOVE_CURSOR]
+              << ", Dropped: " << queue->getDroppedEvents()
+              << ", Max cursors: " << maxCursors
+              << ", Left: " << snapshot.size() << std::endl;
+    
+    bool ok = numEvents[TUIO::TuioEvent::ADD_CURSOR]==(unsigned int)numCursors &&
+              numEvents[TUIO::TuioEvent::REMOVE_CURSOR]==(unsigned int)numCursors && snapshot.empty();
+    delete server;
+    client->removeTuioListener( queue );
+    client->disconnect();
+    delete client;
+    delete queue;
+    return ok ? 0 : 1;
+}
+
+/** Writes the packets of a TuioServer to a file, each prefixed by its size */
+class RecordingSender : public TUIO::OscSender
+{
+public:
+    RecordingSender( std::ostream& out ) : _out(out) { buffer_size = MAX_UDP_SIZE; }
+    
+    virtual bool sendOscPacket( osc::OutboundPacketStream* bundle )
+    {
+        osc::int32 size = bundle->Size();
+        _out.write( (const char*)&size, sizeof(size) );
+        _out.write( bundle->Data(), size );
+        return true;
+    }
+    
+    virtual bool isConnected() { return _out.good(); }
+    
+protected:
+    std::ostream& _out;
+};
+
+/** Feeds recorded packets to the TuioClient directly */
+class ReplayReceiver : public TUIO::OscReceiver
+{
+public:
+    virtual void connect( bool lock ) { connected = true; }
+    virtual void disconnect() { connected = false; }
+};
+
+/** Counts the cursor events of a replay */
+class CountingListener : public TUIO::TuioListener
+{
+public:
+    CountingListener() : numAdded(0), numUpdated(0), numRemoved(0) {}
+    
+    virtual void addTuioObject( TUIO::TuioObject* ) {}
+    virtual void updateTuioObject( TUIO::TuioObject* ) {}
+    virtual void removeTuioObject( TUIO::TuioObject* ) {}
+    virtual void addTuioCursor( TUIO::TuioCursor* ) { numAdded++; }
+    virtual void updateTuioCursor( TUIO::TuioCursor* ) { numUpdated++; }
+    virtual void removeTuioCursor( TUIO::TuioCursor* ) { numRemoved++; }
+    virtual void addTuioBlob( TUIO::TuioBlob* ) {}
+    virtual void updateTuioBlob( TUIO::TuioBlob* ) {}
+    virtual void removeTuioBlob( TUIO::TuioBlob* ) {}
+    virtual void refresh( TUIO::TuioTime ) {}
+    
+    unsigned int numAdded, numUpdated, numRemoved;
+};
+
+int recordCursors( const std::string& file, int numCursors, int numFrames )
+{
+    std::ofstream out( file.c_str(), std::ios::out|std::ios::binary );
+    if ( !out )
+    {
+        OSG_NOTICE << "Can't write " << file << std::endl;
+        return 1;
+    }
+    
+    RecordingSender* sender = new RecordingSender( out );
+    TUIO::TuioServer* server = new TUIO::TuioServer( sender );
+    std::vector<TUIO::TuioCursor*> cursors( numCursors );
+    for ( int f=0; f<=numFrames+1; ++f )
+    {
+        server->initFrame( TUIO::TuioTime::getSessionTime() );
+        for ( int i=0; i<numCursors; ++i )
+        {
+            float angle = osg::PI * 2.0 * (i + f * 0.01) / numCursors;
+            float x = 0.5f + 0.4f * cosf(angle), y = 0.5f + 0.4f * sinf(angle);
+            if ( f==0 ) cursors[i] = server->addTuioCursor( x, y );
+            else if ( f<=numFrames ) server->updateTuioCursor( cursors[i], x, y );
+            else server->removeTuioCursor( cursors[i] );
+        }
+        server->commitFrame();
+    }
+    delete server;
+    delete sender;
+    return 0;
+}
+
+osc::uint32 decodeMessage( const osc::ReceivedMessage& msg )
+{
+    // Add up the bits of all 32 bit arguments, as tracking speeds may be NaN
+    osc::uint32 sum = 0;
+    for ( osc::ReceivedMessage::const_iterator a=msg.ArgumentsBegin(); a!=msg.ArgumentsEnd(); ++a )
+    {
+        if ( a->IsFloat() ) { float v = a->AsFloatUnchecked(); osc::uint32 bits; memcpy( &bits, &v, 4 ); sum += bits; }
+        else if ( a->IsInt32() ) sum += (osc::uint32)a->AsInt32Unchecked();
+    }
+    return sum;
+}
+
+osc::uint32 decodeElement( const osc::ReceivedPacket& p )
+{
+    if ( !p.IsBundle() ) return decodeMessage( osc::ReceivedMessage(p) );
+    
+    osc::uint32 sum = 0;
+    osc::ReceivedBundle bundle( p );
+    for ( osc::ReceivedBundle::const_iterator e=bundle.ElementsBegin(); e!=bundle.ElementsEnd(); ++e )
+    {
+        if ( e->IsBundle() ) sum += decodeElement( osc::ReceivedPacket(e->Contents(), e->Size()) );
+        else sum += decodeMessage( osc::ReceivedMessage(*e) );
+    }
+    return sum;
+}
+
+osc::uint32 decodeBulk( const char* data, osc::int32 size, osc::BulkPacketReader& reader,
+                        std::vector<osc::BulkMessage>& messages )
+{
+    osc::uint32 sum = 0, values[16];
+    reader.Read( data, size, messages );
+    for ( unsigned int i=0; i<messages.size(); ++i )
+    {
+        const char* types = messages[i].typeTags;
+        const char* args = messages[i].arguments;
+        if ( *types=='s' ) { args = osc::SkipStringArgument(args); types++; }
+        
+        // TUIO messages only carry 32 bit arguments after the command
+        for ( int count=strlen(types); count>0; count-=16, types+=16, args+=64 )
+        {
+            int n = osg::minimum( count, 16 );
+            osc::ReadInt32Block( args, (osc::int32*)values, n );
+            for ( int j=0; j<n; ++j )
+            {
+                if ( types[j]=='f' || types[j]=='i' ) sum += values[j];
+            }
+        }
+    }
+    return sum;
+}
+
+double replayPackets( const std::vector<char>& data, bool bulk, CountingListener& listener )
+{
+    ReplayReceiver receiver;
+    receiver.setBulkParsing( bulk );
+    TUIO::TuioClient client( &receiver );
+    client.addTuioListener( &listener );
+    client.connect();
+    
+    IpEndpointName endpoint;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for ( unsigned int pos=0; pos+sizeof(osc::int32)<=data.size(); )
+    {
+        osc::int32 size = 0;
+        memcpy( &size, &data[pos], sizeof(size) );
+        pos += sizeof(size);
+        if ( size<=0 || pos+size>data.size() ) break;
+        
+        receiver.ProcessPacket( &data[pos], size, endpoint );
+        pos += size;
+    }
+    double elapsed = osg::Timer::instance()->delta_s( start, osg::Timer::instance()->tick() );
+    client.disconnect();
+    return elapsed;
+}
+
+int runParseBenchmark( const std::string& file )
+{
+    std::ifstream in( file.c_str(), std::ios::in|std::ios::binary );
+    if ( !in )
+    {
+        OSG_NOTICE << "Can't read " << file << std::endl;
+        return 1;
+    }
+    std::vector<char> data( (std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>() );
+    
+    // Decode the arguments of all packets only, first by iterating the received elements
+    // and then by the bulk reader. Both have to see the same values
+    std::vector<std::pair<const char*, osc::int32> > packets;
+    for ( unsigned int pos=0; pos+sizeof(osc::int32)<=data.size(); )
+    {
+        osc::int32 size = 0;
+        memcpy( &size, &data[pos], sizeof(size) );
+        pos += sizeof(size);
+        if ( size<=0 || pos+size>data.size() ) break;
+        packets.push_back( std::pair<const char*, osc::int32>(&data[pos], size) );
+        pos += size;
+    }
+    
+    osc::BulkPacketReader reader;
+    std::vector<osc::BulkMessage> messages;
+    osc::uint32 streamSum = 0, bulkSum = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for ( unsigned int i=0; i<packets.size(); ++i )
+        streamSum += decodeElement( osc::ReceivedPacket(packets[i].first, packets[i].second) );
+    osg::Timer_t middle = osg::Timer::instance()->tick();
+    for ( unsigned int i=0; i<packets.size(); ++i )
+        bulkSum += decodeBulk( packets[i].first, packets[i].second, reader, messages );
+    osg::Timer_t end = osg::Timer::instance()->tick();
+    
+    // Then decode them by the TuioClient, which has to report the same events
+    CountingListener streamCounts, bulkCounts;
+    double streamTime = replayPackets( data, false, streamCounts );
+    double bulkTime = replayPackets( data, true, bulkCounts );
+    std::cout << "Packets: " << packets.size() << ", bytes: " << data.size()
+              << ", Added: " << bulkCounts.numAdded << ", Updated: " << bulkCounts.numUpdated
+              << ", Removed: " << bulkCounts.numRemoved << std::endl
+              << "Decoding: stream " << osg::Timer::instance()->delta_s(start, middle)
+              << "s, bulk " << osg::Timer::instance()->delta_s(middle, end) << "s" << std::endl
+              << "TuioClient: stream " << streamTime << "s, bulk " << bulkTime << "s" << std::endl;
+    
+    bool ok = streamSum==bulkSum && streamCounts.numAdded==bulkCounts.numAdded &&
+              streamCounts.numUpdated==bulkCounts.numUpdated && streamCounts.numRemoved==bulkCounts.numRemoved;
+    return ok ? 0 : 1;
+}
+
+int runPacketCheck()
+{
+    // Packets which the bulk reader once got wrong
+    struct Packet { const char* name; const char* data; int size; };
+    static const Packet packets[] =
+    {
+        // The command string is padded by garbage, so skipping it word by word used to run
+        // beyond the packet. It is now rejected like the received message iterator does
+        { "garbage padded string", "/tuio/2Dcur\0,si\0alive\0XY\0\0\0\7", 28 },
+        { "zero padded string", "/tuio/2Dcur\0,si\0alive\0\0\0\0\0\0\7", 28 }
+    };
+    
+    bool ok = true;
+    osc::BulkPacketReader reader;
+    std::vector<osc::BulkMessage> messages;
+    for ( unsigned int i=0; i<sizeof(packets) / sizeof(Packet); ++i )
+    {
+        // Put each packet at the end of a buffer of its own, so that valgrind or
+        // AddressSanitizer notice any read beyond it
+        osc::int32 size = packets[i].size;
+        std::vector<char> data( sizeof(size) );
+        memcpy( &data[0], &size, sizeof(size) );
+        data.insert( data.end(), packets[i].data, packets[i].data + size );
+        const char* packet = &data[sizeof(size)];
+        
+        // Both decoders have to accept or reject the packet alike
+        bool streamValid = true, bulkValid = true;
+        osc::uint32 streamSum = 0, bulkSum = 0;
+        try { streamSum = decodeElement( osc::ReceivedPacket(packet, size) ); }
+        catch ( osc::Exception& ) { streamValid = false; }
+        try { bulkSum = decodeBulk( packet, size, reader, messages ); }
+        catch ( osc::Exception& ) { bulkValid = false; }
+        
+        // Then the TuioClient gets it, which only uses the bulk reader's validation
+        CountingListener counts;
+        replayPackets( data, true, counts );
+        
+        bool same = streamValid==bulkValid && streamSum==bulkSum;
+        std::cout << packets[i].name << ": stream " << (streamValid ? "valid" : "rejected")
+                  << ", bulk " << (bulkValid ? "valid" : "rejected") << (same ? "" : ", MISMATCH") << std::endl;
+        ok = ok && same;
+    }
+    return ok ? 0 : 1;
+}
+
+/** Receives the benchmark packets of runUdpBenchmark() and measures their latency */
+class BenchmarkReceiver : public TUIO::UdpReceiver
+{
+public:
+    BenchmarkReceiver( int port )
+    :   TUIO::UdpReceiver(port), numPackets(0), numLost(0), numBytes(0),
+        totalLatency(0.0), maxLatency(0.0), _nextSequence(0) {}
+    
+    virtual void ProcessPacket( const char* data, int size, const IpEndpointName& remoteEndpoint )
+    {
+        try
+        {
+            osc::ReceivedMessage message( osc::ReceivedPacket(data, size) );
+            osc::ReceivedMessageArgumentStream args = message.ArgumentStream();
+            osc::int32 sequence = 0; double sent = 0.0;
+            args >> sequence >> sent;
+            
+            double latency = osg::Timer::instance()->time_u() - sent;
+            totalLatency += latency;
+            if ( latency>maxLatency ) maxLatency = latency;
+            if ( sequence>_nextSequence ) numLost += sequence - _nextSequence;
+            _nextSequence = sequence + 1;
+            numPackets++; numBytes += size;
+        }
+        catch ( osc::Exception& e )
+        { OSG_NOTICE << "Invalid benchmark packet: " << e.what() << std::endl; }
+    }
+    
+    unsigned int numPackets, numLost;
+    double numBytes, totalLatency, maxLatency;
+    
+protected:
+    osc::int32 _nextSequence;
+};
+
+int runUdpBenchmark( int port, double seconds, double rate, int packetsPerFrame,
+                     int packetSize, int socketBufferSize )
+{
+    packetSize = osg::clampBetween( packetSize, 0, MAX_UDP_SIZE - 64 );
+    std::vector<char> padding( packetSize );
+    std::vector<char> buffer( MAX_UDP_SIZE );
+    osc::OutboundPacketStream packet( &buffer[0], buffer.size() );
+    
+    // Send the same frames packet by packet and then in batches, rate 0 sends as fast as possible
+    int batchSizes[2] = { 1, UDP_BATCH_SIZE };
+    for ( int b=0; b<2; ++b )
+    {
+        BenchmarkReceiver* receiver = new BenchmarkReceiver( port );
+        if ( socketBufferSize>0 ) receiver->setSocketBufferSize( socketBufferSize );
+        receiver->connect();
+        
+        TUIO::UdpSender* sender = new TUIO::UdpSender( "127.0.0.1", port );
+        if ( socketBufferSize>0 ) sender->setSocketBufferSize( socketBufferSize );
+        sender->setBatchSize( batchSizes[b] );
+        
+        osc::int32 sequence = 0;
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        for ( int f=0; ; ++f )
+        {
+            double now = osg::Timer::instance()->delta_s( start, osg::Timer::instance()->tick() );
+            if ( now>=seconds ) break;
+            if ( rate>0.0 && f/rate>now ) OpenThreads::Thread::microSleep( (unsigned int)((f/rate - now) * 1e6) );
+            
+            for ( int i=0; i<packetsPerFrame; ++i )
+            {
+                packet.Clear();
+                packet << osc::BeginMessage( "/bench" ) << sequence++ << osg::Timer::instance()->time_u()
+                       << osc::Blob( &padding[0], packetSize ) << osc::EndMessage;
+                sender->sendOscPacket( &packet );
+            }
+            sender->flush();
+        }
+        double elapsed = osg::Timer::instance()->delta_s( start, osg::Timer::instance()->tick() );
+        delete sender;
+        
+        OpenThreads::Thread::microSleep( 100000 );
+        receiver->disconnect();
+        std::cout << "Batch size " << batchSizes[b] << ": sent " << sequence << " packets in " << elapsed << "s"
+                  << ", received " << receiver->numPackets << ", lost " << receiver->numLost
+                  << ", " << receiver->numBytes / (elapsed * 1024.0 * 1024.0) << " MB/s"
+                  << ", latency " << (receiver->numPackets>0 ? receiver->totalLatency / receiver->numPackets : 0.0)
+                  << "us average, " << receiver->maxLatency << "us max" << std::endl;
+        delete receiver;
+    }
+    return 0;
+}
+
+/** Counts the packets and bytes a TuioServer delivers through another sender */
+class CountingSender : public TUIO::OscSender
+{
+public:
+    CountingSender( TUIO::OscSender* sender )
+    :   numPackets(0), numBytes(0.0), _sender(sender)
+    { buffer_size = sender->getBufferSize(); local = sender->isLocal(); }
+    
+    virtual bool sendOscPacket( osc::OutboundPacketStream* bundle )
+    {
+        numPackets++; numBytes += bundle->Size();
+        return _sender->sendOscPacket( bundle );
+    }
+    
+    virtual bool isConnected() { return _sender->isConnected(); }
+    virtual void flush() { _sender->flush(); }
+    
+    unsigned int numPackets;
+    double numBytes;
+    
+protected:
+    TUIO::OscSender* _sender;
+};
+
+int runServerBenchmark( int port, int numObjects, int numMoving, int numFrames, double rate )
+{
+    numMoving = osg::clampBetween( numMoving, 0, numObjects );
+    
+    // Run the same session with full updates of all objects and with updates of the changed ones only
+    bool fullUpdates[2] = { true, false };
+    bool ok = true;
+    for ( int u=0; u<2; ++u )
+    {
+        TUIO::TuioEventQueue* queue = new TUIO::TuioEventQueue( 65536 );
+        TUIO::TuioClient* client = new TUIO::TuioClient( port );
+        client->addTuioListener( queue );
+        client->connect();
+        
+        TUIO::UdpSender* udpSender = new TUIO::UdpSender( "127.0.0.1", port );
+        CountingSender* sender = new CountingSender( udpSender );
+        TUIO::TuioServer* server = new TUIO::TuioServer( sender );
+        if ( fullUpdates[u] ) server->enableFullUpdate();
+        sender->numPackets = 0; sender->numBytes = 0.0;
+        
+        // Some objects move each frame and are updated twice like by a tracker refining its
+        // estimate, and every 50th frame one object leaves the table and another one arrives
+        std::vector<TUIO::TuioObject*> objects( numObjects );
+        double serverTime = 0.0, maxServerTime = 0.0;
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        for ( int f=0; f<=numFrames; ++f )
+        {
+            osg::Timer_t frameStart = osg::Timer::instance()->tick();
+            server->initFrame( TUIO::TuioTime::getSessionTime() );
+            if ( f==0 )
+            {
+                for ( int i=0; i<numObjects; ++i )
+                    objects[i] = server->addTuioObject( i, (i % 25) / 25.0f, (i / 25) / 25.0f, 0.0f );
+            }
+            else
+            {
+                for ( int j=0; j<numMoving; ++j )
+                {
+                    int i = (j + f * numMoving) % numObjects;
+                    float x = (i % 25) / 25.0f + 0.01f * sinf(f * 0.1f), y = (i / 25) / 25.0f;
+                    server->updateTuioObject( objects[i], x - 0.001f, y, f * 0.01f );
+                    server->updateTuioObject( objects[i], x, y, f * 0.01f );
+                }
+                
+                if ( f%50==0 )
+                {
+                    int i = (f / 50) % numObjects;
+                    server->removeTuioObject( objects[i] );
+                    objects[i] = server->addTuioObject( i, (i % 25) / 25.0f, (i / 25) / 25.0f, 0.0f );
+                }
+            }
+            server->commitFrame();
+            
+            double frameTime = osg::Timer::instance()->delta_s( frameStart, osg::Timer::instance()->tick() );
+            serverTime += frameTime;
+            if ( frameTime>maxServerTime ) maxServerTime = frameTime;
+            
+            TUIO::TuioEvent event;
+            while ( queue->pop(event) ) {}
+            
+            double next = (f + 1) / rate, now = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+            if ( next>now ) OpenThreads::Thread::microSleep( (unsigned int)((next - now) * 1e6) );
+        }
+        
+        // The client has to end up with the final state of all objects
+        OpenThreads::Thread::microSleep( 100000 );
+        std::vector<TUIO::TuioEntity> snapshot;
+        client->getTuioObjects( snapshot );
+        std::map<long, TUIO::TuioEntity> received;
+        for ( unsigned int i=0; i<snapshot.size(); ++i ) received[snapshot[i].session_id] = snapshot[i];
+        
+        unsigned int numMismatched = 0;
+        for ( int i=0; i<numObjects; ++i )
+        {
+            std::map<long, TUIO::TuioEntity>::iterator itr = received.find( objects[i]->getSessionID() );
+            if ( itr==received.end() || itr->second.x!=objects[i]->getX() || itr->second.y!=objects[i]->getY() ||
+                 itr->second.angle!=objects[i]->getAngle() ) numMismatched++;
+        }
+        
+        std::cout << (fullUpdates[u] ? "Full updates" : "Delta updates") << ": " << numFrames << " frames of "
+                  << numObjects << " objects, " << numMoving << " moving"
+                  << ", server " << serverTime * 1e6 / (numFrames + 1) << "us per frame, "
+                  << maxServerTime * 1e6 << "us max"
+                  << ", " << sender->numBytes / (numFrames + 1) << " bytes and "
+                  << (double)sender->numPackets / (numFrames + 1) << " packets per frame"
+                  << ", client objects " << snapshot.size() << ", mismatched " << numMismatched
+                  << ", dropped events " << queue->getDroppedEvents() << std::endl;
+        if ( numMismatched>0 || snapshot.size()!=(unsigned int)numObjects ) ok = false;
+        
+        server->resetTuioObjects();
+        delete server;
+        delete sender;
+        delete udpSender;
+        client->removeTuioListener( queue );
+        client->disconnect();
+        delete client;
+        delete queue;
+    }
+    return ok ? 0 : 1;
+}
+
 int main( int argc, char** argv )
 {
+    // Headless stress test over UDP loopback, e.g. --stress 10 --cursors 200 --rate 200
+    osg::ArgumentParser arguments( &argc, argv );
+    int port = 3333, numCursors = 200;
+    double seconds = 0.0, rate = 200.0;
+    arguments.read( "--port", port );
+    arguments.read( "--cursors", numCursors );
+    arguments.read( "--rate", rate );
+    if ( arguments.read("--stress", seconds) )
+        return runStressTest( port, numCursors, rate, seconds );
+    
+    // UDP loopback benchmark of single and batched sends, e.g. --udp-bench 5 --rate 0 --packets 8
+    int packetsPerFrame = 8, packetSize = 1024, socketBufferSize = 0;
+    arguments.read( "--packets", packetsPerFrame );
+    arguments.read( "--packet-size", packetSize );
+    arguments.read( "--socket-buffer", socketBufferSize );
+    if ( arguments.read("--udp-bench", seconds) )
+        return runUdpBenchmark( port, seconds, rate, packetsPerFrame, packetSize, socketBufferSize );
+    
+    // Decoding benchmark of recorded bundles, e.g. --record cursors.tuio --frames 2000, then --parse cursors.tuio
+    std::string file;
+    int numFrames = 2000;
+    arguments.read( "--frames", numFrames );
+    if ( arguments.read("--record", file) )
+        return recordCursors( file, numCursors, numFrames );
+    if ( arguments.read("--parse", file) )
+        return runParseBenchmark( file );
+    
+    // Decoding of packets which were malformed in tricky ways, e.g. --check-packets
+    if ( arguments.read("--check-packets") )
+        return runPacketCheck();
+    
+    // Encoding benchmark of a crowded table over UDP loopback, e.g. --server-bench 2000 --objects 500 --moving 50
+    int numObjects = 500, numMoving = 50;
+    arguments.read( "--objects", numObjects );
+    arguments.read( "--moving", numMoving );
+    if ( arguments.read("--server-bench", numFrames) )
+        return runServerBenchmark( port, numObjects, numMoving, numFrames, rate );
+    
     osg::ref_ptr<osg::MatrixTransform> scene = new osg::MatrixTransform;
     scene->addChild( osgDB::readNodeFile("cow.osg") );
     
@@ -120,7 +827,7 @@ int main( int argc, char** argv )
     viewer.addEventHandler( new osgGA::StateSetManipulator(viewer.getCamera()->getOrCreateStateSet()) );
     viewer.addEventHandler( new osgViewer::StatsHandler );
     viewer.addEventHandler( new osgViewer::WindowSizeHandler );
-    viewer.addEventHandler( new TUIOClientHandler(3333) );
+    viewer.addEventHandler( new TUIOClientHandler(port) );
     viewer.setCameraManipulator( new osgGA::MultiTouchTrackballManipulator );
     viewer.setSceneData( scene.get() );
     return viewer.run();